@@ -2,7 +2,9 @@
 #include "cfgo/defer.hpp"
 #include "cfgo/utils.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/metrics.hpp"
 #include "spdlog/spdlog.h"
+#include <atomic>
 #include <list>
 #include <chrono>
 
@@ -10,11 +12,87 @@ namespace cfgo
 {
     close_chan INVALID_CLOSE_CHAN {nullptr};
 
+    namespace detail
+    {
+        struct AsyncMetrics
+        {
+            metrics::CounterPtr mutex_immediate;
+            metrics::CounterPtr mutex_contended;
+            metrics::CounterPtr mutex_canceled;
+            metrics::CounterPtr signal_canceled;
+            metrics::CounterPtr signal_timeout;
+            metrics::CounterPtr error_canceled;
+            metrics::CounterPtr error_timeout;
+
+            AsyncMetrics()
+            {
+                auto & registry = metrics::Registry::instance();
+                const char * mutex_help = "The acquires of the AsyncMutex, immediate ones got the lock without waiting.";
+                mutex_immediate = registry.counter("cfgo_async_mutex_acquires_total", mutex_help, { .category = "immediate" });
+                mutex_contended = registry.counter("cfgo_async_mutex_acquires_total", mutex_help, { .category = "contended" });
+                mutex_canceled = registry.counter("cfgo_async_mutex_acquires_total", mutex_help, { .category = "canceled" });
+                const char * signal_help = "The close signals closed, including the children closed with their parents.";
+                signal_canceled = registry.counter("cfgo_close_signals_closed_total", signal_help, { .category = "cancel" });
+                signal_timeout = registry.counter("cfgo_close_signals_closed_total", signal_help, { .category = "timeout" });
+                const char * error_help = "The CancelError created.";
+                error_canceled = registry.counter("cfgo_cancel_errors_total", error_help, { .category = "cancel" });
+                error_timeout = registry.counter("cfgo_cancel_errors_total", error_help, { .category = "timeout" });
+            }
+        };
+
+        static const AsyncMetrics & async_metrics()
+        {
+            // never destroyed, the primitives may still be used by the other static objects on exit.
+            static const AsyncMetrics & metrics = *new AsyncMetrics {};
+            return metrics;
+        }
+
+        #if DEBUG
+        static std::atomic_uint32_t g_cancel_trace_sampling {64};
+        #else
+        static std::atomic_uint32_t g_cancel_trace_sampling {0};
+        #endif
+    } // namespace detail
+
+    void set_cancel_trace_sampling(std::uint32_t n) noexcept
+    {
+        detail::g_cancel_trace_sampling.store(n, std::memory_order_relaxed);
+    }
+
+    std::uint32_t get_cancel_trace_sampling() noexcept
+    {
+        return detail::g_cancel_trace_sampling.load(std::memory_order_relaxed);
+    }
+
+    bool sample_cancel_trace() noexcept
+    {
+        auto n = detail::g_cancel_trace_sampling.load(std::memory_order_relaxed);
+        if (n == 0)
+        {
+            return false;
+        }
+        // per thread, so the sampling never contends between the threads.
+        thread_local std::uint32_t counter = 0;
+        if (++counter >= n)
+        {
+            counter = 0;
+            return true;
+        }
+        return false;
+    }
+
     CancelError::CancelError(std::string&& message, Reason reason, bool trace) noexcept:
-        cpptrace::exception_with_message(std::move(message), trace ? cpptrace::detail::get_raw_trace_and_absorb() : cpptrace::raw_trace{}),
+        // trace is updated by the sampling before m_trace is initialized.
+        cpptrace::exception_with_message(
+            std::move(message),
+            (trace = trace || sample_cancel_trace()) ? cpptrace::detail::get_raw_trace_and_absorb() : cpptrace::raw_trace{}
+        ),
         m_reason(reason),
         m_trace(trace)
-    {}
+    {
+        auto & metrics = detail::async_metrics();
+        (reason == TIMEOUT ? metrics.error_timeout : metrics.error_canceled)->inc();
+    }
 
     CancelError::CancelError(Reason reason, bool trace) noexcept: CancelError("", reason, trace)
     {}
@@ -74,6 +152,7 @@ namespace cfgo
         bool success = false;
         busy_chan ch{};
         bool ch_added = false;
+        auto & metrics = detail::async_metrics();
         while (true)
         {
             {
@@ -95,11 +174,14 @@ namespace cfgo
             }
             if (success)
             {
+                (ch_added ? metrics.mutex_contended : metrics.mutex_immediate)->inc();
                 co_return true;
             }
+            event_trace::Span span(event_trace::Event::MUTEX_WAIT, this);
             auto &&result = co_await chan_read<void>(ch, close_chan);
             if (result.is_canceled())
             {
+                metrics.mutex_canceled->inc();
                 co_return false;
             }
         }
@@ -249,6 +331,8 @@ namespace cfgo
             m_stop = false;
             m_close_reason = std::move(reason);
             m_is_timeout = is_timeout;
+            (is_timeout ? async_metrics().signal_timeout : async_metrics().signal_canceled)->inc();
+            event_trace::record(event_trace::Event::CLOSE, event_trace::Phase::INSTANT, this, is_timeout ? 1 : 0);
             m_timeout = duration_t {0};
             if (m_timer)
             {
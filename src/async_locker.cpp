@@ -1,7 +1,11 @@
 #include "cfgo/async_locker.hpp"
 #include "cfgo/async.hpp"
 #include "cfgo/log.hpp"
-#include <list>
+#include "cfgo/metrics.hpp"
+#include <set>
+#include <map>
+#include <chrono>
+#include <unordered_map>
 #include <memory>
 #include <algorithm>
 #include <limits>
@@ -10,11 +14,35 @@ namespace cfgo
 {
     namespace detail
     {
+        struct BlockerMetrics
+        {
+            metrics::CounterPtr by_batch;
+            metrics::CounterPtr by_deadline;
+            metrics::CounterPtr by_timeout;
+            metrics::HistogramPtr queue_delay;
+
+            BlockerMetrics()
+            {
+                auto & registry = metrics::Registry::instance();
+                const char * flushes_help = "The flushes of all the blocker managers by the reason.";
+                by_batch = registry.counter("cfgo_async_blocker_flushes_total", flushes_help, { .category = "batch" });
+                by_deadline = registry.counter("cfgo_async_blocker_flushes_total", flushes_help, { .category = "deadline" });
+                by_timeout = registry.counter("cfgo_async_blocker_flushes_total", flushes_help, { .category = "timeout" });
+                queue_delay = registry.histogram("cfgo_async_blocker_queue_delay_seconds", "The time from a blocker blocked to its flush.");
+            }
+        };
+
+        static const BlockerMetrics & blocker_metrics()
+        {
+            static const BlockerMetrics & metrics = *new BlockerMetrics {};
+            return metrics;
+        }
+
         class AsyncBlockerManager;
         class AsyncBlocker
         {
         public:
-            AsyncBlocker(std::uint32_t id): m_id(id), m_user_data(nullptr) {}
+            AsyncBlocker(std::uint32_t id, const unique_void_chan & blocked_notify): m_id(id), m_blocked_notify(blocked_notify), m_user_data(nullptr) {}
             AsyncBlocker(const AsyncBlocker &) = delete;
             AsyncBlocker & operator = (const AsyncBlocker &) = delete;
             bool need_block() const noexcept;
@@ -41,12 +69,17 @@ namespace cfgo
             mutex m_mutex;
             unique_void_chan m_request_chan;
             unique_void_chan m_response_chan;
+            // shared with the manager, notified once blocked.
+            unique_void_chan m_blocked_notify;
+            std::chrono::steady_clock::time_point m_blocked_at;
             std::variant<std::nullptr_t, std::shared_ptr<void>, std::int64_t, double, std::string> m_user_data;
 
             bool request_block();
             bool request_unblock();
             auto sync(const close_chan & closer) -> asio::awaitable<bool>;
             auto await_unblock(const close_chan & closer) -> asio::awaitable<bool>;
+            auto await_request(const close_chan & closer) -> asio::awaitable<bool>;
+            std::chrono::steady_clock::time_point blocked_at();
 
             friend class AsyncBlockerManager;
         };
@@ -143,7 +176,9 @@ namespace cfgo
                         if (m_block)
                         {
                             m_blocked = true;
+                            m_blocked_at = std::chrono::steady_clock::now();
                             chan_maybe_write(m_response_chan);
+                            chan_maybe_write(m_blocked_notify);
                         }
                         else
                         {
@@ -159,6 +194,32 @@ namespace cfgo
             co_return true;
         }
 
+        auto AsyncBlocker::await_request(const close_chan & closer) -> asio::awaitable<bool>
+        {
+            do
+            {
+                {
+                    std::lock_guard g(m_mutex);
+                    if (m_block)
+                    {
+                        break;
+                    }
+                }
+                if (!co_await chan_read<void>(m_request_chan, closer))
+                {
+                    co_return false;
+                }
+            } while (true);
+            co_return true;
+        }
+
+        // only called by manager
+        std::chrono::steady_clock::time_point AsyncBlocker::blocked_at()
+        {
+            std::lock_guard g(m_mutex);
+            return m_blocked_at;
+        }
+
         std::uint32_t AsyncBlocker::id() const noexcept
         {
             return m_id;
@@ -238,9 +299,9 @@ namespace cfgo
         {
         public:
             using ScheduleConfigure = cfgo::AsyncBlockerManager::Configure;
+            using Statistics = cfgo::AsyncBlockerManager::Statistics;
             struct BlockerRequest
             {
-                std::uint32_t m_id;
                 int m_priority;
                 unique_chan<AsyncBlockerPtr> m_chan;
             };
@@ -253,6 +314,27 @@ namespace cfgo
                 bool m_valid;
             };
 
+            // the schedule order. higher priority first, then the one served least recently, then the older one.
+            struct BlockerKey
+            {
+                int m_priority;
+                std::uint32_t m_epoch;
+                std::uint32_t m_id;
+
+                bool operator < (const BlockerKey & other) const noexcept
+                {
+                    if (m_priority != other.m_priority)
+                    {
+                        return m_priority > other.m_priority;
+                    }
+                    if (m_epoch != other.m_epoch)
+                    {
+                        return m_epoch < other.m_epoch;
+                    }
+                    return m_id < other.m_id;
+                }
+            };
+
             AsyncBlockerManager(const ScheduleConfigure & configure);
             AsyncBlockerManager(const AsyncBlockerManager &) = delete;
             AsyncBlockerManager & operator = (const AsyncBlockerManager &) = delete;
@@ -262,9 +344,10 @@ namespace cfgo
             void collect_locked_blocker(std::vector<cfgo::AsyncBlocker> & blockers);
             auto add_blocker(int priority, const close_chan & closer) -> asio::awaitable<AsyncBlockerPtr>;
             auto wait_blocker(std::uint32_t id, const close_chan & closer) -> asio::awaitable<void>;
+            auto wait_block_request(std::uint32_t id, const close_chan & closer) -> asio::awaitable<void>;
             void remove_blocker(std::uint32_t id);
+            Statistics statistics() const;
         protected:
-            auto _select_and_request_block(int n, close_chan closer) -> asio::awaitable<int>;
             std::uint32_t _calc_batch() const noexcept
             {
                 std::uint32_t n;
@@ -289,18 +372,76 @@ namespace cfgo
                 }
                 return n;
             }
+            static BlockerKey _key_of(const BlockerInfo & info) noexcept
+            {
+                return BlockerKey {info.m_priority, info.m_epoch, info.m_blocker->id()};
+            }
+            duration_t _queue_delay_of(int priority) const noexcept
+            {
+                auto iter = m_conf.priority_queue_delays.find(priority);
+                return iter != m_conf.priority_queue_delays.end() ? iter->second : m_conf.max_queue_delay;
+            }
+            void _insert_blocker(const AsyncBlockerPtr & blocker, int priority);
+            void _erase_blocker(std::uint32_t id);
+            enum FlushReason
+            {
+                FLUSH_BY_BATCH,
+                FLUSH_BY_DEADLINE,
+                FLUSH_BY_TIMEOUT,
+            };
+            auto _await_flush(std::uint32_t batch, const close_chan & closer) -> asio::awaitable<void>;
+            void _record_flush(FlushReason reason, std::chrono::steady_clock::time_point now);
         private:
             ScheduleConfigure m_conf;
-            std::list<BlockerInfo> m_blockers;
-            std::list<BlockerRequest> m_blocker_requests;
+            // id -> blocker, the references are stable, so they could be used outside of the lock while locked.
+            std::unordered_map<std::uint32_t, BlockerInfo> m_blockers;
+            std::set<BlockerKey> m_schedule;
+            // the blockers requested to block by the current lock, in schedule order.
+            std::vector<AsyncBlockerPtr> m_selected;
+            // the max queue delay of each selected blocker, zero means no deadline.
+            std::vector<duration_t> m_selected_delays;
+            // the blockers added or removed while locked, applied by unlock.
+            std::unordered_map<std::uint32_t, BlockerRequest> m_blocker_requests;
+            std::vector<std::uint32_t> m_removed;
             std::uint32_t m_next_id = 0;
+            // a blocker gets a new epoch when added and each time it is served, so it goes behind the others of its priority.
             std::uint32_t m_next_epoch = 0;
             bool m_locked = false;
             unique_void_chan m_ready_ch;
-            mutex m_mutex;
+            // written by the blockers once they are blocked.
+            unique_void_chan m_blocked_ch;
+            Statistics m_stats;
+            mutable mutex m_mutex;
         };
         
-        AsyncBlockerManager::AsyncBlockerManager(const ScheduleConfigure & configure): m_conf(configure) {}
+        AsyncBlockerManager::AsyncBlockerManager(const ScheduleConfigure & configure): m_conf(configure)
+        {
+            // 100us, 200us, 500us, 1ms, ..., 500ms, and the overflow bucket.
+            for (std::int64_t bound = 100; bound <= 500000; bound *= 10)
+            {
+                m_stats.queue_delay_bounds.push_back(std::chrono::microseconds {bound});
+                m_stats.queue_delay_bounds.push_back(std::chrono::microseconds {bound * 2});
+                m_stats.queue_delay_bounds.push_back(std::chrono::microseconds {bound * 5});
+            }
+            m_stats.queue_delays.resize(m_stats.queue_delay_bounds.size() + 1, 0);
+        }
+
+        void AsyncBlockerManager::_insert_blocker(const AsyncBlockerPtr & blocker, int priority)
+        {
+            auto [iter, _] = m_blockers.emplace(blocker->id(), BlockerInfo {blocker, m_next_epoch++, priority, true});
+            m_schedule.insert(_key_of(iter->second));
+        }
+
+        void AsyncBlockerManager::_erase_blocker(std::uint32_t id)
+        {
+            auto iter = m_blockers.find(id);
+            if (iter != m_blockers.end())
+            {
+                m_schedule.erase(_key_of(iter->second));
+                m_blockers.erase(iter);
+            }
+        }
+
         auto AsyncBlockerManager::add_blocker(int priority, const close_chan & closer) -> asio::awaitable<AsyncBlockerPtr>
         {
             auto self = shared_from_this();
@@ -312,8 +453,8 @@ namespace cfgo
                 bool not_enouth = _calc_batch() > m_blockers.size();
                 if (!m_locked)
                 {
-                    block_ptr = std::make_shared<AsyncBlocker>(m_next_id++);
-                    m_blockers.push_back({block_ptr, m_next_epoch++, priority, true});
+                    block_ptr = std::make_shared<AsyncBlocker>(m_next_id++, m_blocked_ch);
+                    _insert_blocker(block_ptr, priority);
                     if (not_enouth && _calc_batch() <= m_blockers.size())
                     {
                         chan_must_write(m_ready_ch);
@@ -322,7 +463,7 @@ namespace cfgo
                 else
                 {
                     id = m_next_id++;
-                    m_blocker_requests.push_back({id, priority, chan});
+                    m_blocker_requests.emplace(id, BlockerRequest {priority, chan});
                 }
             }
             if (block_ptr)
@@ -337,57 +478,38 @@ namespace cfgo
             else
             {
                 std::lock_guard lk(m_mutex);
-                auto req_iter = std::find_if(m_blocker_requests.begin(), m_blocker_requests.end(), [id](const BlockerRequest & request) -> bool {
-                    return request.m_id == id;
-                });
-                if (req_iter != m_blocker_requests.end())
+                if (m_blocker_requests.erase(id) > 0)
                 {
-                    m_blocker_requests.erase(req_iter);
                     throw CancelError(closer);
                 }
-                auto iter = std::find_if(m_blockers.begin(), m_blockers.end(), [id](const BlockerInfo & info) -> bool {
-                    return info.m_blocker->id() == id;
-                });
+                auto iter = m_blockers.find(id);
                 if (iter == m_blockers.end())
                 {
                     throw cpptrace::logic_error(THIS_IS_IMPOSSIBLE);
                 }
-                co_return iter->m_blocker;
+                co_return iter->second.m_blocker;
             }
         }
 
         void AsyncBlockerManager::remove_blocker(std::uint32_t id)
         {
             std::lock_guard lk(m_mutex);
-            m_blocker_requests.erase(
-                std::remove_if(m_blocker_requests.begin(), m_blocker_requests.end(), [id](const BlockerRequest & request) {
-                    return request.m_id == id;
-                }),
-                m_blocker_requests.end()
-            );
+            m_blocker_requests.erase(id);
             if (!m_locked)
             {
-                m_blockers.erase(
-                    std::remove_if(m_blockers.begin(), m_blockers.end(), [id](const BlockerInfo & info) {
-                        return info.m_blocker->id() == id;
-                    }),
-                    m_blockers.end()
-                );
+                _erase_blocker(id);
             }
             else
             {
-                auto iter = std::find_if(m_blockers.begin(), m_blockers.end(), [id](const BlockerInfo & info) {
-                    return info.m_blocker->id() == id;
-                });
-                if (iter != m_blockers.end())
+                auto iter = m_blockers.find(id);
+                if (iter != m_blockers.end() && iter->second.m_valid)
                 {
-                    iter->m_valid = false;
+                    iter->second.m_valid = false;
+                    m_removed.push_back(id);
                 }
             }
         }
 
-
-
         auto AsyncBlockerManager::lock(const close_chan & closer) -> asio::awaitable<void>
         {
             if (m_locked)
@@ -395,6 +517,7 @@ namespace cfgo
                 throw cpptrace::runtime_error("Already locked.");
             }
             auto self = shared_from_this();
+            event_trace::Span span(event_trace::Event::BLOCKER_LOCK, this);
             std::uint32_t batch;
             do
             {
@@ -416,80 +539,60 @@ namespace cfgo
             } while (true);
             try
             {
-                AsyncTasksAll<void> tasks(closer);
-                // After locked (m_locked == true), no blocker should be added to or removed from m_blockers, so we can copy refs of m_blockers outside of lock.
-                std::vector<std::reference_wrapper<BlockerInfo>> selects(m_blockers.begin(), m_blockers.end());
                 {
                     std::lock_guard lk(m_mutex);
-                    std::sort(selects.begin(), selects.end(), [](const BlockerInfo & b1, const BlockerInfo & b2) -> bool {
-                        if (b1.m_epoch == b2.m_epoch)
-                        {
-                            if (b1.m_priority == b2.m_priority)
-                            {
-                                return b1.m_blocker->id() < b2.m_blocker->id();
-                            }
-                            else
-                            {
-                                return b1.m_priority > b2.m_priority;
-                            }
-                        }
-                        else
-                        {
-                            return b1.m_epoch < b2.m_epoch;
-                        }
-                    });
-                    BlockerInfo & blocker_with_max_epoch = *std::max_element(selects.begin(), selects.end(), [](const BlockerInfo & b1, const BlockerInfo & b2) -> bool {
-                        return b1.m_epoch < b2.m_epoch;
-                    });
-                    std::uint32_t max_epoch = blocker_with_max_epoch.m_epoch;
-
-                    std::uint32_t n = 0;
-                    for (std::uint32_t i = 0; i < selects.size(); ++i)
+                    // request twice the batch in schedule order, so the ones which do not reach wait_blocker in time could be replaced.
+                    std::size_t n = std::min<std::size_t>(m_schedule.size(), (std::size_t) batch * 2);
+                    m_selected.clear();
+                    m_selected.reserve(n);
+                    m_selected_delays.clear();
+                    m_selected_delays.reserve(n);
+                    for (auto && key : m_schedule)
                     {
-                        BlockerInfo & blocker = selects[i];
-                        if (blocker.m_epoch == max_epoch)
-                        {
-                            ++n;
-                        }
-                        if (n > batch)
+                        if (m_selected.size() >= n)
                         {
                             break;
                         }
-                        tasks.add_task(fix_async_lambda([blocker = blocker.m_blocker, timeout = m_conf.block_timeout](close_chan closer) -> asio::awaitable<void> {
-                            auto child_closer = closer.create_child();
-                            child_closer.set_timeout(timeout);
-                            blocker->request_block();
-                            if (!co_await blocker->sync(child_closer))
-                            {
-                                blocker->request_unblock();
-                            }
-                        }));
+                        m_selected.push_back(m_blockers.at(key.m_id).m_blocker);
+                        m_selected_delays.push_back(_queue_delay_of(key.m_priority));
+                    }
+                }
+                // After locked (m_locked == true), m_selected is only changed by unlock, so we can use it outside of lock.
+                for (auto && blocker : m_selected)
+                {
+                    blocker->request_block();
+                }
+                co_await _await_flush(batch, closer);
+                for (auto && blocker : m_selected)
+                {
+                    if (!blocker->is_blocked())
+                    {
+                        blocker->request_unblock();
                     }
                 }
-                co_await tasks.await();
-                for (BlockerInfo & select : selects)
+                for (auto && blocker : m_selected)
                 {
-                    if (!co_await select.m_blocker->sync(closer))
+                    if (!co_await blocker->sync(closer))
                     {
                         throw CancelError(closer);
                     }
                 }
                 // unblock blockers exceed the plan.
-                int n_blocked = 0;
-                for (BlockerInfo & select : selects)
+                std::uint32_t n_blocked = 0;
+                for (auto && blocker : m_selected)
                 {
                     std::lock_guard lk(m_mutex);
-                    if (select.m_blocker->is_blocked())
+                    if (blocker->is_blocked())
                     {
                         if (++n_blocked > batch)
                         {
-                            select.m_blocker->request_unblock();
+                            blocker->request_unblock();
                         }
                     }
                 }
-                for (BlockerInfo & select : selects)
+                for (auto && blocker : m_selected)
                 {
-                    if (!co_await select.m_blocker->sync(closer))
+                    if (!co_await blocker->sync(closer))
                     {
                         throw CancelError(closer);
                     }
@@ -501,6 +604,110 @@ namespace cfgo
                 std::rethrow_exception(std::current_exception());
             }
         }
+
+        auto AsyncBlockerManager::_await_flush(std::uint32_t batch, const close_chan & closer) -> asio::awaitable<void>
+        {
+            using clock = std::chrono::steady_clock;
+            const auto start = clock::now();
+            const auto no_deadline = clock::time_point::max();
+            do
+            {
+                std::uint32_t n_blocked = 0;
+                // the earliest deadline of the blocked ones. It is the time the oldest request must be served.
+                auto deadline = no_deadline;
+                for (std::size_t i = 0; i < m_selected.size(); ++i)
+                {
+                    auto & blocker = m_selected[i];
+                    if (blocker->is_blocked())
+                    {
+                        ++n_blocked;
+                        if (m_selected_delays[i] != duration_t {0})
+                        {
+                            deadline = std::min(deadline, blocker->blocked_at() + m_selected_delays[i]);
+                        }
+                    }
+                }
+                auto now = clock::now();
+                if (n_blocked >= batch)
+                {
+                    _record_flush(FLUSH_BY_BATCH, now);
+                    co_return;
+                }
+                if (n_blocked >= m_conf.min_batch && deadline <= now)
+                {
+                    _record_flush(FLUSH_BY_DEADLINE, now);
+                    co_return;
+                }
+                auto timeout_at = m_conf.block_timeout != duration_t {0} ? start + m_conf.block_timeout : no_deadline;
+                if (timeout_at <= now)
+                {
+                    _record_flush(FLUSH_BY_TIMEOUT, now);
+                    co_return;
+                }
+                auto wake_at = n_blocked >= m_conf.min_batch ? std::min(deadline, timeout_at) : timeout_at;
+                if (wake_at == no_deadline)
+                {
+                    co_await chan_read_or_throw<void>(m_blocked_ch, closer);
+                }
+                else
+                {
+                    auto timer = closer.create_child();
+                    timer.set_timeout(std::max(std::chrono::duration_cast<duration_t>(wake_at - now), duration_t {1}));
+                    if (!co_await chan_read<void>(m_blocked_ch, timer) && closer.is_closed())
+                    {
+                        throw CancelError(closer);
+                    }
+                }
+            } while (true);
+        }
+
+        void AsyncBlockerManager::_record_flush(FlushReason reason, std::chrono::steady_clock::time_point now)
+        {
+            std::uint32_t n_blocked = 0;
+            auto & metrics = blocker_metrics();
+            std::lock_guard lk(m_mutex);
+            for (auto && blocker : m_selected)
+            {
+                if (!blocker->is_blocked())
+                {
+                    continue;
+                }
+                ++n_blocked;
+                auto delay = std::chrono::duration_cast<duration_t>(now - blocker->blocked_at());
+                metrics.queue_delay->record(delay);
+                auto bound = std::lower_bound(m_stats.queue_delay_bounds.begin(), m_stats.queue_delay_bounds.end(), delay);
+                ++m_stats.queue_delays[bound - m_stats.queue_delay_bounds.begin()];
+            }
+            if (m_stats.batch_sizes.size() <= n_blocked)
+            {
+                m_stats.batch_sizes.resize(n_blocked + 1, 0);
+            }
+            ++m_stats.batch_sizes[n_blocked];
+            switch (reason)
+            {
+            case FLUSH_BY_BATCH:
+                ++m_stats.flushed_by_batch;
+                metrics.by_batch->inc();
+                break;
+            case FLUSH_BY_DEADLINE:
+                ++m_stats.flushed_by_deadline;
+                metrics.by_deadline->inc();
+                break;
+            case FLUSH_BY_TIMEOUT:
+                ++m_stats.flushed_by_timeout;
+                metrics.by_timeout->inc();
+                break;
+            default:
+                throw cpptrace::logic_error(THIS_IS_IMPOSSIBLE);
+            }
+        }
+
+        auto AsyncBlockerManager::statistics() const -> Statistics
+        {
+            std::lock_guard lk(m_mutex);
+            return m_stats;
+        }
+
         void AsyncBlockerManager::unlock()
         {
             {
@@ -510,29 +717,30 @@ namespace cfgo
                     return;
                 }
                 m_locked = false;
-                for (auto && blocker : m_blockers)
+                for (auto && blocker : m_selected)
                 {
-                    if (blocker.m_blocker->request_unblock())
+                    if (blocker->request_unblock())
                     {
-                        ++blocker.m_epoch;
+                        auto iter = m_blockers.find(blocker->id());
+                        if (iter != m_blockers.end())
+                        {
+                            m_schedule.erase(_key_of(iter->second));
+                            iter->second.m_epoch = m_next_epoch++;
+                            m_schedule.insert(_key_of(iter->second));
+                        }
                     }
                 }
-                for (auto it = m_blockers.begin(); it != m_blockers.end();)
+                m_selected.clear();
+                m_selected_delays.clear();
+                for (auto id : m_removed)
                 {
-                    auto & blocker = *it;
-                    if (!blocker.m_valid)
-                    {
-                        it = m_blockers.erase(it);
-                    }
-                    else
-                    {
-                        ++it;
-                    }
+                    _erase_blocker(id);
                 }
-                for (auto && request : m_blocker_requests)
+                m_removed.clear();
+                for (auto && [id, request] : m_blocker_requests)
                 {
-                    auto block_ptr = std::make_shared<AsyncBlocker>(request.m_id);
-                    m_blockers.push_back({block_ptr, m_next_epoch++, request.m_priority, true});
+                    auto block_ptr = std::make_shared<AsyncBlocker>(id, m_blocked_ch);
+                    _insert_blocker(block_ptr, request.m_priority);
                     chan_must_write(request.m_chan, block_ptr);
                 }
                 m_blocker_requests.clear();
@@ -542,11 +750,11 @@ namespace cfgo
         void AsyncBlockerManager::collect_locked_blocker(std::vector<cfgo::AsyncBlocker> & blockers)
         {
             blockers.clear();
-            for (auto && blocker : m_blockers)
+            for (auto && blocker : m_selected)
             {
-                if (blocker.m_blocker->is_blocked())
+                if (blocker->is_blocked())
                 {
-                    blockers.push_back(cfgo::AsyncBlocker{blocker.m_blocker});
+                    blockers.push_back(cfgo::AsyncBlocker{blocker});
                 }
             }
         }
@@ -556,13 +764,10 @@ namespace cfgo
             AsyncBlockerPtr blocker = nullptr;
             {
                 std::lock_guard lk(m_mutex);
-                for (auto && blocker_info : m_blockers)
+                auto iter = m_blockers.find(id);
+                if (iter != m_blockers.end())
                 {
-                    if (blocker_info.m_blocker->id() == id)
-                    {
-                        blocker = blocker_info.m_blocker;
-                        break;
-                    }
+                    blocker = iter->second.m_blocker;
                 }
             }
             if (blocker)
@@ -575,6 +780,27 @@ namespace cfgo
             co_return;
         }
 
+        auto AsyncBlockerManager::wait_block_request(std::uint32_t id, const close_chan & closer) -> asio::awaitable<void>
+        {
+            AsyncBlockerPtr blocker = nullptr;
+            {
+                std::lock_guard lk(m_mutex);
+                auto iter = m_blockers.find(id);
+                if (iter != m_blockers.end())
+                {
+                    blocker = iter->second.m_blocker;
+                }
+            }
+            if (blocker)
+            {
+                if (!co_await blocker->await_request(closer) || !co_await blocker->await_unblock(closer))
+                {
+                    throw CancelError(closer);
+                }
+            }
+            co_return;
+        }
+
     } // namespace detail
 
     AsyncBlocker::AsyncBlocker(detail::AsyncBlockerPtr impl): ImplBy(impl) {}
@@ -674,6 +900,17 @@ namespace cfgo
         {
             throw cpptrace::runtime_error("Invalid target_batch. The target_batch must greater than min_batch when it is positive.");
         }
+        if (max_queue_delay < duration_t {0})
+        {
+            throw cpptrace::runtime_error("Invalid max_queue_delay. The max_queue_delay must not be negative.");
+        }
+        for (auto && [priority, delay] : priority_queue_delays)
+        {
+            if (delay < duration_t {0})
+            {
+                throw cpptrace::runtime_error(fmt::format("Invalid queue delay of priority {}. The queue delay must not be negative.", priority));
+            }
+        }
     }
 
     AsyncBlockerManager::AsyncBlockerManager(const Configure & configure): ImplBy(configure) {}
@@ -708,5 +945,15 @@ namespace cfgo
     {
         return impl()->wait_blocker(id, closer);
     }
+
+    auto AsyncBlockerManager::wait_block_request(std::uint32_t id, const close_chan & closer) const -> asio::awaitable<void>
+    {
+        return impl()->wait_block_request(id, closer);
+    }
+
+    auto AsyncBlockerManager::statistics() const -> Statistics
+    {
+        return impl()->statistics();
+    }
 } // namespace cfgo
 
@@ -0,0 +1,333 @@
+#include "cfgo/async_log.hpp"
+#include "cfgo/metrics.hpp"
+#include "cpptrace/cpptrace.hpp"
+#include "spdlog/details/log_msg.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace cfgo
+{
+    namespace detail
+    {
+        class AsyncLogBackend;
+
+        class AsyncLogSink : public spdlog::sinks::sink
+        {
+        public:
+            AsyncLogSink(std::shared_ptr<AsyncLogBackend> backend, spdlog::sink_ptr target);
+            ~AsyncLogSink() override;
+
+            void log(const spdlog::details::log_msg & msg) override;
+            void flush() override;
+            void set_pattern(const std::string & pattern) override;
+            void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+            // called by the background thread.
+            void write(const spdlog::details::log_msg & msg);
+        private:
+            std::shared_ptr<AsyncLogBackend> m_backend;
+            spdlog::sink_ptr m_target;
+        };
+
+        class AsyncLogBackend
+        {
+        public:
+            using Configure = cfgo::AsyncLogBackend::Configure;
+
+            explicit AsyncLogBackend(const Configure & conf);
+            ~AsyncLogBackend();
+            AsyncLogBackend(const AsyncLogBackend &) = delete;
+            AsyncLogBackend & operator = (const AsyncLogBackend &) = delete;
+
+            void push(AsyncLogSink * sink, const spdlog::details::log_msg & msg);
+            void flush();
+            std::uint64_t dropped() const noexcept
+            {
+                return m_dropped->value();
+            }
+        private:
+            struct Record
+            {
+                std::atomic<std::size_t> m_seq;
+                AsyncLogSink * m_sink = nullptr;
+                spdlog::level::level_enum m_level = spdlog::level::off;
+                spdlog::log_clock::time_point m_time;
+                std::size_t m_thread_id = 0;
+                spdlog::source_loc m_source;
+                // the logger name followed by the payload, the logger may be gone before the record is written.
+                std::string m_text;
+                std::size_t m_name_size = 0;
+            };
+            static constexpr std::size_t CACHE_LINE = 64;
+            // the done position is published once per batch, so a flush does not wait for the whole ring.
+            static constexpr std::size_t BATCH = 64;
+
+            const Configure m_conf;
+            const std::size_t m_mask;
+            std::unique_ptr<Record[]> m_records;
+            metrics::CounterPtr m_dropped;
+            alignas(CACHE_LINE) std::atomic<std::size_t> m_enqueue_pos {0};
+            alignas(CACHE_LINE) std::atomic<std::size_t> m_done_pos {0};
+            std::atomic<std::uint32_t> m_flush_waiters {0};
+            alignas(CACHE_LINE) std::atomic_bool m_sleeping {false};
+            std::atomic<std::uint32_t> m_signal {0};
+            std::atomic_bool m_stop {false};
+            std::thread m_thread;
+
+            void _run();
+            void _wake() noexcept;
+            void _force_wake() noexcept;
+            bool _is_ready(std::size_t pos) const noexcept
+            {
+                return m_records[pos & m_mask].m_seq.load(std::memory_order_acquire) == pos + 1;
+            }
+        };
+
+        AsyncLogSink::AsyncLogSink(std::shared_ptr<AsyncLogBackend> backend, spdlog::sink_ptr target):
+            m_backend(std::move(backend)),
+            m_target(std::move(target))
+        {
+            if (!m_target)
+            {
+                throw cpptrace::logic_error("The target sink must not be null.");
+            }
+        }
+
+        AsyncLogSink::~AsyncLogSink()
+        {
+            // no record may refer to this sink after it is gone.
+            m_backend->flush();
+        }
+
+        void AsyncLogSink::log(const spdlog::details::log_msg & msg)
+        {
+            m_backend->push(this, msg);
+        }
+
+        void AsyncLogSink::flush()
+        {
+            m_backend->flush();
+            m_target->flush();
+        }
+
+        void AsyncLogSink::set_pattern(const std::string & pattern)
+        {
+            m_target->set_pattern(pattern);
+        }
+
+        void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter)
+        {
+            m_target->set_formatter(std::move(sink_formatter));
+        }
+
+        void AsyncLogSink::write(const spdlog::details::log_msg & msg)
+        {
+            if (m_target->should_log(msg.level))
+            {
+                m_target->log(msg);
+            }
+        }
+
+        AsyncLogBackend::AsyncLogBackend(const Configure & conf):
+            m_conf(conf),
+            m_mask(std::bit_ceil(std::max<std::size_t>(conf.capacity, 2)) - 1),
+            m_records(std::make_unique<Record[]>(m_mask + 1)),
+            m_dropped(metrics::Registry::instance().counter("cfgo_log_dropped_records_total", "The log records dropped because the ring of the async log backend is full."))
+        {
+            m_conf.validate();
+            for (std::size_t i = 0; i <= m_mask; ++i)
+            {
+                m_records[i].m_seq.store(i, std::memory_order_relaxed);
+                m_records[i].m_text.reserve(m_conf.record_size);
+            }
+            m_thread = std::thread([this]() {
+                _run();
+            });
+        }
+
+        AsyncLogBackend::~AsyncLogBackend()
+        {
+            m_stop.store(true, std::memory_order_release);
+            _force_wake();
+            if (m_thread.joinable())
+            {
+                m_thread.join();
+            }
+        }
+
+        void AsyncLogBackend::_wake() noexcept
+        {
+            // pairs with the fence of the sleeping consumer, either it sees the new record or we see it sleeping.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_relaxed))
+            {
+                _force_wake();
+            }
+        }
+
+        void AsyncLogBackend::_force_wake() noexcept
+        {
+            m_signal.fetch_add(1, std::memory_order_release);
+            m_signal.notify_one();
+        }
+
+        void AsyncLogBackend::push(AsyncLogSink * sink, const spdlog::details::log_msg & msg)
+        {
+            // the consumer must never wait for itself, such as a target which logs.
+            bool may_block = m_conf.block_when_full && std::this_thread::get_id() != m_thread.get_id();
+            auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            Record * record;
+            do
+            {
+                record = &m_records[pos & m_mask];
+                auto seq = record->m_seq.load(std::memory_order_acquire);
+                auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (dif == 0)
+                {
+                    if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    if (!may_block || m_stop.load(std::memory_order_relaxed))
+                    {
+                        m_dropped->inc();
+                        return;
+                    }
+                    _wake();
+                    std::this_thread::yield();
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+                else
+                {
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            } while (true);
+            record->m_sink = sink;
+            record->m_level = msg.level;
+            record->m_time = msg.time;
+            record->m_thread_id = msg.thread_id;
+            record->m_source = msg.source;
+            // within the reserved capacity, assign reuses the buffer.
+            record->m_text.assign(msg.logger_name.data(), msg.logger_name.size());
+            record->m_text.append(msg.payload.data(), msg.payload.size());
+            record->m_name_size = msg.logger_name.size();
+            record->m_seq.store(pos + 1, std::memory_order_release);
+            _wake();
+        }
+
+        void AsyncLogBackend::flush()
+        {
+            if (std::this_thread::get_id() == m_thread.get_id())
+            {
+                return;
+            }
+            auto target = m_enqueue_pos.load(std::memory_order_acquire);
+            m_flush_waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            _force_wake();
+            auto done = m_done_pos.load(std::memory_order_acquire);
+            while (done < target)
+            {
+                m_done_pos.wait(done, std::memory_order_acquire);
+                done = m_done_pos.load(std::memory_order_acquire);
+            }
+            m_flush_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        void AsyncLogBackend::_run()
+        {
+            std::size_t pos = 0;
+            spdlog::details::log_msg msg {};
+            do
+            {
+                for (std::size_t n = 0; n < BATCH && _is_ready(pos); ++n, ++pos)
+                {
+                    auto & record = m_records[pos & m_mask];
+                    msg.logger_name = spdlog::string_view_t(record.m_text.data(), record.m_name_size);
+                    msg.level = record.m_level;
+                    msg.time = record.m_time;
+                    msg.thread_id = record.m_thread_id;
+                    msg.source = record.m_source;
+                    msg.payload = spdlog::string_view_t(record.m_text.data() + record.m_name_size, record.m_text.size() - record.m_name_size);
+                    msg.color_range_start = 0;
+                    msg.color_range_end = 0;
+                    try
+                    {
+                        record.m_sink->write(msg);
+                    }
+                    catch(...)
+                    {
+                        // a broken target must not stop the others.
+                    }
+                    record.m_seq.store(pos + m_mask + 1, std::memory_order_release);
+                }
+                m_done_pos.store(pos, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_flush_waiters.load(std::memory_order_relaxed) > 0)
+                {
+                    m_done_pos.notify_all();
+                }
+                if (_is_ready(pos))
+                {
+                    continue;
+                }
+                if (m_stop.load(std::memory_order_acquire))
+                {
+                    // no sink is alive when stopped, so nothing is pushed anymore.
+                    return;
+                }
+                auto signal = m_signal.load(std::memory_order_acquire);
+                m_sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!_is_ready(pos) && !m_stop.load(std::memory_order_relaxed))
+                {
+                    m_signal.wait(signal, std::memory_order_acquire);
+                }
+                m_sleeping.store(false, std::memory_order_relaxed);
+            } while (true);
+        }
+    } // namespace detail
+
+    void AsyncLogBackend::Configure::validate() const
+    {
+        if (capacity < 1)
+        {
+            throw cpptrace::runtime_error("Invalid capacity. The capacity must be greater or equal than 1.");
+        }
+        if (record_size < 1)
+        {
+            throw cpptrace::runtime_error("Invalid record_size. The record_size must be greater or equal than 1.");
+        }
+    }
+
+    AsyncLogBackend::AsyncLogBackend(std::nullptr_t): ImplBy(std::shared_ptr<detail::AsyncLogBackend>()) {}
+
+    AsyncLogBackend::AsyncLogBackend(const Configure & conf): ImplBy(conf) {}
+
+    AsyncLogBackend::operator bool() const noexcept
+    {
+        return (bool) impl();
+    }
+
+    spdlog::sink_ptr AsyncLogBackend::wrap(spdlog::sink_ptr target) const
+    {
+        return std::make_shared<detail::AsyncLogSink>(impl(), std::move(target));
+    }
+
+    void AsyncLogBackend::flush() const
+    {
+        impl()->flush();
+    }
+
+    std::uint64_t AsyncLogBackend::dropped() const noexcept
+    {
+        return impl()->dropped();
+    }
+} // namespace cfgo
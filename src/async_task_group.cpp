@@ -0,0 +1,471 @@
+#include "cfgo/async_task_group.hpp"
+#include "cfgo/async.hpp"
+#include "cfgo/log.hpp"
+#include "cfgo/defer.hpp"
+#include "cfgo/metrics.hpp"
+#include "asio/co_spawn.hpp"
+#include "asio/detached.hpp"
+#include "asio/this_coro.hpp"
+#include "boost/circular_buffer.hpp"
+#include <atomic>
+#include <deque>
+#include <tuple>
+#include <algorithm>
+#include <limits>
+
+namespace cfgo
+{
+    namespace detail
+    {
+        struct TaskGroupMetrics
+        {
+            metrics::CounterPtr completed;
+            metrics::CounterPtr failed;
+            metrics::CounterPtr stolen;
+            metrics::GaugePtr running;
+
+            TaskGroupMetrics()
+            {
+                auto & registry = metrics::Registry::instance();
+                const char * tasks_help = "The tasks of all the task groups, the failed ones are counted as completed too.";
+                completed = registry.counter("cfgo_async_task_group_tasks_total", tasks_help, { .category = "completed" });
+                failed = registry.counter("cfgo_async_task_group_tasks_total", tasks_help, { .category = "failed" });
+                stolen = registry.counter("cfgo_async_task_group_tasks_total", tasks_help, { .category = "stolen" });
+                running = registry.gauge("cfgo_async_task_group_running_tasks", "The running tasks of all the task groups.");
+            }
+        };
+
+        static const TaskGroupMetrics & task_group_metrics()
+        {
+            // never destroyed, a task may complete during the static destruction.
+            static const TaskGroupMetrics & metrics = *new TaskGroupMetrics {};
+            return metrics;
+        }
+
+        class AsyncTaskGroup : public std::enable_shared_from_this<AsyncTaskGroup>
+        {
+        public:
+            using Configure = cfgo::AsyncTaskGroup::Configure;
+            using Stats = cfgo::AsyncTaskGroup::Stats;
+            using Task = cfgo::AsyncTaskGroup::Task;
+            using Lanes = std::vector<std::deque<Task>>;
+            struct Worker
+            {
+                asio::any_io_executor m_executor;
+                // guards the lanes only, a thief locks one victim at a time.
+                mutex m_mutex;
+                // one deque per priority lane. the owner pops the front, the thieves pop the back.
+                Lanes m_lanes;
+                std::atomic_uint32_t m_running {0};
+
+                Worker(const asio::any_io_executor & executor, std::uint32_t lanes): m_executor(executor), m_lanes(lanes) {}
+            };
+
+            AsyncTaskGroup(const Configure & configure, const close_chan & closer);
+            AsyncTaskGroup(const AsyncTaskGroup &) = delete;
+            AsyncTaskGroup & operator = (const AsyncTaskGroup &) = delete;
+
+            void add_task(Task && task, std::uint32_t priority);
+            auto await() -> asio::awaitable<void>;
+            Stats stats() const;
+            const close_chan & closer() const noexcept
+            {
+                return m_close_ch;
+            }
+        private:
+            Configure m_conf;
+            close_chan m_close_ch;
+            unique_void_chan m_idle_ch;
+            // guards the start, the pending lanes, the error and the run times. never taken to pop or steal a task.
+            mutable mutex m_mutex;
+            std::atomic_bool m_start {false};
+            // the tasks added before the start, spread over the workers by the start.
+            Lanes m_pending;
+            // fixed once started.
+            std::vector<std::unique_ptr<Worker>> m_workers;
+            std::atomic_size_t m_next_worker {0};
+            std::atomic_uint64_t m_queued {0};
+            std::atomic_uint64_t m_running {0};
+            std::atomic_uint64_t m_completed {0};
+            std::atomic_uint64_t m_failed {0};
+            std::atomic_uint64_t m_stolen {0};
+            boost::circular_buffer<duration_t> m_run_times;
+            std::exception_ptr m_err = nullptr;
+
+            void _start(const asio::any_io_executor & executor);
+            bool _try_take_slot() noexcept;
+            bool _pop_own(std::size_t wid, std::uint32_t priority, Task & task);
+            bool _steal(std::size_t wid, std::uint32_t priority, Task & task);
+            bool _pop_task(std::size_t wid, Task & task);
+            std::size_t _select_worker() const noexcept;
+            using Ready = std::vector<std::tuple<std::size_t, asio::any_io_executor, Task>>;
+            void _dispatch(std::size_t hint, Ready & ready);
+            void _spawn(Ready & ready);
+            void _on_task_done(std::size_t wid, duration_t run_time, std::exception_ptr except);
+            void _clear_queued();
+            bool _is_idle() const noexcept
+            {
+                return m_queued.load() == 0 && m_running.load() == 0;
+            }
+        };
+
+        AsyncTaskGroup::AsyncTaskGroup(const Configure & configure, const close_chan & closer):
+            m_conf(configure),
+            m_close_ch(closer.create_child()),
+            m_pending(configure.lanes),
+            m_run_times(configure.stat_window)
+        {
+            m_conf.validate();
+        }
+
+        // called with m_mutex held.
+        void AsyncTaskGroup::_start(const asio::any_io_executor & executor)
+        {
+            if (m_conf.executors.empty())
+            {
+                m_workers.push_back(std::make_unique<Worker>(executor, m_conf.lanes));
+            }
+            else
+            {
+                for (auto && e : m_conf.executors)
+                {
+                    m_workers.push_back(std::make_unique<Worker>(e, m_conf.lanes));
+                }
+            }
+            for (std::uint32_t p = 0; p < m_conf.lanes; ++p)
+            {
+                for (auto && task : m_pending[p])
+                {
+                    auto wid = m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+                    m_workers[wid]->m_lanes[p].push_back(std::move(task));
+                }
+                m_pending[p].clear();
+            }
+            m_start.store(true, std::memory_order_release);
+        }
+
+        void AsyncTaskGroup::add_task(Task && task, std::uint32_t priority)
+        {
+            if (m_close_ch.is_closed())
+            {
+                throw CancelError(m_close_ch);
+            }
+            priority = std::min(priority, m_conf.lanes - 1);
+            if (!m_start.load(std::memory_order_acquire))
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_start.load(std::memory_order_relaxed))
+                {
+                    m_pending[priority].push_back(std::move(task));
+                    ++m_queued;
+                    return;
+                }
+            }
+            auto wid = m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+            // counted before it is visible, so a dispatcher never sees the group idle with a task in a lane.
+            ++m_queued;
+            {
+                auto & worker = *m_workers[wid];
+                std::lock_guard lock(worker.m_mutex);
+                worker.m_lanes[priority].push_back(std::move(task));
+            }
+            Ready ready {};
+            _dispatch(wid, ready);
+            _spawn(ready);
+            // the task may have been taken and completed by another dispatcher while this one held a slot.
+            if (_is_idle())
+            {
+                chan_maybe_write(m_idle_ch);
+            }
+        }
+
+        bool AsyncTaskGroup::_try_take_slot() noexcept
+        {
+            if (m_conf.max_in_flight == 0)
+            {
+                ++m_running;
+                return true;
+            }
+            auto running = m_running.load();
+            do
+            {
+                if (running >= m_conf.max_in_flight)
+                {
+                    return false;
+                }
+            } while (!m_running.compare_exchange_weak(running, running + 1));
+            return true;
+        }
+
+        bool AsyncTaskGroup::_pop_own(std::size_t wid, std::uint32_t priority, Task & task)
+        {
+            auto & worker = *m_workers[wid];
+            std::lock_guard lock(worker.m_mutex);
+            auto & lane = worker.m_lanes[priority];
+            if (lane.empty())
+            {
+                return false;
+            }
+            task = std::move(lane.front());
+            lane.pop_front();
+            return true;
+        }
+
+        bool AsyncTaskGroup::_steal(std::size_t wid, std::uint32_t priority, Task & task)
+        {
+            for (std::size_t i = 1; i < m_workers.size(); ++i)
+            {
+                auto & victim = *m_workers[(wid + i) % m_workers.size()];
+                std::lock_guard lock(victim.m_mutex);
+                auto & lane = victim.m_lanes[priority];
+                if (!lane.empty())
+                {
+                    task = std::move(lane.back());
+                    lane.pop_back();
+                    ++m_stolen;
+                    task_group_metrics().stolen->inc();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool AsyncTaskGroup::_pop_task(std::size_t wid, Task & task)
+        {
+            // the most urgent lane wins. the own lane is preferred, otherwise steal from the back of the victims.
+            for (std::int64_t p = m_conf.lanes - 1; p >= 0; --p)
+            {
+                if (_pop_own(wid, p, task) || _steal(wid, p, task))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::size_t AsyncTaskGroup::_select_worker() const noexcept
+        {
+            std::size_t wid = 0;
+            for (std::size_t i = 1; i < m_workers.size(); ++i)
+            {
+                if (m_workers[i]->m_running.load(std::memory_order_relaxed) < m_workers[wid]->m_running.load(std::memory_order_relaxed))
+                {
+                    wid = i;
+                }
+            }
+            return wid;
+        }
+
+        void AsyncTaskGroup::_dispatch(std::size_t hint, Ready & ready)
+        {
+            while (m_queued.load() > 0 && !m_close_ch.is_closed())
+            {
+                if (!_try_take_slot())
+                {
+                    return;
+                }
+                auto wid = m_workers[hint]->m_running.load(std::memory_order_relaxed) == 0 ? hint : _select_worker();
+                Task task;
+                if (!_pop_task(wid, task))
+                {
+                    // another dispatcher took the last queued task.
+                    --m_running;
+                    // it may have completed while the slot was held here, then nobody else sees the group idle.
+                    if (_is_idle())
+                    {
+                        chan_maybe_write(m_idle_ch);
+                    }
+                    return;
+                }
+                --m_queued;
+                task_group_metrics().running->add();
+                ++m_workers[wid]->m_running;
+                ready.emplace_back(wid, m_workers[wid]->m_executor, std::move(task));
+            }
+        }
+
+        // never called with a lock held, the task may start inline and complete synchronously.
+        void AsyncTaskGroup::_spawn(Ready & ready)
+        {
+            for (auto && [id, executor, task] : ready)
+            {
+                asio::co_spawn(
+                    executor,
+                    fix_async_lambda([self = shared_from_this(), wid = id, task = std::move(task)]() -> asio::awaitable<void> {
+                        auto start = std::chrono::steady_clock::now();
+                        std::exception_ptr except = nullptr;
+                        try
+                        {
+                            co_await task(self->m_close_ch);
+                        }
+                        catch(...)
+                        {
+                            except = std::current_exception();
+                        }
+                        self->_on_task_done(wid, std::chrono::steady_clock::now() - start, except);
+                    }),
+                    asio::detached
+                );
+            }
+            ready.clear();
+        }
+
+        void AsyncTaskGroup::_on_task_done(std::size_t wid, duration_t run_time, std::exception_ptr except)
+        {
+            auto & metrics = task_group_metrics();
+            {
+                std::lock_guard lock(m_mutex);
+                m_run_times.push_back(run_time);
+                if (except)
+                {
+                    ++m_failed;
+                    metrics.failed->inc();
+                    if (!m_err && !m_close_ch.is_closed())
+                    {
+                        m_err = except;
+                        _clear_queued();
+                        m_close_ch.close_no_except("Some task of the task group failed.");
+                    }
+                }
+            }
+            ++m_completed;
+            metrics.running->sub();
+            metrics.completed->inc();
+            --m_workers[wid]->m_running;
+            // the slot is freed before the lanes are checked, paired with add_task which queues before it dispatches.
+            --m_running;
+            Ready ready {};
+            _dispatch(wid, ready);
+            _spawn(ready);
+            if (_is_idle())
+            {
+                chan_maybe_write(m_idle_ch);
+            }
+        }
+
+        void AsyncTaskGroup::_clear_queued()
+        {
+            std::uint64_t cleared = 0;
+            for (auto && lane : m_pending)
+            {
+                cleared += lane.size();
+                lane.clear();
+            }
+            for (auto && worker : m_workers)
+            {
+                std::lock_guard lock(worker->m_mutex);
+                for (auto && lane : worker->m_lanes)
+                {
+                    cleared += lane.size();
+                    lane.clear();
+                }
+            }
+            m_queued -= cleared;
+        }
+
+        auto AsyncTaskGroup::await() -> asio::awaitable<void>
+        {
+            auto executor = co_await asio::this_coro::executor;
+            {
+                Ready ready {};
+                bool started = false;
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (!m_start.load(std::memory_order_relaxed))
+                    {
+                        _start(executor);
+                        started = true;
+                    }
+                }
+                if (started)
+                {
+                    for (std::size_t i = 0; i < m_workers.size(); ++i)
+                    {
+                        _dispatch(i, ready);
+                    }
+                }
+                _spawn(ready);
+            }
+            do
+            {
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (m_err)
+                    {
+                        std::rethrow_exception(m_err);
+                    }
+                }
+                if (_is_idle())
+                {
+                    co_return;
+                }
+                if (!co_await chan_read<void>(m_idle_ch, m_close_ch))
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (m_err)
+                    {
+                        std::rethrow_exception(m_err);
+                    }
+                    _clear_queued();
+                    throw CancelError(m_close_ch);
+                }
+            } while (true);
+        }
+
+        auto AsyncTaskGroup::stats() const -> Stats
+        {
+            std::vector<duration_t> run_times {};
+            Stats stats {};
+            {
+                std::lock_guard lock(m_mutex);
+                stats.queued = m_queued.load();
+                stats.running = m_running.load();
+                stats.completed = m_completed.load();
+                stats.failed = m_failed.load();
+                stats.stolen = m_stolen.load();
+                run_times.assign(m_run_times.begin(), m_run_times.end());
+            }
+            if (!run_times.empty())
+            {
+                auto p99 = run_times.begin() + (run_times.size() - 1) * 99 / 100;
+                std::nth_element(run_times.begin(), p99, run_times.end());
+                stats.p99_run_time = *p99;
+            }
+            return stats;
+        }
+    } // namespace detail
+
+    void AsyncTaskGroup::Configure::validate() const
+    {
+        if (lanes < 1)
+        {
+            throw cpptrace::runtime_error("Invalid lanes. The lanes must be greater or equal than 1.");
+        }
+        if (stat_window < 1)
+        {
+            throw cpptrace::runtime_error("Invalid stat_window. The stat_window must be greater or equal than 1.");
+        }
+    }
+
+    AsyncTaskGroup::AsyncTaskGroup(const Configure & configure, const close_chan & closer): ImplBy(configure, closer) {}
+
+    void AsyncTaskGroup::add_task(Task task, std::uint32_t priority) const
+    {
+        impl()->add_task(std::move(task), priority);
+    }
+
+    auto AsyncTaskGroup::await() const -> asio::awaitable<void>
+    {
+        return impl()->await();
+    }
+
+    auto AsyncTaskGroup::stats() const -> Stats
+    {
+        return impl()->stats();
+    }
+
+    const close_chan & AsyncTaskGroup::closer() const noexcept
+    {
+        return impl()->closer();
+    }
+} // namespace cfgo
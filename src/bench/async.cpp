@@ -0,0 +1,178 @@
+#include "cfgo/async.hpp"
+#include "asio.hpp"
+#include "benchmark/benchmark.h"
+#include <vector>
+
+/**
+ * The primitives every packet and every subscribation goes through: AsyncMutex, the close signal trees and chan_read/select.
+*/
+
+// a lock/unlock of AsyncMutex by range(0) coroutines on 4 threads, each one takes the lock 100 times per iteration.
+static void BM_AsyncMutexContention(benchmark::State & state)
+{
+    using namespace cfgo;
+    constexpr int rounds = 100;
+    auto n_coros = state.range(0);
+    asio::thread_pool pool {4};
+    AsyncMutex mutex {};
+    for (auto _ : state)
+    {
+        std::vector<std::future<void>> futures {};
+        for (int i = 0; i < n_coros; ++i)
+        {
+            futures.push_back(asio::co_spawn(pool.get_executor(), fix_async_lambda([&mutex]() -> asio::awaitable<void> {
+                for (int r = 0; r < rounds; ++r)
+                {
+                    if (!co_await mutex.accquire())
+                    {
+                        co_return;
+                    }
+                    co_await mutex.release();
+                }
+            }), asio::use_future));
+        }
+        for (auto && future : futures)
+        {
+            future.get();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n_coros * rounds);
+    pool.join();
+}
+BENCHMARK(BM_AsyncMutexContention)->Arg(1)->Arg(4)->Arg(16)->Arg(64)->UseRealTime();
+
+// create a root with range(0) children, each child has range(1) grandchildren, then close the root.
+static void BM_CloseSignalTree(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto n_children = state.range(0);
+    auto n_grandchildren = state.range(1);
+    std::vector<close_chan> closers {};
+    closers.reserve(n_children * (n_grandchildren + 1));
+    for (auto _ : state)
+    {
+        close_chan root {};
+        for (int i = 0; i < n_children; ++i)
+        {
+            auto child = root.create_child();
+            for (int j = 0; j < n_grandchildren; ++j)
+            {
+                closers.push_back(child.create_child());
+            }
+            closers.push_back(std::move(child));
+        }
+        root.close();
+        closers.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * (1 + n_children * (n_grandchildren + 1)));
+}
+BENCHMARK(BM_CloseSignalTree)->Args({1, 0})->Args({16, 0})->Args({16, 16})->Args({256, 4});
+
+// the round trip of a ping pong between two coroutines of the same io_context, with a closer when range(0) is 1.
+static void BM_ChanReadPingPong(benchmark::State & state)
+{
+    using namespace cfgo;
+    bool with_closer = state.range(0) != 0;
+    asio::io_context ctx {};
+    asiochan::channel<int> ping {};
+    asiochan::channel<int> pong {};
+    close_chan stop {};
+    close_chan closer = with_closer ? stop.create_child() : INVALID_CLOSE_CHAN;
+    asio::co_spawn(ctx, fix_async_lambda([ping, pong, closer]() mutable -> asio::awaitable<void> {
+        do
+        {
+            auto v = co_await chan_read<int>(ping, closer);
+            if (v.is_canceled() || v.value() < 0)
+            {
+                co_return;
+            }
+            co_await pong.write(v.value());
+        } while (true);
+    }), asio::detached);
+    asio::co_spawn(ctx, fix_async_lambda([&state, ping, pong, closer]() mutable -> asio::awaitable<void> {
+        for (auto _ : state)
+        {
+            co_await ping.write(1);
+            benchmark::DoNotOptimize(co_await chan_read<int>(pong, closer));
+        }
+        co_await ping.write(-1);
+    }), asio::detached);
+    ctx.run();
+    stop.close_no_except();
+}
+BENCHMARK(BM_ChanReadPingPong)->Arg(0)->Arg(1);
+
+// the same round trip, but the pong side selects between two channels and the closer.
+static void BM_SelectPingPong(benchmark::State & state)
+{
+    using namespace cfgo;
+    asio::io_context ctx {};
+    asiochan::channel<int> ping_a {};
+    asiochan::channel<long> ping_b {};
+    asiochan::channel<int> pong {};
+    close_chan closer {};
+    asio::co_spawn(ctx, fix_async_lambda([ping_a, ping_b, pong, closer]() mutable -> asio::awaitable<void> {
+        do
+        {
+            auto res = co_await select(closer, asiochan::ops::read(ping_a), asiochan::ops::read(ping_b));
+            if (!res)
+            {
+                co_return;
+            }
+            auto v = res.received_from(ping_a) ? res.template get_received<int>() : static_cast<int>(res.template get_received<long>());
+            if (v < 0)
+            {
+                co_return;
+            }
+            co_await pong.write(v);
+        } while (true);
+    }), asio::detached);
+    asio::co_spawn(ctx, fix_async_lambda([&state, ping_a, ping_b, pong]() mutable -> asio::awaitable<void> {
+        bool a = true;
+        for (auto _ : state)
+        {
+            if (a)
+            {
+                co_await ping_a.write(1);
+            }
+            else
+            {
+                co_await ping_b.write(1);
+            }
+            a = !a;
+            benchmark::DoNotOptimize(co_await pong.read());
+        }
+        co_await ping_a.write(-1);
+    }), asio::detached);
+    ctx.run();
+}
+BENCHMARK(BM_SelectPingPong);
+
+// the cost per cancel: select_or_throw on a closed closer throws a CancelError to the coroutine, 1 in range(0) of them captures the trace, 0 never does.
+static void BM_CancelErrorThrowCatch(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto sampling = get_cancel_trace_sampling();
+    set_cancel_trace_sampling(static_cast<std::uint32_t>(state.range(0)));
+    asio::io_context ctx {};
+    asiochan::channel<int> ch {};
+    close_chan closer {};
+    closer.close_no_except();
+    asio::co_spawn(ctx, fix_async_lambda([&state, ch, closer]() mutable -> asio::awaitable<void> {
+        for (auto _ : state)
+        {
+            try
+            {
+                benchmark::DoNotOptimize(co_await select_or_throw(closer, asiochan::ops::read(ch)));
+            }
+            catch(const CancelError & e)
+            {
+                benchmark::DoNotOptimize(e.is_timeout());
+            }
+        }
+    }), asio::detached);
+    ctx.run();
+    set_cancel_trace_sampling(sampling);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CancelErrorThrowCatch)->Arg(0)->Arg(64)->Arg(1);
@@ -0,0 +1,58 @@
+#include "cfgo/async.hpp"
+#include "cfgo/async_locker.hpp"
+#include "cfgo/defer.hpp"
+#include "asio.hpp"
+#include "benchmark/benchmark.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/**
+ * Measure the cost of a lock/collect/unlock cycle of AsyncBlockerManager with range(0) blockers.
+ * Every blocker parks until requested, so the pool threads are left to the manager.
+*/
+
+static void BM_BlockerLockCycle(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto n_blockers = static_cast<std::size_t>(state.range(0));
+    asio::thread_pool pool {4};
+    AsyncBlockerManager::Configure conf {
+        .block_timeout = std::chrono::milliseconds {10},
+        .target_batch = 8,
+        .min_batch = 1,
+    };
+    AsyncBlockerManager manager {conf};
+    close_chan closer {};
+    for (std::size_t i = 0; i < n_blockers; ++i)
+    {
+        asio::co_spawn(pool.get_executor(), fix_async_lambda([manager, closer, priority = (int) (i % 4)]() -> asio::awaitable<void> {
+            auto blocker = co_await manager.add_blocker(priority, closer);
+            DEFER({
+                manager.remove_blocker(blocker.id());
+            });
+            try
+            {
+                do
+                {
+                    co_await manager.wait_block_request(blocker.id(), closer);
+                } while (!closer.is_closed());
+            }
+            catch(const CancelError &) {}
+        }), asio::detached);
+    }
+    // the loop runs on the pool, so only the real time makes sense.
+    asio::co_spawn(pool.get_executor(), fix_async_lambda([&state, manager, closer]() -> asio::awaitable<void> {
+        std::vector<AsyncBlocker> blockers {};
+        for (auto _ : state)
+        {
+            co_await manager.lock(closer);
+            manager.collect_locked_blocker(blockers);
+            manager.unlock();
+        }
+        closer.close_no_except();
+    }), asio::use_future).get();
+    pool.join();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BlockerLockCycle)->Arg(16)->Arg(256)->Arg(4096)->UseRealTime();
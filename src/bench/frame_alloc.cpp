@@ -0,0 +1,110 @@
+#include "impl/track.hpp"
+#include "cfgo/async.hpp"
+#include "asio.hpp"
+#include "benchmark/benchmark.h"
+#include "rtc/rtc.hpp"
+#include "sio_message.h"
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * Count the allocations per packet on the real receive path: impl::Track::on_track_msg caches the packet and notifies,
+ * a coroutine waiting in impl::Track::await_timed_msg takes it, the way CfgoSrc::_post_buffer reads a track.
+ * Build with -DCORO_FRAME_RECYCLING=OFF and ON to compare, the allocs_per_packet counter is the result.
+ * CORO_FRAME_CACHE_SIZE needs asio 1.21 or later, the older ones keep 2 frames per thread and configure warns about it.
+ * The global operator new is replaced, so the benchmark has its own binary, bench-frame-alloc.
+ * Only the allocations of the benchmark thread inside the measured window are counted.
+*/
+
+static thread_local bool t_counting = false;
+static thread_local std::uint64_t t_allocs = 0;
+
+void * operator new(std::size_t size)
+{
+    if (t_counting)
+    {
+        ++t_allocs;
+    }
+    if (auto p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static rtc::binary make_rtp_packet(std::size_t size)
+{
+    rtc::binary packet(size, std::byte {0});
+    packet[0] = std::byte {0x80};
+    packet[1] = std::byte {96};
+    return packet;
+}
+
+/**
+ * The consumer is already waiting when the packet arrives, so every packet goes through the whole wait:
+ * await_timed_msg -> MpmcChan::read -> chan_read -> select. Both coroutines run on the benchmark thread,
+ * the window lasts from the ingest until the consumer waits again.
+ * The packet is built before the window, the box of the cached packet made by on_track_msg is counted.
+*/
+static void BM_FrameAllocPerPacket(benchmark::State & state)
+{
+    using namespace cfgo;
+    asio::io_context ctx {};
+    auto track = std::make_shared<impl::Track>(sio::object_message::create(), 16);
+    track->prepare_injected();
+    close_chan closer {};
+    std::uint64_t packets = 0;
+    asio::co_spawn(ctx, fix_async_lambda([track, closer, &packets]() -> asio::awaitable<void> {
+        while (true)
+        {
+            auto msg = co_await track->await_timed_msg(Track::MsgType::RTP, closer);
+            if (!msg)
+            {
+                co_return;
+            }
+            ++packets;
+        }
+    }), asio::detached);
+    asio::co_spawn(ctx, fix_async_lambda([&state, &ctx, &packets, track, closer]() -> asio::awaitable<void> {
+        // let the consumer reach its wait.
+        co_await asio::post(ctx, asio::use_awaitable);
+        std::uint64_t sent = 0;
+        for (auto _ : state)
+        {
+            auto packet = make_rtp_packet(1200);
+            t_counting = true;
+            track->on_track_msg(std::move(packet));
+            ++sent;
+            // the consumer counts the packet and waits again without suspending in between.
+            while (packets < sent)
+            {
+                co_await asio::post(ctx, asio::use_awaitable);
+            }
+            t_counting = false;
+        }
+        closer.close_no_except();
+    }), asio::detached);
+    t_allocs = 0;
+    ctx.run();
+    t_counting = false;
+    state.SetItemsProcessed(packets);
+    state.counters["allocs_per_packet"] = benchmark::Counter(packets ? (double) t_allocs / packets : 0.0);
+    #ifdef ASIO_DISABLE_AWAITABLE_FRAME_RECYCLING
+    state.SetLabel("frame recycling: off");
+    #else
+    state.SetLabel("frame recycling: on, cache size " + std::to_string(ASIO_RECYCLING_ALLOCATOR_CACHE_SIZE));
+    #endif
+}
+BENCHMARK(BM_FrameAllocPerPacket);
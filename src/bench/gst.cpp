@@ -0,0 +1,197 @@
+#include "impl/track.hpp"
+#include "cfgo/async.hpp"
+#include "cfgo/defer.hpp"
+#include "cfgo/gst/appsink.hpp"
+#include "cfgo/gst/error.hpp"
+#include "asio.hpp"
+#include "benchmark/benchmark.h"
+#include "gst/gst.h"
+#include "gst/app/gstappsrc.h"
+#include "gst/app/gstappsink.h"
+#include "rtc/rtc.hpp"
+#include "sio_message.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * The gstreamer side of a track: the packets pushed to appsrc like CfgoSrc::_post_buffer does, and the samples pulled from AppSink.
+*/
+
+static GstElement * make_pipeline(const char * description)
+{
+    gst_init(nullptr, nullptr);
+    GError * error = nullptr;
+    auto pipeline = gst_parse_launch(description, &error);
+    if (error)
+    {
+        g_error_free(error);
+    }
+    return pipeline;
+}
+
+static void destroy_msg(gpointer data)
+{
+    delete static_cast<rtc::binary *>(data);
+}
+
+static GstBuffer * wrap_msg(cfgo::Track::MsgPtr && msg)
+{
+    auto size = msg->size();
+    auto data = msg->data();
+    auto raw = msg.release();
+    return gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, data, size, 0, size, raw, destroy_msg);
+}
+
+static rtc::binary make_rtp_packet(std::size_t size)
+{
+    rtc::binary packet(size, std::byte {0});
+    packet[0] = std::byte {0x80};
+    packet[1] = std::byte {96};
+    return packet;
+}
+
+/**
+ * CfgoSrc::_post_buffer needs a subscribed session of a connected client, so the same loop is replayed on a bare track:
+ * await the first packet, take the arrived ones up to range(0), wrap them without copy and push them as one buffer list.
+ * One iteration is one push.
+*/
+static void BM_PostBufferFakesink(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto batch_size = static_cast<std::size_t>(state.range(0));
+    auto pipeline = make_pipeline("appsrc name=src format=time max-bytes=0 ! fakesink sync=false async=false");
+    if (!pipeline)
+    {
+        state.SkipWithError("Unable to create the pipeline.");
+        return;
+    }
+    DEFER({
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+    });
+    auto appsrc = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    DEFER({
+        gst_object_unref(appsrc);
+    });
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    auto track = std::make_shared<impl::Track>(sio::object_message::create(), 4096);
+    track->prepare_injected();
+    std::atomic_bool stop {false};
+    std::thread producer([track, &stop]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            track->on_track_msg(make_rtp_packet(1200));
+        }
+    });
+    std::uint64_t packets = 0;
+    asio::io_context ctx {};
+    asio::co_spawn(ctx, fix_async_lambda([&state, &packets, track, appsrc, batch_size]() -> asio::awaitable<void> {
+        std::vector<Track::TimedMsg> msgs {};
+        for (auto _ : state)
+        {
+            msgs.clear();
+            msgs.push_back(co_await track->await_timed_msg(Track::MsgType::RTP, INVALID_CLOSE_CHAN));
+            while (msgs.size() < batch_size)
+            {
+                auto next = track->receive_timed_msg(Track::MsgType::RTP);
+                if (!next)
+                {
+                    break;
+                }
+                msgs.push_back(std::move(next));
+            }
+            auto list = gst_buffer_list_new_sized(msgs.size());
+            for (auto && msg : msgs)
+            {
+                gst_buffer_list_add(list, wrap_msg(std::move(msg.msg)));
+            }
+            packets += msgs.size();
+            gst_app_src_push_buffer_list(GST_APP_SRC(appsrc), list);
+        }
+    }), asio::detached);
+    ctx.run();
+    stop = true;
+    producer.join();
+    state.SetItemsProcessed(packets);
+    state.SetBytesProcessed(packets * 1200);
+}
+BENCHMARK(BM_PostBufferFakesink)->Arg(1)->Arg(32)->UseRealTime();
+
+/**
+ * A thread keeps pushing buffers to appsrc, a coroutine pulls them from AppSink with up to range(0) samples per pull.
+ * One iteration is one pull.
+*/
+static void BM_AppSinkPull(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto max_n = static_cast<std::size_t>(state.range(0));
+    auto pipeline = make_pipeline("appsrc name=src format=time block=true max-bytes=307200 ! appsink name=sink sync=false");
+    if (!pipeline)
+    {
+        state.SkipWithError("Unable to create the pipeline.");
+        return;
+    }
+    DEFER({
+        gst_object_unref(pipeline);
+    });
+    auto appsrc = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+    auto raw_appsink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    DEFER({
+        gst_object_unref(appsrc);
+        gst_object_unref(raw_appsink);
+    });
+    gst::AppSink appsink(GST_APP_SINK(raw_appsink), 64);
+    appsink.init();
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    std::atomic_bool stop {false};
+    std::thread producer([appsrc, &stop]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            // returns flushing once the pipeline is stopped.
+            if (gst_app_src_push_buffer(GST_APP_SRC(appsrc), gst_buffer_new_allocate(nullptr, 1200, nullptr)) != GST_FLOW_OK)
+            {
+                break;
+            }
+        }
+    });
+    std::uint64_t samples = 0;
+    asio::io_context ctx {};
+    asio::co_spawn(ctx, fix_async_lambda([&state, &samples, appsink, max_n]() -> asio::awaitable<void> {
+        for (auto _ : state)
+        {
+            auto pulled = co_await appsink.pull_samples(max_n);
+            samples += pulled.size();
+        }
+    }), asio::detached);
+    ctx.run();
+    stop = true;
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    producer.join();
+    state.SetItemsProcessed(samples);
+}
+BENCHMARK(BM_AppSinkPull)->Arg(1)->Arg(32)->UseRealTime();
+
+/**
+ * The timeout GError _post_buffer submits when a read times out, 1 in range(0) of them captures the trace, 0 never does.
+ * range(1) is 1 when the trace is read like cfgo_error_submit does, the trace is only resolved and printed then.
+*/
+static void BM_TimeoutGError(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto sampling = get_cancel_trace_sampling();
+    set_cancel_trace_sampling(static_cast<std::uint32_t>(state.range(0)));
+    bool read_trace = state.range(1) != 0;
+    for (auto _ : state)
+    {
+        auto error = gst::create_gerror_timeout("Timeout to read subsrcibed track rtp data");
+        if (read_trace)
+        {
+            benchmark::DoNotOptimize(cfgo_error_get_trace(error));
+        }
+        g_error_free(error);
+    }
+    set_cancel_trace_sampling(sampling);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeoutGError)->Args({0, 1})->Args({64, 0})->Args({64, 1})->Args({1, 0})->Args({1, 1});
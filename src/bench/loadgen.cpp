@@ -0,0 +1,851 @@
+#include "cfgo/config/configuration.h"
+#include "cfgo/track.hpp"
+#include "cfgo/async.hpp"
+#include "cfgo/defer.hpp"
+#include "cfgo/histogram.hpp"
+#include "cfgo/rtp_capture.hpp"
+#include "asio.hpp"
+#include "rtc/rtc.hpp"
+#include "sio_message.h"
+#include "fmt/format.h"
+#ifdef CFGO_SUPPORT_GSTREAMER
+#include "gst/gst.h"
+#include "gst/app/gstappsrc.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * Drive impl::Track with synthetic rtp streams, without network and without a server.
+ * The producers inject the packets with Track::inject_msg on the schedule of the source, after the loss, burst, reorder and jitter models.
+ * The consumers read them like a raw Track user (receive / await) or push them into an appsrc pipeline like cfgosrc (pipeline).
+ * A capture of RtpRecorder or wireshark may be replayed instead, its packets are injected as they are at their captured times scaled by 1 / speed.
+ * At the end the per track ingest latency (the cost of on_track_msg) and delivery latency (from the arrival to the consumer) are reported.
+ *
+ * loadgen-cfgo --tracks=8 --codec=h264 --input=sample.h264 --fps=30 --loss=0.01 --jitter-ms=20 --duration=30
+ * loadgen-cfgo --tracks=8 --capture=track.pcapng --speed=0 --duration=30
+*/
+
+using clock_type = std::chrono::steady_clock;
+
+struct Options
+{
+    int tracks = 4;
+    int producers = 1;
+    int consumers = 1;
+    // raw, h264, vp8 or opus. the payloads are generated when no input file is given.
+    std::string codec = "raw";
+    // an annex b h264 stream, an ivf vp8 stream or an ogg opus stream.
+    std::string input;
+    // a rtpdump or pcapng capture, replaces codec, input, fps and frame-size. a speed of 0 replays as fast as possible.
+    std::string capture;
+    double speed = 1;
+    double fps = 30;
+    std::size_t frame_size = 4000;
+    std::size_t mtu = 1200;
+    double duration = 10;
+    double loss = 0;
+    // the probability to enter a loss burst and the mean length of the bursts, in packets.
+    double burst_loss = 0;
+    double burst_len = 5;
+    // the probability to delay a packet by reorder_ms, so it arrives after its successors.
+    double reorder = 0;
+    double reorder_ms = 10;
+    double jitter_ms = 0;
+    // release the frames n by n, like a sender recovering from stalls.
+    int burst = 1;
+    int cache = 64;
+    // receive, await or pipeline.
+    std::string mode = "await";
+    std::string pipeline = "fakesink sync=false async=false";
+    unsigned seed = 1;
+};
+
+static void print_usage()
+{
+    fmt::print(
+        "usage: loadgen-cfgo [--name=value]...\n"
+        "  --tracks=4 --producers=1 --consumers=1\n"
+        "  --codec=raw|h264|vp8|opus --input=<file> --fps=30 --frame-size=4000 --mtu=1200 --duration=10\n"
+        "  --capture=<rtpdump or pcapng file> --speed=1\n"
+        "  --loss=0 --burst-loss=0 --burst-len=5 --reorder=0 --reorder-ms=10 --jitter-ms=0 --burst=1\n"
+        "  --cache=64 --mode=receive|await|pipeline --pipeline=\"fakesink sync=false async=false\" --seed=1\n"
+    );
+}
+
+static bool parse_options(int argc, char ** argv, Options & opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string_view::npos)
+        {
+            return false;
+        }
+        auto name = arg.substr(2, eq - 2);
+        std::string value {arg.substr(eq + 1)};
+        try
+        {
+            if (name == "tracks") opts.tracks = std::stoi(value);
+            else if (name == "producers") opts.producers = std::stoi(value);
+            else if (name == "consumers") opts.consumers = std::stoi(value);
+            else if (name == "codec") opts.codec = value;
+            else if (name == "input") opts.input = value;
+            else if (name == "capture") opts.capture = value;
+            else if (name == "speed") opts.speed = std::stod(value);
+            else if (name == "fps") opts.fps = std::stod(value);
+            else if (name == "frame-size") opts.frame_size = std::stoul(value);
+            else if (name == "mtu") opts.mtu = std::stoul(value);
+            else if (name == "duration") opts.duration = std::stod(value);
+            else if (name == "loss") opts.loss = std::stod(value);
+            else if (name == "burst-loss") opts.burst_loss = std::stod(value);
+            else if (name == "burst-len") opts.burst_len = std::stod(value);
+            else if (name == "reorder") opts.reorder = std::stod(value);
+            else if (name == "reorder-ms") opts.reorder_ms = std::stod(value);
+            else if (name == "jitter-ms") opts.jitter_ms = std::stod(value);
+            else if (name == "burst") opts.burst = std::stoi(value);
+            else if (name == "cache") opts.cache = std::stoi(value);
+            else if (name == "mode") opts.mode = value;
+            else if (name == "pipeline") opts.pipeline = value;
+            else if (name == "seed") opts.seed = static_cast<unsigned>(std::stoul(value));
+            else return false;
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+    return opts.tracks > 0 && opts.producers > 0 && opts.consumers > 0 && opts.fps > 0 && opts.speed >= 0 && opts.mtu > 16 && opts.burst > 0 && opts.burst_len >= 1
+        && (opts.mode == "receive" || opts.mode == "await" || opts.mode == "pipeline")
+        && (opts.codec == "raw" || opts.codec == "h264" || opts.codec == "vp8" || opts.codec == "opus");
+}
+
+using Bytes = std::vector<std::byte>;
+
+/**
+ * The packetized frames of a stream, shared by all the tracks and looped when the duration is longer than the stream.
+*/
+struct Source
+{
+    std::uint8_t payload_type = 96;
+    std::uint32_t clock_rate = 90000;
+    std::vector<std::vector<Bytes>> frames;
+    // the frames of a capture are complete rtp packets, sent at their offsets instead of by fps.
+    bool captured = false;
+    std::vector<clock_type::duration> offsets;
+    clock_type::duration loop_length {};
+};
+
+static std::optional<Bytes> read_file(const std::string & path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return std::nullopt;
+    }
+    std::vector<char> chars {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    Bytes data(chars.size());
+    std::memcpy(data.data(), chars.data(), chars.size());
+    return data;
+}
+
+static std::uint8_t u8(const Bytes & data, std::size_t pos)
+{
+    return std::to_integer<std::uint8_t>(data[pos]);
+}
+
+static std::uint32_t le32(const Bytes & data, std::size_t pos)
+{
+    return u8(data, pos) | (u8(data, pos + 1) << 8) | (u8(data, pos + 2) << 16) | (static_cast<std::uint32_t>(u8(data, pos + 3)) << 24);
+}
+
+// split the payload of a frame into packets of at most mtu bytes, each one starts with the payload header returned by make_prefix(first, last).
+template<typename F>
+static void fragment(std::vector<Bytes> & packets, const std::byte * data, std::size_t size, std::size_t mtu, F && make_prefix)
+{
+    // the payload headers of a packetizer have a fixed size.
+    auto room = mtu - make_prefix(true, true).size();
+    std::size_t pos = 0;
+    do
+    {
+        auto n = std::min(room, size - pos);
+        Bytes packet = make_prefix(pos == 0, pos + n == size);
+        packet.insert(packet.end(), data + pos, data + pos + n);
+        packets.push_back(std::move(packet));
+        pos += n;
+    } while (pos < size);
+}
+
+// rfc 6184, single nal unit packets and fu-a fragments. the nal units are grouped into access units by the first_mb_in_slice bit.
+static bool load_h264(const Bytes & data, std::size_t mtu, Source & source)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> nals {};
+    std::size_t i = 0, start = std::string::npos;
+    while (i + 3 <= data.size())
+    {
+        if (u8(data, i) == 0 && u8(data, i + 1) == 0 && u8(data, i + 2) == 1)
+        {
+            if (start != std::string::npos)
+            {
+                auto end = i;
+                while (end > start && u8(data, end - 1) == 0)
+                {
+                    --end;
+                }
+                nals.emplace_back(start, end - start);
+            }
+            i += 3;
+            start = i;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    if (start != std::string::npos && start < data.size())
+    {
+        nals.emplace_back(start, data.size() - start);
+    }
+    std::vector<Bytes> frame {};
+    bool has_vcl = false;
+    for (auto [pos, size] : nals)
+    {
+        if (size == 0)
+        {
+            continue;
+        }
+        auto header = u8(data, pos);
+        auto type = header & 0x1F;
+        bool vcl = type >= 1 && type <= 5;
+        if (has_vcl && (!vcl || (size > 1 && (u8(data, pos + 1) & 0x80))))
+        {
+            source.frames.push_back(std::move(frame));
+            frame.clear();
+            has_vcl = false;
+        }
+        has_vcl = has_vcl || vcl;
+        if (size <= mtu)
+        {
+            frame.emplace_back(data.begin() + pos, data.begin() + pos + size);
+            continue;
+        }
+        fragment(frame, data.data() + pos + 1, size - 1, mtu, [header, type](bool first, bool last) {
+            return Bytes {
+                std::byte (static_cast<std::uint8_t>((header & 0xE0) | 28)),
+                std::byte (static_cast<std::uint8_t>(type | (first ? 0x80 : 0) | (last ? 0x40 : 0))),
+            };
+        });
+    }
+    if (!frame.empty())
+    {
+        source.frames.push_back(std::move(frame));
+    }
+    return !source.frames.empty();
+}
+
+// rfc 7741 with the 1 byte payload descriptor, the frames come from an ivf container.
+static bool load_vp8(const Bytes & data, std::size_t mtu, Source & source)
+{
+    if (data.size() < 32 || std::memcmp(data.data(), "DKIF", 4) != 0)
+    {
+        return false;
+    }
+    std::size_t pos = u8(data, 6) | (u8(data, 7) << 8);
+    while (pos + 12 <= data.size())
+    {
+        std::size_t size = le32(data, pos);
+        pos += 12;
+        if (size == 0 || pos + size > data.size())
+        {
+            break;
+        }
+        std::vector<Bytes> frame {};
+        fragment(frame, data.data() + pos, size, mtu, [](bool first, bool) {
+            return Bytes {std::byte (static_cast<std::uint8_t>(first ? 0x10 : 0x00))};
+        });
+        source.frames.push_back(std::move(frame));
+        pos += size;
+    }
+    return !source.frames.empty();
+}
+
+// rfc 7587, one opus packet per rtp packet, the packets come from an ogg container. the id and comment headers are skipped.
+static bool load_opus(const Bytes & data, Source & source)
+{
+    std::size_t pos = 0;
+    std::size_t n_packets = 0;
+    Bytes packet {};
+    while (pos + 27 <= data.size() && std::memcmp(data.data() + pos, "OggS", 4) == 0)
+    {
+        std::size_t n_segments = u8(data, pos + 26);
+        auto body = pos + 27 + n_segments;
+        if (body > data.size())
+        {
+            break;
+        }
+        for (std::size_t s = 0; s < n_segments; ++s)
+        {
+            std::size_t lacing = u8(data, pos + 27 + s);
+            if (body + lacing > data.size())
+            {
+                return !source.frames.empty();
+            }
+            packet.insert(packet.end(), data.begin() + body, data.begin() + body + lacing);
+            body += lacing;
+            if (lacing < 255)
+            {
+                if (n_packets++ >= 2 && !packet.empty())
+                {
+                    source.frames.push_back({std::move(packet)});
+                }
+                packet.clear();
+            }
+        }
+        pos = body;
+    }
+    return !source.frames.empty();
+}
+
+static void generate_frames(const Options & opts, std::size_t mtu, Source & source)
+{
+    std::mt19937 rng {opts.seed};
+    // 1 second of distinct frames is enough to defeat any cache of the payloads.
+    auto n_frames = std::max<std::size_t>(1, static_cast<std::size_t>(opts.fps));
+    for (std::size_t i = 0; i < n_frames; ++i)
+    {
+        Bytes payload(std::max<std::size_t>(1, opts.frame_size));
+        for (auto & b : payload)
+        {
+            b = std::byte (static_cast<std::uint8_t>(rng()));
+        }
+        std::vector<Bytes> frame {};
+        fragment(frame, payload.data(), payload.size(), mtu, [](bool, bool) {
+            return Bytes {};
+        });
+        source.frames.push_back(std::move(frame));
+    }
+}
+
+static bool load_source(const Options & opts, Source & source)
+{
+    if (opts.codec == "opus")
+    {
+        source.payload_type = 111;
+        source.clock_rate = 48000;
+    }
+    if (!opts.capture.empty())
+    {
+        try
+        {
+            for (auto && packet : cfgo::load_rtp_capture(opts.capture))
+            {
+                source.offsets.push_back(std::chrono::duration_cast<clock_type::duration>(packet.offset));
+                source.frames.push_back({std::move(packet.data)});
+            }
+        }
+        catch (const std::exception & e)
+        {
+            fmt::print(stderr, "{}\n", e.what());
+            return false;
+        }
+        if (source.frames.empty())
+        {
+            fmt::print(stderr, "No rtp packet found in {}.\n", opts.capture);
+            return false;
+        }
+        // the loop restarts one mean gap after the last packet.
+        auto last = source.offsets.back();
+        source.loop_length = last + (source.offsets.size() > 1 ? last / static_cast<int>(source.offsets.size() - 1) : std::chrono::milliseconds {1});
+        source.captured = true;
+        return true;
+    }
+    // the rtp header takes 12 bytes of the mtu.
+    auto mtu = opts.mtu - 12;
+    if (opts.input.empty())
+    {
+        generate_frames(opts, mtu, source);
+        return true;
+    }
+    auto data = read_file(opts.input);
+    if (!data)
+    {
+        fmt::print(stderr, "Unable to read {}.\n", opts.input);
+        return false;
+    }
+    bool ok = false;
+    if (opts.codec == "h264")
+    {
+        ok = load_h264(*data, mtu, source);
+    }
+    else if (opts.codec == "vp8")
+    {
+        ok = load_vp8(*data, mtu, source);
+    }
+    else if (opts.codec == "opus")
+    {
+        ok = load_opus(*data, source);
+    }
+    if (!ok)
+    {
+        fmt::print(stderr, "No {} frame found in {}.\n", opts.codec, opts.input);
+    }
+    return ok;
+}
+
+struct TrackStats
+{
+    cfgo::LatencyHistogram ingest;
+    cfgo::LatencyHistogram delivery;
+    std::atomic_uint64_t sent {0};
+    std::atomic_uint64_t lost {0};
+    std::atomic_uint64_t delivered {0};
+    std::atomic_uint64_t reordered {0};
+};
+
+/**
+ * The sender side of a track: the rtp header state and the state of the loss model.
+*/
+struct Sender
+{
+    cfgo::Track track;
+    TrackStats * stats;
+    clock_type::duration phase;
+    std::uint16_t seq;
+    std::uint32_t ssrc;
+    std::uint32_t base_ts;
+    std::uint64_t frame = 0;
+    bool in_loss_burst = false;
+};
+
+struct Pending
+{
+    clock_type::time_point due;
+    // keep the packets due at the same time in the sending order.
+    std::uint64_t order;
+    Sender * sender;
+    rtc::binary packet;
+
+    bool operator > (const Pending & other) const noexcept
+    {
+        return due > other.due || (due == other.due && order > other.order);
+    }
+};
+
+static rtc::binary make_rtp_packet(const Source & source, Sender & sender, const Bytes & payload, std::uint32_t ts, bool marker)
+{
+    rtc::binary packet(12 + payload.size());
+    auto put = [&packet](std::size_t pos, std::uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i)
+        {
+            packet[pos + i] = std::byte (static_cast<std::uint8_t>(value >> (8 * (bytes - 1 - i))));
+        }
+    };
+    packet[0] = std::byte {0x80};
+    packet[1] = std::byte (static_cast<std::uint8_t>(source.payload_type | (marker ? 0x80 : 0)));
+    put(2, sender.seq++, 2);
+    put(4, ts, 4);
+    put(8, sender.ssrc, 4);
+    std::memcpy(packet.data() + 12, payload.data(), payload.size());
+    return packet;
+}
+
+/**
+ * Schedule the frames of its senders on the clock of the source and inject the due packets, until the end time.
+*/
+static void run_producer(const Options & opts, const Source & source, std::vector<Sender *> senders, clock_type::time_point start, clock_type::time_point end, unsigned seed)
+{
+    using namespace std::chrono;
+    std::mt19937 rng {seed};
+    std::uniform_real_distribution<double> uniform {0.0, 1.0};
+    auto interval = duration_cast<clock_type::duration>(duration<double>(1.0 / opts.fps));
+    auto frame_time = [&](const Sender & sender) {
+        auto n = sender.frame / opts.burst * opts.burst;
+        if (!source.captured)
+        {
+            return start + sender.phase + interval * static_cast<std::int64_t>(n);
+        }
+        if (opts.speed == 0)
+        {
+            // 1 packet per nanosecond, more than any producer can inject.
+            return start + nanoseconds {static_cast<std::int64_t>(n)};
+        }
+        auto size = source.frames.size();
+        auto offset = source.loop_length * static_cast<std::int64_t>(n / size) + source.offsets[n % size];
+        return start + sender.phase + duration_cast<clock_type::duration>(offset / opts.speed);
+    };
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending {};
+    std::uint64_t order = 0;
+    do
+    {
+        auto now = clock_type::now();
+        auto next = end;
+        for (auto sender : senders)
+        {
+            // at most 256 frames per round, so a speed of 0 or a producer behind the schedule neither queues the whole duration nor starves the other senders.
+            for (auto [t, n] = std::pair {frame_time(*sender), 0}; t <= now && t < end && n < 256; t = frame_time(*sender), ++n)
+            {
+                auto & frame = source.frames[sender->frame % source.frames.size()];
+                auto ts = sender->base_ts + static_cast<std::uint32_t>(sender->frame * source.clock_rate / opts.fps);
+                ++sender->frame;
+                for (std::size_t i = 0; i < frame.size(); ++i)
+                {
+                    auto packet = source.captured ? rtc::binary(frame[i]) : make_rtp_packet(source, *sender, frame[i], ts, i + 1 == frame.size());
+                    // gilbert-elliott, the lost packets still take their seq.
+                    if (sender->in_loss_burst)
+                    {
+                        sender->in_loss_burst = uniform(rng) >= 1.0 / opts.burst_len;
+                    }
+                    else
+                    {
+                        sender->in_loss_burst = uniform(rng) < opts.burst_loss;
+                    }
+                    if (sender->in_loss_burst || uniform(rng) < opts.loss)
+                    {
+                        sender->stats->lost.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    auto delay = duration<double, std::milli>(opts.jitter_ms * uniform(rng));
+                    if (uniform(rng) < opts.reorder)
+                    {
+                        delay += duration<double, std::milli>(opts.reorder_ms);
+                    }
+                    pending.push(Pending {
+                        .due = t + duration_cast<clock_type::duration>(delay),
+                        .order = order++,
+                        .sender = sender,
+                        .packet = std::move(packet),
+                    });
+                }
+            }
+            next = std::min(next, frame_time(*sender));
+        }
+        while (!pending.empty() && pending.top().due <= now)
+        {
+            // the priority queue only gives a const top.
+            auto item = std::move(const_cast<Pending &>(pending.top()));
+            pending.pop();
+            auto begin = clock_type::now();
+            item.sender->track.inject_msg(std::move(item.packet));
+            item.sender->stats->ingest.record(clock_type::now() - begin);
+            item.sender->stats->sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!pending.empty())
+        {
+            next = std::min(next, pending.top().due);
+        }
+        else if (now >= end)
+        {
+            break;
+        }
+        std::this_thread::sleep_until(next);
+    } while (true);
+}
+
+/**
+ * The consumer side of a track, only touched by the single consumer of the track.
+*/
+struct Receiver
+{
+    cfgo::Track track;
+    TrackStats * stats;
+    std::optional<std::uint16_t> last_seq {};
+
+    void on_msg(const cfgo::Track::TimedMsg & msg, clock_type::time_point now)
+    {
+        stats->delivery.record(now - msg.arrival);
+        stats->delivered.fetch_add(1, std::memory_order_relaxed);
+        auto & data = *msg.msg;
+        if (data.size() < 12)
+        {
+            return;
+        }
+        std::uint16_t seq = (std::to_integer<std::uint16_t>(data[2]) << 8) | std::to_integer<std::uint16_t>(data[3]);
+        if (last_seq && static_cast<std::int16_t>(seq - *last_seq) < 0)
+        {
+            stats->reordered.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            last_seq = seq;
+        }
+    }
+};
+
+// poll the tracks round robin every 100us when idle, like a user which does not use coroutines.
+static void run_receive_consumers(const Options & opts, std::vector<Receiver> & receivers, std::atomic_bool & stop)
+{
+    std::vector<std::thread> threads {};
+    for (int c = 0; c < opts.consumers; ++c)
+    {
+        threads.emplace_back([&opts, &receivers, &stop, c]() {
+            do
+            {
+                bool stopping = stop.load(std::memory_order_acquire);
+                bool idle = true;
+                for (std::size_t i = c; i < receivers.size(); i += opts.consumers)
+                {
+                    while (auto msg = receivers[i].track.receive_timed_msg(cfgo::Track::MsgType::RTP))
+                    {
+                        receivers[i].on_msg(msg, clock_type::now());
+                        idle = false;
+                    }
+                }
+                if (stopping && idle)
+                {
+                    break;
+                }
+                if (idle)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds {100});
+                }
+            } while (true);
+        });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// one coroutine per track awaiting the packets, like the users of Track::await_msg.
+static void run_await_consumers(const Options & opts, std::vector<Receiver> & receivers)
+{
+    asio::thread_pool pool {static_cast<std::size_t>(opts.consumers)};
+    for (auto & receiver : receivers)
+    {
+        asio::co_spawn(pool.get_executor(), cfgo::fix_async_lambda([&receiver]() -> asio::awaitable<void> {
+            do
+            {
+                auto msg = co_await receiver.track.await_timed_msg(cfgo::Track::MsgType::RTP, cfgo::INVALID_CLOSE_CHAN);
+                if (!msg)
+                {
+                    co_return;
+                }
+                receiver.on_msg(msg, clock_type::now());
+            } while (true);
+        }), asio::detached);
+    }
+    pool.join();
+}
+
+#ifdef CFGO_SUPPORT_GSTREAMER
+static void destroy_msg(gpointer data)
+{
+    delete static_cast<rtc::binary *>(data);
+}
+
+/**
+ * One appsrc pipeline per track, fed like CfgoSrc::_post_buffer does:
+ * await the first packet, take the arrived ones, wrap them without copy and push them as one buffer list.
+ * The delivery latency is taken at the push, it is the track_to_push latency of cfgosrc.
+*/
+static bool run_pipeline_consumers(const Options & opts, std::vector<Receiver> & receivers)
+{
+    gst_init(nullptr, nullptr);
+    std::vector<GstElement *> pipelines {};
+    DEFER({
+        for (auto pipeline : pipelines)
+        {
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            gst_object_unref(pipeline);
+        }
+    });
+    auto description = fmt::format("appsrc name=src format=time max-bytes=0 ! {}", opts.pipeline);
+    for (std::size_t i = 0; i < receivers.size(); ++i)
+    {
+        GError * error = nullptr;
+        auto pipeline = gst_parse_launch(description.c_str(), &error);
+        if (error)
+        {
+            fmt::print(stderr, "Unable to create the pipeline \"{}\": {}\n", description, error->message);
+            g_error_free(error);
+            if (pipeline)
+            {
+                gst_object_unref(pipeline);
+            }
+            return false;
+        }
+        pipelines.push_back(pipeline);
+        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    }
+    asio::thread_pool pool {static_cast<std::size_t>(opts.consumers)};
+    for (std::size_t i = 0; i < receivers.size(); ++i)
+    {
+        auto appsrc = gst_bin_get_by_name(GST_BIN(pipelines[i]), "src");
+        asio::co_spawn(pool.get_executor(), cfgo::fix_async_lambda([receiver = &receivers[i], appsrc]() -> asio::awaitable<void> {
+            DEFER({
+                gst_object_unref(appsrc);
+            });
+            std::vector<cfgo::Track::TimedMsg> msgs {};
+            do
+            {
+                msgs.clear();
+                auto first = co_await receiver->track.await_timed_msg(cfgo::Track::MsgType::RTP, cfgo::INVALID_CLOSE_CHAN);
+                if (!first)
+                {
+                    co_return;
+                }
+                msgs.push_back(std::move(first));
+                while (auto next = receiver->track.receive_timed_msg(cfgo::Track::MsgType::RTP))
+                {
+                    msgs.push_back(std::move(next));
+                }
+                auto list = gst_buffer_list_new_sized(msgs.size());
+                auto now = clock_type::now();
+                for (auto && msg : msgs)
+                {
+                    receiver->on_msg(msg, now);
+                    auto size = msg.msg->size();
+                    auto data = msg.msg->data();
+                    gst_buffer_list_add(list, gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, data, size, 0, size, msg.msg.release(), destroy_msg));
+                }
+                gst_app_src_push_buffer_list(GST_APP_SRC(appsrc), list);
+            } while (true);
+        }), asio::detached);
+    }
+    pool.join();
+    return true;
+}
+#endif
+
+static void print_report(const Options & opts, const std::vector<Receiver> & receivers, const std::vector<std::unique_ptr<TrackStats>> & stats, double wall_seconds, double cpu_seconds)
+{
+    using namespace std::chrono;
+    auto us = [](nanoseconds ns) {
+        return duration<double, std::micro>(ns).count();
+    };
+    fmt::print("{:<12} {:>9} {:>7} {:>9} {:>8} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>8}\n",
+        "track", "sent", "lost", "delivered", "dropped", "reorder",
+        "ingest p50", "ingest p99", "ingest max", "deliv p50", "deliv p99", "deliv max", "ingest%");
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < receivers.size(); ++i)
+    {
+        auto & s = *stats[i];
+        auto ingest = s.ingest.snapshot();
+        auto delivery = s.delivery.snapshot();
+        total += s.delivered.load();
+        fmt::print("{:<12} {:>9} {:>7} {:>9} {:>8} {:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>8.3f}\n",
+            receivers[i].track.global_id(), s.sent.load(), s.lost.load(), s.delivered.load(), receivers[i].track.get_rtp_drops_packets(), s.reordered.load(),
+            us(ingest.percentile(0.5)), us(ingest.percentile(0.99)), us(ingest.max),
+            us(delivery.percentile(0.5)), us(delivery.percentile(0.99)), us(delivery.max),
+            // the share of a core spent in on_track_msg for this track.
+            100.0 * duration<double>(ingest.sum).count() / wall_seconds);
+    }
+    fmt::print("latencies in us, mode {}, {} packets delivered in {:.2f}s, {:.0f} packets/s\n", opts.mode, total, wall_seconds, total / wall_seconds);
+    fmt::print("cpu {:.1f}% of a core, {:.2f}% per track\n", 100.0 * cpu_seconds / wall_seconds, 100.0 * cpu_seconds / wall_seconds / receivers.size());
+}
+
+int main(int argc, char ** argv)
+{
+    using namespace std::chrono;
+    Options opts {};
+    if (!parse_options(argc, argv, opts))
+    {
+        print_usage();
+        return 1;
+    }
+    #ifndef CFGO_SUPPORT_GSTREAMER
+    if (opts.mode == "pipeline")
+    {
+        fmt::print(stderr, "The pipeline mode needs the gstreamer support.\n");
+        return 1;
+    }
+    #endif
+    Source source {};
+    if (!load_source(opts, source))
+    {
+        return 1;
+    }
+
+    std::mt19937 rng {opts.seed};
+    std::vector<std::unique_ptr<TrackStats>> stats {};
+    std::vector<Sender> senders {};
+    std::vector<Receiver> receivers {};
+    auto interval = duration_cast<clock_type::duration>(duration<double>(1.0 / opts.fps));
+    for (int i = 0; i < opts.tracks; ++i)
+    {
+        auto msg = sio::object_message::create();
+        msg->get_map()["type"] = sio::string_message::create(opts.codec == "opus" ? "audio" : "video");
+        msg->get_map()["globalId"] = sio::string_message::create(fmt::format("loadgen-{}", i));
+        cfgo::Track track {msg, opts.cache};
+        track.prepare_injected();
+        stats.push_back(std::make_unique<TrackStats>());
+        senders.push_back(Sender {
+            .track = track,
+            .stats = stats.back().get(),
+            // spread the frames of the tracks over the frame interval.
+            .phase = interval * i / opts.tracks,
+            .seq = static_cast<std::uint16_t>(rng()),
+            .ssrc = static_cast<std::uint32_t>(rng()),
+            .base_ts = static_cast<std::uint32_t>(rng()),
+        });
+        receivers.push_back(Receiver {
+            .track = track,
+            .stats = stats.back().get(),
+        });
+    }
+
+    auto cpu_start = std::clock();
+    auto start = clock_type::now();
+    auto end = start + duration_cast<clock_type::duration>(duration<double>(opts.duration));
+    std::atomic_bool stop {false};
+    std::vector<std::thread> producers {};
+    for (int p = 0; p < opts.producers; ++p)
+    {
+        std::vector<Sender *> owned {};
+        for (std::size_t i = p; i < senders.size(); i += opts.producers)
+        {
+            owned.push_back(&senders[i]);
+        }
+        producers.emplace_back(run_producer, std::cref(opts), std::cref(source), std::move(owned), start, end, opts.seed + 1 + p);
+    }
+    std::thread closer([&]() {
+        for (auto & producer : producers)
+        {
+            producer.join();
+        }
+        stop.store(true, std::memory_order_release);
+        // the consumers drain the caches, then the awaits return nothing.
+        for (auto & sender : senders)
+        {
+            sender.track.close_injected();
+        }
+    });
+    bool ok = true;
+    if (opts.mode == "receive")
+    {
+        run_receive_consumers(opts, receivers, stop);
+    }
+    else if (opts.mode == "await")
+    {
+        run_await_consumers(opts, receivers);
+    }
+    #ifdef CFGO_SUPPORT_GSTREAMER
+    else
+    {
+        ok = run_pipeline_consumers(opts, receivers);
+    }
+    #endif
+    closer.join();
+    auto wall_seconds = duration<double>(clock_type::now() - start).count();
+    auto cpu_seconds = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    if (!ok)
+    {
+        return 1;
+    }
+    print_report(opts, receivers, stats, wall_seconds, cpu_seconds);
+    return 0;
+}
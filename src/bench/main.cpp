@@ -0,0 +1,35 @@
+#include "benchmark/benchmark.h"
+#include <cstring>
+#include <vector>
+
+/**
+ * The entry of bench-cfgo and bench-frame-alloc. The report is json unless --benchmark_format is given,
+ * so the results of the releases could be diffed with tools/compare.py of Google Benchmark.
+*/
+
+int main(int argc, char **argv)
+{
+    std::vector<char *> args(argv, argv + argc);
+    bool has_format = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--benchmark_format", 18) == 0)
+        {
+            has_format = true;
+        }
+    }
+    char json_format[] = "--benchmark_format=json";
+    if (!has_format)
+    {
+        args.push_back(json_format);
+    }
+    int n = static_cast<int>(args.size());
+    benchmark::Initialize(&n, args.data());
+    if (benchmark::ReportUnrecognizedArguments(n, args.data()))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "impl/track.hpp"
+#include "cfgo/async.hpp"
+#include "asio.hpp"
+#include "benchmark/benchmark.h"
+#include "rtc/rtc.hpp"
+#include "sio_message.h"
+#include <atomic>
+#include <thread>
+
+/**
+ * impl::Track from on_track_msg, where libdatachannel hands over the packets, to receive_msg/await_msg, where cfgosrc takes them.
+ * range(0) is the cache capicity of the track.
+*/
+
+static std::shared_ptr<cfgo::impl::Track> make_track(int cache_capicity)
+{
+    auto track = std::make_shared<cfgo::impl::Track>(sio::object_message::create(), cache_capicity);
+    track->prepare_injected();
+    return track;
+}
+
+static rtc::binary make_rtp_packet(std::size_t size)
+{
+    rtc::binary packet(size, std::byte {0});
+    // version 2 and a dynamic payload type, so it is not taken as rtcp.
+    packet[0] = std::byte {0x80};
+    packet[1] = std::byte {96};
+    return packet;
+}
+
+// fill the cache then drain it on the same thread, no wait involved.
+static void BM_TrackIngestReceive(benchmark::State & state)
+{
+    auto cache_capicity = static_cast<int>(state.range(0));
+    auto track = make_track(cache_capicity);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < cache_capicity; ++i)
+        {
+            track->on_track_msg(make_rtp_packet(1200));
+        }
+        for (int i = 0; i < cache_capicity; ++i)
+        {
+            benchmark::DoNotOptimize(track->receive_msg(cfgo::Track::MsgType::RTP));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * cache_capicity);
+    state.SetBytesProcessed(state.iterations() * cache_capicity * 1200);
+}
+BENCHMARK(BM_TrackIngestReceive)->Arg(16)->Arg(256)->Arg(4096);
+
+// a producer thread keeps ingesting while a coroutine awaits, one iteration is one packet received.
+static void BM_TrackIngestAwait(benchmark::State & state)
+{
+    using namespace cfgo;
+    auto track = make_track(static_cast<int>(state.range(0)));
+    std::atomic_bool stop {false};
+    std::thread producer([track, &stop]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            track->on_track_msg(make_rtp_packet(1200));
+        }
+    });
+    asio::io_context ctx {};
+    asio::co_spawn(ctx, fix_async_lambda([&state, track]() -> asio::awaitable<void> {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(co_await track->await_msg(cfgo::Track::MsgType::RTP, INVALID_CLOSE_CHAN));
+        }
+    }), asio::detached);
+    ctx.run();
+    stop = true;
+    producer.join();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(track->get_rtp_drops_packets()));
+}
+BENCHMARK(BM_TrackIngestAwait)->Arg(16)->Arg(256)->Arg(4096)->UseRealTime();
@@ -3,6 +3,8 @@
 #include "cfgo/utils.hpp"
 #include "cfgo/async.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/metrics.hpp"
+#include "cfgo/event_trace.hpp"
 #include "cpptrace/cpptrace.hpp"
 #include "spdlog/spdlog.h"
 #include "asio/io_context.hpp"
@@ -12,7 +14,10 @@
 #include "asio/detached.hpp"
 #include "boost/algorithm/string.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <exception>
+#include <limits>
 #include <mutex>
 #include <vector>
 #include <string>
@@ -572,4 +577,69 @@ CFGO_API int cfgo_track_unref(int track_handle)
         cfgo::unref_track(track_handle);
         return CFGO_ERR_SUCCESS;
     });
+}
+
+CFGO_API int cfgo_metrics_export_text(char * buf, int size)
+{
+    return cfgo::c_wrap([=]() {
+        // reused by the next scrape of the same thread, the text of hundreds of streams is large.
+        thread_local std::string text {};
+        text.clear();
+        cfgo::metrics::Registry::instance().export_text(text);
+        if (text.size() > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+        {
+            throw cpptrace::runtime_error("The metrics text is too large.");
+        }
+        if (buf && size > 0)
+        {
+            auto n = std::min(text.size(), static_cast<std::size_t>(size - 1));
+            std::memcpy(buf, text.data(), n);
+            buf[n] = '\0';
+        }
+        return static_cast<int>(text.size());
+    });
+}
+
+CFGO_API int cfgo_event_trace_start(int ring_size)
+{
+    return cfgo::c_wrap([=]() {
+        cfgo::event_trace::Configure conf {};
+        if (ring_size > 0)
+        {
+            conf.ring_size = static_cast<std::size_t>(ring_size);
+        }
+        cfgo::event_trace::start(conf);
+        return CFGO_ERR_SUCCESS;
+    });
+}
+
+CFGO_API int cfgo_event_trace_stop()
+{
+    return cfgo::c_wrap([=]() {
+        cfgo::event_trace::stop();
+        return CFGO_ERR_SUCCESS;
+    });
+}
+
+CFGO_API int cfgo_event_trace_dump(const char * path)
+{
+    return cfgo::c_wrap([=]() {
+        if (!path)
+        {
+            throw cpptrace::runtime_error("The path must not be null.");
+        }
+        if (!cfgo::event_trace::dump(std::string(path)))
+        {
+            throw cpptrace::runtime_error("Unable to write the event trace to " + std::string(path) + ".");
+        }
+        return CFGO_ERR_SUCCESS;
+    });
+}
+
+CFGO_API int cfgo_event_trace_install_crash_handler(const char * path)
+{
+    return cfgo::c_wrap([=]() {
+        cfgo::event_trace::install_crash_handler(path ? std::string(path) : std::string());
+        return CFGO_ERR_SUCCESS;
+    });
 }
\ No newline at end of file
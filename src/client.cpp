@@ -71,4 +71,14 @@ namespace cfgo
     {
         return impl()->get_closer();
     }
+
+    const Configuration & Client::config() const noexcept
+    {
+        return impl()->config();
+    }
+
+    const std::string & Client::id() const noexcept
+    {
+        return impl()->id();
+    }
 }
@@ -0,0 +1,464 @@
+#include "cfgo/event_trace.hpp"
+#include "cpptrace/cpptrace.hpp"
+#include "spdlog/details/os.h"
+
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cfgo
+{
+    namespace event_trace
+    {
+        namespace detail
+        {
+            // a seqlock per slot, so the dumper skips the slots being overwritten instead of locking the owner.
+            struct Slot
+            {
+                std::atomic<std::uint64_t> seq {0};
+                std::atomic<std::uint64_t> time_ns {0};
+                std::atomic<std::uint64_t> object {0};
+                std::atomic<std::uint64_t> arg {0};
+                std::atomic<std::uint32_t> info {0};
+            };
+
+            struct Ring
+            {
+                Ring(std::size_t size, std::uint32_t index):
+                    mask(size - 1),
+                    slots(std::make_unique<Slot[]>(size)),
+                    index(index)
+                {}
+
+                const std::size_t mask;
+                std::unique_ptr<Slot[]> slots;
+                const std::uint32_t index;
+                // only written by the owner thread.
+                std::atomic<std::uint64_t> pos {0};
+                std::atomic<std::uint64_t> thread_id {0};
+                std::atomic_bool in_use {true};
+                // immutable after published.
+                Ring * next = nullptr;
+            };
+
+            // the rings are never released, so the crash handler could walk them without any lock.
+            static std::atomic<Ring *> s_rings {nullptr};
+            static std::atomic<std::uint32_t> s_ring_count {0};
+            static std::atomic<std::size_t> s_ring_size {Configure {}.ring_size};
+
+            static Ring * claim_ring()
+            {
+                for (auto ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+                {
+                    bool in_use = false;
+                    if (!ring->in_use.load(std::memory_order_relaxed) && ring->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+                    {
+                        ring->thread_id.store(spdlog::details::os::thread_id(), std::memory_order_relaxed);
+                        return ring;
+                    }
+                }
+                auto ring = new Ring(s_ring_size.load(std::memory_order_relaxed), s_ring_count.fetch_add(1, std::memory_order_relaxed));
+                ring->thread_id.store(spdlog::details::os::thread_id(), std::memory_order_relaxed);
+                auto head = s_rings.load(std::memory_order_relaxed);
+                do
+                {
+                    ring->next = head;
+                } while (!s_rings.compare_exchange_weak(head, ring, std::memory_order_release, std::memory_order_relaxed));
+                return ring;
+            }
+
+            struct ThreadRing
+            {
+                Ring * ring = nullptr;
+
+                ~ThreadRing()
+                {
+                    if (ring)
+                    {
+                        ring->in_use.store(false, std::memory_order_release);
+                    }
+                }
+            };
+
+            static thread_local ThreadRing t_ring {};
+
+            void record(Event event, Phase phase, std::uint64_t object, std::uint64_t arg) noexcept
+            {
+                auto ring = t_ring.ring;
+                if (!ring)
+                {
+                    try
+                    {
+                        ring = t_ring.ring = claim_ring();
+                    }
+                    catch(...)
+                    {
+                        return;
+                    }
+                }
+                auto time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                auto pos = ring->pos.load(std::memory_order_relaxed);
+                auto & slot = ring->slots[pos & ring->mask];
+                slot.seq.store(pos * 2 + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.time_ns.store(static_cast<std::uint64_t>(time_ns), std::memory_order_relaxed);
+                slot.object.store(object, std::memory_order_relaxed);
+                slot.arg.store(arg, std::memory_order_relaxed);
+                slot.info.store((static_cast<std::uint32_t>(event) << 8) | static_cast<std::uint32_t>(phase), std::memory_order_relaxed);
+                slot.seq.store(pos * 2 + 2, std::memory_order_release);
+                ring->pos.store(pos + 1, std::memory_order_release);
+            }
+
+            // formats into a fixed buffer without allocating, so it is usable by the crash handler.
+            class TraceWriter
+            {
+            public:
+                using Flush = void(*)(void * ctx, const char * data, std::size_t size);
+
+                TraceWriter(Flush flush, void * ctx) noexcept: m_flush(flush), m_ctx(ctx) {}
+
+                void put(const char * str) noexcept
+                {
+                    while (*str)
+                    {
+                        _put(*str++);
+                    }
+                }
+
+                void put_u64(std::uint64_t v) noexcept
+                {
+                    char buf[20];
+                    int n = 0;
+                    do
+                    {
+                        buf[n++] = static_cast<char>('0' + v % 10);
+                        v /= 10;
+                    } while (v);
+                    while (n)
+                    {
+                        _put(buf[--n]);
+                    }
+                }
+
+                void put_hex(std::uint64_t v) noexcept
+                {
+                    constexpr const char * digits = "0123456789abcdef";
+                    put("0x");
+                    int shift = 60;
+                    while (shift > 0 && ((v >> shift) & 0xf) == 0)
+                    {
+                        shift -= 4;
+                    }
+                    for (; shift >= 0; shift -= 4)
+                    {
+                        _put(digits[(v >> shift) & 0xf]);
+                    }
+                }
+
+                // the trace format takes microseconds.
+                void put_us(std::uint64_t ns) noexcept
+                {
+                    put_u64(ns / 1000);
+                    _put('.');
+                    auto frac = ns % 1000;
+                    _put(static_cast<char>('0' + frac / 100));
+                    _put(static_cast<char>('0' + frac / 10 % 10));
+                    _put(static_cast<char>('0' + frac % 10));
+                }
+
+                void flush() noexcept
+                {
+                    if (m_size > 0)
+                    {
+                        m_flush(m_ctx, m_buf, m_size);
+                        m_size = 0;
+                    }
+                }
+
+            private:
+                Flush m_flush;
+                void * m_ctx;
+                char m_buf[4096];
+                std::size_t m_size = 0;
+
+                void _put(char c) noexcept
+                {
+                    if (m_size == sizeof(m_buf))
+                    {
+                        flush();
+                    }
+                    m_buf[m_size++] = c;
+                }
+            };
+
+            static std::uint64_t process_id() noexcept
+            {
+#ifdef _WIN32
+                return static_cast<std::uint64_t>(_getpid());
+#else
+                return static_cast<std::uint64_t>(::getpid());
+#endif
+            }
+
+            static void write_trace(TraceWriter & writer) noexcept
+            {
+                auto pid = process_id();
+                bool first = true;
+                writer.put("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+                for (auto ring = s_rings.load(std::memory_order_acquire); ring; ring = ring->next)
+                {
+                    auto tid = ring->thread_id.load(std::memory_order_relaxed);
+                    writer.put(first ? "\n" : ",\n");
+                    first = false;
+                    writer.put("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":");
+                    writer.put_u64(pid);
+                    writer.put(",\"tid\":");
+                    writer.put_u64(tid);
+                    writer.put(",\"args\":{\"name\":\"cfgo-");
+                    writer.put_u64(ring->index);
+                    writer.put("\"}}");
+                    auto end = ring->pos.load(std::memory_order_acquire);
+                    auto size = ring->mask + 1;
+                    for (auto pos = end > size ? end - size : 0; pos < end; ++pos)
+                    {
+                        auto & slot = ring->slots[pos & ring->mask];
+                        auto seq = slot.seq.load(std::memory_order_acquire);
+                        if (seq != pos * 2 + 2)
+                        {
+                            continue;
+                        }
+                        auto time_ns = slot.time_ns.load(std::memory_order_relaxed);
+                        auto object = slot.object.load(std::memory_order_relaxed);
+                        auto arg = slot.arg.load(std::memory_order_relaxed);
+                        auto info = slot.info.load(std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        if (slot.seq.load(std::memory_order_relaxed) != seq)
+                        {
+                            continue;
+                        }
+                        auto event = static_cast<Event>(info >> 8);
+                        auto phase = static_cast<Phase>(info & 0xff);
+                        auto name = get_event_name(event);
+                        writer.put(",\n{\"name\":\"");
+                        writer.put(name);
+                        writer.put("\",\"cat\":\"");
+                        writer.put(name);
+                        writer.put(phase == Phase::BEGIN ? "\",\"ph\":\"b\"" : (phase == Phase::END ? "\",\"ph\":\"e\"" : "\",\"ph\":\"n\""));
+                        writer.put(",\"id\":\"");
+                        writer.put_hex(object);
+                        writer.put("\",\"pid\":");
+                        writer.put_u64(pid);
+                        writer.put(",\"tid\":");
+                        writer.put_u64(tid);
+                        writer.put(",\"ts\":");
+                        writer.put_us(time_ns);
+                        writer.put(",\"args\":{\"arg\":");
+                        writer.put_u64(arg);
+                        writer.put("}}");
+                    }
+                }
+                writer.put("\n]}\n");
+                writer.flush();
+            }
+
+            static void write_fd(void * ctx, const char * data, std::size_t size)
+            {
+                auto fd = *static_cast<int *>(ctx);
+                while (size > 0)
+                {
+#ifdef _WIN32
+                    auto n = ::_write(fd, data, static_cast<unsigned int>(size));
+#else
+                    auto n = ::write(fd, data, size);
+#endif
+                    if (n <= 0)
+                    {
+                        return;
+                    }
+                    data += n;
+                    size -= static_cast<std::size_t>(n);
+                }
+            }
+
+            static char s_crash_path[4096] {};
+            static std::atomic_flag s_crash_dumping = ATOMIC_FLAG_INIT;
+            static constexpr int CRASH_SIGNALS[] = {
+                SIGSEGV,
+                SIGFPE,
+                SIGILL,
+                SIGABRT,
+#ifndef _WIN32
+                SIGBUS,
+#endif
+            };
+            static constexpr std::size_t CRASH_SIGNAL_COUNT = sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]);
+
+            static void crash_dump() noexcept
+            {
+                if (s_crash_dumping.test_and_set())
+                {
+                    return;
+                }
+#ifdef _WIN32
+                int fd = ::_open(s_crash_path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+                int fd = ::open(s_crash_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+                if (fd < 0)
+                {
+                    return;
+                }
+                TraceWriter writer(write_fd, &fd);
+                write_trace(writer);
+#ifdef _WIN32
+                ::_close(fd);
+#else
+                ::close(fd);
+#endif
+            }
+
+#ifdef _WIN32
+            using signal_handler_t = void(*)(int);
+            static signal_handler_t s_prev_handlers[CRASH_SIGNAL_COUNT] {};
+
+            static void crash_handler(int sig)
+            {
+                crash_dump();
+                for (std::size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i)
+                {
+                    if (CRASH_SIGNALS[i] == sig)
+                    {
+                        std::signal(sig, s_prev_handlers[i] ? s_prev_handlers[i] : SIG_DFL);
+                    }
+                }
+                std::raise(sig);
+            }
+#else
+            static struct sigaction s_prev_actions[CRASH_SIGNAL_COUNT] {};
+
+            static void crash_handler(int sig, siginfo_t *, void *)
+            {
+                crash_dump();
+                for (std::size_t i = 0; i < CRASH_SIGNAL_COUNT; ++i)
+                {
+                    if (CRASH_SIGNALS[i] == sig)
+                    {
+                        ::sigaction(sig, &s_prev_actions[i], nullptr);
+                    }
+                }
+                // delivered to the previous handler once this one returns.
+                ::raise(sig);
+            }
+#endif
+        } // namespace detail
+
+        void Configure::validate() const
+        {
+            if (ring_size < 2)
+            {
+                throw cpptrace::runtime_error("Invalid ring_size. The ring_size must be greater or equal than 2.");
+            }
+        }
+
+        const char * get_event_name(Event event) noexcept
+        {
+            switch (event)
+            {
+            case Event::CHAN_WAIT:
+                return "chan_wait";
+            case Event::MUTEX_WAIT:
+                return "mutex_wait";
+            case Event::BLOCKER_LOCK:
+                return "blocker_lock";
+            case Event::SUBSCRIBE:
+                return "subscribe";
+            case Event::SRC_READ:
+                return "src_read";
+            case Event::SRC_NEED_DATA:
+                return "src_need_data";
+            case Event::PACKET_INGEST:
+                return "packet_ingest";
+            case Event::PACKET_PUSH:
+                return "packet_push";
+            case Event::CLOSE:
+                return "close";
+            default:
+                return "unknown";
+            }
+        }
+
+        void start(const Configure & conf)
+        {
+            conf.validate();
+            detail::s_ring_size.store(std::bit_ceil(conf.ring_size), std::memory_order_relaxed);
+            detail::s_enabled.store(true, std::memory_order_relaxed);
+        }
+
+        void stop() noexcept
+        {
+            detail::s_enabled.store(false, std::memory_order_relaxed);
+        }
+
+        void dump(std::ostream & os)
+        {
+            detail::TraceWriter writer([](void * ctx, const char * data, std::size_t size) {
+                static_cast<std::ostream *>(ctx)->write(data, static_cast<std::streamsize>(size));
+            }, &os);
+            detail::write_trace(writer);
+        }
+
+        bool dump(const std::string & path)
+        {
+            std::ofstream os(path, std::ios::binary | std::ios::trunc);
+            if (!os)
+            {
+                return false;
+            }
+            dump(os);
+            return static_cast<bool>(os);
+        }
+
+        void install_crash_handler(const std::string & path)
+        {
+            if (path.empty() || path.size() >= sizeof(detail::s_crash_path))
+            {
+                throw cpptrace::runtime_error("Invalid path. The path must not be empty and shorter than 4096.");
+            }
+            std::memcpy(detail::s_crash_path, path.c_str(), path.size() + 1);
+            for (std::size_t i = 0; i < detail::CRASH_SIGNAL_COUNT; ++i)
+            {
+#ifdef _WIN32
+                auto prev = std::signal(detail::CRASH_SIGNALS[i], detail::crash_handler);
+                if (prev != detail::crash_handler && prev != SIG_ERR)
+                {
+                    detail::s_prev_handlers[i] = prev;
+                }
+#else
+                struct sigaction action {};
+                action.sa_sigaction = detail::crash_handler;
+                action.sa_flags = SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+                struct sigaction prev {};
+                ::sigaction(detail::CRASH_SIGNALS[i], &action, &prev);
+                // installed twice, keep the real previous one.
+                if (prev.sa_sigaction != detail::crash_handler)
+                {
+                    detail::s_prev_actions[i] = prev;
+                }
+#endif
+            }
+        }
+    } // namespace event_trace
+} // namespace cfgo
@@ -1,6 +1,13 @@
 #include "cfgo/gst/appsink.hpp"
-#include "boost/circular_buffer.hpp"
+#include "cfgo/gst/latency_meta.hpp"
+#include "cfgo/metrics.hpp"
+#include "cfgo/mpmc_chan.hpp"
+#include "cfgo/defer.hpp"
+#include "gst/video/video.h"
+#include "cpptrace/cpptrace.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <limits>
 
@@ -10,35 +17,224 @@ namespace cfgo
     {
         namespace detail
         {
+            static void record_sample_latency(GstSample * sample)
+            {
+                if (auto buffer = gst_sample_get_buffer(sample))
+                {
+                    record_buffer_latency(buffer);
+                }
+            }
+
+            /**
+             * A broadcast ring with one writer and many cursors. The writer never waits for the cursors.
+             * A slot is released once every cursor has passed it, so the ring does not keep the buffers of the pool.
+            */
+            class SampleRing
+            {
+            public:
+                struct Cursor
+                {
+                    std::uint64_t m_pos;
+                    std::uint64_t m_dropped = 0;
+                    unique_void_chan m_notify {};
+                };
+
+                explicit SampleRing(std::size_t capacity): m_slots(capacity > 0 ? capacity : 1) {}
+                SampleRing(const SampleRing &) = delete;
+                SampleRing & operator = (const SampleRing &) = delete;
+
+                void write(GstSampleSPtr sample);
+                void close();
+                std::shared_ptr<Cursor> create_cursor();
+                auto read_n(Cursor & cursor, std::size_t n, close_chan closer) -> asio::awaitable<std::vector<GstSampleSPtr>>;
+                std::uint64_t dropped(const Cursor & cursor) const;
+            private:
+                mutable mutex m_mutex;
+                std::vector<GstSampleSPtr> m_slots;
+                std::uint64_t m_write_pos = 0;
+                // the slots before it are released or overwritten.
+                std::uint64_t m_release_pos = 0;
+                bool m_closed = false;
+                std::vector<std::weak_ptr<Cursor>> m_cursors {};
+
+                void _notify_cursors();
+                void _release_passed(std::vector<GstSampleSPtr> & released);
+            };
+
+            void SampleRing::_notify_cursors()
+            {
+                std::erase_if(m_cursors, [](const std::weak_ptr<Cursor> & weak_cursor) {
+                    if (auto cursor = weak_cursor.lock())
+                    {
+                        chan_maybe_write(cursor->m_notify);
+                        return false;
+                    }
+                    return true;
+                });
+            }
+
+            void SampleRing::_release_passed(std::vector<GstSampleSPtr> & released)
+            {
+                auto min_pos = m_write_pos;
+                for (auto && weak_cursor : m_cursors)
+                {
+                    if (auto cursor = weak_cursor.lock())
+                    {
+                        min_pos = std::min(min_pos, cursor->m_pos);
+                    }
+                }
+                if (m_write_pos > m_slots.size())
+                {
+                    m_release_pos = std::max(m_release_pos, m_write_pos - m_slots.size());
+                }
+                for (; m_release_pos < min_pos; ++m_release_pos)
+                {
+                    if (auto & slot = m_slots[m_release_pos % m_slots.size()])
+                    {
+                        released.push_back(std::move(slot));
+                    }
+                }
+            }
+
+            void SampleRing::write(GstSampleSPtr sample)
+            {
+                // the overwritten and the released samples are released outside of the lock.
+                std::vector<GstSampleSPtr> released {};
+                {
+                    std::lock_guard lk(m_mutex);
+                    std::swap(m_slots[m_write_pos % m_slots.size()], sample);
+                    ++m_write_pos;
+                    _notify_cursors();
+                    // no cursor left, or all of them are waiting at the end.
+                    _release_passed(released);
+                }
+            }
+
+            void SampleRing::close()
+            {
+                std::lock_guard lk(m_mutex);
+                m_closed = true;
+                _notify_cursors();
+            }
+
+            auto SampleRing::create_cursor() -> std::shared_ptr<Cursor>
+            {
+                std::lock_guard lk(m_mutex);
+                auto cursor = std::make_shared<Cursor>();
+                cursor->m_pos = m_write_pos;
+                m_cursors.push_back(cursor);
+                return cursor;
+            }
+
+            auto SampleRing::read_n(Cursor & cursor, std::size_t n, close_chan closer) -> asio::awaitable<std::vector<GstSampleSPtr>>
+            {
+                std::vector<GstSampleSPtr> samples {};
+                std::vector<GstSampleSPtr> released {};
+                do
+                {
+                    {
+                        std::lock_guard lk(m_mutex);
+                        if (m_write_pos - cursor.m_pos > m_slots.size())
+                        {
+                            // too slow, skip the overwritten samples.
+                            auto oldest = m_write_pos - m_slots.size();
+                            cursor.m_dropped += oldest - cursor.m_pos;
+                            cursor.m_pos = oldest;
+                        }
+                        while (cursor.m_pos < m_write_pos && samples.size() < n)
+                        {
+                            samples.push_back(m_slots[cursor.m_pos % m_slots.size()]);
+                            ++cursor.m_pos;
+                        }
+                        _release_passed(released);
+                        if (!samples.empty() || m_closed)
+                        {
+                            co_return samples;
+                        }
+                    }
+                    if (!co_await chan_read<void>(cursor.m_notify, closer))
+                    {
+                        throw CancelError(closer);
+                    }
+                } while (true);
+            }
+
+            std::uint64_t SampleRing::dropped(const Cursor & cursor) const
+            {
+                std::lock_guard lk(m_mutex);
+                return cursor.m_dropped;
+            }
+
+            class AppSinkConsumer : public std::enable_shared_from_this<AppSinkConsumer>
+            {
+            public:
+                AppSinkConsumer(std::shared_ptr<SampleRing> ring): m_ring(std::move(ring)), m_cursor(m_ring->create_cursor()) {}
+
+                auto pull_samples(std::size_t max_n, close_chan closer) -> asio::awaitable<std::vector<GstSampleSPtr>>
+                {
+                    auto self = shared_from_this();
+                    if (max_n == 0)
+                    {
+                        throw cpptrace::runtime_error("Invalid max_n. The max_n must be greater than 0.");
+                    }
+                    co_return co_await m_ring->read_n(*m_cursor, max_n, std::move(closer));
+                }
+
+                std::uint64_t dropped_samples() const
+                {
+                    return m_ring->dropped(*m_cursor);
+                }
+            private:
+                std::shared_ptr<SampleRing> m_ring;
+                std::shared_ptr<SampleRing::Cursor> m_cursor;
+            };
+
             class AppSink : public std::enable_shared_from_this<AppSink>
             {
             public:
-                using SampleBuffer = boost::circular_buffer<std::pair<std::uint32_t, GstSampleSPtr>>;
+                using SampleBuffer = MpmcChan<GstSampleSPtr>;
                 using Statistics = gst::AppSink::Statistics;
                 using OnSampleCb = gst::AppSink::OnSampleCb;
                 using OnStatCb = gst::AppSink::OnStatCb;
+                using AllocationConfigure = gst::AppSink::AllocationConfigure;
+                struct Metrics
+                {
+                    metrics::CounterPtr received_samples;
+                    metrics::CounterPtr received_bytes;
+                    metrics::CounterPtr dropped_samples;
+                    metrics::CounterPtr dropped_bytes;
+                };
                 AppSink(GstAppSink * sink, int cache_capicity);
                 ~AppSink();
 
                 void init();
                 auto pull_sample(close_chan closer) -> asio::awaitable<GstSampleSPtr>;
+                auto pull_samples(std::size_t max_n, close_chan closer) -> asio::awaitable<std::vector<GstSampleSPtr>>;
+                impl_ptr<AppSinkConsumer> create_consumer();
                 void set_on_sample(const OnSampleCb & cb);
                 void set_on_sample(OnSampleCb && cb);
                 void unset_on_sample() noexcept;
                 void set_on_stat(const OnStatCb & cb);
                 void set_on_stat(OnStatCb && cb);
                 void unset_on_stat() noexcept;
+                void set_allocation_configure(const AllocationConfigure & conf);
             private:
                 GstAppSink * m_sink;
+                // closed on eos.
                 SampleBuffer m_cache;
-                unique_void_chan m_sample_notify;
-                unique_void_chan m_eos_notify;
-                OnSampleCb m_on_sample;
+                std::shared_ptr<SampleRing> m_ring;
+                std::atomic_bool m_fanout {false};
+                // the callbacks are copied out of the lock before invoked, so they are never called with m_mutex held.
+                std::shared_ptr<const OnSampleCb> m_on_sample;
                 Statistics m_stat;
-                OnStatCb m_on_stat;
+                // the drops of the fan-out consumers are not included.
+                Metrics m_metrics;
+                std::shared_ptr<const OnStatCb> m_on_stat;
+                // the allocator is reffed.
+                AllocationConfigure m_alloc_conf;
+                // guard the statistics, the callbacks and the mode switch, the cache itself is lock-free.
+                // the fan-out ring has its own lock which is only held to copy the samples.
                 mutex m_mutex;
-                std::uint32_t m_seq;
-                bool m_eos;
                 bool m_init;
 
                 static void on_eos(GstAppSink *appsink, gpointer userdata);
@@ -48,12 +244,22 @@ namespace cfgo
                 static gboolean on_propose_allocation(GstAppSink *appsink, GstQuery *query, gpointer userdata);
 
                 void _init();
-                std::uint32_t _makesure_min_seq() const noexcept;
+                bool _propose_allocation(GstQuery * query);
             };
             
-            AppSink::AppSink(GstAppSink * sink, int cache_capicity): m_sink(sink), m_seq(0), m_eos(false), m_cache(cache_capicity), m_init(false)
+            AppSink::AppSink(GstAppSink * sink, int cache_capicity): m_sink(sink), m_cache(cache_capicity), m_ring(std::make_shared<SampleRing>(cache_capicity)), m_init(false)
             {
                 gst_object_ref(m_sink);
+                auto name = gst_object_get_name(GST_OBJECT(m_sink));
+                DEFER({
+                    g_free(name);
+                });
+                auto & registry = metrics::Registry::instance();
+                metrics::Labels labels { .category = name ? name : "" };
+                m_metrics.received_samples = registry.counter("cfgo_appsink_received_samples_total", "The samples received by the appsink.", labels);
+                m_metrics.received_bytes = registry.counter("cfgo_appsink_received_bytes_total", "The bytes of the samples received by the appsink.", labels);
+                m_metrics.dropped_samples = registry.counter("cfgo_appsink_dropped_samples_total", "The samples dropped because the cache of the appsink is full.", labels);
+                m_metrics.dropped_bytes = registry.counter("cfgo_appsink_dropped_bytes_total", "The bytes of the samples dropped because the cache of the appsink is full.", labels);
             }
 
             void AppSink::_init()
@@ -82,15 +288,18 @@ namespace cfgo
                 GstAppSinkCallbacks callbacks {};
                 gst_app_sink_set_callbacks(m_sink, &callbacks, NULL, NULL);
                 gst_object_unref(m_sink);
+                if (m_alloc_conf.allocator)
+                {
+                    gst_object_unref(m_alloc_conf.allocator);
+                }
             }
 
             void AppSink::on_eos(GstAppSink *appsink, gpointer userdata)
             {
                 if (auto self = cast_weak_holder<AppSink>(userdata)->lock())
                 {
-                    std::lock_guard lk(self->m_mutex);
-                    self->m_eos = true;
-                    chan_maybe_write(self->m_eos_notify);
+                    self->m_cache.close();
+                    self->m_ring->close();
                 }
             }
             GstFlowReturn AppSink::on_new_preroll(GstAppSink *appsink, gpointer userdata)
@@ -101,38 +310,64 @@ namespace cfgo
             {
                 if (auto self = cast_weak_holder<AppSink>(userdata)->lock())
                 {
-                    std::lock_guard lk(self->m_mutex);
-                    if (self->m_seq == std::numeric_limits<std::uint32_t>::max())
+                    auto sample = gst_app_sink_pull_sample(appsink);
+                    if (!sample)
                     {
-                        auto offset = self->_makesure_min_seq();
-                        for (auto && v : self->m_cache)
-                        {
-                            v.first -= offset;
-                        }
-                        self->m_seq -= offset;
+                        return GST_FLOW_OK;
                     }
-                    auto sample = gst_app_sink_pull_sample(appsink);
-                    if (sample)
+                    auto sample_ptr = steal_shared_gst_sample(sample);
+                    auto sample_size = gst_buffer_get_size(gst_sample_get_buffer(sample));
+                    std::shared_ptr<const OnSampleCb> on_sample;
+                    std::shared_ptr<const OnStatCb> on_stat;
                     {
-                        auto sample_size = gst_buffer_get_size(gst_sample_get_buffer(sample));
-                        self->m_stat.m_received_bytes += sample_size;
-                        ++ self->m_stat.m_received_samples;
-                        if (self->m_cache.full())
-                        {
-                            auto sample_size = gst_buffer_get_size(gst_sample_get_buffer(self->m_cache.front().second.get()));
-                            self->m_stat.m_droped_bytes += sample_size;
-                            ++ self->m_stat.m_droped_samples;
-                        }
-                        if (self->m_on_sample)
+                        std::lock_guard lk(self->m_mutex);
+                        on_sample = self->m_on_sample;
+                        on_stat = self->m_on_stat;
+                    }
+                    if (on_sample)
+                    {
+                        (*on_sample)(sample);
+                    }
+                    std::uint64_t dropped_bytes = 0;
+                    std::uint32_t dropped_samples = 0;
+                    // released outside of the lock.
+                    std::optional<GstSampleSPtr> dropped = std::nullopt;
+                    Statistics stat;
+                    {
+                        // published under the lock, so create_consumer never misses a sample when switching the mode.
+                        std::lock_guard lk(self->m_mutex);
+                        if (self->m_fanout.load(std::memory_order_relaxed))
                         {
-                            self->m_on_sample(sample);
+                            // recorded once when the sample is published, not once per consumer.
+                            record_sample_latency(sample);
+                            // the consumers count their own drops.
+                            self->m_ring->write(std::move(sample_ptr));
                         }
-                        if (self->m_on_stat)
+                        else
                         {
-                            self->m_on_stat(self->m_stat);
+                            dropped = self->m_cache.force_write(std::move(sample_ptr));
+                            if (dropped && *dropped)
+                            {
+                                dropped_bytes = gst_buffer_get_size(gst_sample_get_buffer(dropped->get()));
+                                dropped_samples = 1;
+                            }
                         }
-                        self->m_cache.push_back(std::make_pair(self->m_seq++, steal_shared_gst_sample(sample)));
-                        chan_maybe_write(self->m_sample_notify);
+                        self->m_stat.m_received_bytes += sample_size;
+                        ++ self->m_stat.m_received_samples;
+                        self->m_stat.m_droped_bytes += dropped_bytes;
+                        self->m_stat.m_droped_samples += dropped_samples;
+                        stat = self->m_stat;
+                    }
+                    self->m_metrics.received_samples->inc();
+                    self->m_metrics.received_bytes->inc(sample_size);
+                    if (dropped_samples > 0)
+                    {
+                        self->m_metrics.dropped_samples->inc(dropped_samples);
+                        self->m_metrics.dropped_bytes->inc(dropped_bytes);
+                    }
+                    if (on_stat)
+                    {
+                        (*on_stat)(stat);
                     }
                 }
                 return GST_FLOW_OK;
@@ -143,74 +378,163 @@ namespace cfgo
             }
             gboolean AppSink::on_propose_allocation(GstAppSink *appsink, GstQuery *query, gpointer userdata)
             {
+                if (auto self = cast_weak_holder<AppSink>(userdata)->lock())
+                {
+                    return self->_propose_allocation(query);
+                }
                 return FALSE;
             }
 
-            std::uint32_t AppSink::_makesure_min_seq() const noexcept
+            bool AppSink::_propose_allocation(GstQuery * query)
             {
-                if (m_cache.empty())
+                AllocationConfigure conf;
+                {
+                    std::lock_guard lk(m_mutex);
+                    conf = m_alloc_conf;
+                    if (conf.allocator)
+                    {
+                        gst_object_ref(conf.allocator);
+                    }
+                }
+                DEFER({
+                    if (conf.allocator)
+                    {
+                        gst_object_unref(conf.allocator);
+                    }
+                });
+                // the samples are handed to the user as is, so any strided or padded layout is fine.
+                gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, nullptr);
+                GstAllocationParams params;
+                gst_allocation_params_init(&params);
+                params.align = conf.align;
+                if (conf.allocator || conf.align > 0)
+                {
+                    gst_query_add_allocation_param(query, conf.allocator, &params);
+                }
+
+                GstCaps * caps = nullptr;
+                gboolean need_pool = FALSE;
+                gst_query_parse_allocation(query, &caps, &need_pool);
+                if (!conf.propose_pool || !need_pool || !caps)
                 {
-                    return std::numeric_limits<std::uint32_t>::max();
+                    return true;
                 }
-                else
+                // the memory of other features, such as cuda memory, is better allocated by the upstream itself.
+                auto features = gst_caps_get_features(caps, 0);
+                if (features && !gst_caps_features_is_any(features) && !gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_SYSTEM_MEMORY))
                 {
-                    return m_cache.front().first;
+                    return true;
                 }
+                GstVideoInfo info;
+                if (!gst_video_info_from_caps(&info, caps))
+                {
+                    return true;
+                }
+                guint min_buffers = static_cast<guint>(m_cache.capacity()) + conf.extra_buffers;
+                guint max_buffers = conf.limit_max_buffers ? min_buffers : 0;
+                auto pool = gst_video_buffer_pool_new();
+                DEFER({
+                    gst_object_unref(pool);
+                });
+                auto pool_conf = gst_buffer_pool_get_config(pool);
+                gst_buffer_pool_config_set_params(pool_conf, caps, static_cast<guint>(info.size), min_buffers, max_buffers);
+                gst_buffer_pool_config_set_allocator(pool_conf, conf.allocator, &params);
+                gst_buffer_pool_config_add_option(pool_conf, GST_BUFFER_POOL_OPTION_VIDEO_META);
+                if (!gst_buffer_pool_set_config(pool, pool_conf))
+                {
+                    // still answer the query with the meta, the upstream falls back to its own pool.
+                    return true;
+                }
+                gst_query_add_allocation_pool(query, pool, static_cast<guint>(info.size), min_buffers, max_buffers);
+                return true;
             }
 
-            // only support one receiver at same time.
             auto AppSink::pull_sample(close_chan closer) -> asio::awaitable<GstSampleSPtr>
             {
                 auto self = shared_from_this();
                 init();
-                GstSampleSPtr sample_ptr = nullptr;
-                bool done = false;
+                if (m_fanout.load(std::memory_order_acquire))
                 {
-                    std::lock_guard lk(m_mutex);
-                    if (!m_cache.empty())
+                    throw cpptrace::logic_error("The pull_sample is not available in the fan-out mode, use the consumers instead.");
+                }
+                auto res = co_await m_cache.read(closer);
+                if (!res)
+                {
+                    if (is_valid_close_chan(closer) && closer.is_closed())
                     {
-                        sample_ptr = m_cache.front().second;
-                        m_cache.pop_front();
-                        done = true;
+                        throw CancelError(closer);
                     }
-                    else if (m_eos)
+                    if (m_fanout.load(std::memory_order_acquire))
                     {
-                        done = true;
+                        throw cpptrace::logic_error("The pull_sample is not available in the fan-out mode, use the consumers instead.");
                     }
+                    // eos and no sample available.
+                    co_return nullptr;
                 }
-                if (done)
+                record_sample_latency(res.value().get());
+                co_return std::move(res).value();
+            }
+
+            auto AppSink::pull_samples(std::size_t max_n, close_chan closer) -> asio::awaitable<std::vector<GstSampleSPtr>>
+            {
+                auto self = shared_from_this();
+                init();
+                if (max_n == 0)
                 {
-                    co_return sample_ptr;
+                    throw cpptrace::runtime_error("Invalid max_n. The max_n must be greater than 0.");
                 }
-                do
+                if (m_fanout.load(std::memory_order_acquire))
                 {
-                    co_await select_or_throw(closer, asiochan::ops::read(m_sample_notify, m_eos_notify));
+                    throw cpptrace::logic_error("The pull_samples is not available in the fan-out mode, use the consumers instead.");
+                }
+                auto samples = co_await m_cache.read_n(max_n, closer);
+                if (samples.empty() && is_valid_close_chan(closer) && closer.is_closed())
+                {
+                    throw CancelError(closer);
+                }
+                if (samples.empty() && m_fanout.load(std::memory_order_acquire))
+                {
+                    throw cpptrace::logic_error("The pull_samples is not available in the fan-out mode, use the consumers instead.");
+                }
+                for (auto && sample : samples)
+                {
+                    record_sample_latency(sample.get());
+                }
+                co_return samples;
+            }
+
+            impl_ptr<AppSinkConsumer> AppSink::create_consumer()
+            {
+                std::lock_guard lk(m_mutex);
+                _init();
+                auto consumer = std::make_shared<AppSinkConsumer>(m_ring);
+                if (!m_fanout.load(std::memory_order_relaxed))
+                {
+                    // the samples queued before the switch are moved after the cursor of the first consumer.
+                    while (auto sample = m_cache.try_read())
                     {
-                        std::lock_guard lk(m_mutex);
-                        if (!m_cache.empty() || m_eos)
-                        {
-                            if (!m_cache.empty())
-                            {
-                                sample_ptr = m_cache.front().second;
-                                m_cache.pop_front();
-                            }
-                            break;
-                        }
+                        record_sample_latency(sample->get());
+                        m_ring->write(std::move(*sample));
                     }
-                } while (true);
-                co_return sample_ptr;
+                    m_fanout.store(true, std::memory_order_release);
+                    // wake up the pending pullers, they throw as the new ones.
+                    m_cache.close();
+                }
+                return consumer;
             }
 
             void AppSink::set_on_sample(const OnSampleCb & cb)
             {
+                auto ptr = std::make_shared<const OnSampleCb>(cb);
                 std::lock_guard lk(m_mutex);
-                m_on_sample = cb;
+                m_on_sample = std::move(ptr);
             }
 
             void AppSink::set_on_sample(OnSampleCb && cb)
             {
+                auto ptr = std::make_shared<const OnSampleCb>(std::move(cb));
                 std::lock_guard lk(m_mutex);
-                m_on_sample = std::move(cb);
+                m_on_sample = std::move(ptr);
             }
 
             void AppSink::unset_on_sample() noexcept
@@ -221,14 +545,16 @@ namespace cfgo
 
             void AppSink::set_on_stat(const OnStatCb & cb)
             {
+                auto ptr = std::make_shared<const OnStatCb>(cb);
                 std::lock_guard lk(m_mutex);
-                m_on_stat = cb;
+                m_on_stat = std::move(ptr);
             }
 
             void AppSink::set_on_stat(OnStatCb && cb)
             {
+                auto ptr = std::make_shared<const OnStatCb>(std::move(cb));
                 std::lock_guard lk(m_mutex);
-                m_on_stat = std::move(cb);
+                m_on_stat = std::move(ptr);
             }
 
             void AppSink::unset_on_stat() noexcept
@@ -237,8 +563,38 @@ namespace cfgo
                 m_on_stat = nullptr;
             }
 
+            void AppSink::set_allocation_configure(const AllocationConfigure & conf)
+            {
+                if (conf.allocator)
+                {
+                    gst_object_ref(conf.allocator);
+                }
+                GstAllocator * old_allocator = nullptr;
+                {
+                    std::lock_guard lk(m_mutex);
+                    old_allocator = m_alloc_conf.allocator;
+                    m_alloc_conf = conf;
+                }
+                if (old_allocator)
+                {
+                    gst_object_unref(old_allocator);
+                }
+            }
+
         } // namespace detail
 
+        AppSinkConsumer::AppSinkConsumer(impl_ptr<detail::AppSinkConsumer> impl): ImplBy(std::move(impl)) {}
+
+        auto AppSinkConsumer::pull_samples(std::size_t max_n, close_chan closer) const -> asio::awaitable<std::vector<GstSampleSPtr>>
+        {
+            return impl()->pull_samples(max_n, std::move(closer));
+        }
+
+        std::uint64_t AppSinkConsumer::dropped_samples() const
+        {
+            return impl()->dropped_samples();
+        }
+
         AppSink::AppSink(GstAppSink *sink, int cache_capicity) : ImplBy(sink, cache_capicity) {}
 
         void AppSink::init() const
@@ -251,6 +607,16 @@ namespace cfgo
             return impl()->pull_sample(std::move(closer));
         }
 
+        auto AppSink::pull_samples(std::size_t max_n, close_chan closer) const -> asio::awaitable<std::vector<GstSampleSPtr>>
+        {
+            return impl()->pull_samples(max_n, std::move(closer));
+        }
+
+        AppSinkConsumer AppSink::create_consumer() const
+        {
+            return AppSinkConsumer(impl()->create_consumer());
+        }
+
         void AppSink::set_on_sample(const OnSampleCb & cb) const
         {
             impl()->set_on_sample(cb);
@@ -281,6 +647,11 @@ namespace cfgo
             impl()->unset_on_stat();
         }
 
+        void AppSink::set_allocation_configure(const AllocationConfigure & conf) const
+        {
+            impl()->set_allocation_configure(conf);
+        }
+
     } // namespace gst
     
 } // namespace cfgo
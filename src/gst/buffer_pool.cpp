@@ -1,6 +1,193 @@
 #include "cfgo/gst/buffer_pool.hpp"
 #include "cfgo/fmt.hpp"
 #include "cpptrace/cpptrace.hpp"
+#include <atomic>
+#include <algorithm>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace cfgo
+{
+    namespace gst
+    {
+        struct BufferPoolClassStats
+        {
+            std::atomic<std::uint64_t> m_hits {0};
+            std::atomic<std::uint64_t> m_fallbacks {0};
+            std::atomic<std::uint64_t> m_in_use {0};
+            std::atomic<std::uint64_t> m_peak_in_use {0};
+            // the buffers preallocated by set_active are released without acquired.
+            std::atomic_bool m_active {false};
+        };
+    } // namespace gst
+} // namespace cfgo
+
+typedef struct _CfgoCountingBufferPool
+{
+    GstBufferPool parent;
+    cfgo::gst::BufferPoolClassStats * stats;
+} CfgoCountingBufferPool;
+
+typedef struct _CfgoCountingBufferPoolClass
+{
+    GstBufferPoolClass parent_class;
+} CfgoCountingBufferPoolClass;
+
+G_DEFINE_TYPE(CfgoCountingBufferPool, cfgo_counting_buffer_pool, GST_TYPE_BUFFER_POOL);
+
+static GstFlowReturn
+cfgo_counting_buffer_pool_acquire_buffer(GstBufferPool * pool, GstBuffer ** buffer, GstBufferPoolAcquireParams * params)
+{
+    auto self = (CfgoCountingBufferPool *) pool;
+    auto ret = GST_BUFFER_POOL_CLASS(cfgo_counting_buffer_pool_parent_class)->acquire_buffer(pool, buffer, params);
+    if (ret == GST_FLOW_OK)
+    {
+        self->stats->m_hits.fetch_add(1, std::memory_order_relaxed);
+        auto in_use = self->stats->m_in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto peak = self->stats->m_peak_in_use.load(std::memory_order_relaxed);
+        while (in_use > peak && !self->stats->m_peak_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+    }
+    return ret;
+}
+
+static void
+cfgo_counting_buffer_pool_release_buffer(GstBufferPool * pool, GstBuffer * buffer)
+{
+    auto self = (CfgoCountingBufferPool *) pool;
+    if (self->stats->m_active.load(std::memory_order_relaxed))
+    {
+        self->stats->m_in_use.fetch_sub(1, std::memory_order_relaxed);
+    }
+    GST_BUFFER_POOL_CLASS(cfgo_counting_buffer_pool_parent_class)->release_buffer(pool, buffer);
+}
+
+static void
+cfgo_counting_buffer_pool_finalize(GObject * object)
+{
+    auto self = (CfgoCountingBufferPool *) object;
+    delete self->stats;
+    self->stats = nullptr;
+    G_OBJECT_CLASS(cfgo_counting_buffer_pool_parent_class)->finalize(object);
+}
+
+static void
+cfgo_counting_buffer_pool_class_init(CfgoCountingBufferPoolClass * klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = cfgo_counting_buffer_pool_finalize;
+    GST_BUFFER_POOL_CLASS(klass)->acquire_buffer = cfgo_counting_buffer_pool_acquire_buffer;
+    GST_BUFFER_POOL_CLASS(klass)->release_buffer = cfgo_counting_buffer_pool_release_buffer;
+}
+
+static void
+cfgo_counting_buffer_pool_init(CfgoCountingBufferPool * self)
+{
+    self->stats = new cfgo::gst::BufferPoolClassStats();
+}
+
+#define CFGO_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#if defined(__linux__)
+
+typedef struct _CfgoHugePageAllocator
+{
+    GstAllocator parent;
+} CfgoHugePageAllocator;
+
+typedef struct _CfgoHugePageAllocatorClass
+{
+    GstAllocatorClass parent_class;
+} CfgoHugePageAllocatorClass;
+
+typedef struct _CfgoHugePageMemory
+{
+    GstMemory mem;
+    guint8 * data;
+    // 0 for the shared memory, the mapping is owned by the parent.
+    gsize map_size;
+} CfgoHugePageMemory;
+
+G_DEFINE_TYPE(CfgoHugePageAllocator, cfgo_huge_page_allocator, GST_TYPE_ALLOCATOR);
+
+static GstMemory *
+cfgo_huge_page_allocator_alloc(GstAllocator * allocator, gsize size, GstAllocationParams * params)
+{
+    // mmap is page aligned, which satisfies any reasonable align mask.
+    gsize maxsize = size + params->prefix + params->padding;
+    gsize map_size = (maxsize + CFGO_HUGE_PAGE_SIZE - 1) / CFGO_HUGE_PAGE_SIZE * CFGO_HUGE_PAGE_SIZE;
+    void * data = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+#if defined(MADV_HUGEPAGE)
+    madvise(data, map_size, MADV_HUGEPAGE);
+#endif
+    auto mem = g_new0(CfgoHugePageMemory, 1);
+    gst_memory_init(GST_MEMORY_CAST(mem), params->flags, allocator, nullptr, maxsize, params->align, params->prefix, size);
+    mem->data = (guint8 *) data;
+    mem->map_size = map_size;
+    return GST_MEMORY_CAST(mem);
+}
+
+static void
+cfgo_huge_page_allocator_free(GstAllocator * allocator, GstMemory * memory)
+{
+    auto mem = (CfgoHugePageMemory *) memory;
+    if (mem->map_size > 0)
+    {
+        munmap(mem->data, mem->map_size);
+    }
+    g_free(mem);
+}
+
+static gpointer
+cfgo_huge_page_mem_map(GstMemory * memory, gsize maxsize, GstMapFlags flags)
+{
+    return ((CfgoHugePageMemory *) memory)->data;
+}
+
+static void
+cfgo_huge_page_mem_unmap(GstMemory * memory) {}
+
+static GstMemory *
+cfgo_huge_page_mem_share(GstMemory * memory, gssize offset, gssize size)
+{
+    auto mem = (CfgoHugePageMemory *) memory;
+    auto parent = memory->parent ? memory->parent : memory;
+    if (size == -1)
+    {
+        size = memory->size - offset;
+    }
+    auto sub = g_new0(CfgoHugePageMemory, 1);
+    gst_memory_init(
+        GST_MEMORY_CAST(sub),
+        (GstMemoryFlags) (GST_MINI_OBJECT_FLAGS(parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY),
+        memory->allocator, parent, memory->maxsize, memory->align, memory->offset + offset, size
+    );
+    sub->data = mem->data;
+    sub->map_size = 0;
+    return GST_MEMORY_CAST(sub);
+}
+
+static void
+cfgo_huge_page_allocator_class_init(CfgoHugePageAllocatorClass * klass)
+{
+    GST_ALLOCATOR_CLASS(klass)->alloc = cfgo_huge_page_allocator_alloc;
+    GST_ALLOCATOR_CLASS(klass)->free = cfgo_huge_page_allocator_free;
+}
+
+static void
+cfgo_huge_page_allocator_init(CfgoHugePageAllocator * self)
+{
+    auto alloc = GST_ALLOCATOR_CAST(self);
+    alloc->mem_type = "CfgoHugePageMemory";
+    alloc->mem_map = cfgo_huge_page_mem_map;
+    alloc->mem_unmap = cfgo_huge_page_mem_unmap;
+    alloc->mem_share = cfgo_huge_page_mem_share;
+}
+
+#endif
 
 namespace cfgo
 {
@@ -11,53 +198,163 @@ namespace cfgo
             class BufferPool
             {
             public:
+                using Configure = cfgo::gst::BufferPool::Configure;
+                using Statistics = cfgo::gst::BufferPool::Statistics;
                 BufferPool(guint buf_size, guint min_buf, guint max_buf);
+                BufferPool(const Configure & conf);
                 ~BufferPool();
+                BufferPool(const BufferPool &) = delete;
+                BufferPool & operator = (const BufferPool &) = delete;
 
                 GstBuffer * acquire_buffer();
+                GstBuffer * acquire_buffer(gsize size);
+                GstBufferPool * get_pool(gsize size) const noexcept;
+                GstAllocator * get_allocator() const noexcept
+                {
+                    return m_allocator;
+                }
+                const GstAllocationParams & get_allocation_params() const noexcept
+                {
+                    return m_params;
+                }
+                Statistics statistics() const;
             private:
-                GstBufferPool * m_pool;
-                guint m_buf_size;
+                struct SizeClass
+                {
+                    guint m_buf_size;
+                    GstBufferPool * m_pool;
+                    GstAllocator * m_allocator;
+                };
+                std::vector<SizeClass> m_classes {};
+                GstAllocator * m_allocator = nullptr;
+                GstAllocator * m_huge_page_allocator = nullptr;
+                GstAllocationParams m_params;
+                std::atomic<std::uint64_t> m_oversizes {0};
+
+                const SizeClass * _find_class(gsize size) const noexcept;
+                GstBuffer * _fallback(GstAllocator * allocator, gsize size);
             };
-            
-            BufferPool::BufferPool(guint buf_size, guint min_buf, guint max_buf): 
-                m_pool(gst_buffer_pool_new()),
-                m_buf_size(buf_size)
+
+            static Configure make_single_configure(guint buf_size, guint min_buf, guint max_buf)
+            {
+                Configure conf {};
+                conf.size_classes.push_back({ .buf_size = buf_size, .min_buf = min_buf, .max_buf = max_buf });
+                return conf;
+            }
+
+            BufferPool::BufferPool(guint buf_size, guint min_buf, guint max_buf): BufferPool(make_single_configure(buf_size, min_buf, max_buf)) {}
+
+            BufferPool::BufferPool(const Configure & conf)
             {
-                GstStructure *conf = gst_buffer_pool_get_config (m_pool);
-                gst_buffer_pool_config_set_params (conf, nullptr, m_buf_size, min_buf, max_buf);
-                if (!gst_buffer_pool_set_config (m_pool, conf))
+                conf.validate();
+                gst_allocation_params_init(&m_params);
+                m_params.align = conf.align;
+                m_allocator = conf.allocator ? GST_ALLOCATOR_CAST(gst_object_ref(conf.allocator)) : gst_allocator_find(nullptr);
+#if defined(__linux__)
+                if (conf.huge_pages)
                 {
-                    throw cpptrace::runtime_error("Unable to config the pool.");
+                    m_huge_page_allocator = GST_ALLOCATOR_CAST(g_object_new(cfgo_huge_page_allocator_get_type(), nullptr));
+                    gst_object_ref_sink(m_huge_page_allocator);
                 }
-                if (!gst_buffer_pool_set_active (m_pool, TRUE))
+#endif
+                auto size_classes = conf.size_classes;
+                std::sort(size_classes.begin(), size_classes.end(), [](auto && a, auto && b) {
+                    return a.buf_size < b.buf_size;
+                });
+                for (auto && size_class : size_classes)
                 {
-                    throw cpptrace::runtime_error("Unable to active the pool.");
+                    auto allocator = m_huge_page_allocator && size_class.buf_size >= CFGO_HUGE_PAGE_SIZE ? m_huge_page_allocator : m_allocator;
+                    auto pool = GST_BUFFER_POOL_CAST(g_object_new(cfgo_counting_buffer_pool_get_type(), nullptr));
+                    gst_object_ref_sink(pool);
+                    m_classes.push_back({ .m_buf_size = size_class.buf_size, .m_pool = pool, .m_allocator = allocator });
+                    GstStructure *pool_conf = gst_buffer_pool_get_config (pool);
+                    gst_buffer_pool_config_set_params (pool_conf, nullptr, size_class.buf_size, size_class.min_buf, size_class.max_buf);
+                    gst_buffer_pool_config_set_allocator (pool_conf, allocator, &m_params);
+                    if (!gst_buffer_pool_set_config (pool, pool_conf))
+                    {
+                        throw cpptrace::runtime_error(fmt::format("Unable to config the pool of size class {}.", size_class.buf_size));
+                    }
+                    if (!gst_buffer_pool_set_active (pool, TRUE))
+                    {
+                        throw cpptrace::runtime_error(fmt::format("Unable to active the pool of size class {}.", size_class.buf_size));
+                    }
+                    ((CfgoCountingBufferPool *) pool)->stats->m_active = true;
                 }
             }
-            
+
             BufferPool::~BufferPool()
             {
-                gst_buffer_pool_set_active (m_pool, FALSE);
-                gst_object_unref (m_pool);
+                for (auto && size_class : m_classes)
+                {
+                    gst_buffer_pool_set_active (size_class.m_pool, FALSE);
+                    gst_object_unref (size_class.m_pool);
+                }
+                if (m_huge_page_allocator)
+                {
+                    gst_object_unref (m_huge_page_allocator);
+                }
+                if (m_allocator)
+                {
+                    gst_object_unref (m_allocator);
+                }
+            }
+
+            auto BufferPool::_find_class(gsize size) const noexcept -> const SizeClass *
+            {
+                for (auto && size_class : m_classes)
+                {
+                    if (size <= size_class.m_buf_size)
+                    {
+                        return &size_class;
+                    }
+                }
+                return nullptr;
+            }
+
+            GstBuffer * BufferPool::_fallback(GstAllocator * allocator, gsize size)
+            {
+                auto buf = gst_buffer_new_allocate(allocator, size, &m_params);
+                if (!buf)
+                {
+                    throw cpptrace::runtime_error(fmt::format("Unable to allocate a buffer of {} bytes.", size));
+                }
+                return buf;
             }
 
             GstBuffer * BufferPool::acquire_buffer()
             {
+                // the constructor ensures at least one class.
+                return acquire_buffer(m_classes.back().m_buf_size);
+            }
+
+            GstBuffer * BufferPool::acquire_buffer(gsize size)
+            {
+                auto size_class = _find_class(size);
+                if (!size_class)
+                {
+                    m_oversizes.fetch_add(1, std::memory_order_relaxed);
+                    return _fallback(m_classes.back().m_allocator, size);
+                }
                 GstBuffer * buf = nullptr;
                 GstBufferPoolAcquireParams params {
-                    .format = GstFormat::GST_FORMAT_UNDEFINED, 
-                    .start = 0, 
-                    .stop = 0, 
+                    .format = GstFormat::GST_FORMAT_UNDEFINED,
+                    .start = 0,
+                    .stop = 0,
                     .flags = GstBufferPoolAcquireFlags::GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT
                 };
-                auto gfr = gst_buffer_pool_acquire_buffer(m_pool, &buf, &params);
+                auto gfr = gst_buffer_pool_acquire_buffer(size_class->m_pool, &buf, &params);
                 if (gfr == GST_FLOW_EOS)
                 {
-                    return gst_buffer_new_and_alloc(m_buf_size);
+                    // the pool is exhausted.
+                    ((CfgoCountingBufferPool *) size_class->m_pool)->stats->m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+                    return _fallback(size_class->m_allocator, size);
                 }
                 else if (gfr == GST_FLOW_OK)
                 {
+                    if (size != size_class->m_buf_size)
+                    {
+                        gst_buffer_set_size(buf, size);
+                    }
                     return buf;
                 }
                 else
@@ -66,30 +363,131 @@ namespace cfgo
                 }
             }
 
+            GstBufferPool * BufferPool::get_pool(gsize size) const noexcept
+            {
+                auto size_class = _find_class(size);
+                return size_class ? size_class->m_pool : nullptr;
+            }
+
+            auto BufferPool::statistics() const -> Statistics
+            {
+                Statistics stats {};
+                for (auto && size_class : m_classes)
+                {
+                    auto class_stats = ((CfgoCountingBufferPool *) size_class.m_pool)->stats;
+                    stats.classes.push_back({
+                        .buf_size = size_class.m_buf_size,
+                        .hits = class_stats->m_hits.load(std::memory_order_relaxed),
+                        .fallbacks = class_stats->m_fallbacks.load(std::memory_order_relaxed),
+                        .in_use = class_stats->m_in_use.load(std::memory_order_relaxed),
+                        .peak_in_use = class_stats->m_peak_in_use.load(std::memory_order_relaxed),
+                    });
+                }
+                stats.oversizes = m_oversizes.load(std::memory_order_relaxed);
+                return stats;
+            }
+
         } // namespace detail
 
+        void BufferPool::Configure::validate() const
+        {
+            if (size_classes.empty())
+            {
+                throw cpptrace::runtime_error("Invalid size_classes. At least one size class is required.");
+            }
+            for (auto && size_class : size_classes)
+            {
+                if (size_class.buf_size == 0)
+                {
+                    throw cpptrace::runtime_error("Invalid buf_size. The buf_size must be greater than 0.");
+                }
+                if (size_class.max_buf > 0 && size_class.max_buf < size_class.min_buf)
+                {
+                    throw cpptrace::runtime_error(fmt::format("Invalid max_buf of size class {}. The max_buf must be 0 or not less than the min_buf.", size_class.buf_size));
+                }
+            }
+            if ((align & (align + 1)) != 0)
+            {
+                throw cpptrace::runtime_error("Invalid align. The align must be a mask like 2^n - 1.");
+            }
+            if (huge_pages && allocator)
+            {
+                throw cpptrace::runtime_error("The huge_pages can not be used with a custom allocator.");
+            }
+#if !defined(__linux__)
+            if (huge_pages)
+            {
+                throw cpptrace::runtime_error("The huge_pages is only supported on linux.");
+            }
+#endif
+        }
+
+        auto BufferPool::make_default_configure(guint mtu, guint frame_size, guint min_buf, guint max_buf) -> Configure
+        {
+            Configure conf {};
+            // the rtcp compound packets are usually much smaller than the mtu.
+            conf.size_classes.push_back({ .buf_size = std::min<guint>(256, mtu), .min_buf = min_buf, .max_buf = max_buf });
+            if (mtu > 256)
+            {
+                conf.size_classes.push_back({ .buf_size = mtu, .min_buf = min_buf, .max_buf = max_buf });
+            }
+            if (frame_size > mtu)
+            {
+                conf.size_classes.push_back({ .buf_size = frame_size, .min_buf = min_buf, .max_buf = max_buf });
+            }
+            return conf;
+        }
+
         BufferPool::BufferPool(std::nullptr_t): ImplBy(std::shared_ptr<detail::BufferPool>()) {}
 
         BufferPool::BufferPool(guint buf_size, guint min_buf, guint max_buf): ImplBy(buf_size, min_buf, max_buf) {}
 
+        BufferPool::BufferPool(const Configure & conf): ImplBy(conf) {}
+
         BufferPool::operator bool() const noexcept
         {
             return (bool) impl();
         }
 
-        GstBuffer * BufferPool::acquire_buffer() const
+        static const impl_ptr<detail::BufferPool> & checked_impl(const impl_ptr<detail::BufferPool> & ptr)
         {
-            auto & ptr = impl();
-            if (ptr)
-            {
-                return ptr->acquire_buffer();
-            }
-            else
+            if (!ptr)
             {
                 throw cpptrace::runtime_error("The pool is nullptr.");
             }
+            return ptr;
+        }
+
+        GstBuffer * BufferPool::acquire_buffer() const
+        {
+            return checked_impl(impl())->acquire_buffer();
         }
-        
+
+        GstBuffer * BufferPool::acquire_buffer(gsize size) const
+        {
+            return checked_impl(impl())->acquire_buffer(size);
+        }
+
+        GstBufferPool * BufferPool::get_pool(gsize size) const
+        {
+            return checked_impl(impl())->get_pool(size);
+        }
+
+        GstAllocator * BufferPool::get_allocator() const
+        {
+            return checked_impl(impl())->get_allocator();
+        }
+
+        const GstAllocationParams & BufferPool::get_allocation_params() const
+        {
+            return checked_impl(impl())->get_allocation_params();
+        }
+
+        auto BufferPool::statistics() const -> Statistics
+        {
+            return checked_impl(impl())->statistics();
+        }
+
     } // namespace gst
-    
+
 } // namespace cfgo
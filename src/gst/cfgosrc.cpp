@@ -3,6 +3,7 @@
 #include "cfgo/gst/error.hpp"
 #include "cfgo/gst/utils.hpp"
 #include "cfgo/gst/helper.h"
+#include "cfgo/gst/latency_meta.hpp"
 #include "cfgo/common.hpp"
 #include "cfgo/cfgo.hpp"
 #include "cfgo/defer.hpp"
@@ -10,11 +11,16 @@
 #include "spdlog/spdlog.h"
 #include "cpptrace/cpptrace.hpp"
 #include "asio/experimental/awaitable_operators.hpp"
+#include "gst/rtp/gstrtpbuffer.h"
+#include "gst/rtp/gstrtcpbuffer.h"
 
 namespace cfgo
 {
     namespace gst
     {
+        // the default mtu of libdatachannel.
+        constexpr guint DEFAULT_MTU = 1280;
+
         static gboolean
         copy_sticky_events (GstPad * pad, GstEvent ** event, gpointer user_data)
         {
@@ -54,6 +60,10 @@ namespace cfgo
             {
                 gst_object_unref(m_processor);
             }
+            if (m_processor_key)
+            {
+                gst_caps_unref(m_processor_key);
+            }
             if (!m_pads.empty())
             {
                 CFGO_WARN("m_pads should be empty when destructed.");
@@ -181,21 +191,28 @@ namespace cfgo
             {
                 CFGO_WARN("m_rtcp_pad must be nullptr when sesson destructed.");
             }
+            if (m_rtp_src || m_rtcp_src)
+            {
+                CFGO_WARN("m_rtp_src and m_rtcp_src must be nullptr when sesson destructed.");
+            }
+            if (m_latency_ref)
+            {
+                m_latency_ref->unref();
+            }
         }
 
         auto CfgoSrc::Session::create_channel(CfgoSrc * parent, GstCfgoSrc * owner, guint ssrc, guint pt, GstPad * pad) -> ChannelPtr
         {
             auto channel = std::make_shared<Channel>();
+            // registered before init, a reused processor installs its existing src pads which look up the channel.
+            m_channels.push_back(channel);
             channel->init(parent, owner, m_id, ssrc, pt, pad);
-            m_channels.push_back(
-                std::move(channel)
-            );
-            return m_channels.back();
+            return channel;
         }
 
-        void CfgoSrc::Session::destroy_channel(CfgoSrc * parent, GstCfgoSrc * owner, Channel & channel, bool remove)
+        void CfgoSrc::Session::destroy_channel(CfgoSrc * parent, GstCfgoSrc * owner, Channel & channel, bool remove, bool recycle)
         {
-            parent->_destroy_processor(owner, channel);
+            parent->_destroy_processor(owner, channel, recycle);
             if (remove)
             {
                 m_channels.erase(
@@ -251,6 +268,120 @@ namespace cfgo
             }
         }
 
+        static void release_session_src(GstCfgoSrc * owner, GstElement *& src)
+        {
+            if (!src)
+            {
+                return;
+            }
+            GstAppSrcCallbacks cbs {};
+            gst_app_src_set_callbacks(GST_APP_SRC(src), &cbs, nullptr, nullptr);
+            gst_element_set_locked_state(src, TRUE);
+            gst_element_set_state(src, GST_STATE_NULL);
+            gst_bin_remove(GST_BIN(owner), src);
+            gst_object_unref(src);
+            src = nullptr;
+        }
+
+        void CfgoSrc::Session::release_srcs(GstCfgoSrc * owner)
+        {
+            release_session_src(owner, m_rtp_src);
+            release_session_src(owner, m_rtcp_src);
+        }
+
+        static void release_depay_element(GstCfgoSrc * owner, GstElement * element)
+        {
+            auto src_pad = gst_element_get_static_pad(element, "src");
+            if (src_pad)
+            {
+                auto gpad = g_object_get_data(G_OBJECT (src_pad), "GstCfgoSrc.ghostpad");
+                if (gpad)
+                {
+                    gst_pad_set_active(GST_PAD(gpad), FALSE);
+                    gst_element_remove_pad(GST_ELEMENT(owner), GST_PAD(gpad));
+                    g_object_set_data(G_OBJECT (src_pad), "GstCfgoSrc.ghostpad", nullptr);
+                }
+                gst_object_unref(src_pad);
+            }
+            gst_element_set_locked_state(element, TRUE);
+            gst_element_set_state(element, GST_STATE_NULL);
+            gst_bin_remove(GST_BIN(owner), element);
+            gst_object_unref(element);
+        }
+
+        void CfgoSrc::Session::release_depays(GstCfgoSrc * owner)
+        {
+            for (auto && depay : m_depays)
+            {
+                release_depay_element(owner, depay);
+            }
+            m_depays.clear();
+            if (m_ptdemux)
+            {
+                release_depay_element(owner, m_ptdemux);
+                m_ptdemux = nullptr;
+            }
+        }
+
+        void CfgoSrc::Session::set_queue_limits(guint64 max_bytes, guint64 max_buffers)
+        {
+            for (auto src : {m_rtp_src, m_rtcp_src})
+            {
+                if (src)
+                {
+                    g_object_set(
+                        src,
+                        "max-bytes", max_bytes,
+                        "max-buffers", max_buffers,
+                        NULL
+                    );
+                }
+            }
+        }
+
+        void CfgoSrc::SrcStats::init(const metrics::Labels & labels)
+        {
+            auto & registry = metrics::Registry::instance();
+            m_need_data = registry.counter("cfgo_cfgosrc_need_data_total", "The need-data signals of the appsrc of the cfgosrc session.", labels);
+            m_enough_data = registry.counter("cfgo_cfgosrc_enough_data_total", "The enough-data signals of the appsrc of the cfgosrc session.", labels);
+            m_pushed_buffers = registry.counter("cfgo_cfgosrc_pushed_buffers_total", "The buffers pushed into the pipeline by the cfgosrc session.", labels);
+            m_pushed_bytes = registry.counter("cfgo_cfgosrc_pushed_bytes_total", "The bytes pushed into the pipeline by the cfgosrc session.", labels);
+            m_level_bytes = registry.gauge("cfgo_cfgosrc_level_bytes", "The bytes queued in the appsrc of the cfgosrc session after the last push.", labels);
+        }
+
+        static void set_src_stats(GstStructure * stats, const char * prefix, GstElement * src, const CfgoSrc::SrcStats & src_stats)
+        {
+            auto field = [prefix](const char * name) {
+                return fmt::format("{}-{}", prefix, name);
+            };
+            guint64 level_bytes = 0;
+            guint64 level_buffers = 0;
+            if (src)
+            {
+                level_bytes = gst_app_src_get_current_level_bytes(GST_APP_SRC(src));
+                level_buffers = gst_app_src_get_current_level_buffers(GST_APP_SRC(src));
+            }
+            gst_structure_set(
+                stats,
+                field("level-bytes").c_str(), G_TYPE_UINT64, level_bytes,
+                field("level-buffers").c_str(), G_TYPE_UINT64, level_buffers,
+                field("max-level-bytes").c_str(), G_TYPE_UINT64, src_stats.m_max_level_bytes.load(std::memory_order_relaxed),
+                field("need-data").c_str(), G_TYPE_UINT64, src_stats.m_need_data->value(),
+                field("enough-data").c_str(), G_TYPE_UINT64, src_stats.m_enough_data->value(),
+                field("pushed-buffers").c_str(), G_TYPE_UINT64, src_stats.m_pushed_buffers->value(),
+                field("pushed-bytes").c_str(), G_TYPE_UINT64, src_stats.m_pushed_bytes->value(),
+                NULL
+            );
+        }
+
+        GstStructure * CfgoSrc::Session::create_stats() const
+        {
+            auto stats = gst_structure_new("application/x-cfgosrc-session-stats", "id", G_TYPE_UINT, m_id, NULL);
+            set_src_stats(stats, "rtp", m_rtp_src, m_rtp_stats);
+            set_src_stats(stats, "rtcp", m_rtcp_src, m_rtcp_stats);
+            return stats;
+        }
+
         CfgoSrc::CfgoSrc(int client_handle, const char * pattern_json, const char * req_types_str, guint64 sub_timeout, guint64 read_timeout):
             m_logger(Log::instance().create_logger(Log::Category::CFGOSRC)),
             m_state(INITED),
@@ -328,7 +459,10 @@ namespace cfgo
             m_detached = false;
             m_owner = owner;
             m_mode = owner->mode;
-            _create_rtp_bin(m_owner);
+            if (m_mode != GST_CFGO_SRC_MODE_DEPAY)
+            {
+                _create_rtp_bin(m_owner);
+            }
         }
 
         void CfgoSrc::_detach()
@@ -350,12 +484,13 @@ namespace cfgo
                     }
                     session->destroy_channel(this, m_owner, *channel, false);
                 }
+                session->release_srcs(m_owner);
+                session->release_depays(m_owner);
                 session->release_rtp_pad(m_rtp_bin);
                 session->release_rtcp_pad(m_rtp_bin);
             }
             m_sessions.clear();
-            rtp_src_remove_callbacks(m_owner);
-            rtcp_src_remove_callbacks(m_owner);
+            _trim_processor_pool(m_owner, 0);
             if (m_rtp_bin)
             {
                 if (m_request_pt_map)
@@ -377,6 +512,11 @@ namespace cfgo
             {
                 gst_caps_unref(m_decode_caps);
             }
+            if (m_clock)
+            {
+                gst_object_unref(m_clock);
+                m_clock = nullptr;
+            }
             m_owner = nullptr;
         }
 
@@ -394,43 +534,143 @@ namespace cfgo
             return make_shared_gst_element(GST_ELEMENT(m_owner));
         }
 
-        void CfgoSrc::_create_processor(GstCfgoSrc * owner, Channel & channel, const std::string & type)
+        struct ProcessorTag
         {
-            auto processor_name = fmt::sprintf("%s_%u_%u_%u", type, channel.m_sessid, channel.m_ssrc, channel.m_pt);
-            auto processor = gst_element_factory_make(type.c_str(), processor_name.c_str());
-            if (!processor)
+            guint m_sessid;
+            guint m_ssrc;
+            guint m_pt;
+        };
+
+        static const char * PROCESSOR_TAG_KEY = "GstCfgoSrc.processor_tag";
+
+        // a pooled processor changes its channel, so the channel is attached as data instead of encoded in the element name.
+        static void tag_processor(GstElement * processor, const CfgoSrc::Channel & channel)
+        {
+            auto tag = g_new(ProcessorTag, 1);
+            tag->m_sessid = channel.m_sessid;
+            tag->m_ssrc = channel.m_ssrc;
+            tag->m_pt = channel.m_pt;
+            g_object_set_data_full(G_OBJECT(processor), PROCESSOR_TAG_KEY, tag, g_free);
+        }
+
+        static GstCaps * make_processor_key(GstPad * pad)
+        {
+            auto caps = gst_pad_get_current_caps(pad);
+            if (!caps)
             {
-                cfgo_error_submit_general(GST_ELEMENT(owner), ("Unable to create the " + type + " element: " + processor_name + ".").c_str(), TRUE, TRUE);
-                return;
+                return nullptr;
             }
-            if (!gst_bin_add(GST_BIN(owner), processor))
+            caps = gst_caps_make_writable(caps);
+            for (guint i = 0; i < gst_caps_get_size(caps); ++i)
             {
-                cfgo_error_submit_general(GST_ELEMENT(owner), ("Unable to add " + processor_name + " to " + GST_ELEMENT_NAME(owner) + ".").c_str(), TRUE, TRUE);
-                return;
+                gst_structure_remove_fields(
+                    gst_caps_get_structure(caps, i),
+                    "ssrc", "payload", "clock-base", "seqnum-base", "timestamp-offset", "seqnum-offset",
+                    NULL
+                );
+            }
+            return caps;
+        }
+
+        static void flush_processor(GstElement * processor)
+        {
+            auto sink_pad = gst_element_get_static_pad(processor, "sink");
+            DEFER({
+                g_object_unref(sink_pad);
+            });
+            gst_pad_send_event(sink_pad, gst_event_new_flush_start());
+            gst_pad_send_event(sink_pad, gst_event_new_flush_stop(TRUE));
+        }
+
+        GstElement * CfgoSrc::_take_pooled_processor(const std::string & type, const GstCaps * key)
+        {
+            auto iter = std::find_if(m_processor_pool.begin(), m_processor_pool.end(), [&type, key](const PooledProcessor & pooled) {
+                auto factory_name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(gst_element_get_factory(pooled.m_processor)));
+                return type == factory_name && gst_caps_is_equal(pooled.m_key, key);
+            });
+            if (iter == m_processor_pool.end())
+            {
+                return nullptr;
+            }
+            auto processor = iter->m_processor;
+            gst_caps_unref(iter->m_key);
+            m_processor_pool.erase(iter);
+            return processor;
+        }
+
+        void CfgoSrc::_trim_processor_pool(GstCfgoSrc * owner, std::size_t size)
+        {
+            while (m_processor_pool.size() > size)
+            {
+                auto pooled = m_processor_pool.front();
+                m_processor_pool.pop_front();
+                gst_caps_unref(pooled.m_key);
+                _dispose_processor(owner, pooled.m_processor);
             }
-            if (type == "decodebin")
+        }
+
+        void CfgoSrc::_create_processor(GstCfgoSrc * owner, Channel & channel, const std::string & type)
+        {
+            GstElement * processor = nullptr;
+            if (m_processor_pool_size > 0)
             {
-                cfgosrc_decodebin_created(GST_ELEMENT(owner), processor);
-                if (m_decode_caps)
+                channel.m_processor_key = make_processor_key(channel.m_pad);
+                if (channel.m_processor_key)
                 {
-                    g_object_set(
-                        processor,
-                        "caps",
-                        m_decode_caps,
-                        NULL
-                    );
+                    processor = _take_pooled_processor(type, channel.m_processor_key);
+                }
+                if (processor)
+                {
+                    m_processor_reuses.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    m_processor_misses.fetch_add(1, std::memory_order_relaxed);
                 }
             }
-            else if (type == "parsebin")
+            bool reused = processor != nullptr;
+            if (!processor)
             {
-                cfgosrc_parsebin_created(GST_ELEMENT(owner), processor);
+                auto processor_name = fmt::sprintf("%s_%u", type, m_processor_seq++);
+                processor = gst_element_factory_make(type.c_str(), processor_name.c_str());
+                if (!processor)
+                {
+                    cfgo_error_submit_general(GST_ELEMENT(owner), ("Unable to create the " + type + " element: " + processor_name + ".").c_str(), TRUE, TRUE);
+                    return;
+                }
+                if (!gst_bin_add(GST_BIN(owner), processor))
+                {
+                    cfgo_error_submit_general(GST_ELEMENT(owner), ("Unable to add " + processor_name + " to " + GST_ELEMENT_NAME(owner) + ".").c_str(), TRUE, TRUE);
+                    return;
+                }
+                if (type == "decodebin")
+                {
+                    cfgosrc_decodebin_created(GST_ELEMENT(owner), processor);
+                    if (m_decode_caps)
+                    {
+                        g_object_set(
+                            processor,
+                            "caps",
+                            m_decode_caps,
+                            NULL
+                        );
+                    }
+                }
+                else if (type == "parsebin")
+                {
+                    cfgosrc_parsebin_created(GST_ELEMENT(owner), processor);
+                }
+                gst_object_ref(processor);
             }
+            tag_processor(processor, channel);
             channel.m_pad_added_handle = g_signal_connect_data(processor, "pad-added", G_CALLBACK(pad_added_handler), make_weak_holder(weak_from_this()), [](gpointer data, GClosure * closure) {
                 destroy_weak_holder<CfgoSrc>(data);
             }, G_CONNECT_DEFAULT);
             channel.m_pad_removed_handle = g_signal_connect_data(processor, "pad-removed", G_CALLBACK(pad_removed_handler), make_weak_holder(weak_from_this()), [](gpointer data, GClosure * closure) {
                 destroy_weak_holder<CfgoSrc>(data);
             }, G_CONNECT_DEFAULT);
+            // owned by the channel from now on, even if linking fails.
+            channel.m_processor = processor;
             auto sink_pad = gst_element_get_static_pad(processor, "sink");
             DEFER({
                 g_object_unref(sink_pad);
@@ -445,42 +685,66 @@ namespace cfgo
                 );
                 return;
             }
-            gst_element_sync_state_with_parent(processor);
-            gst_object_ref(processor);
-            channel.m_processor = processor;
-        }
-
-        void CfgoSrc::_destroy_processor(GstCfgoSrc * owner, Channel & channel)
-        {
-            if (!channel.m_processor)
+            if (reused)
             {
-                return;
+                // the pads were exposed for the previous channel, pad-added will not be emitted again.
+                gst_element_foreach_src_pad(processor, [](GstElement * element, GstPad * pad, gpointer user_data) -> gboolean {
+                    ((CfgoSrc *) user_data)->_install_pad(pad);
+                    return TRUE;
+                }, this);
             }
+            else
+            {
+                gst_element_sync_state_with_parent(processor);
+            }
+        }
 
-            auto processor_name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(gst_element_get_factory(channel.m_processor)));
+        void CfgoSrc::_dispose_processor(GstCfgoSrc * owner, GstElement * processor)
+        {
+            auto processor_name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(gst_element_get_factory(processor)));
             if (g_str_equal(processor_name, "decodebin"))
             {
-                cfgosrc_decodebin_will_destroyed(GST_ELEMENT(owner), channel.m_processor);
+                cfgosrc_decodebin_will_destroyed(GST_ELEMENT(owner), processor);
             }
             else if (g_str_equal(processor_name, "parsebin"))
             {
-                cfgosrc_parsebin_will_destroyed(GST_ELEMENT(owner), channel.m_processor);
+                cfgosrc_parsebin_will_destroyed(GST_ELEMENT(owner), processor);
+            }
+            gst_bin_remove(GST_BIN(owner), processor);
+            gst_object_unref(processor);
+        }
+
+        void CfgoSrc::_destroy_processor(GstCfgoSrc * owner, Channel & channel, bool recycle)
+        {
+            if (!channel.m_processor)
+            {
+                return;
             }
-            
             if (channel.m_pad_added_handle)
             {
                 g_signal_handler_disconnect(channel.m_processor, channel.m_pad_added_handle);
+                channel.m_pad_added_handle = 0L;
             }
             if (channel.m_pad_removed_handle)
             {
                 g_signal_handler_disconnect(channel.m_processor, channel.m_pad_removed_handle);
+                channel.m_pad_removed_handle = 0L;
             }
             auto sink_pad = gst_element_get_static_pad(channel.m_processor, "sink");
             gst_pad_unlink(channel.m_pad, sink_pad);
             g_object_unref(sink_pad);
-            gst_bin_remove(GST_BIN(owner), channel.m_processor);
-            gst_object_unref(channel.m_processor);
+            auto processor = channel.m_processor;
             channel.m_processor = nullptr;
+            if (recycle && m_processor_pool_size > 0 && channel.m_processor_key)
+            {
+                // the processor keeps its autoplugged chain and its state, the pool takes the ref of the channel.
+                flush_processor(processor);
+                m_processor_pool.push_back({ .m_key = channel.m_processor_key, .m_processor = processor });
+                channel.m_processor_key = nullptr;
+                _trim_processor_pool(owner, m_processor_pool_size);
+                return;
+            }
+            _dispose_processor(owner, processor);
         }
 
         std::string get_ghost_pad_name(GstPad * pad)
@@ -499,27 +763,27 @@ namespace cfgo
                     {
                         return "";
                     }
+                    DEFER({
+                        gst_object_unref(pad_owner);
+                    });
+                    auto tag = (ProcessorTag *) g_object_get_data(G_OBJECT(pad_owner), PROCESSOR_TAG_KEY);
+                    if (!tag)
+                    {
+                        return "";
+                    }
                     if (g_str_has_prefix(GST_ELEMENT_NAME(pad_owner), "parsebin_"))
                     {
-                        guint sessid, ssrc, pt;
-                        if (sscanf(GST_ELEMENT_NAME(pad_owner), "parsebin_%u_%u_%u", &sessid, &ssrc, &pt) == 3)
-                        {
-                            auto _name = g_strdup_printf("parse_src_%u_%u_%u_%u", sessid, ssrc, pt, pad_id);
-                            auto result = std::string(_name);
-                            g_free(_name);
-                            return result;
-                        }
+                        auto _name = g_strdup_printf("parse_src_%u_%u_%u_%u", tag->m_sessid, tag->m_ssrc, tag->m_pt, pad_id);
+                        auto result = std::string(_name);
+                        g_free(_name);
+                        return result;
                     }
                     else if (g_str_has_prefix(GST_ELEMENT_NAME(pad_owner), "decodebin_"))
                     {
-                        guint sessid, ssrc, pt;
-                        if (sscanf(GST_ELEMENT_NAME(pad_owner), "decodebin_%u_%u_%u", &sessid, &ssrc, &pt) == 3)
-                        {
-                            auto _name = g_strdup_printf("decode_src_%u_%u_%u_%u", sessid, ssrc, pt, pad_id);
-                            auto result = std::string(_name);
-                            g_free(_name);
-                            return result;
-                        }
+                        auto _name = g_strdup_printf("decode_src_%u_%u_%u_%u", tag->m_sessid, tag->m_ssrc, tag->m_pt, pad_id);
+                        auto result = std::string(_name);
+                        g_free(_name);
+                        return result;
                     }
                 }
             }
@@ -575,6 +839,13 @@ namespace cfgo
                         auto session = m_sessions[sessid];
                         auto channel = session->find_channel(ssrc, pt);
                         channel->uninstall_ghost(owner, pad);
+                        // the stream is gone, release the channel so its processor could be reused by a later channel with the same caps.
+                        auto processor_pads = channel->m_pads;
+                        for (auto && processor_pad : processor_pads)
+                        {
+                            channel->uninstall_ghost(owner, processor_pad);
+                        }
+                        session->destroy_channel(this, owner, *channel, true, true);
                     }
                 }
                 else if (ghost_name.starts_with("parse_src_"))
@@ -674,6 +945,12 @@ namespace cfgo
                 {
                     return;
                 }
+                if (mode == GST_CFGO_SRC_MODE_DEPAY || m_mode == GST_CFGO_SRC_MODE_DEPAY)
+                {
+                    // the depay mode has no rtpbin, the sessions would have to be rebuilt.
+                    CFGO_THIS_WARN("Switching between the depay mode and the other modes is not supported after attached, ignored.");
+                    return;
+                }
                 for (auto && session : m_sessions)
                 {
                     for (auto && channel : session->m_channels)
@@ -687,6 +964,7 @@ namespace cfgo
                         session->destroy_channel(this, owner, *channel, false);
                     }
                 }
+                _trim_processor_pool(owner, 0);
                 m_mode = mode;
                 for (auto && session : m_sessions)
                 {
@@ -723,55 +1001,106 @@ namespace cfgo
                     }
                 } 
             }
+            for (auto && pooled : m_processor_pool)
+            {
+                if (g_str_has_prefix(GST_ELEMENT_NAME(pooled.m_processor), "decodebin_"))
+                {
+                    g_object_set(
+                        pooled.m_processor,
+                        "caps",
+                        m_decode_caps,
+                        NULL
+                    );
+                }
+            }
+        }
+
+        void CfgoSrc::set_processor_pool_size(guint size)
+        {
+            std::lock_guard lock(m_mutex);
+            m_processor_pool_size = size;
+            _safe_use_owner<void>([this, size](GstCfgoSrc * owner) {
+                _trim_processor_pool(owner, size);
+            }, false);
         }
 
-        void rtpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data)
+        void CfgoSrc::set_session_queue_limits(guint64 max_bytes, guint64 max_buffers)
         {
-            auto & self = cast_shared_holder_ref<CfgoSrc>(user_data);
-            CFGO_SELF_TRACE("{} need {} bytes data", GST_ELEMENT_NAME(appsrc), length);
-            std::lock_guard lock(self->m_mutex);
-            for (auto && session : self->m_sessions)
+            std::lock_guard lock(m_mutex);
+            m_session_max_bytes = max_bytes;
+            m_session_max_buffers = max_buffers;
+            for (auto && session : m_sessions)
             {
-                std::ignore = session->m_rtp_need_data_ch.try_write();
+                session->set_queue_limits(max_bytes, max_buffers);
             }
         }
 
-        void rtpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data)
+        GstStructure * CfgoSrc::create_stats()
         {
-            if (auto self = cast_weak_holder<CfgoSrc>(user_data)->lock())
+            std::lock_guard lock(m_mutex);
+            GValue sessions = G_VALUE_INIT;
+            g_value_init(&sessions, GST_TYPE_ARRAY);
+            for (auto && session : m_sessions)
             {
-                CFGO_SELF_TRACE("{} say data is enough.", GST_ELEMENT_NAME(appsrc));
-                std::lock_guard lock(self->m_mutex);
-                for (auto && session : self->m_sessions)
-                {
-                    std::ignore = session->m_rtp_enough_data_ch.try_write();
-                }
+                GValue value = G_VALUE_INIT;
+                g_value_init(&value, GST_TYPE_STRUCTURE);
+                g_value_take_boxed(&value, session->create_stats());
+                gst_value_array_append_and_take_value(&sessions, &value);
             }
+            auto stats = gst_structure_new(
+                "application/x-cfgosrc-stats",
+                "processor-reuses", G_TYPE_UINT64, m_processor_reuses.load(std::memory_order_relaxed),
+                "processor-misses", G_TYPE_UINT64, m_processor_misses.load(std::memory_order_relaxed),
+                "processor-pooled", G_TYPE_UINT, (guint) m_processor_pool.size(),
+                NULL
+            );
+            gst_structure_take_value(stats, "session-stats", &sessions);
+            return stats;
         }
 
-        void rtcpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data)
+        static void session_src_need_data(GstAppSrc * appsrc, guint length, asiochan::channel<void, 1> & ch, CfgoSrc::SrcStats & stats)
         {
-            if (auto self = cast_weak_holder<CfgoSrc>(user_data)->lock())
+            CFGO_TRACE("{} need {} bytes data", GST_ELEMENT_NAME(appsrc), length);
+            stats.m_need_data->inc();
+            std::ignore = ch.try_write();
+        }
+
+        static void session_src_enough_data(GstAppSrc * appsrc, asiochan::channel<void, 1> & ch, CfgoSrc::SrcStats & stats)
+        {
+            CFGO_TRACE("{} say data is enough.", GST_ELEMENT_NAME(appsrc));
+            stats.m_enough_data->inc();
+            std::ignore = ch.try_write();
+        }
+
+        static void rtpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data)
+        {
+            if (auto session = cast_weak_holder<CfgoSrc::Session>(user_data)->lock())
             {
-                CFGO_SELF_TRACE("{} need {} bytes data", GST_ELEMENT_NAME(appsrc), length);
-                std::lock_guard lock(self->m_mutex);
-                for (auto && session : self->m_sessions)
-                {
-                    std::ignore = session->m_rtcp_need_data_ch.try_write();
-                }
+                session_src_need_data(appsrc, length, session->m_rtp_need_data_ch, session->m_rtp_stats);
             }
         }
 
-        void rtcpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data)
+        static void rtpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data)
         {
-            if (auto self = cast_weak_holder<CfgoSrc>(user_data)->lock())
+            if (auto session = cast_weak_holder<CfgoSrc::Session>(user_data)->lock())
             {
-                CFGO_SELF_TRACE("{} say data is enough.", GST_ELEMENT_NAME(appsrc));
-                std::lock_guard lock(self->m_mutex);
-                for (auto && session : self->m_sessions)
-                {
-                    std::ignore = session->m_rtcp_enough_data_ch.try_write();
-                }
+                session_src_enough_data(appsrc, session->m_rtp_enough_data_ch, session->m_rtp_stats);
+            }
+        }
+
+        static void rtcpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data)
+        {
+            if (auto session = cast_weak_holder<CfgoSrc::Session>(user_data)->lock())
+            {
+                session_src_need_data(appsrc, length, session->m_rtcp_need_data_ch, session->m_rtcp_stats);
+            }
+        }
+
+        static void rtcpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data)
+        {
+            if (auto session = cast_weak_holder<CfgoSrc::Session>(user_data)->lock())
+            {
+                session_src_enough_data(appsrc, session->m_rtcp_enough_data_ch, session->m_rtcp_stats);
             }
         }
 
@@ -798,14 +1127,6 @@ namespace cfgo
             {
                 throw cpptrace::runtime_error("Unable to create rtpbin.");
             }
-            GstAppSrcCallbacks rtp_cbs {};
-            rtp_cbs.enough_data = rtpsrc_enough_data;
-            rtp_cbs.need_data = rtpsrc_need_data;
-            rtp_src_set_callbacks(owner, rtp_cbs, make_weak_holder(weak_from_this()), destroy_weak_holder<CfgoSrc>);
-            GstAppSrcCallbacks rtcp_cbs {};
-            rtcp_cbs.enough_data = rtcpsrc_enough_data;
-            rtcp_cbs.need_data = rtcpsrc_need_data;
-            rtcp_src_set_callbacks(owner, rtcp_cbs, make_weak_holder(weak_from_this()), destroy_weak_holder<CfgoSrc>);
             m_request_pt_map = g_signal_connect_data(m_rtp_bin, "request-pt-map", G_CALLBACK(request_pt_map), make_weak_holder(weak_from_this()), [](gpointer data, GClosure * closure) {
                 destroy_weak_holder<CfgoSrc>(data);
             }, G_CONNECT_DEFAULT);
@@ -819,34 +1140,643 @@ namespace cfgo
             gst_element_sync_state_with_parent(m_rtp_bin);
         }
 
-        auto CfgoSrc::_create_session(GstCfgoSrc * owner, TrackPtr track) -> SessionPtr
+        GstElement * CfgoSrc::_create_session_src(GstCfgoSrc * owner, Session & session, const std::string & name, GstPad * sink_pad, GstAppSrcCallbacks & callbacks)
         {
-            auto i = m_sessions.size();
-            CFGO_THIS_DEBUG("Creating session {}.", i);
-            SessionPtr session = std::make_shared<Session>();
-            session->m_id = i;
-            session->m_track = track;
+            auto src = gst_element_factory_make("appsrc", name.c_str());
+            if (!src)
+            {
+                throw cpptrace::runtime_error(fmt::format("Unable to create element {} for the parent cfgosrc.", name));
+            }
+            g_object_set(
+                src,
+                "format", GST_FORMAT_TIME,
+                "is-live", TRUE,
+                "max-bytes", m_session_max_bytes,
+                "max-buffers", m_session_max_buffers,
+                NULL
+            );
+            gst_app_src_set_callbacks(GST_APP_SRC(src), &callbacks, make_weak_holder(session.weak_from_this()), destroy_weak_holder<Session>);
+            if (!gst_bin_add(GST_BIN(owner), src))
+            {
+                gst_object_unref(src);
+                throw cpptrace::runtime_error(fmt::format("Unable to add {} to {}.", name, GST_ELEMENT_NAME(owner)));
+            }
+            gst_object_ref(src);
+            auto src_pad = gst_element_get_static_pad(src, "src");
+            DEFER({
+                gst_object_unref(src_pad);
+            });
+            if (GST_PAD_LINK_FAILED(gst_pad_link(src_pad, sink_pad)))
+            {
+                release_session_src(owner, src);
+                throw cpptrace::runtime_error(fmt::format("Unable to link {} to {}.", name, get_pad_full_name(sink_pad)));
+            }
+            gst_element_sync_state_with_parent(src);
+            return src;
+        }
+
+        void CfgoSrc::_create_rtp_session(GstCfgoSrc * owner, Session & session)
+        {
+            auto i = session.m_id;
             string rtp_pad_name = fmt::sprintf("recv_rtp_sink_%u", i);
             CFGO_THIS_DEBUG("Requesting the rtp pad {}.", rtp_pad_name);
-            session->m_rtp_pad = gst_element_request_pad_simple(m_rtp_bin, rtp_pad_name.c_str());
-            if (!session->m_rtp_pad)
+            session.m_rtp_pad = gst_element_request_pad_simple(m_rtp_bin, rtp_pad_name.c_str());
+            if (!session.m_rtp_pad)
             {
                 throw cpptrace::runtime_error(fmt::format("Unable to request the pad {} from rtpbin.", rtp_pad_name));
             }
-            link_rtp_src(owner, session->m_rtp_pad);
+            GstAppSrcCallbacks rtp_cbs {};
+            rtp_cbs.enough_data = rtpsrc_enough_data;
+            rtp_cbs.need_data = rtpsrc_need_data;
+            session.m_rtp_src = _create_session_src(owner, session, fmt::sprintf("rtpsrc_%u", i), session.m_rtp_pad, rtp_cbs);
             string rtcp_pad_name = fmt::sprintf("recv_rtcp_sink_%u", i);
             CFGO_THIS_DEBUG("Requesting the rtcp pad {}.", rtcp_pad_name);
-            session->m_rtcp_pad = gst_element_request_pad_simple(m_rtp_bin, rtcp_pad_name.c_str());
-            if (!session->m_rtcp_pad)
+            session.m_rtcp_pad = gst_element_request_pad_simple(m_rtp_bin, rtcp_pad_name.c_str());
+            if (!session.m_rtcp_pad)
             {
                 throw cpptrace::runtime_error(fmt::format("Unable to request the pad {} from rtpbin.", rtcp_pad_name));
             }
-            link_rtcp_src(owner, session->m_rtcp_pad);
+            GstAppSrcCallbacks rtcp_cbs {};
+            rtcp_cbs.enough_data = rtcpsrc_enough_data;
+            rtcp_cbs.need_data = rtcpsrc_need_data;
+            session.m_rtcp_src = _create_session_src(owner, session, fmt::sprintf("rtcpsrc_%u", i), session.m_rtcp_pad, rtcp_cbs);
+        }
+
+        static GstCaps * depay_request_pt_map(GstElement * ptdemux, guint pt, gpointer user_data)
+        {
+            if (auto session = cast_weak_holder<CfgoSrc::Session>(user_data)->lock())
+            {
+                return (GstCaps *) session->m_track->get_gst_caps(pt);
+            }
+            return nullptr;
+        }
+
+        void depay_pad_added_handler(GstElement * src, GstPad * new_pad, gpointer user_data)
+        {
+            if (auto self = cast_weak_holder<CfgoSrc>(user_data)->lock())
+            {
+                CFGO_SELF_DEBUG("[{}] add pad {}", GST_ELEMENT_NAME(src), GST_PAD_NAME(new_pad));
+                self->_install_depay_pad(src, new_pad);
+            }
+        }
+
+        static GstElementFactory * find_depayloader(const GstCaps * caps)
+        {
+            auto factories = gst_element_factory_list_get_elements(GST_ELEMENT_FACTORY_TYPE_DEPAYLOADER, GST_RANK_MARGINAL);
+            auto matched = gst_element_factory_list_filter(factories, caps, GST_PAD_SINK, FALSE);
+            gst_plugin_feature_list_free(factories);
+            matched = g_list_sort(matched, gst_plugin_feature_rank_compare_func);
+            GstElementFactory * factory = matched ? GST_ELEMENT_FACTORY(gst_object_ref(matched->data)) : nullptr;
+            gst_plugin_feature_list_free(matched);
+            return factory;
+        }
+
+        void CfgoSrc::_create_depay_session(GstCfgoSrc * owner, Session & session)
+        {
+            auto i = session.m_id;
+            auto ptdemux_name = fmt::sprintf("ptdemux_%u", i);
+            auto ptdemux = gst_element_factory_make("rtpptdemux", ptdemux_name.c_str());
+            if (!ptdemux)
+            {
+                throw cpptrace::runtime_error(fmt::format("Unable to create element {} for the parent cfgosrc.", ptdemux_name));
+            }
+            g_signal_connect_data(ptdemux, "request-pt-map", G_CALLBACK(depay_request_pt_map), make_weak_holder(session.weak_from_this()), [](gpointer data, GClosure * closure) {
+                destroy_weak_holder<Session>(data);
+            }, G_CONNECT_DEFAULT);
+            g_signal_connect_data(ptdemux, "pad-added", G_CALLBACK(depay_pad_added_handler), make_weak_holder(weak_from_this()), [](gpointer data, GClosure * closure) {
+                destroy_weak_holder<CfgoSrc>(data);
+            }, G_CONNECT_DEFAULT);
+            if (!gst_bin_add(GST_BIN(owner), ptdemux))
+            {
+                gst_object_unref(ptdemux);
+                throw cpptrace::runtime_error(fmt::format("Unable to add {} to {}.", ptdemux_name, GST_ELEMENT_NAME(owner)));
+            }
+            gst_object_ref(ptdemux);
+            session.m_ptdemux = ptdemux;
+            gst_element_sync_state_with_parent(ptdemux);
+            auto sink_pad = gst_element_get_static_pad(ptdemux, "sink");
+            DEFER({
+                gst_object_unref(sink_pad);
+            });
+            GstAppSrcCallbacks rtp_cbs {};
+            rtp_cbs.enough_data = rtpsrc_enough_data;
+            rtp_cbs.need_data = rtpsrc_need_data;
+            session.m_rtp_src = _create_session_src(owner, session, fmt::sprintf("rtpsrc_%u", i), sink_pad, rtp_cbs);
+            auto caps = gst_caps_new_empty_simple("application/x-rtp");
+            g_object_set(session.m_rtp_src, "caps", caps, NULL);
+            gst_caps_unref(caps);
+            // no rtcp src, the sender reports are parsed in _push_msgs only to map the rtp timestamps.
+        }
+
+        void CfgoSrc::_install_depay_pad(GstElement * ptdemux, GstPad * pad)
+        {
+            _safe_use_owner<void>([this, ptdemux, pad](GstCfgoSrc * owner) {
+                guint sessid, pt;
+                if (sscanf(GST_ELEMENT_NAME(ptdemux), "ptdemux_%u", &sessid) != 1 || sscanf(GST_PAD_NAME(pad), "src_%u", &pt) != 1)
+                {
+                    return;
+                }
+                auto & session = m_sessions[sessid];
+                auto caps = gst_pad_get_current_caps(pad);
+                if (!caps)
+                {
+                    caps = (GstCaps *) session->m_track->get_gst_caps(pt);
+                }
+                DEFER({
+                    if (caps)
+                    {
+                        gst_caps_unref(caps);
+                    }
+                });
+                auto factory = caps ? find_depayloader(caps) : nullptr;
+                DEFER({
+                    if (factory)
+                    {
+                        gst_object_unref(factory);
+                    }
+                });
+                // rtx, fec or unknown payloads are consumed by a fakesink, otherwise not-linked stops the whole session.
+                GstElement * depay = nullptr;
+                if (factory)
+                {
+                    depay = gst_element_factory_create(factory, fmt::sprintf("depay_%u_%u", sessid, pt).c_str());
+                }
+                else
+                {
+                    CFGO_THIS_WARN("No depayloader found for pt {} of session {}, the payloads are dropped.", pt, sessid);
+                    depay = gst_element_factory_make("fakesink", fmt::sprintf("depay_%u_%u", sessid, pt).c_str());
+                    if (depay)
+                    {
+                        g_object_set(depay, "sync", FALSE, "async", FALSE, NULL);
+                    }
+                }
+                if (!depay)
+                {
+                    cfgo_error_submit_general(GST_ELEMENT(owner), fmt::format("Unable to create the element for pt {} of session {}.", pt, sessid).c_str(), TRUE, TRUE);
+                    return;
+                }
+                if (!gst_bin_add(GST_BIN(owner), depay))
+                {
+                    gst_object_unref(depay);
+                    cfgo_error_submit_general(GST_ELEMENT(owner), fmt::format("Unable to add {} to {}.", GST_ELEMENT_NAME(depay), GST_ELEMENT_NAME(owner)).c_str(), TRUE, TRUE);
+                    return;
+                }
+                gst_object_ref(depay);
+                session->m_depays.push_back(depay);
+                auto depay_sink = gst_element_get_static_pad(depay, "sink");
+                DEFER({
+                    gst_object_unref(depay_sink);
+                });
+                if (GST_PAD_LINK_FAILED(gst_pad_link(pad, depay_sink)))
+                {
+                    auto msg = "Unable to link" + get_pad_full_name(pad) + " to " + get_pad_full_name(depay_sink) + ".";
+                    cfgo_error_submit_general(GST_ELEMENT(owner), msg.c_str(), TRUE, TRUE);
+                    return;
+                }
+                gst_element_sync_state_with_parent(depay);
+                if (!factory)
+                {
+                    return;
+                }
+                auto depay_src = gst_element_get_static_pad(depay, "src");
+                DEFER({
+                    gst_object_unref(depay_src);
+                });
+                auto templ = gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(owner), "depay_src_%u_%u");
+                auto gpad = gst_ghost_pad_new_from_template(fmt::sprintf("depay_src_%u_%u", sessid, pt).c_str(), depay_src, templ);
+                g_object_set_data(G_OBJECT (depay_src), "GstCfgoSrc.ghostpad", gpad);
+                gst_pad_set_active(gpad, TRUE);
+                gst_element_add_pad(GST_ELEMENT(owner), gpad);
+            });
+        }
+
+        auto CfgoSrc::_create_session(GstCfgoSrc * owner, const std::string & sub_id, TrackPtr track) -> SessionPtr
+        {
+            auto i = m_sessions.size();
+            CFGO_THIS_DEBUG("Creating session {}.", i);
+            SessionPtr session = std::make_shared<Session>();
+            session->m_id = i;
+            session->m_track = track;
+            metrics::Labels labels {
+                .client = m_client->id(),
+                .sub = sub_id,
+                .track = track->global_id(),
+                .category = "rtp",
+            };
+            session->m_rtp_stats.init(labels);
+            labels.category = "rtcp";
+            session->m_rtcp_stats.init(labels);
+            if (m_mode == GST_CFGO_SRC_MODE_DEPAY)
+            {
+                _create_depay_session(owner, *session);
+            }
+            else
+            {
+                _create_rtp_session(owner, *session);
+            }
+            session->m_emit_buffer_allocate = cfgosrc_has_buffer_allocate_handler(GST_ELEMENT(owner));
+            if (m_pool_min_buffers > 0 || m_pool_max_buffers > 0)
+            {
+                session->m_pool_buf_size = m_client->config().m_rtc_config.mtu.value_or(DEFAULT_MTU);
+                // rtcp packets go to the small class, rtp packets to the mtu class.
+                session->m_pool = BufferPool(BufferPool::make_default_configure(session->m_pool_buf_size, 0, m_pool_min_buffers, m_pool_max_buffers));
+            }
             m_sessions.push_back(session);
             CFGO_THIS_DEBUG("Session {} created.", i);
             return session;
         }
 
+        static void destroy_msg(gpointer data)
+        {
+            delete static_cast<rtc::binary *>(data);
+        }
+
+        static GstBuffer * wrap_msg(Track::MsgPtr && msg)
+        {
+            auto size = msg->size();
+            auto data = msg->data();
+            auto raw = msg.release();
+            return gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY, data, size, 0, size, raw, destroy_msg);
+        }
+
+        GstBuffer * CfgoSrc::_create_buffer(GstCfgoSrc * owner, Session & session, Track::MsgPtr && msg)
+        {
+            GstBuffer * buffer = nullptr;
+            if (session.m_emit_buffer_allocate)
+            {
+                buffer = cfgosrc_buffer_allocate(GST_ELEMENT(owner));
+            }
+            if (!buffer && session.m_pool && msg->size() <= session.m_pool_buf_size)
+            {
+                buffer = session.m_pool.acquire_buffer(msg->size());
+            }
+            if (!buffer)
+            {
+                // no user allocated or pooled buffer, wrap the received memory directly. the msg is released with the buffer.
+                return wrap_msg(std::move(msg));
+            }
+            // the buffer is from the buffer-allocate handler or the pool, fallback to copy.
+            GstMapInfo info = GST_MAP_INFO_INIT;
+            if (!gst_buffer_map(buffer, &info, GST_MAP_READWRITE))
+            {
+                gst_buffer_unref(buffer);
+                throw cpptrace::runtime_error("Unable to map the buffer");
+            }
+            if (msg->size() > info.maxsize)
+            {
+                CFGO_THIS_WARN("The buffer is too small for the msg. The msg size is {}. The buffer max size is {}", msg->size(), info.maxsize);
+                gst_buffer_unmap(buffer, &info);
+                gst_buffer_unref(buffer);
+                return nullptr;
+            }
+            memcpy(info.data, msg->data(), msg->size());
+            gst_buffer_unmap(buffer, &info);
+            gst_buffer_set_size(buffer, msg->size());
+            return buffer;
+        }
+
+        void CfgoSrc::_push_msgs(GstCfgoSrc * owner, Session & session, Track::MsgType msg_type, std::vector<Track::TimedMsg> & msgs)
+        {
+            auto src = msg_type == Track::MsgType::RTP ? session.m_rtp_src : session.m_rtcp_src;
+            auto & stats = msg_type == Track::MsgType::RTP ? session.m_rtp_stats : session.m_rtcp_stats;
+            if (!src)
+            {
+                if (msg_type == Track::MsgType::RTCP && session.m_ptdemux && (m_timestamp_mode == GST_CFGO_SRC_TIMESTAMP_MODE_RTP || m_latency_meta))
+                {
+                    // the depay mode has no rtcp src, the sender reports are only used to map the rtp timestamps.
+                    auto running_time = _get_running_time(owner);
+                    for (auto && msg : msgs)
+                    {
+                        auto buffer = wrap_msg(std::move(msg.msg));
+                        _on_rtcp_buffer(session, buffer, running_time);
+                        gst_buffer_unref(buffer);
+                    }
+                }
+                return;
+            }
+            auto runing_time = _get_running_time(owner);
+            // the clocks are read once for the whole batch.
+            GstClockTime push_time = m_latency_meta ? steady_clock_ns() : GST_CLOCK_TIME_NONE;
+            GstClockTime now = m_latency_meta ? system_clock_ns() : GST_CLOCK_TIME_NONE;
+            GstBufferList * list = gst_buffer_list_new_sized(msgs.size());
+            DEFER({
+                if (list)
+                {
+                    gst_buffer_list_unref(list);
+                }
+            });
+            gsize bytes = 0;
+            for (auto && msg : msgs)
+            {
+                CFGO_THIS_TRACE("Received {} bytes {} data.", msg.msg->size(), msg_type);
+                auto buffer = _create_buffer(owner, session, std::move(msg.msg));
+                if (!buffer)
+                {
+                    continue;
+                }
+                if (msg_type == Track::MsgType::RTCP)
+                {
+                    // only the rtp timestamps and the latency meta use the sender reports.
+                    if (m_timestamp_mode == GST_CFGO_SRC_TIMESTAMP_MODE_RTP || m_latency_meta)
+                    {
+                        _on_rtcp_buffer(session, buffer, runing_time);
+                    }
+                    GST_BUFFER_PTS(buffer) = GST_BUFFER_DTS(buffer) = runing_time;
+                }
+                else
+                {
+                    bool use_rtp_ts = m_timestamp_mode == GST_CFGO_SRC_TIMESTAMP_MODE_RTP;
+                    bool clock_updated = (use_rtp_ts || m_latency_meta) && _update_rtp_clock(session, buffer);
+                    if (use_rtp_ts)
+                    {
+                        GST_BUFFER_PTS(buffer) = GST_BUFFER_DTS(buffer) = _rtp_to_running_time(session, clock_updated, runing_time);
+                    }
+                    else
+                    {
+                        GST_BUFFER_PTS(buffer) = GST_BUFFER_DTS(buffer) = runing_time;
+                    }
+                    if (m_latency_meta)
+                    {
+                        _add_latency_meta(session, buffer, clock_updated, msg, push_time, now);
+                    }
+                }
+                bytes += gst_buffer_get_size(buffer);
+                gst_buffer_list_add(list, buffer);
+            }
+            auto n = gst_buffer_list_length(list);
+            if (n == 0)
+            {
+                return;
+            }
+            CFGO_THIS_TRACE("Push {} bytes {} data in {} buffers.", bytes, msg_type, n);
+            if (n == 1)
+            {
+                auto buffer = gst_buffer_ref(gst_buffer_list_get(list, 0));
+                gst_buffer_list_remove(list, 0, 1);
+                gst_app_src_push_buffer(GST_APP_SRC(src), buffer);
+            }
+            else
+            {
+                gst_app_src_push_buffer_list(GST_APP_SRC(src), list);
+                list = nullptr;
+            }
+            stats.m_pushed_buffers->inc(n);
+            stats.m_pushed_bytes->inc(bytes);
+            auto level = gst_app_src_get_current_level_bytes(GST_APP_SRC(src));
+            stats.m_level_bytes->set(static_cast<std::int64_t>(level));
+            auto max_level = stats.m_max_level_bytes.load(std::memory_order_relaxed);
+            while (level > max_level && !stats.m_max_level_bytes.compare_exchange_weak(max_level, level, std::memory_order_relaxed)) {}
+        }
+
+        void CfgoSrc::set_clock(GstClock * clock, GstClockTime base_time)
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_clock)
+            {
+                gst_object_unref(m_clock);
+            }
+            m_clock = clock ? GST_CLOCK(gst_object_ref(clock)) : nullptr;
+            m_base_time = base_time;
+        }
+
+        void CfgoSrc::set_pool_limits(guint min_buffers, guint max_buffers)
+        {
+            std::lock_guard lock(m_mutex);
+            m_pool_min_buffers = min_buffers;
+            m_pool_max_buffers = max_buffers;
+        }
+
+        void CfgoSrc::set_timestamp_mode(GstCfgoSrcTimestampMode mode)
+        {
+            std::lock_guard lock(m_mutex);
+            m_timestamp_mode = mode;
+        }
+
+        void CfgoSrc::set_latency_meta(bool enable)
+        {
+            std::lock_guard lock(m_mutex);
+            m_latency_meta = enable;
+        }
+
+        GstClockTime CfgoSrc::_get_running_time(GstCfgoSrc * owner)
+        {
+            if (m_clock)
+            {
+                return gst_clock_get_time(m_clock) - m_base_time;
+            }
+            // not playing yet, so the clock is not cached.
+            auto clock = gst_element_get_clock(GST_ELEMENT(owner));
+            if (!clock)
+            {
+                clock = gst_system_clock_obtain();
+            }
+            DEFER({
+                gst_object_unref(clock);
+            });
+            return gst_clock_get_time(clock) - gst_element_get_base_time(GST_ELEMENT(owner));
+        }
+
+        static GstClockTime ntp_to_ns(guint64 ntp)
+        {
+            return gst_util_uint64_scale(ntp, GST_SECOND, G_GUINT64_CONSTANT(1) << 32);
+        }
+
+        static GstClockTime apply_offset(GstClockTime base, gint64 offset)
+        {
+            if (offset < 0 && (guint64) -offset > base)
+            {
+                return 0;
+            }
+            return base + offset;
+        }
+
+        static gint64 rtp_diff_to_ns(guint64 ext_ts, guint64 base_ext_ts, guint32 clock_rate)
+        {
+            if (ext_ts >= base_ext_ts)
+            {
+                return (gint64) gst_util_uint64_scale(ext_ts - base_ext_ts, GST_SECOND, clock_rate);
+            }
+            else
+            {
+                return -(gint64) gst_util_uint64_scale(base_ext_ts - ext_ts, GST_SECOND, clock_rate);
+            }
+        }
+
+        void CfgoSrc::_on_rtcp_buffer(Session & session, GstBuffer * buffer, GstClockTime running_time)
+        {
+            auto & rtp_clock = session.m_rtp_clock;
+            if (rtp_clock.m_ext_ts == (guint64) -1)
+            {
+                // the sender report is useless until its rtp timestamp could be extended.
+                return;
+            }
+            GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+            if (!gst_rtcp_buffer_map(buffer, GST_MAP_READ, &rtcp))
+            {
+                return;
+            }
+            DEFER({
+                gst_rtcp_buffer_unmap(&rtcp);
+            });
+            GstRTCPPacket packet;
+            for (auto more = gst_rtcp_buffer_get_first_packet(&rtcp, &packet); more; more = gst_rtcp_packet_move_to_next(&packet))
+            {
+                if (gst_rtcp_packet_get_type(&packet) != GST_RTCP_TYPE_SR)
+                {
+                    continue;
+                }
+                guint32 ssrc, rtp_ts, packet_count, octet_count;
+                guint64 ntp;
+                gst_rtcp_packet_sr_get_sender_info(&packet, &ssrc, &ntp, &rtp_ts, &packet_count, &octet_count);
+                if (ssrc != rtp_clock.m_ssrc)
+                {
+                    // the report of another stream, its rtp timestamps are unrelated.
+                    continue;
+                }
+                guint64 ext_ts = rtp_clock.m_ext_ts;
+                gst_rtp_buffer_ext_timestamp(&ext_ts, rtp_ts);
+                rtp_clock.m_sr_ext_ts = ext_ts;
+                rtp_clock.m_sr_ntp = ntp_to_ns(ntp);
+                rtp_clock.m_has_sr = true;
+                // the first sender report of all sessions maps the sender wall clock to the running time, so the tracks keep in sync.
+                if (!m_has_ntp_offset)
+                {
+                    m_ntp_offset = (gint64) running_time - (gint64) rtp_clock.m_sr_ntp;
+                    m_has_ntp_offset = true;
+                }
+            }
+        }
+
+        bool CfgoSrc::_update_rtp_clock(Session & session, GstBuffer * buffer)
+        {
+            GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+            if (!gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp))
+            {
+                return false;
+            }
+            auto pt = gst_rtp_buffer_get_payload_type(&rtp);
+            auto ssrc = gst_rtp_buffer_get_ssrc(&rtp);
+            auto rtp_ts = gst_rtp_buffer_get_timestamp(&rtp);
+            gst_rtp_buffer_unmap(&rtp);
+            auto & rtp_clock = session.m_rtp_clock;
+            if (rtp_clock.m_ssrc != ssrc && rtp_clock.m_ext_ts != (guint64) -1)
+            {
+                // a new stream, its timestamps are unrelated to the previous ones.
+                rtp_clock.m_ext_ts = (guint64) -1;
+                rtp_clock.m_has_base = false;
+                rtp_clock.m_has_sr = false;
+                rtp_clock.m_sr_mapped = false;
+                rtp_clock.m_pts_offset = 0;
+            }
+            rtp_clock.m_ssrc = ssrc;
+            if (rtp_clock.m_pt != pt)
+            {
+                rtp_clock.m_pt = pt;
+                rtp_clock.m_clock_rate = 0;
+                auto caps = (GstCaps *) session.m_track->get_gst_caps(pt);
+                if (caps)
+                {
+                    gint clock_rate = 0;
+                    if (gst_structure_get_int(gst_caps_get_structure(caps, 0), "clock-rate", &clock_rate) && clock_rate > 0)
+                    {
+                        rtp_clock.m_clock_rate = clock_rate;
+                    }
+                    gst_caps_unref(caps);
+                }
+                // the timestamps of different payload types are not comparable.
+                rtp_clock.m_has_base = false;
+                rtp_clock.m_has_sr = false;
+                rtp_clock.m_sr_mapped = false;
+                rtp_clock.m_pts_offset = 0;
+            }
+            if (rtp_clock.m_clock_rate == 0)
+            {
+                return false;
+            }
+            gst_rtp_buffer_ext_timestamp(&rtp_clock.m_ext_ts, rtp_ts);
+            return true;
+        }
+
+        GstClockTime CfgoSrc::_rtp_to_running_time(Session & session, bool clock_updated, GstClockTime arrival_time)
+        {
+            if (!clock_updated)
+            {
+                return arrival_time;
+            }
+            auto & rtp_clock = session.m_rtp_clock;
+            if (rtp_clock.m_has_sr && m_has_ntp_offset)
+            {
+                auto ntp = apply_offset(rtp_clock.m_sr_ntp, rtp_diff_to_ns(rtp_clock.m_ext_ts, rtp_clock.m_sr_ext_ts, rtp_clock.m_clock_rate));
+                auto pts = apply_offset(ntp, m_ntp_offset);
+                if (!rtp_clock.m_sr_mapped)
+                {
+                    // continue from the arrival anchored timestamps, so the pts neither jumps nor goes back at the switch.
+                    if (rtp_clock.m_has_base)
+                    {
+                        auto arrival_pts = apply_offset(rtp_clock.m_base_time, rtp_diff_to_ns(rtp_clock.m_ext_ts, rtp_clock.m_base_ext_ts, rtp_clock.m_clock_rate));
+                        rtp_clock.m_pts_offset = (gint64) arrival_pts - (gint64) pts;
+                    }
+                    rtp_clock.m_sr_mapped = true;
+                    rtp_clock.m_slew_ext_ts = rtp_clock.m_ext_ts;
+                }
+                else if (rtp_clock.m_pts_offset != 0 && rtp_clock.m_ext_ts > rtp_clock.m_slew_ext_ts)
+                {
+                    // 1/64 of the elapsed media time, small enough to keep the pts monotonic, so the sessions converge to the sender report sync.
+                    auto step = rtp_diff_to_ns(rtp_clock.m_ext_ts, rtp_clock.m_slew_ext_ts, rtp_clock.m_clock_rate) / 64;
+                    rtp_clock.m_pts_offset = rtp_clock.m_pts_offset > 0 ? std::max<gint64>(rtp_clock.m_pts_offset - step, 0) : std::min<gint64>(rtp_clock.m_pts_offset + step, 0);
+                    rtp_clock.m_slew_ext_ts = rtp_clock.m_ext_ts;
+                }
+                return apply_offset(pts, rtp_clock.m_pts_offset);
+            }
+            if (!rtp_clock.m_has_base)
+            {
+                rtp_clock.m_base_ext_ts = rtp_clock.m_ext_ts;
+                rtp_clock.m_base_time = arrival_time;
+                rtp_clock.m_has_base = true;
+            }
+            return apply_offset(rtp_clock.m_base_time, rtp_diff_to_ns(rtp_clock.m_ext_ts, rtp_clock.m_base_ext_ts, rtp_clock.m_clock_rate));
+        }
+
+        // the seconds from 1900 to 1970.
+        constexpr GstClockTime NTP_UNIX_OFFSET = G_GUINT64_CONSTANT(2208988800) * GST_SECOND;
+
+        GstClockTime CfgoSrc::_rtp_to_sender_time(Session & session, bool clock_updated)
+        {
+            auto & rtp_clock = session.m_rtp_clock;
+            if (!clock_updated || !rtp_clock.m_has_sr)
+            {
+                return GST_CLOCK_TIME_NONE;
+            }
+            auto ntp = apply_offset(rtp_clock.m_sr_ntp, rtp_diff_to_ns(rtp_clock.m_ext_ts, rtp_clock.m_sr_ext_ts, rtp_clock.m_clock_rate));
+            return ntp > NTP_UNIX_OFFSET ? ntp - NTP_UNIX_OFFSET : GST_CLOCK_TIME_NONE;
+        }
+
+        void CfgoSrc::_add_latency_meta(Session & session, GstBuffer * buffer, bool clock_updated, const Track::TimedMsg & msg, GstClockTime push_time, GstClockTime now)
+        {
+            auto & latency = session.m_track->latency();
+            GstClockTime arrival = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.arrival.time_since_epoch()).count();
+            auto queued = push_time > arrival ? push_time - arrival : 0;
+            latency->track_to_push.record_ns(queued);
+            auto sender_time = _rtp_to_sender_time(session, clock_updated);
+            if (GST_CLOCK_TIME_IS_VALID(sender_time))
+            {
+                // the arrival in the wall clock, so it is comparable with the sender time.
+                auto arrival_wall = now - queued;
+                latency->sender_to_track.record_ns(arrival_wall > sender_time ? arrival_wall - sender_time : 0);
+            }
+            if (!session.m_latency_ref)
+            {
+                session.m_latency_ref = new LatencyRef(latency);
+            }
+            buffer_add_latency_meta(buffer, push_time, sender_time, session.m_latency_ref);
+        }
+
+        void CfgoSrc::set_batch_size(guint batch_size)
+        {
+            std::lock_guard lock(m_mutex);
+            m_batch_size = std::max(batch_size, 1u);
+        }
+
         auto CfgoSrc::_post_buffer(Session & session, Track::MsgType msg_type) -> asio::awaitable<void>
         {
             auto self = shared_from_this();
@@ -857,26 +1787,30 @@ namespace cfgo
                 {   
                     TryOption try_option;
                     guint64 read_timeout;
+                    guint batch_size;
                     {
                         std::lock_guard lock(m_mutex);
                         try_option = m_read_try_option;
                         read_timeout = m_read_timeout;
+                        batch_size = m_batch_size;
                     }
                     auto track = session.m_track;
-                    auto read_task = [self, track, msg_type](auto try_times, auto timeout_closer) -> asio::awaitable<Track::MsgPtr>
+                    auto read_task = [self, track, msg_type](auto try_times, auto timeout_closer) -> asio::awaitable<Track::TimedMsg>
                     {
                         if (try_times > 1)
                         {
                             CFGO_SELF_DEBUG("Read {} data timeout after {} ms. Tring the {} time.", msg_type, std::chrono::duration_cast<std::chrono::milliseconds>(timeout_closer.get_timeout()), Nth{try_times});
                         }
-                        Track::MsgPtr msg_ptr = std::move(co_await track->await_msg(msg_type, timeout_closer));
-                        co_return msg_ptr;
+                        Track::TimedMsg msg = std::move(co_await track->await_timed_msg(msg_type, timeout_closer));
+                        co_return msg;
                     };
-                    auto msg_ptr = co_await async_retry<Track::MsgPtr>(
+                    std::optional<event_trace::Span> read_span {};
+                    read_span.emplace(event_trace::Event::SRC_READ, &session, static_cast<std::uint64_t>(msg_type));
+                    auto msg_ptr = co_await async_retry<Track::TimedMsg>(
                         std::chrono::milliseconds {read_timeout},
                         try_option,
                         read_task,
-                        [](const Track::MsgPtr & msg) -> bool {
+                        [](const Track::TimedMsg & msg) -> bool {
                             return !msg;
                         },
                         m_close_ch
@@ -895,6 +1829,7 @@ namespace cfgo
                         }
                         co_return;
                     }
+                    read_span.reset();
                     auto msg = std::move(msg_ptr.value());
                     if (!msg)
                     {
@@ -902,91 +1837,25 @@ namespace cfgo
                         co_return;
                     }
 
-                    bool stop = false;
-                    bool skip = false;
-                    GstBuffer * buffer = nullptr;
-                    do {
-                        CFGO_SELF_TRACE("Received {} bytes {} data.", msg->size(), msg_type);
-                        auto maybe_buffer = _safe_use_owner<GstBuffer *>([&msg](auto owner) {
-                            GstBuffer *buffer = cfgosrc_buffer_allocate(GST_ELEMENT(owner));
-                            if (!buffer)
-                            {
-                                buffer = gst_buffer_new_and_alloc(msg->size());
-                            }
-                            auto clock = gst_element_get_clock(GST_ELEMENT(owner));
-                            if (!clock)
-                            {
-                                clock = gst_system_clock_obtain();
-                            }
-                            DEFER({
-                                gst_object_unref(clock);
-                            });
-                            auto time_now = gst_clock_get_time(clock);
-                            auto runing_time = time_now - gst_element_get_base_time(GST_ELEMENT(owner));
-                            GST_BUFFER_PTS(buffer) = GST_BUFFER_DTS(buffer) = runing_time;
-                            return buffer;
-                        });
-                        if (!maybe_buffer)
-                        {
-                            stop = true;
-                            break;
-                        }
-                        buffer = maybe_buffer.value();
-                        if (!buffer)
-                        {
-                            stop = true;
-                            break;
-                        }                        
-                        {
-                            GstMapInfo info = GST_MAP_INFO_INIT;
-                            if (!gst_buffer_map(buffer, &info, GST_MAP_READWRITE))
-                            {
-                                if (auto owner = _safe_get_owner())
-                                {
-                                    auto error = steal_shared_g_error(create_gerror_general("Unable to map the buffer", true));
-                                    cfgo_error_submit(owner.get(), error.get());
-                                }
-                                stop = true;
-                                break;
-                            }
-                            if (msg->size() > info.maxsize)
-                            {
-                                skip = true;
-                                CFGO_THIS_WARN("The buffer is too small for the msg. The msg size is {}. The buffer max size is {}", msg->size(), info.maxsize);
-                                break;
-                            }
-                            memcpy(info.data, msg->data(), msg->size());
-                            gst_buffer_unmap(buffer, &info);
-                        }
-                        if (!_safe_use_owner<void>([self, msg_type, buffer](auto owner) {
-                            CFGO_SELF_TRACE("Push {} bytes {} buffer.", gst_buffer_get_size(buffer), msg_type);
-                            if (msg_type == Track::MsgType::RTP)
-                            {
-                                push_rtp_buffer(owner, buffer);
-                            }
-                            else if (msg_type == Track::MsgType::RTCP)
-                            {
-                                push_rtcp_buffer(owner, buffer);
-                            }
-                            else
-                            {
-                                gst_buffer_unref(buffer);
-                            }
-                        }))
+                    // take the packets which have already arrived, so they are pushed as one buffer list.
+                    std::vector<Track::TimedMsg> msgs {};
+                    msgs.push_back(std::move(msg));
+                    while (msgs.size() < batch_size)
+                    {
+                        auto next = track->receive_timed_msg(msg_type);
+                        if (!next)
                         {
-                            stop = true;
                             break;
                         }
-                    } while (false);
-
-                    if (stop)
+                        msgs.push_back(std::move(next));
+                    }
+                    if (!_safe_use_owner<void>([this, &session, msg_type, &msgs](auto owner) {
+                        _push_msgs(owner, session, msg_type, msgs);
+                    }))
                     {
-                        if (buffer)
-                        {
-                            gst_buffer_unref(buffer);
-                        }
                         co_return;
                     }
+                    event_trace::record(event_trace::Event::PACKET_PUSH, event_trace::Phase::INSTANT, &session, msgs.size());
                     
                     if (msg_type == Track::MsgType::RTP)
                     {
@@ -1004,6 +1873,7 @@ namespace cfgo
                     }
                 } while (true);
                 assert (msg_type != Track::MsgType::ALL);
+                event_trace::Span need_data_span(event_trace::Event::SRC_NEED_DATA, &session, static_cast<std::uint64_t>(msg_type));
                 if (msg_type == Track::MsgType::RTP)
                 {
                     co_await chan_read_or_throw<void>(session.m_rtp_need_data_ch, m_close_ch);
@@ -1069,8 +1939,8 @@ namespace cfgo
                 cfgo::AsyncTasksAll<void> tasks(m_close_ch);
                 for (auto &track : sub.value()->tracks())
                 {
-                    auto session = _safe_use_owner<SessionPtr>([this, track](auto owner) {
-                        auto session = _create_session(owner, track);
+                    auto session = _safe_use_owner<SessionPtr>([this, &sub, track](auto owner) {
+                        auto session = _create_session(owner, sub.value()->sub_id(), track);
                         cfgosrc_on_track(GST_ELEMENT(owner), cfgo_boxed_track_make(*track));
                         return session;
                     });
@@ -1,4 +1,5 @@
 #include "cfgo/gst/error.hpp"
+#include "cfgo/async.hpp"
 #include "cfgo/gst/utils.hpp"
 #include "cfgo/log.hpp"
 #include "cfgo/utils.hpp"
@@ -49,17 +50,18 @@ namespace cfgo
         struct ErrorPrivateState
         {
             std::exception_ptr m_except_ptr;
+            // resolved and printed the first time the trace is read.
+            cpptrace::raw_trace m_raw_trace;
             bool m_cached;
             std::string m_trace_str;
-            std::string m_trace_color_str;
             std::string m_message;
             mutex m_mutex;
 
             void _capture();
-            void _cache_trace(const cpptrace::stacktrace & trace, bool overwrite = true);
+            void _cache_trace(const cpptrace::stacktrace & trace);
             ErrorPrivateState(std::exception_ptr except);
-            ErrorPrivateState(const cpptrace::stacktrace & trace);
-            ErrorPrivateState(std::exception_ptr except, const cpptrace::stacktrace & trace);
+            ErrorPrivateState(cpptrace::raw_trace && trace);
+            ErrorPrivateState(std::exception_ptr except, cpptrace::raw_trace && trace);
             const char * get_trace_str();
             const char * get_message();
         };
@@ -67,36 +69,31 @@ namespace cfgo
         ErrorPrivateState::ErrorPrivateState(std::exception_ptr except): m_except_ptr(except), m_cached(false)
         {}
 
-        ErrorPrivateState::ErrorPrivateState(const cpptrace::stacktrace & trace): m_cached(true)
-        {
-            _cache_trace(trace);
-        }
+        ErrorPrivateState::ErrorPrivateState(cpptrace::raw_trace && trace): m_raw_trace(std::move(trace)), m_cached(false)
+        {}
 
-        ErrorPrivateState::ErrorPrivateState(std::exception_ptr except, const cpptrace::stacktrace & trace): m_except_ptr(except), m_cached(false)
-        {
-            _cache_trace(trace);
-        }
+        ErrorPrivateState::ErrorPrivateState(std::exception_ptr except, cpptrace::raw_trace && trace): m_except_ptr(except), m_raw_trace(std::move(trace)), m_cached(false)
+        {}
 
-        void ErrorPrivateState::_cache_trace(const cpptrace::stacktrace & trace, bool overwrite)
+        void ErrorPrivateState::_cache_trace(const cpptrace::stacktrace & trace)
         {
             std::stringstream ss;
-            if (overwrite || m_trace_str.empty())
-            {
-                trace.print_with_snippets(ss, false);
-                m_trace_str = ss.str();
-                ss.clear();
-                ss.str("");
-            }
-            if (overwrite || m_trace_color_str.empty())
-            {
-                trace.print_with_snippets(ss, true);
-                m_trace_color_str = ss.str();
-            }
+            trace.print_with_snippets(ss, false);
+            m_trace_str = ss.str();
         }
 
         void ErrorPrivateState::_capture()
         {
+            if (m_cached)
+            {
+                return;
+            }
             m_cached = true;
+            if (!m_raw_trace.empty())
+            {
+                _cache_trace(m_raw_trace.resolve());
+                m_raw_trace.clear();
+            }
             if (!m_except_ptr)
             {
                 return;
@@ -106,20 +103,22 @@ namespace cfgo
                 std::rethrow_exception(m_except_ptr);
             }
             catch(const cpptrace::exception & e)
-            {   
-                _cache_trace(e.trace(), false);
+            {
+                // the trace captured when the error was created is preferred.
+                if (m_trace_str.empty())
+                {
+                    _cache_trace(e.trace());
+                }
                 m_message = e.message();
                 return;
             }
+            catch(...)
+            {}
             m_message = cfgo::what(m_except_ptr);
         }
 
         const char * ErrorPrivateState::get_trace_str()
         {
-            if (m_cached)
-            {
-                return m_trace_str.c_str();
-            }
             std::lock_guard lock(m_mutex);
             _capture();
             return m_trace_str.c_str();
@@ -127,15 +126,27 @@ namespace cfgo
 
         const char * ErrorPrivateState::get_message()
         {
-            if (m_cached)
-            {
-                return m_message.c_str();
-            }
             std::lock_guard lock(m_mutex);
             _capture();
             return m_message.c_str();
         }
 
+        static bool is_cancel_error(const std::exception_ptr & except)
+        {
+            try
+            {
+                std::rethrow_exception(except);
+            }
+            catch(const CancelError &)
+            {
+                return true;
+            }
+            catch(...)
+            {
+                return false;
+            }
+        }
+
         auto crete_gerror (CfgoError type, const gchar * message, bool gen_trace, const std::exception_ptr & except) -> GError *
         {
             auto error = g_error_new(CFGO_ERR, type, "%s", message);
@@ -149,13 +160,11 @@ namespace cfgo
                 }
                 if (except && gen_trace)
                 {
-                    auto trace = cpptrace::generate_trace(1);
-                    priv->m_state = std::make_shared<ErrorPrivateState>(except, trace);
+                    priv->m_state = std::make_shared<ErrorPrivateState>(except, cpptrace::generate_raw_trace(1));
                 }
                 else if (gen_trace)
                 {
-                    auto trace = cpptrace::generate_trace(1);
-                    priv->m_state = std::make_shared<ErrorPrivateState>(trace);
+                    priv->m_state = std::make_shared<ErrorPrivateState>(cpptrace::generate_raw_trace(1));
                 }
                 else
                 {
@@ -167,7 +176,8 @@ namespace cfgo
 
         GError * create_gerror_timeout(const std::string & message, bool trace)
         {
-            return crete_gerror(CFGO_ERROR_TIMEOUT, message.c_str(), trace, nullptr);
+            // a timeout is a cancellation, its trace is sampled like the CancelError.
+            return crete_gerror(CFGO_ERROR_TIMEOUT, message.c_str(), trace || sample_cancel_trace(), nullptr);
         }
 
         GError * create_gerror_general(const std::string & message, bool trace)
@@ -177,6 +187,10 @@ namespace cfgo
 
         GError * create_gerror_from_except(const std::exception_ptr & except, bool trace)
         {
+            if (trace && except && is_cancel_error(except))
+            {
+                trace = sample_cancel_trace();
+            }
             return crete_gerror(CFGO_ERROR_GENERAL, nullptr, trace, except);
         }
     } // namespace gst
@@ -54,8 +54,6 @@ namespace cfgo
 struct _GstCfgoSrcPrivate
 {
     cfgo::gst::GstCfgoSrcPrivateState * state;
-    GstElement * rtpsrc;
-    GstElement * rtcpsrc;
     GstElement * parsebin;
     GstElement * decodebin;
 };
@@ -100,6 +98,14 @@ enum
 static guint gst_cfgosrc_signals[LAST_SIGNAL] = { 0 };
 
 #define DEFAULT_GST_CFGO_SRC_MODE GST_CFGO_SRC_MODE_RAW
+#define DEFAULT_SESSION_MAX_BYTES 200000
+#define DEFAULT_SESSION_MAX_BUFFERS 0
+#define DEFAULT_BATCH_SIZE 1
+#define DEFAULT_POOL_MIN_BUFFERS 0
+#define DEFAULT_POOL_MAX_BUFFERS 0
+#define DEFAULT_PROCESSOR_POOL_SIZE 0
+#define DEFAULT_LATENCY_META FALSE
+#define DEFAULT_GST_CFGO_SRC_TIMESTAMP_MODE GST_CFGO_SRC_TIMESTAMP_MODE_ARRIVAL
 
 enum
 {
@@ -118,7 +124,16 @@ enum
     PROP_READ_TRY_DELAY_STEP,
     PROP_READ_TRY_DELAY_LEVEL,
     PROP_MODE,
-    PROP_DECODE_CAPS
+    PROP_DECODE_CAPS,
+    PROP_SESSION_MAX_BYTES,
+    PROP_SESSION_MAX_BUFFERS,
+    PROP_STATS,
+    PROP_BATCH_SIZE,
+    PROP_TIMESTAMP_MODE,
+    PROP_POOL_MIN_BUFFERS,
+    PROP_POOL_MAX_BUFFERS,
+    PROP_PROCESSOR_POOL_SIZE,
+    PROP_LATENCY_META
 };
 
 #define GST_CFGO_SRC_MODE_TYPE (gst_cfgo_src_mode_get_type())
@@ -130,6 +145,7 @@ gst_cfgo_src_mode_get_type (void)
     {GST_CFGO_SRC_MODE_RAW, "raw", "raw"},
     {GST_CFGO_SRC_MODE_PARSE, "parse", "parse"},
     {GST_CFGO_SRC_MODE_DECODE, "decode", "decode"},
+    {GST_CFGO_SRC_MODE_DEPAY, "depay", "depay"},
     {0, NULL, NULL},
   };
 
@@ -139,6 +155,23 @@ gst_cfgo_src_mode_get_type (void)
   return mode_type;
 }
 
+#define GST_CFGO_SRC_TIMESTAMP_MODE_TYPE (gst_cfgo_src_timestamp_mode_get_type())
+static GType
+gst_cfgo_src_timestamp_mode_get_type (void)
+{
+  static GType mode_type = 0;
+  static const GEnumValue mode_types[] = {
+    {GST_CFGO_SRC_TIMESTAMP_MODE_ARRIVAL, "the running time when the packet arrives", "arrival"},
+    {GST_CFGO_SRC_TIMESTAMP_MODE_RTP, "derived from the rtp timestamp and the rtcp sender report", "rtp"},
+    {0, NULL, NULL},
+  };
+
+  if (!mode_type) {
+    mode_type = g_enum_register_static ("GstCfgoSrcTimestampMode", mode_types);
+  }
+  return mode_type;
+}
+
 /* pad templates */
 
 static GstStaticPadTemplate gst_cfgosrc_rtp_src_template =
@@ -159,6 +192,12 @@ static GstStaticPadTemplate gst_cfgosrc_decode_src_template =
                             GST_PAD_SOMETIMES,
                             GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate gst_cfgosrc_depay_src_template =
+    GST_STATIC_PAD_TEMPLATE("depay_src_%u_%u",
+                            GST_PAD_SRC,
+                            GST_PAD_SOMETIMES,
+                            GST_STATIC_CAPS_ANY);
+
 /* class initialization */
 
 G_DEFINE_TYPE_WITH_CODE(GstCfgoSrc, gst_cfgosrc, GST_TYPE_BIN,
@@ -183,70 +222,6 @@ namespace cfgo
 {
     namespace gst
     {
-        void rtp_src_set_callbacks(GstCfgoSrc * parent, GstAppSrcCallbacks & callbacks, gpointer user_data, GDestroyNotify notify)
-        {
-            gst_app_src_set_callbacks(GST_APP_SRC(parent->priv->rtpsrc), &callbacks, user_data, notify);
-        }
-
-        void rtp_src_remove_callbacks(GstCfgoSrc * parent)
-        {
-            GstAppSrcCallbacks cbs {};
-            gst_app_src_set_callbacks(GST_APP_SRC(parent->priv->rtpsrc), &cbs, nullptr, nullptr);
-        }
-
-        void rtcp_src_set_callbacks(GstCfgoSrc * parent, GstAppSrcCallbacks & callbacks, gpointer user_data, GDestroyNotify notify)
-        {
-            gst_app_src_set_callbacks(GST_APP_SRC(parent->priv->rtcpsrc), &callbacks, user_data, notify);
-        }
-
-        void rtcp_src_remove_callbacks(GstCfgoSrc * parent)
-        {
-            GstAppSrcCallbacks cbs {};
-            gst_app_src_set_callbacks(GST_APP_SRC(parent->priv->rtcpsrc), &cbs, nullptr, nullptr);
-        }
-
-        void link_rtp_src(GstCfgoSrc * parent, GstPad * pad)
-        {
-            auto src_pad = gst_element_get_static_pad(parent->priv->rtpsrc, "src");
-            if (!src_pad)
-            {
-                throw cpptrace::range_error("Unable to get the pad src from rtpsrc.");
-            }
-            DEFER({
-                gst_object_unref(src_pad);
-            });
-            if (GST_PAD_LINK_FAILED(gst_pad_link(src_pad, pad)))
-            {
-                throw cpptrace::range_error("Unable to link the rtp src pad.");
-            }
-        }
-
-        void link_rtcp_src(GstCfgoSrc * parent, GstPad * pad)
-        {
-            auto src_pad = gst_element_get_static_pad(parent->priv->rtcpsrc, "src");
-            if (!src_pad)
-            {
-                throw cpptrace::range_error("Unable to get the pad src from rtcpsrc.");
-            }
-            DEFER({
-                gst_object_unref(src_pad);
-            });
-            if (GST_PAD_LINK_FAILED(gst_pad_link(src_pad, pad)))
-            {
-                throw cpptrace::range_error("Unable to link the rtcp src pad.");
-            }
-        }
-
-        GstFlowReturn push_rtp_buffer(GstCfgoSrc * parent, GstBuffer * buffer)
-        {
-            return gst_app_src_push_buffer(GST_APP_SRC(parent->priv->rtpsrc), buffer);
-        }
-
-        GstFlowReturn push_rtcp_buffer(GstCfgoSrc * parent, GstBuffer * buffer)
-        {
-            return gst_app_src_push_buffer(GST_APP_SRC(parent->priv->rtcpsrc), buffer);
-        }
-
         void cfgosrc_decodebin_created(GstElement * cfgosrc, GstElement * decodebin)
         {
             g_signal_emit(G_OBJECT(cfgosrc), gst_cfgosrc_signals[SIGNAL_DECODEBIN_CREATED], 0, decodebin);
@@ -274,6 +249,11 @@ namespace cfgo
             return buffer;
         }
 
+        bool cfgosrc_has_buffer_allocate_handler(GstElement * cfgosrc)
+        {
+            return g_signal_has_handler_pending(G_OBJECT(cfgosrc), gst_cfgosrc_signals[SIGNAL_BUFFER_ALLOCATE], 0, FALSE);
+        }
+
         void cfgosrc_on_track(GstElement * cfgosrc, CfgoBoxedTrack * track)
         {
             g_signal_emit(G_OBJECT(cfgosrc), gst_cfgosrc_signals[SIGNAL_ON_TRACK], 0, track);
@@ -296,6 +276,8 @@ gst_cfgosrc_class_init(GstCfgoSrcClass *klass)
                                               &gst_cfgosrc_parse_src_template);
     gst_element_class_add_static_pad_template(element_class,
                                               &gst_cfgosrc_decode_src_template);
+    gst_element_class_add_static_pad_template(element_class,
+                                              &gst_cfgosrc_depay_src_template);
 
     gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
                                           "FIXME Long name", "Generic", "FIXME Description",
@@ -416,7 +398,7 @@ gst_cfgosrc_class_init(GstCfgoSrcClass *klass)
     g_object_class_install_property(
         gobject_class, PROP_MODE,
         g_param_spec_enum (
-            "mode", "mode", "Control the exposed pad type", 
+            "mode", "mode", "Control the exposed pad type. The depay mode bypasses rtpbin and links each session to the depayloaders directly, it can not be switched from or to after started", 
             GST_CFGO_SRC_MODE_TYPE, DEFAULT_GST_CFGO_SRC_MODE, 
             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
     g_object_class_install_property(
@@ -425,6 +407,60 @@ gst_cfgosrc_class_init(GstCfgoSrcClass *klass)
             "The caps on which to stop decoding. (NULL = default)",
             GST_TYPE_CAPS,
             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_SESSION_MAX_BYTES,
+        g_param_spec_uint64(
+            "session-max-bytes", "session-max-bytes", "The maximum number of bytes queued by the appsrc of each session, 0 means unlimited",
+            0, G_MAXUINT64, DEFAULT_SESSION_MAX_BYTES,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_SESSION_MAX_BUFFERS,
+        g_param_spec_uint64(
+            "session-max-buffers", "session-max-buffers", "The maximum number of buffers queued by the appsrc of each session, 0 means unlimited",
+            0, G_MAXUINT64, DEFAULT_SESSION_MAX_BUFFERS,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_STATS,
+        g_param_spec_boxed ("stats", "Statistics",
+            "The queue statistics of each session",
+            GST_TYPE_STRUCTURE,
+            (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_BATCH_SIZE,
+        g_param_spec_uint(
+            "batch-size", "batch-size", "The max number of the arrived packets pushed together as one buffer list",
+            1, G_MAXINT32, DEFAULT_BATCH_SIZE,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_TIMESTAMP_MODE,
+        g_param_spec_enum (
+            "timestamp-mode", "timestamp-mode", "How the pts of the rtp buffers is calculated",
+            GST_CFGO_SRC_TIMESTAMP_MODE_TYPE, DEFAULT_GST_CFGO_SRC_TIMESTAMP_MODE,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_POOL_MIN_BUFFERS,
+        g_param_spec_uint(
+            "pool-min-buffers", "pool-min-buffers", "The min buffers of each size class of the session buffer pool. The pool is used instead of wrapping the packets when any of pool-min-buffers and pool-max-buffers is not 0",
+            0, G_MAXINT32, DEFAULT_POOL_MIN_BUFFERS,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_POOL_MAX_BUFFERS,
+        g_param_spec_uint(
+            "pool-max-buffers", "pool-max-buffers", "The max buffers of each size class of the session buffer pool, 0 means unlimited",
+            0, G_MAXINT32, DEFAULT_POOL_MAX_BUFFERS,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_PROCESSOR_POOL_SIZE,
+        g_param_spec_uint(
+            "processor-pool-size", "processor-pool-size", "How many flushed decodebin or parsebin are kept for the later channels with the same caps, 0 means never reuse them",
+            0, G_MAXINT32, DEFAULT_PROCESSOR_POOL_SIZE,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_LATENCY_META,
+        g_param_spec_boolean(
+            "latency-meta", "latency-meta", "Attach the push time and the sender time to the rtp buffers and record the latency histograms of the tracks",
+            DEFAULT_LATENCY_META,
+            (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     klass->decodebin_created = GST_DEBUG_FUNCPTR(gst_cfgosrc_decodebin_created);
     klass->parsebin_created = GST_DEBUG_FUNCPTR(gst_cfgosrc_parsebin_created);
@@ -437,34 +473,15 @@ gst_cfgosrc_init(GstCfgoSrc *cfgosrc)
 {
     cfgosrc->priv = (GstCfgoSrcPrivate *)gst_cfgosrc_get_instance_private(cfgosrc);
     GST_CFGOSRC_PVS(cfgosrc) = new cfgo::gst::GstCfgoSrcPrivateState();
-    auto rtpsrc = gst_element_factory_make("appsrc", "rtpsrc");
-    if (!rtpsrc)
-    {
-        throw cpptrace::runtime_error("Unable to create element rtpsrc for the parent cfgosrc.");
-    }
-    g_object_set(
-        rtpsrc,
-        "format", GST_FORMAT_TIME,
-        "is-live", TRUE,
-        "do-timestamp", TRUE,
-        NULL
-    );
-    gst_bin_add(GST_BIN(cfgosrc), rtpsrc);
-    cfgosrc->priv->rtpsrc = rtpsrc;
-    auto rtcpsrc = gst_element_factory_make("appsrc", "rtcpsrc");
-    if (!rtcpsrc)
-    {
-        throw cpptrace::runtime_error("Unable to create element rtcpsrc for the parent cfgosrc.");
-    }
-    g_object_set(
-        rtcpsrc,
-        "format", GST_FORMAT_TIME,
-        "is-live", TRUE,
-        "do-timestamp", TRUE,
-        NULL
-    );
-    gst_bin_add(GST_BIN(cfgosrc), rtcpsrc);
-    cfgosrc->priv->rtcpsrc = rtcpsrc;
+    // the appsrc pairs are created per session by the task.
+    cfgosrc->session_max_bytes = DEFAULT_SESSION_MAX_BYTES;
+    cfgosrc->session_max_buffers = DEFAULT_SESSION_MAX_BUFFERS;
+    cfgosrc->batch_size = DEFAULT_BATCH_SIZE;
+    cfgosrc->timestamp_mode = DEFAULT_GST_CFGO_SRC_TIMESTAMP_MODE;
+    cfgosrc->pool_min_buffers = DEFAULT_POOL_MIN_BUFFERS;
+    cfgosrc->pool_max_buffers = DEFAULT_POOL_MAX_BUFFERS;
+    cfgosrc->processor_pool_size = DEFAULT_PROCESSOR_POOL_SIZE;
+    cfgosrc->latency_meta = DEFAULT_LATENCY_META;
 }
 
 void _gst_cfgosrc_prepare(GstCfgoSrc *cfgosrc, bool reset_task)
@@ -490,6 +507,12 @@ void _gst_cfgosrc_prepare(GstCfgoSrc *cfgosrc, bool reset_task)
                 {
                     GST_CFGOSRC_PVS(cfgosrc)->task->set_decode_caps(cfgosrc->decode_caps);
                 }
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_session_queue_limits(cfgosrc->session_max_bytes, cfgosrc->session_max_buffers);
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_batch_size(cfgosrc->batch_size);
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_timestamp_mode(cfgosrc->timestamp_mode);
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_pool_limits(cfgosrc->pool_min_buffers, cfgosrc->pool_max_buffers);
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_processor_pool_size(cfgosrc->processor_pool_size);
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_latency_meta(cfgosrc->latency_meta);
             }
             else
             {
@@ -522,6 +545,13 @@ void gst_cfgosrc_start(GstCfgoSrc *cfgosrc)
     _gst_cfgosrc_prepare(cfgosrc, false);
     if (GST_CFGOSRC_PVS(cfgosrc)->task)
     {
+        // the base time is distributed before the children go to playing, so it is stable until the next state change.
+        auto clock = gst_element_get_clock(GST_ELEMENT(cfgosrc));
+        GST_CFGOSRC_PVS(cfgosrc)->task->set_clock(clock, gst_element_get_base_time(GST_ELEMENT(cfgosrc)));
+        if (clock)
+        {
+            gst_object_unref(clock);
+        }
         GST_DEBUG_OBJECT(cfgosrc, "%s", "start task, if already started, no side effect");
         GST_CFGOSRC_PVS(cfgosrc)->task->start();
         GST_DEBUG_OBJECT(cfgosrc, "%s", "resume task");
@@ -537,6 +567,7 @@ void gst_cfgosrc_stop(GstCfgoSrc *cfgosrc)
     if (GST_CFGOSRC_PVS(cfgosrc)->task)
     {
         GST_CFGOSRC_PVS(cfgosrc)->task->pause();
+        GST_CFGOSRC_PVS(cfgosrc)->task->set_clock(nullptr, 0);
     }
 }
 
@@ -626,6 +657,20 @@ bool gst_cfgosrc_set_enum_property(const GValue * value, gint * target)
     }
 }
 
+bool gst_cfgosrc_set_boolean_property(const GValue * value, gboolean * target)
+{
+    auto src = g_value_get_boolean(value);
+    if (src == *target)
+    {
+        return false;
+    }
+    else
+    {
+        *target = src;
+        return true;
+    }
+}
+
 void gst_cfgosrc_set_property(GObject *object, guint property_id,
                               const GValue *value, GParamSpec *pspec)
 {
@@ -819,6 +864,112 @@ void gst_cfgosrc_set_property(GObject *object, guint property_id,
         }
         break;
     }
+    case PROP_SESSION_MAX_BYTES:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint64_property(value, &cfgosrc->session_max_bytes))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The session-max-bytes argument was changed to %" G_GUINT64_FORMAT "\n", cfgosrc->session_max_bytes);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_session_queue_limits(cfgosrc->session_max_bytes, cfgosrc->session_max_buffers);
+            }
+        }
+        break;
+    }
+    case PROP_SESSION_MAX_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint64_property(value, &cfgosrc->session_max_buffers))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The session-max-buffers argument was changed to %" G_GUINT64_FORMAT "\n", cfgosrc->session_max_buffers);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_session_queue_limits(cfgosrc->session_max_bytes, cfgosrc->session_max_buffers);
+            }
+        }
+        break;
+    }
+    case PROP_BATCH_SIZE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint32_property(value, &cfgosrc->batch_size))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The batch-size argument was changed to %u\n", cfgosrc->batch_size);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_batch_size(cfgosrc->batch_size);
+            }
+        }
+        break;
+    }
+    case PROP_TIMESTAMP_MODE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_enum_property(value, (gint *) &cfgosrc->timestamp_mode))
+        {
+            auto smode = g_enum_to_string(GST_CFGO_SRC_TIMESTAMP_MODE_TYPE, cfgosrc->timestamp_mode);
+            GST_DEBUG_OBJECT(cfgosrc, "The timestamp-mode argument was changed to %s\n", smode);
+            g_free(smode);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_timestamp_mode(cfgosrc->timestamp_mode);
+            }
+        }
+        break;
+    }
+    case PROP_POOL_MIN_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint32_property(value, &cfgosrc->pool_min_buffers))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The pool-min-buffers argument was changed to %u\n", cfgosrc->pool_min_buffers);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_pool_limits(cfgosrc->pool_min_buffers, cfgosrc->pool_max_buffers);
+            }
+        }
+        break;
+    }
+    case PROP_POOL_MAX_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint32_property(value, &cfgosrc->pool_max_buffers))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The pool-max-buffers argument was changed to %u\n", cfgosrc->pool_max_buffers);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_pool_limits(cfgosrc->pool_min_buffers, cfgosrc->pool_max_buffers);
+            }
+        }
+        break;
+    }
+    case PROP_PROCESSOR_POOL_SIZE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_uint32_property(value, &cfgosrc->processor_pool_size))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The processor-pool-size argument was changed to %u\n", cfgosrc->processor_pool_size);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_processor_pool_size(cfgosrc->processor_pool_size);
+            }
+        }
+        break;
+    }
+    case PROP_LATENCY_META:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (gst_cfgosrc_set_boolean_property(value, &cfgosrc->latency_meta))
+        {
+            GST_DEBUG_OBJECT(cfgosrc, "The latency-meta argument was changed to %d\n", cfgosrc->latency_meta);
+            if (GST_CFGOSRC_PVS(cfgosrc)->task)
+            {
+                GST_CFGOSRC_PVS(cfgosrc)->task->set_latency_meta(cfgosrc->latency_meta);
+            }
+        }
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -923,6 +1074,67 @@ void gst_cfgosrc_get_property(GObject *object, guint property_id,
         g_value_set_boxed (value, cfgosrc->decode_caps);
         break;
     }
+    case PROP_SESSION_MAX_BYTES:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint64(value, cfgosrc->session_max_bytes);
+        break;
+    }
+    case PROP_SESSION_MAX_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint64(value, cfgosrc->session_max_buffers);
+        break;
+    }
+    case PROP_BATCH_SIZE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint(value, cfgosrc->batch_size);
+        break;
+    }
+    case PROP_TIMESTAMP_MODE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_enum(value, cfgosrc->timestamp_mode);
+        break;
+    }
+    case PROP_POOL_MIN_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint(value, cfgosrc->pool_min_buffers);
+        break;
+    }
+    case PROP_POOL_MAX_BUFFERS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint(value, cfgosrc->pool_max_buffers);
+        break;
+    }
+    case PROP_PROCESSOR_POOL_SIZE:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_uint(value, cfgosrc->processor_pool_size);
+        break;
+    }
+    case PROP_LATENCY_META:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        g_value_set_boolean(value, cfgosrc->latency_meta);
+        break;
+    }
+    case PROP_STATS:
+    {
+        GST_CFGOSRC_LOCK_GUARD(cfgosrc);
+        if (GST_CFGOSRC_PVS(cfgosrc)->task)
+        {
+            g_value_take_boxed(value, GST_CFGOSRC_PVS(cfgosrc)->task->create_stats());
+        }
+        else
+        {
+            g_value_take_boxed(value, gst_structure_new_empty("application/x-cfgosrc-stats"));
+        }
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -0,0 +1,140 @@
+#include "cfgo/gst/latency_meta.hpp"
+#include <chrono>
+
+namespace cfgo
+{
+    namespace gst
+    {
+        static gboolean latency_meta_init(GstMeta * meta, gpointer params, GstBuffer * buffer)
+        {
+            auto lmeta = reinterpret_cast<LatencyMeta *>(meta);
+            lmeta->push_time = GST_CLOCK_TIME_NONE;
+            lmeta->sender_time = GST_CLOCK_TIME_NONE;
+            lmeta->latency = nullptr;
+            return TRUE;
+        }
+
+        static void latency_meta_free(GstMeta * meta, GstBuffer * buffer)
+        {
+            auto lmeta = reinterpret_cast<LatencyMeta *>(meta);
+            if (lmeta->latency)
+            {
+                lmeta->latency->unref();
+                lmeta->latency = nullptr;
+            }
+        }
+
+        static gboolean latency_meta_transform(GstBuffer * dest, GstMeta * meta, GstBuffer * buffer, GQuark type, gpointer data)
+        {
+            auto lmeta = reinterpret_cast<LatencyMeta *>(meta);
+            if (!lmeta->latency)
+            {
+                return TRUE;
+            }
+            // the meta is about the time, so it survives any copy or transform of the data.
+            return buffer_add_latency_meta(dest, lmeta->push_time, lmeta->sender_time, lmeta->latency) != nullptr;
+        }
+
+        GType latency_meta_api_get_type()
+        {
+            static GType type = 0;
+            static const gchar * tags[] = { nullptr };
+            if (g_once_init_enter(&type))
+            {
+                GType _type = gst_meta_api_type_register("CfgoLatencyMetaAPI", tags);
+                g_once_init_leave(&type, _type);
+            }
+            return type;
+        }
+
+        const GstMetaInfo * latency_meta_get_info()
+        {
+            static const GstMetaInfo * meta_info = nullptr;
+            if (g_once_init_enter(&meta_info))
+            {
+                auto mi = gst_meta_register(
+                    latency_meta_api_get_type(),
+                    "CfgoLatencyMeta",
+                    sizeof(LatencyMeta),
+                    latency_meta_init,
+                    latency_meta_free,
+                    latency_meta_transform
+                );
+                g_once_init_leave(&meta_info, mi);
+            }
+            return meta_info;
+        }
+
+        LatencyMeta * buffer_add_latency_meta(GstBuffer * buffer, GstClockTime push_time, GstClockTime sender_time, LatencyRef * latency)
+        {
+            auto meta = reinterpret_cast<LatencyMeta *>(gst_buffer_add_meta(buffer, latency_meta_get_info(), nullptr));
+            if (!meta)
+            {
+                return nullptr;
+            }
+            meta->push_time = push_time;
+            meta->sender_time = sender_time;
+            meta->latency = latency ? latency->ref() : nullptr;
+            return meta;
+        }
+
+        void record_buffer_latency(GstBuffer * buffer)
+        {
+            TrackLatency * latency = nullptr;
+            GstClockTime push_time = GST_CLOCK_TIME_NONE;
+            GstClockTime sender_time = GST_CLOCK_TIME_NONE;
+            auto flush = [&]() {
+                if (!latency)
+                {
+                    return;
+                }
+                if (GST_CLOCK_TIME_IS_VALID(push_time))
+                {
+                    auto diff = GST_CLOCK_DIFF(push_time, steady_clock_ns());
+                    latency->push_to_sample.record_ns(diff > 0 ? diff : 0);
+                }
+                if (GST_CLOCK_TIME_IS_VALID(sender_time))
+                {
+                    auto diff = GST_CLOCK_DIFF(sender_time, system_clock_ns());
+                    latency->sender_to_sample.record_ns(diff > 0 ? diff : 0);
+                }
+            };
+            gpointer state = nullptr;
+            while (auto meta = gst_buffer_iterate_meta_filtered(buffer, &state, latency_meta_api_get_type()))
+            {
+                auto lmeta = reinterpret_cast<LatencyMeta *>(meta);
+                if (!lmeta->latency)
+                {
+                    continue;
+                }
+                if (lmeta->latency->get() != latency)
+                {
+                    // a new track, the metas of the same track are usually adjacent.
+                    flush();
+                    latency = lmeta->latency->get();
+                    push_time = GST_CLOCK_TIME_NONE;
+                    sender_time = GST_CLOCK_TIME_NONE;
+                }
+                if (GST_CLOCK_TIME_IS_VALID(lmeta->push_time) && (!GST_CLOCK_TIME_IS_VALID(push_time) || lmeta->push_time > push_time))
+                {
+                    push_time = lmeta->push_time;
+                }
+                if (GST_CLOCK_TIME_IS_VALID(lmeta->sender_time) && (!GST_CLOCK_TIME_IS_VALID(sender_time) || lmeta->sender_time > sender_time))
+                {
+                    sender_time = lmeta->sender_time;
+                }
+            }
+            flush();
+        }
+
+        GstClockTime steady_clock_ns() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        GstClockTime system_clock_ns() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    } // namespace gst
+} // namespace cfgo
@@ -10,7 +10,7 @@ namespace cfgo
 {
     namespace gst
     {
-        Pipeline::Pipeline(const std::string & name, CtxPtr exec_ctx): ImplBy(name, exec_ctx) {}
+        Pipeline::Pipeline(const std::string & name, CtxPtr exec_ctx, std::size_t message_capacity): ImplBy(name, exec_ctx, message_capacity) {}
 
         void Pipeline::run()
         {
@@ -27,6 +27,41 @@ namespace cfgo
             return impl()->await(close_ch);
         }
 
+        auto Pipeline::await_message(GstMessageType types, close_chan close_ch) -> asio::awaitable<GstMessageSPtr>
+        {
+            return impl()->await_message(types, std::move(close_ch));
+        }
+
+        void Pipeline::set_message_mask(GstMessageType types) const noexcept
+        {
+            impl()->set_message_mask(types);
+        }
+
+        GstMessageType Pipeline::message_mask() const noexcept
+        {
+            return impl()->message_mask();
+        }
+
+        auto Pipeline::message_statistics() const noexcept -> MessageStatistics
+        {
+            return impl()->message_statistics();
+        }
+
+        ElementTracer Pipeline::enable_tracer(const ElementTracer::Configure & conf) const
+        {
+            return impl()->enable_tracer(conf);
+        }
+
+        void Pipeline::disable_tracer() const
+        {
+            impl()->disable_tracer();
+        }
+
+        ElementTracer Pipeline::tracer() const
+        {
+            return impl()->tracer();
+        }
+
         void Pipeline::add_node(const std::string & name, const std::string & type)
         {
             impl()->add_node(name, type);
@@ -0,0 +1,555 @@
+#include "cfgo/gst/tracer.hpp"
+#include "cfgo/defer.hpp"
+#include "cfgo/log.hpp"
+#include "cfgo/utils.hpp"
+#include "cpptrace/cpptrace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace cfgo
+{
+    namespace gst
+    {
+        namespace detail
+        {
+            using Configure = cfgo::gst::ElementTracer::Configure;
+
+            static std::int64_t now_ns() noexcept
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            /**
+             * The state of one traced element. The hot fields are only touched by the probes with relaxed atomics.
+             * It refs the element and its probed pads, detach must be called to break the cycle through the probes.
+            */
+            class ElementStats
+            {
+            public:
+                static constexpr std::size_t ARRIVALS = 64;
+                // how many recent arrivals are scanned for the pts of an outgoing buffer.
+                static constexpr std::size_t SCAN = 16;
+
+                struct Arrival
+                {
+                    std::atomic<std::uint64_t> m_pts {GST_CLOCK_TIME_NONE};
+                    std::atomic<std::int64_t> m_at {0};
+                };
+
+                ElementStats(GstElement * element, std::uint32_t sample_interval):
+                    m_element(GST_ELEMENT(gst_object_ref(element))),
+                    m_sample_interval(sample_interval)
+                {
+                    auto path = gst_object_get_path_string(GST_OBJECT(element));
+                    m_path = path;
+                    g_free(path);
+                    if (auto factory = gst_element_get_factory(element))
+                    {
+                        m_factory = GST_OBJECT_NAME(factory);
+                    }
+                    m_level_buffers = g_object_class_find_property(G_OBJECT_GET_CLASS(element), "current-level-buffers");
+                    m_level_bytes = g_object_class_find_property(G_OBJECT_GET_CLASS(element), "current-level-bytes");
+                }
+
+                ~ElementStats()
+                {
+                    detach();
+                    gst_object_unref(m_element);
+                }
+
+                void on_sink(GstBuffer * buffer) noexcept
+                {
+                    if (m_sample_interval > 1 && m_sink_seq.fetch_add(1, std::memory_order_relaxed) % m_sample_interval != 0)
+                    {
+                        return;
+                    }
+                    auto at = now_ns();
+                    auto & arrival = m_arrivals[m_arrival_pos.fetch_add(1, std::memory_order_relaxed) % ARRIVALS];
+                    arrival.m_at.store(at, std::memory_order_relaxed);
+                    arrival.m_pts.store(GST_BUFFER_PTS(buffer), std::memory_order_release);
+                    m_last_arrival.store(at, std::memory_order_release);
+                }
+
+                void on_src(GstBuffer * buffer, guint n, gsize bytes) noexcept
+                {
+                    m_buffers.fetch_add(n, std::memory_order_relaxed);
+                    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+                    // nothing is pending, so the clock is not read at all.
+                    if (m_last_arrival.load(std::memory_order_acquire) == 0)
+                    {
+                        return;
+                    }
+                    auto pts = GST_BUFFER_PTS(buffer);
+                    std::int64_t at = 0;
+                    if (GST_CLOCK_TIME_IS_VALID(pts))
+                    {
+                        auto newest = m_arrival_pos.load(std::memory_order_relaxed);
+                        for (std::size_t i = 1; i <= SCAN && i <= newest; ++i)
+                        {
+                            auto & arrival = m_arrivals[(newest - i) % ARRIVALS];
+                            if (arrival.m_pts.load(std::memory_order_acquire) == pts)
+                            {
+                                at = arrival.m_at.exchange(0, std::memory_order_relaxed);
+                                break;
+                            }
+                        }
+                    }
+                    auto last = m_last_arrival.exchange(0, std::memory_order_acq_rel);
+                    if (at == 0)
+                    {
+                        at = last;
+                    }
+                    if (at != 0)
+                    {
+                        m_latency.record_ns(static_cast<std::uint64_t>(std::max<std::int64_t>(now_ns() - at, 0)));
+                    }
+                }
+
+                // the probe is removed at once if detach has already run, it would never be removed otherwise.
+                void add_probe(GstPad * pad, gulong id)
+                {
+                    {
+                        std::lock_guard lock(m_mutex);
+                        if (!m_detached)
+                        {
+                            m_probes.emplace_back(GST_PAD(gst_object_ref(pad)), id);
+                            return;
+                        }
+                    }
+                    gst_pad_remove_probe(pad, id);
+                }
+
+                void set_pad_added_handler(gulong handler)
+                {
+                    {
+                        std::lock_guard lock(m_mutex);
+                        if (!m_detached)
+                        {
+                            m_pad_added_handler = handler;
+                            return;
+                        }
+                    }
+                    g_signal_handler_disconnect(m_element, handler);
+                }
+
+                void detach()
+                {
+                    std::vector<std::pair<GstPad *, gulong>> probes {};
+                    gulong handler = 0;
+                    {
+                        std::lock_guard lock(m_mutex);
+                        m_detached = true;
+                        probes = std::move(m_probes);
+                        m_probes.clear();
+                        handler = std::exchange(m_pad_added_handler, 0);
+                    }
+                    if (handler)
+                    {
+                        g_signal_handler_disconnect(m_element, handler);
+                    }
+                    for (auto && [pad, id] : probes)
+                    {
+                        gst_pad_remove_probe(pad, id);
+                        gst_object_unref(pad);
+                    }
+                }
+
+                cfgo::gst::ElementTracer::ElementSnapshot snapshot(double secs)
+                {
+                    cfgo::gst::ElementTracer::ElementSnapshot s {
+                        .path = m_path,
+                        .factory = m_factory,
+                        .latency = m_latency.snapshot(),
+                        .buffers = m_buffers.load(std::memory_order_relaxed),
+                        .bytes = m_bytes.load(std::memory_order_relaxed),
+                        .buffers_per_sec = 0,
+                        .bytes_per_sec = 0,
+                        .queue_buffers = _read_level(m_level_buffers),
+                        .queue_bytes = _read_level(m_level_bytes),
+                    };
+                    if (secs > 0)
+                    {
+                        s.buffers_per_sec = (s.buffers - m_prev_buffers) / secs;
+                        s.bytes_per_sec = (s.bytes - m_prev_bytes) / secs;
+                    }
+                    m_prev_buffers = s.buffers;
+                    m_prev_bytes = s.bytes;
+                    return s;
+                }
+
+            private:
+                GstElement * m_element;
+                std::string m_path;
+                std::string m_factory;
+                GParamSpec * m_level_buffers;
+                GParamSpec * m_level_bytes;
+                const std::uint32_t m_sample_interval;
+                std::atomic<std::uint32_t> m_sink_seq {0};
+                std::array<Arrival, ARRIVALS> m_arrivals {};
+                std::atomic<std::size_t> m_arrival_pos {0};
+                std::atomic<std::int64_t> m_last_arrival {0};
+                std::atomic<std::uint64_t> m_buffers {0};
+                std::atomic<std::uint64_t> m_bytes {0};
+                LatencyHistogram m_latency {};
+                // only used by snapshot, which is serialized by the tracer.
+                std::uint64_t m_prev_buffers = 0;
+                std::uint64_t m_prev_bytes = 0;
+                mutex m_mutex;
+                std::vector<std::pair<GstPad *, gulong>> m_probes {};
+                gulong m_pad_added_handler = 0;
+                // set by detach, the stats may be detached by stop or remove_element before add_element installs the probes.
+                bool m_detached = false;
+
+                std::int64_t _read_level(GParamSpec * pspec) const
+                {
+                    if (!pspec)
+                    {
+                        return -1;
+                    }
+                    // guint for queue, guint64 for appsrc.
+                    GValue value = G_VALUE_INIT;
+                    GValue level = G_VALUE_INIT;
+                    g_value_init(&value, pspec->value_type);
+                    g_value_init(&level, G_TYPE_INT64);
+                    DEFER({
+                        g_value_unset(&value);
+                        g_value_unset(&level);
+                    });
+                    g_object_get_property(G_OBJECT(m_element), pspec->name, &value);
+                    if (!g_value_transform(&value, &level))
+                    {
+                        return -1;
+                    }
+                    return g_value_get_int64(&level);
+                }
+            };
+            using ElementStatsPtr = std::shared_ptr<ElementStats>;
+
+            static void destroy_stats_holder(gpointer data)
+            {
+                delete static_cast<ElementStatsPtr *>(data);
+            }
+
+            static GstPadProbeReturn sink_probe(GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+            {
+                auto & stats = *static_cast<ElementStatsPtr *>(user_data);
+                if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+                {
+                    stats->on_sink(GST_PAD_PROBE_INFO_BUFFER(info));
+                }
+                else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+                {
+                    auto list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+                    if (gst_buffer_list_length(list) > 0)
+                    {
+                        stats->on_sink(gst_buffer_list_get(list, 0));
+                    }
+                }
+                return GST_PAD_PROBE_OK;
+            }
+
+            static GstPadProbeReturn src_probe(GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+            {
+                auto & stats = *static_cast<ElementStatsPtr *>(user_data);
+                if (info->type & GST_PAD_PROBE_TYPE_BUFFER)
+                {
+                    auto buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+                    stats->on_src(buffer, 1, gst_buffer_get_size(buffer));
+                }
+                else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+                {
+                    auto list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+                    auto n = gst_buffer_list_length(list);
+                    if (n > 0)
+                    {
+                        stats->on_src(gst_buffer_list_get(list, 0), n, gst_buffer_list_calculate_size(list));
+                    }
+                }
+                return GST_PAD_PROBE_OK;
+            }
+
+            static void probe_pad(const ElementStatsPtr & stats, GstPad * pad)
+            {
+                auto probe = GST_PAD_IS_SRC(pad) ? src_probe : sink_probe;
+                auto id = gst_pad_add_probe(
+                    pad,
+                    static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                    probe,
+                    new ElementStatsPtr(stats),
+                    destroy_stats_holder
+                );
+                if (id)
+                {
+                    stats->add_probe(pad, id);
+                }
+            }
+
+            static void on_pad_added(GstElement * element, GstPad * pad, gpointer user_data)
+            {
+                probe_pad(*static_cast<ElementStatsPtr *>(user_data), pad);
+            }
+
+            class ElementTracer : public std::enable_shared_from_this<ElementTracer>
+            {
+            public:
+                using Snapshot = cfgo::gst::ElementTracer::Snapshot;
+                using SnapshotCallback = cfgo::gst::ElementTracer::SnapshotCallback;
+
+                ElementTracer(GstBin * bin, const Configure & conf);
+                ~ElementTracer();
+                ElementTracer(const ElementTracer &) = delete;
+                ElementTracer & operator = (const ElementTracer &) = delete;
+
+                void start();
+                void stop();
+                Snapshot snapshot();
+                auto run(duration_t interval, SnapshotCallback cb, close_chan closer) -> asio::awaitable<void>;
+
+                void add_element(GstElement * element);
+                void remove_element(GstElement * element);
+            private:
+                GstBin * m_bin;
+                Configure m_conf;
+                mutex m_mutex;
+                bool m_stopped = false;
+                std::unordered_map<GstElement *, ElementStatsPtr> m_elements {};
+                gulong m_added_handler = 0;
+                gulong m_removed_handler = 0;
+                mutex m_snapshot_mutex;
+                std::chrono::steady_clock::time_point m_last_snapshot;
+            };
+
+            static void on_deep_element_added(GstBin * bin, GstBin * sub_bin, GstElement * element, gpointer user_data)
+            {
+                if (auto tracer = cast_weak_holder<ElementTracer>(user_data)->lock())
+                {
+                    tracer->add_element(element);
+                }
+            }
+
+            static void on_deep_element_removed(GstBin * bin, GstBin * sub_bin, GstElement * element, gpointer user_data)
+            {
+                if (auto tracer = cast_weak_holder<ElementTracer>(user_data)->lock())
+                {
+                    tracer->remove_element(element);
+                }
+            }
+
+            static void on_element_added(GstBin * bin, GstElement * element, gpointer user_data)
+            {
+                on_deep_element_added(bin, bin, element, user_data);
+            }
+
+            static void on_element_removed(GstBin * bin, GstElement * element, gpointer user_data)
+            {
+                on_deep_element_removed(bin, bin, element, user_data);
+            }
+
+            ElementTracer::ElementTracer(GstBin * bin, const Configure & conf):
+                m_bin(GST_BIN(gst_object_ref(bin))),
+                m_conf(conf),
+                m_last_snapshot(std::chrono::steady_clock::now())
+            {
+                m_conf.validate();
+            }
+
+            ElementTracer::~ElementTracer()
+            {
+                stop();
+                gst_object_unref(m_bin);
+            }
+
+            // weak_from_this is not available in the constructor.
+            void ElementTracer::start()
+            {
+                auto destroy = [](gpointer data, GClosure * closure) {
+                    destroy_weak_holder<ElementTracer>(data);
+                };
+                if (m_conf.recursive)
+                {
+                    m_added_handler = g_signal_connect_data(m_bin, "deep-element-added", G_CALLBACK(on_deep_element_added), make_weak_holder(weak_from_this()), destroy, G_CONNECT_DEFAULT);
+                    m_removed_handler = g_signal_connect_data(m_bin, "deep-element-removed", G_CALLBACK(on_deep_element_removed), make_weak_holder(weak_from_this()), destroy, G_CONNECT_DEFAULT);
+                }
+                else
+                {
+                    m_added_handler = g_signal_connect_data(m_bin, "element-added", G_CALLBACK(on_element_added), make_weak_holder(weak_from_this()), destroy, G_CONNECT_DEFAULT);
+                    m_removed_handler = g_signal_connect_data(m_bin, "element-removed", G_CALLBACK(on_element_removed), make_weak_holder(weak_from_this()), destroy, G_CONNECT_DEFAULT);
+                }
+                auto iter = m_conf.recursive ? gst_bin_iterate_recurse(m_bin) : gst_bin_iterate_elements(m_bin);
+                DEFER({
+                    gst_iterator_free(iter);
+                });
+                GValue item = G_VALUE_INIT;
+                bool done = false;
+                while (!done)
+                {
+                    switch (gst_iterator_next(iter, &item))
+                    {
+                    case GST_ITERATOR_OK:
+                        add_element(GST_ELEMENT(g_value_get_object(&item)));
+                        g_value_reset(&item);
+                        break;
+                    case GST_ITERATOR_RESYNC:
+                        // add_element ignores the elements already traced.
+                        gst_iterator_resync(iter);
+                        break;
+                    default:
+                        done = true;
+                        break;
+                    }
+                }
+                g_value_unset(&item);
+            }
+
+            void ElementTracer::stop()
+            {
+                std::unordered_map<GstElement *, ElementStatsPtr> elements {};
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (m_stopped)
+                    {
+                        return;
+                    }
+                    m_stopped = true;
+                    elements = std::move(m_elements);
+                    m_elements.clear();
+                }
+                if (m_added_handler)
+                {
+                    g_signal_handler_disconnect(m_bin, m_added_handler);
+                }
+                if (m_removed_handler)
+                {
+                    g_signal_handler_disconnect(m_bin, m_removed_handler);
+                }
+                for (auto && [element, stats] : elements)
+                {
+                    stats->detach();
+                }
+            }
+
+            void ElementTracer::add_element(GstElement * element)
+            {
+                ElementStatsPtr stats {};
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (m_stopped || m_elements.contains(element))
+                    {
+                        return;
+                    }
+                    stats = std::make_shared<ElementStats>(element, m_conf.sample_interval);
+                    m_elements.emplace(element, stats);
+                }
+                auto handler = g_signal_connect_data(element, "pad-added", G_CALLBACK(on_pad_added), new ElementStatsPtr(stats), [](gpointer data, GClosure * closure) {
+                    destroy_stats_holder(data);
+                }, G_CONNECT_DEFAULT);
+                stats->set_pad_added_handler(handler);
+                gst_element_foreach_pad(element, [](GstElement * element, GstPad * pad, gpointer user_data) -> gboolean {
+                    probe_pad(*static_cast<ElementStatsPtr *>(user_data), pad);
+                    return TRUE;
+                }, &stats);
+            }
+
+            void ElementTracer::remove_element(GstElement * element)
+            {
+                ElementStatsPtr stats {};
+                {
+                    std::lock_guard lock(m_mutex);
+                    auto iter = m_elements.find(element);
+                    if (iter == m_elements.end())
+                    {
+                        return;
+                    }
+                    stats = std::move(iter->second);
+                    m_elements.erase(iter);
+                }
+                stats->detach();
+            }
+
+            auto ElementTracer::snapshot() -> Snapshot
+            {
+                std::vector<ElementStatsPtr> elements {};
+                {
+                    std::lock_guard lock(m_mutex);
+                    elements.reserve(m_elements.size());
+                    for (auto && [element, stats] : m_elements)
+                    {
+                        elements.push_back(stats);
+                    }
+                }
+                std::lock_guard lock(m_snapshot_mutex);
+                Snapshot s {};
+                s.at = std::chrono::steady_clock::now();
+                s.interval = s.at - m_last_snapshot;
+                m_last_snapshot = s.at;
+                auto secs = std::chrono::duration<double>(s.interval).count();
+                s.elements.reserve(elements.size());
+                for (auto && stats : elements)
+                {
+                    s.elements.push_back(stats->snapshot(secs));
+                }
+                std::sort(s.elements.begin(), s.elements.end(), [](auto && e1, auto && e2) {
+                    return e1.path < e2.path;
+                });
+                return s;
+            }
+
+            auto ElementTracer::run(duration_t interval, SnapshotCallback cb, close_chan closer) -> asio::awaitable<void>
+            {
+                auto self = shared_from_this();
+                do
+                {
+                    co_await wait_timeout(interval, closer);
+                    {
+                        std::lock_guard lock(m_mutex);
+                        if (m_stopped)
+                        {
+                            co_return;
+                        }
+                    }
+                    cb(snapshot());
+                } while (true);
+            }
+        } // namespace detail
+
+        void ElementTracer::Configure::validate() const
+        {
+            if (sample_interval < 1)
+            {
+                throw cpptrace::runtime_error("Invalid sample_interval. The sample_interval must be greater or equal than 1.");
+            }
+        }
+
+        ElementTracer::ElementTracer(std::nullptr_t): ImplBy(std::shared_ptr<detail::ElementTracer>()) {}
+
+        ElementTracer::ElementTracer(GstBin * bin, const Configure & conf): ImplBy(bin, conf)
+        {
+            impl()->start();
+        }
+
+        ElementTracer::operator bool() const noexcept
+        {
+            return (bool) impl();
+        }
+
+        auto ElementTracer::snapshot() const -> Snapshot
+        {
+            return impl()->snapshot();
+        }
+
+        auto ElementTracer::run(duration_t interval, SnapshotCallback cb, close_chan closer) const -> asio::awaitable<void>
+        {
+            return impl()->run(interval, std::move(cb), std::move(closer));
+        }
+
+        void ElementTracer::stop() const
+        {
+            impl()->stop();
+        }
+    } // namespace gst
+} // namespace cfgo
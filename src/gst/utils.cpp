@@ -14,6 +14,8 @@ namespace cfgo
         CFGO_DEFINE_STEAL_SHARED(gst_sample, GstSample, gst_sample_unref)
         CFGO_DEFINE_MAKE_SHARED(gst_buffer, GstBuffer, gst_buffer_ref, gst_buffer_unref)
         CFGO_DEFINE_STEAL_SHARED(gst_buffer, GstBuffer, gst_buffer_unref)
+        CFGO_DEFINE_MAKE_SHARED(gst_message, GstMessage, gst_message_ref, gst_message_unref)
+        CFGO_DEFINE_STEAL_SHARED(gst_message, GstMessage, gst_message_unref)
         CFGO_DEFINE_STEAL_SHARED(g_error, GError, g_error_free)
 
         std::string get_pad_full_name(GstPad * pad)
@@ -49,6 +49,23 @@ namespace cfgo
             #endif
         {
             m_client->set_reconnect_attempts(0);
+            init_metrics();
+        }
+
+        void Client::init_metrics()
+        {
+            auto & registry = metrics::Registry::instance();
+            auto labels = [this](const char * category) {
+                return metrics::Labels {
+                    .client = m_id,
+                    .category = category,
+                };
+            };
+            const char * subscribes_help = "The subscribe requests of the client.";
+            m_metrics.subscribes_succeeded = registry.counter("cfgo_client_subscribes_total", subscribes_help, labels("succeeded"));
+            m_metrics.subscribes_failed = registry.counter("cfgo_client_subscribes_total", subscribes_help, labels("failed"));
+            m_metrics.messages_sent = registry.counter("cfgo_client_messages_sent_total", "The signal messages sent by the client.", labels(""));
+            m_metrics.ack_timeouts = registry.counter("cfgo_client_ack_timeouts_total", "The signal messages whose ack is not received before canceled.", labels(""));
         }
 
         Client::~Client()
@@ -85,6 +102,16 @@ namespace cfgo
             return m_closer;
         }
 
+        const Configuration & Client::config() const noexcept
+        {
+            return m_config;
+        }
+
+        const std::string & Client::id() const noexcept
+        {
+            return m_id;
+        }
+
         void Client::lock()
         {
             if (!m_thread_safe)
@@ -396,6 +423,7 @@ namespace cfgo
 
         void Client::emit(const std::string &evt, msg_ptr msg)
         {
+            m_metrics.messages_sent->inc();
             m_client->socket()->emit(evt, std::move(msg));
         }
 
@@ -406,6 +434,7 @@ namespace cfgo
             auto self = shared_from_this();
             auto weak_self = weak_from_this();
             CFGO_THIS_DEBUG("[send msg {}] sending msg...", evt);
+            m_metrics.messages_sent->inc();
             m_client->socket()->emit(evt, msg, [&evt, &weak_self, weak_ack_ch](auto &&ack_msgs)
             {
                 if (auto ack_ch = weak_ack_ch.lock())
@@ -438,6 +467,7 @@ namespace cfgo
             if (result.is_canceled())
             {
                 CFGO_SELF_DEBUG("[send msg {}] timeout.", evt);
+                m_metrics.ack_timeouts->inc();
                 co_return make_canceled<msg_ptr>();
             }
             else
@@ -503,6 +533,11 @@ namespace cfgo
         {
             check_inited();
             auto self = shared_from_this();
+            event_trace::Span span(event_trace::Event::SUBSCRIBE, this);
+            bool subscribed = false;
+            DEFER({
+                (subscribed ? m_metrics.subscribes_succeeded : m_metrics.subscribes_failed)->inc();
+            });
             close_chan closer = nullptr;
             if (!close_ch && m_closer)
             {
@@ -637,6 +672,7 @@ namespace cfgo
                 {
                     CFGO_SELF_DEBUG("subscribed with no tracks.");
                     defers.success();
+                    subscribed = true;
                     co_return sub_ptr;
                 }
                 std::vector<TrackPtr> uncompleted_tracks(sub_ptr->tracks());
@@ -720,10 +756,11 @@ namespace cfgo
                 {
                     for (auto &&track : sub_ptr->tracks())
                     {
-                        track->impl()->bind_client(shared_from_this());
+                        track->impl()->bind_client(shared_from_this(), sub_ptr->sub_id());
                         track->impl()->prepare_track();
                     }
                     defers.success();
+                    subscribed = true;
                     co_return sub_ptr;
                 }
             }
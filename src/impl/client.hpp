@@ -6,6 +6,7 @@
 #include "cfgo/async.hpp"
 #include "cfgo/configuration.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/metrics.hpp"
 #include "cfgo/pattern.hpp"
 #include "cfgo/utils.hpp"
 #include "sio_client.h"
@@ -52,6 +53,13 @@ namespace cfgo {
                 const msg_chan &chan(const std::string &evt) const;
                 ~MsgChanner();
             };
+
+            struct Metrics {
+                metrics::CounterPtr subscribes_succeeded;
+                metrics::CounterPtr subscribes_failed;
+                metrics::CounterPtr messages_sent;
+                metrics::CounterPtr ack_timeouts;
+            };
         private:
             Logger m_logger;
             Configuration m_config;
@@ -86,6 +94,8 @@ namespace cfgo {
             std::optional<rtc::Description> peer_remote_desc() const;
             CtxPtr execution_context() const noexcept;
             close_chan get_closer() const noexcept;
+            const Configuration & config() const noexcept;
+            const std::string & id() const noexcept;
         private:
             cfgo::AsyncMutex m_a_mutex;
             void update_gst_sdp();
@@ -124,6 +134,9 @@ namespace cfgo {
 
             std::atomic_uint32_t m_custom_msg_next_id;
 
+            Metrics m_metrics;
+            void init_metrics();
+
             Client(const Configuration& config, const CtxPtr& io_ctx, close_chan closer, bool thread_safe);
             void lock();
             void unlock() noexcept;
@@ -4,6 +4,7 @@
 #include "cfgo/utils.hpp"
 #include "cfgo/log.hpp"
 #include "cfgo/gst/helper.h"
+#include <algorithm>
 #include <cctype>
 
 namespace cfgo
@@ -157,17 +158,27 @@ namespace cfgo
                 }
             }
 
-            gboolean on_bus_message(GstBus *bus, GstMessage *message, gpointer user_data) 
-            {   
-                gst_message_ref(message);
+            GstBusSyncReply on_bus_message(GstBus *bus, GstMessage *message, gpointer user_data)
+            {
                 if (auto pipeline = cast_weak_holder<Pipeline>(user_data)->lock())
                 {
-                    pipeline->m_msg_ch.write(message);
+                    if (pipeline->m_bus_draining.load(std::memory_order_acquire))
+                    {
+                        // posted while the old messages are still forwarded, wait for them.
+                        std::lock_guard lock(pipeline->m_bus_drain_mutex);
+                    }
+                    pipeline->_bridge_message(message);
                 }
-                return TRUE;
+                return GST_BUS_DROP;
             }
 
-            Pipeline::Pipeline(const std::string & name, CtxPtr exec_ctx): m_exec_ctx(exec_ctx)
+            // the message which must never be lost.
+            static constexpr std::uint32_t CRITICAL_MESSAGES = GST_MESSAGE_ERROR | GST_MESSAGE_EOS;
+
+            Pipeline::Pipeline(const std::string & name, CtxPtr exec_ctx, std::size_t message_capacity):
+                m_exec_ctx(exec_ctx),
+                m_msg_ch(message_capacity),
+                m_msg_mask(cfgo::gst::Pipeline::DEFAULT_MESSAGE_MASK | CRITICAL_MESSAGES)
             {
                 if (!m_exec_ctx)
                 {
@@ -184,21 +195,28 @@ namespace cfgo
                 {
                     throw cpptrace::runtime_error("Unable to get the bus from the pipeline " + name + ".");
                 }
-                gst_bus_add_watch_full(m_bus, G_PRIORITY_DEFAULT, on_bus_message, make_weak_holder(weak_from_this()), destroy_weak_holder<Pipeline>);
+                // the messages posted before the bridge is installed are kept by the bus and drained by _ensure_bus_bridge.
             }
 
             Pipeline::~Pipeline()
             {
                 stop();
+                disable_tracer();
                 for (auto && [node_name, node] : m_nodes)
                 {
                     _release_node(node, false);
                 }
-                gst_bus_remove_watch(m_bus);
+                gst_bus_set_sync_handler(m_bus, nullptr, nullptr, nullptr);
+                gst_bus_set_flushing(m_bus, TRUE);
+                m_msg_ch.close();
                 while (auto msg = m_msg_ch.try_read())
                 {
                     gst_message_unref(*msg);
                 }
+                for (auto && msg : m_critical_msgs)
+                {
+                    gst_message_unref(msg);
+                }
                 gst_object_unref(m_bus);
                 for (auto && [node_name, pads] : m_pads)
                 {
@@ -211,8 +229,136 @@ namespace cfgo
                 gst_object_unref(m_pipeline);
             }
 
+            // weak_from_this is not available in the constructor, so the sync handler is installed on the first use.
+            void Pipeline::_ensure_bus_bridge()
+            {
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (m_bus_bridged)
+                    {
+                        return;
+                    }
+                    m_bus_bridged = true;
+                }
+                // the queued messages are forwarded before the ones posted after the handler is installed.
+                std::lock_guard drain_lock(m_bus_drain_mutex);
+                m_bus_draining.store(true, std::memory_order_release);
+                gst_bus_set_sync_handler(m_bus, on_bus_message, make_weak_holder(weak_from_this()), destroy_weak_holder<Pipeline>);
+                while (auto message = gst_bus_pop(m_bus))
+                {
+                    _bridge_message(message);
+                    gst_message_unref(message);
+                }
+                m_bus_draining.store(false, std::memory_order_release);
+            }
+
+            // called in the thread which posts the message, transfer none.
+            void Pipeline::_bridge_message(GstMessage * message)
+            {
+                auto type = static_cast<std::uint32_t>(GST_MESSAGE_TYPE(message));
+                if ((m_msg_mask.load(std::memory_order_relaxed) & type) == 0)
+                {
+                    m_msg_filtered.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                m_msg_received.fetch_add(1, std::memory_order_relaxed);
+                GstMessage * msg = gst_message_ref(message);
+                if ((type & CRITICAL_MESSAGES) != 0)
+                {
+                    // kept aside until a reader of its type takes it, never dropped.
+                    std::vector<close_chan> waiters {};
+                    {
+                        std::lock_guard lock(m_critical_mutex);
+                        m_critical_msgs.push_back(msg);
+                        waiters.swap(m_critical_waiters);
+                    }
+                    for (auto && waiter : waiters)
+                    {
+                        waiter.close_no_except();
+                    }
+                    return;
+                }
+                if (m_msg_ch.try_write(std::move(msg)))
+                {
+                    return;
+                }
+                m_msg_overflows.fetch_add(1, std::memory_order_relaxed);
+                gst_message_unref(msg);
+            }
+
+            // called with m_critical_mutex held.
+            GstMessage * Pipeline::_take_critical_message(std::uint32_t types)
+            {
+                auto iter = std::find_if(m_critical_msgs.begin(), m_critical_msgs.end(), [types](GstMessage * msg) {
+                    return (GST_MESSAGE_TYPE(msg) & types) != 0;
+                });
+                if (iter == m_critical_msgs.end())
+                {
+                    return nullptr;
+                }
+                auto msg = *iter;
+                m_critical_msgs.erase(iter);
+                return msg;
+            }
+
+            std::size_t Pipeline::_critical_queued() const
+            {
+                std::lock_guard lock(m_critical_mutex);
+                return m_critical_msgs.size();
+            }
+
+            void Pipeline::set_message_mask(GstMessageType types) noexcept
+            {
+                m_msg_mask.store(static_cast<std::uint32_t>(types) | CRITICAL_MESSAGES, std::memory_order_relaxed);
+            }
+
+            GstMessageType Pipeline::message_mask() const noexcept
+            {
+                return static_cast<GstMessageType>(m_msg_mask.load(std::memory_order_relaxed));
+            }
+
+            auto Pipeline::message_statistics() const noexcept -> MessageStatistics
+            {
+                return MessageStatistics {
+                    .received = m_msg_received.load(std::memory_order_relaxed),
+                    .filtered = m_msg_filtered.load(std::memory_order_relaxed),
+                    .overflows = m_msg_overflows.load(std::memory_order_relaxed),
+                    .queued = m_msg_ch.size_approx() + _critical_queued(),
+                };
+            }
+
+            ElementTracer Pipeline::enable_tracer(const ElementTracer::Configure & conf)
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_tracer)
+                {
+                    m_tracer = ElementTracer(GST_BIN(m_pipeline), conf);
+                }
+                return m_tracer;
+            }
+
+            void Pipeline::disable_tracer()
+            {
+                ElementTracer tracer {nullptr};
+                {
+                    std::lock_guard lock(m_mutex);
+                    std::swap(tracer, m_tracer);
+                }
+                if (tracer)
+                {
+                    tracer.stop();
+                }
+            }
+
+            ElementTracer Pipeline::tracer() const
+            {
+                std::lock_guard lock(m_mutex);
+                return m_tracer;
+            }
+
             void Pipeline::run()
             {
+                _ensure_bus_bridge();
                 auto ret = gst_element_set_state (GST_ELEMENT (m_pipeline), GST_STATE_PLAYING);
                 if (ret == GST_STATE_CHANGE_FAILURE)
                 {
@@ -225,44 +371,87 @@ namespace cfgo
                 gst_element_set_state (GST_ELEMENT (m_pipeline), GST_STATE_NULL);
             }
 
-            auto Pipeline::await(close_chan & close_ch) -> asio::awaitable<bool>
+            auto Pipeline::await_message(GstMessageType types, close_chan close_ch) -> asio::awaitable<GstMessageSPtr>
             {
+                auto self = shared_from_this();
+                m_msg_mask.fetch_or(static_cast<std::uint32_t>(types), std::memory_order_relaxed);
+                _ensure_bus_bridge();
+                const std::uint32_t critical_types = static_cast<std::uint32_t>(types) & CRITICAL_MESSAGES;
+                const std::uint32_t other_types = static_cast<std::uint32_t>(types) & ~CRITICAL_MESSAGES;
                 do
                 {
-                    auto c_msg = co_await chan_read<GstMessage *>(m_msg_ch, close_ch);
-                    if (!c_msg)
+                    // a reader of only the other types waits on close_ch directly.
+                    close_chan waiter = close_ch;
+                    if (critical_types != 0)
                     {
-                        co_return false;
+                        // registered before the check, so a critical message arriving in between still wakes it up.
+                        waiter = is_valid_close_chan(close_ch) ? close_ch.create_child() : close_chan {};
+                        std::lock_guard lock(m_critical_mutex);
+                        if (auto msg = _take_critical_message(critical_types))
+                        {
+                            co_return steal_shared_gst_message(msg);
+                        }
+                        m_critical_waiters.push_back(waiter);
                     }
-                    auto msg = c_msg.value();
                     DEFER({
-                        gst_message_unref(c_msg.value());
+                        if (critical_types != 0)
+                        {
+                            std::lock_guard lock(m_critical_mutex);
+                            std::erase(m_critical_waiters, waiter);
+                        }
                     });
-                    switch (GST_MESSAGE_TYPE (msg))
+                    if (other_types == 0)
                     {
-                    case GST_MESSAGE_ERROR:
+                        co_await waiter.await();
+                    }
+                    else if (auto c_msg = co_await m_msg_ch.read(waiter))
                     {
-                        GError * err;
-                        gchar * debug_info;
-                        gst_message_parse_error(msg, &err, &debug_info);
-                        DEFER({
-                            g_clear_error(&err);
-                            g_free(debug_info);
-                        });
-                        throw cpptrace::runtime_error(
-                            std::string("Error received from element ")
-                            + GST_OBJECT_NAME (msg->src) 
-                            + ": " + err->message 
-                            + " --- Debug info: " + (debug_info ? debug_info : "none")
-                        );
+                        auto msg = steal_shared_gst_message(c_msg.value());
+                        if ((GST_MESSAGE_TYPE(msg.get()) & other_types) != 0)
+                        {
+                            co_return msg;
+                        }
+                        // the other queued messages are discarded.
+                        continue;
                     }
-                    case GST_MESSAGE_EOS:
-                        CFGO_DEBUG("The pipeline accept eos message.");
-                        co_return true;
+                    else if (m_msg_ch.is_closed())
+                    {
+                        co_return nullptr;
+                    }
+                    if (is_valid_close_chan(close_ch) && close_ch.is_closed())
+                    {
+                        co_return nullptr;
                     }
                 } while (true);
             }
 
+            auto Pipeline::await(close_chan & close_ch) -> asio::awaitable<bool>
+            {
+                auto msg = co_await await_message(static_cast<GstMessageType>(GST_MESSAGE_ERROR | GST_MESSAGE_EOS), close_ch);
+                if (!msg)
+                {
+                    co_return false;
+                }
+                if (GST_MESSAGE_TYPE(msg.get()) == GST_MESSAGE_ERROR)
+                {
+                    GError * err;
+                    gchar * debug_info;
+                    gst_message_parse_error(msg.get(), &err, &debug_info);
+                    DEFER({
+                        g_clear_error(&err);
+                        g_free(debug_info);
+                    });
+                    throw cpptrace::runtime_error(
+                        std::string("Error received from element ")
+                        + GST_OBJECT_NAME (msg->src) 
+                        + ": " + err->message 
+                        + " --- Debug info: " + (debug_info ? debug_info : "none")
+                    );
+                }
+                CFGO_DEBUG("The pipeline accept eos message.");
+                co_return true;
+            }
+
             void Pipeline::add_node(const std::string & name, const std::string & type)
             {
                 auto element = gst_element_factory_make(type.c_str(), name.c_str());
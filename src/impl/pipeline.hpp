@@ -4,12 +4,18 @@
 #include <memory>
 #include <unordered_map>
 #include <list>
+#include <deque>
+#include <vector>
 #include <set>
+#include <atomic>
 #include "asio.hpp"
 #include "gst/gst.h"
 #include "cfgo/alias.hpp"
 #include "cfgo/gst/link.hpp"
 #include "cfgo/gst/utils.hpp"
+#include "cfgo/gst/pipeline.hpp"
+#include "cfgo/gst/tracer.hpp"
+#include "cfgo/mpmc_chan.hpp"
 #include "impl/link.hpp"
 
 namespace cfgo
@@ -31,6 +37,7 @@ namespace cfgo
                 using Waiter = asiochan::channel<GstPad *, 1>;
                 using WaiterList = std::list<std::pair<std::string, Waiter>>;
                 using WaiterMap = std::unordered_map<std::string, WaiterList>;
+                using MessageStatistics = cfgo::gst::Pipeline::MessageStatistics;
                 enum EndpointType
                 {
                     SRC,
@@ -45,8 +52,22 @@ namespace cfgo
                 NODE_HANDLER_MAP m_node_handlers;
                 LinkMap m_links_by_src;
                 LinkList m_pending_links;
-                mutex m_mutex;
-                asiochan::unbounded_channel<GstMessage *> m_msg_ch;
+                mutable mutex m_mutex;
+                MpmcChan<GstMessage *> m_msg_ch;
+                bool m_bus_bridged = false;
+                // the sync handler waits on it while the messages queued before the bridge are forwarded, to keep the order.
+                mutex m_bus_drain_mutex;
+                std::atomic_bool m_bus_draining {false};
+                // the error and eos messages never enter m_msg_ch, so a reader of other types can not consume them.
+                mutable mutex m_critical_mutex;
+                std::deque<GstMessage *> m_critical_msgs;
+                // closed when a critical message arrives, to wake up the readers blocked on m_msg_ch.
+                std::vector<close_chan> m_critical_waiters;
+                std::atomic<std::uint32_t> m_msg_mask;
+                std::atomic<std::uint64_t> m_msg_received {0};
+                std::atomic<std::uint64_t> m_msg_filtered {0};
+                std::atomic<std::uint64_t> m_msg_overflows {0};
+                ElementTracer m_tracer {nullptr};
                 PadMap m_pads;
                 WaiterMap m_waiters;
                 void _add_pad(GstElement *src, GstPad * pad);
@@ -62,13 +83,24 @@ namespace cfgo
                 [[nodiscard]] GstElement * _node(const std::string & name) const;
                 [[nodiscard]] GstElement * _require_node(const std::string & name) const;
                 void _release_node(GstElement * node, bool remove);
+                void _ensure_bus_bridge();
+                void _bridge_message(GstMessage * message);
+                GstMessage * _take_critical_message(std::uint32_t types);
+                std::size_t _critical_queued() const;
             public:
-                Pipeline(const std::string & name, CtxPtr exec_ctx = nullptr);
+                Pipeline(const std::string & name, CtxPtr exec_ctx = nullptr, std::size_t message_capacity = cfgo::gst::Pipeline::DEFAULT_MESSAGE_CAPACITY);
                 ~Pipeline();
                 void add_node(const std::string & name, const std::string & type);
                 void run();
                 void stop();
                 [[nodiscard]] auto await(close_chan & close_ch) -> asio::awaitable<bool>;
+                [[nodiscard]] auto await_message(GstMessageType types, close_chan close_ch) -> asio::awaitable<GstMessageSPtr>;
+                void set_message_mask(GstMessageType types) noexcept;
+                [[nodiscard]] GstMessageType message_mask() const noexcept;
+                [[nodiscard]] MessageStatistics message_statistics() const noexcept;
+                ElementTracer enable_tracer(const ElementTracer::Configure & conf);
+                void disable_tracer();
+                [[nodiscard]] ElementTracer tracer() const;
                 [[nodiscard]] GstElement * node(const std::string & name);
                 [[nodiscard]] GstElement * require_node(const std::string & name);
                 [[nodiscard]] auto await_pad(const std::string & node, const std::string & pad, const std::set<GstPad *> & excludes, close_chan closer) -> asio::awaitable<GstPadSPtr>;
@@ -87,7 +119,7 @@ namespace cfgo
 
                 friend class AsyncLink;
                 friend void pad_added_handler(GstElement *src, GstPad *new_pad, gpointer user_data);
-                friend gboolean on_bus_message(GstBus *bus, GstMessage *message, gpointer user_data);
+                friend GstBusSyncReply on_bus_message(GstBus *bus, GstMessage *message, gpointer user_data);
             };
         } // namespace impl
     } // namespace gst
@@ -14,7 +14,7 @@ namespace cfgo
     namespace impl
     {
         Track::Track(const msg_ptr & msg, int cache_capicity)
-        : m_logger(Log::instance().create_logger(Log::Category::TRACK)), m_rtp_cache(cache_capicity), m_rtcp_cache(cache_capicity), m_inited(false), m_seq(0)
+        : m_logger(Log::instance().create_logger(Log::Category::TRACK)), m_rtp_cache(cache_capicity), m_rtcp_cache(cache_capicity), m_inited(false), m_seq(0), m_latency(std::make_shared<TrackLatency>())
         #ifdef CFGO_SUPPORT_GSTREAMER
         , m_gst_media(nullptr)
         #endif
@@ -80,11 +80,12 @@ namespace cfgo
         }
         #endif
 
-        void Track::bind_client(std::shared_ptr<Client> client)
+        void Track::bind_client(std::shared_ptr<Client> client, const std::string & sub_id)
         {
             if (!m_client)
             {
                 m_client = client;
+                _init_metrics(client->id(), sub_id);
                 #ifdef CFGO_SUPPORT_GSTREAMER
                 auto mid = track->mid();
                 auto sdp = client->m_gst_sdp;
@@ -102,6 +103,38 @@ namespace cfgo
             }
         }
 
+        void Track::_init_metrics(const std::string & client_id, const std::string & sub_id)
+        {
+            auto & registry = metrics::Registry::instance();
+            auto create = [&](Metrics & m, const char * category) {
+                metrics::Labels labels {
+                    .client = client_id,
+                    .sub = sub_id,
+                    .track = globalId,
+                    .category = category,
+                };
+                m.received_packets = registry.counter("cfgo_track_received_packets_total", "The packets received by the track.", labels);
+                m.received_bytes = registry.counter("cfgo_track_received_bytes_total", "The bytes received by the track.", labels);
+                m.dropped_packets = registry.counter("cfgo_track_dropped_packets_total", "The packets dropped because the cache of the track is full.", labels);
+                m.dropped_bytes = registry.counter("cfgo_track_dropped_bytes_total", "The bytes dropped because the cache of the track is full.", labels);
+            };
+            create(m_rtp_metrics, "rtp");
+            create(m_rtcp_metrics, "rtcp");
+            auto attach = [&](LatencyHistogram & histogram, const char * category) {
+                // share the ownership of m_latency, so the series lives as long as the latency metas referring it.
+                registry.attach("cfgo_track_latency_seconds", "The latency of the packets and samples of the track, only recorded when the latency meta of cfgosrc is enabled.", metrics::Labels {
+                    .client = client_id,
+                    .sub = sub_id,
+                    .track = globalId,
+                    .category = category,
+                }, std::shared_ptr<const LatencyHistogram>(m_latency, &histogram));
+            };
+            attach(m_latency->sender_to_track, "sender_to_track");
+            attach(m_latency->track_to_push, "track_to_push");
+            attach(m_latency->push_to_sample, "push_to_sample");
+            attach(m_latency->sender_to_sample, "sender_to_sample");
+        }
+
         void Track::prepare_track() {
             if (!track)
             {
@@ -114,118 +147,86 @@ namespace cfgo
             m_inited = true;
         }
 
-        uint32_t Track::makesure_min_seq()
-        {
-            if (m_rtp_cache.empty() && m_rtcp_cache.empty())
+        void Track::prepare_injected() {
+            if (track)
             {
-                return 0xffffffff;
+                throw cpptrace::logic_error("The track is bound to a rtc::track, the packets can not be injected.");
             }
-            else if (m_rtp_cache.empty())
+            m_inited = true;
+        }
+
+        void Track::on_track_msg(rtc::binary data) {
+            auto arrival = std::chrono::steady_clock::now();
+            bool is_rtcp = rtc::IsRtcp(data);
+            MsgBuffer & cache = is_rtcp ? m_rtcp_cache : m_rtp_cache;
+            auto & metrics = is_rtcp ? m_rtcp_metrics : m_rtp_metrics;
+            event_trace::record(event_trace::Event::PACKET_INGEST, event_trace::Phase::INSTANT, this, data.size() | (is_rtcp ? std::uint64_t {1} << 63 : 0));
+            if (metrics.received_packets)
             {
-                auto min_seq = m_rtcp_cache.front().first;
-                if (min_seq == 0)
-                {
-                    m_rtcp_cache.pop_front();
-                    return makesure_min_seq();
-                }
-                else
-                {
-                    return min_seq;
-                }
+                metrics.received_packets->inc();
+                metrics.received_bytes->inc(data.size());
             }
-            else if (m_rtcp_cache.empty())
+            if (m_recording.load(std::memory_order_relaxed))
             {
-                auto min_seq = m_rtp_cache.front().first;
-                if (min_seq == 0)
+                // the packet is copied into the recorder out of the lock, the handle keeps the recorder alive meanwhile.
+                RtpRecorder recorder {nullptr};
                 {
-                    m_rtp_cache.pop_front();
-                    return makesure_min_seq();
+                    std::lock_guard g(m_lock);
+                    recorder = m_recorder;
                 }
-                else
+                if (recorder)
                 {
-                    return min_seq;
+                    recorder.record(data, is_rtcp, arrival);
                 }
             }
-            else
-            {
-                auto min_seq_rtp = m_rtp_cache.front().first;
-                auto min_seq_rtcp = m_rtcp_cache.front().first;
-                if (min_seq_rtp < min_seq_rtcp)
-                {
-                    if (min_seq_rtp == 0)
-                    {
-                        m_rtp_cache.pop_front();
-                        return makesure_min_seq();
-                    }
-                    else
-                    {
-                        return min_seq_rtp;
-                    }
-                }
-                else
-                {
-                    if (min_seq_rtcp == 0)
-                    {
-                        m_rtcp_cache.pop_front();
-                        return makesure_min_seq();
-                    }
-                    else
-                    {
-                        return min_seq_rtcp;
-                    }
-                }
-            }
-        }
-
-        void Track::on_track_msg(rtc::binary data) {
-            bool is_rtcp = rtc::IsRtcp(data);
-            MsgBuffer & cache = is_rtcp ? m_rtcp_cache : m_rtp_cache;
             {
                 std::lock_guard g(m_lock);
-                if (m_seq == 0xffffffff)
-                {
-                    auto offset = makesure_min_seq();
-                    for (auto &&v : m_rtcp_cache)
-                    {
-                        v.first -= offset;
-                    }
-                    for (auto &&v : m_rtp_cache)
-                    {
-                        v.first -= offset;
-                    }
-                    m_seq -= offset;
-                }
                 if (is_rtcp)
                 {
                     m_statistics.m_rtcp_receives_bytes += data.size();
                     ++m_statistics.m_rtcp_receives_packets;
-                    if (cache.full())
-                    {
-                        m_statistics.m_rtcp_drops_bytes += cache.front().second->size();
-                        ++m_statistics.m_rtcp_drops_packets;
-                    }
                 }
                 else
                 {
                     m_statistics.m_rtp_receives_bytes += data.size();
                     ++m_statistics.m_rtp_receives_packets;
-                    if (cache.full())
-                    {
-                        m_statistics.m_rtp_drops_bytes += cache.front().second->size();
-                        ++m_statistics.m_rtp_drops_packets;
-                    }
                 }
                 if (m_on_data)
                 {
                     m_on_data(data, !is_rtcp);
                 }
+                auto dropped = cache.force_write(std::make_pair(++m_seq, cfgo::Track::TimedMsg {
+                    .msg = std::make_unique<rtc::binary>(std::move(data)),
+                    .arrival = arrival,
+                }));
+                if (dropped && dropped->second)
+                {
+                    if (metrics.dropped_packets)
+                    {
+                        metrics.dropped_packets->inc();
+                        metrics.dropped_bytes->inc(dropped->second.msg->size());
+                    }
+                    if (is_rtcp)
+                    {
+                        m_statistics.m_rtcp_drops_bytes += dropped->second.msg->size();
+                        ++m_statistics.m_rtcp_drops_packets;
+                    }
+                    else
+                    {
+                        m_statistics.m_rtp_drops_bytes += dropped->second.msg->size();
+                        ++m_statistics.m_rtp_drops_packets;
+                    }
+                }
                 if (m_on_stat)
                 {
                     m_on_stat(m_statistics);
                 }
-                cache.push_back(std::make_pair(++m_seq, std::make_unique<rtc::binary>(std::move(data))));
             }
-            chan_maybe_write(m_msg_notify);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_all_waiters.load(std::memory_order_relaxed) > 0)
+            {
+                chan_maybe_write(m_msg_notify);
+            }
         }
 
         void Track::on_track_open()
@@ -236,6 +237,8 @@ namespace cfgo
         void Track::on_track_closed()
         {
             CFGO_THIS_DEBUG("The track is closed.");
+            m_rtp_cache.close();
+            m_rtcp_cache.close();
             chan_must_write(m_closed_notify);
         }
 
@@ -246,7 +249,8 @@ namespace cfgo
 
         auto Track::await_open_or_closed(close_chan close_ch) -> asio::awaitable<bool>
         {
-            if (track->isOpen() || track->isClosed())
+            // an injected track has no rtc::track and is opened by prepare_injected.
+            if (!track || track->isOpen() || track->isClosed())
             {
                 co_return true;
             }
@@ -270,114 +274,162 @@ namespace cfgo
         }
 
         auto Track::await_msg(cfgo::Track::MsgType msg_type, close_chan close_ch) -> asio::awaitable<cfgo::Track::MsgPtr>
+        {
+            auto self = shared_from_this();
+            auto msg = co_await await_timed_msg(msg_type, std::move(close_ch));
+            co_return std::move(msg.msg);
+        }
+
+        auto Track::await_timed_msg(cfgo::Track::MsgType msg_type, close_chan close_ch) -> asio::awaitable<cfgo::Track::TimedMsg>
         {
             if (!m_inited)
             {
                 throw cpptrace::logic_error("Before call await_msg, call prepare_track at first.");
             }
-            auto msg_ptr = receive_msg(msg_type);
+            auto msg_ptr = receive_timed_msg(msg_type);
             if (msg_ptr)
             {
                 co_return std::move(msg_ptr);
             }
             if (is_valid_close_chan(close_ch) && close_ch.is_closed())
             {
-                co_return nullptr;
+                co_return cfgo::Track::TimedMsg {};
             }
 
             if (!co_await await_open_or_closed(close_ch))
             {
-                co_return nullptr;
+                co_return cfgo::Track::TimedMsg {};
             }
             if (is_valid_close_chan(close_ch) && close_ch.is_closed())
             {
-                co_return nullptr;
+                co_return cfgo::Track::TimedMsg {};
+            }
+            if (msg_type != cfgo::Track::MsgType::ALL)
+            {
+                auto & cache = msg_type == cfgo::Track::MsgType::RTP ? m_rtp_cache : m_rtcp_cache;
+                msg_ptr = receive_timed_msg(msg_type);
+                if (msg_ptr)
+                {
+                    co_return std::move(msg_ptr);
+                }
+                // the caches are closed when the track is closed, the read is canceled after drained.
+                auto res = co_await cache.read(close_ch);
+                if (!res)
+                {
+                    co_return cfgo::Track::TimedMsg {};
+                }
+                co_return std::move(res.value().second);
             }
             do
             {
+                m_all_waiters.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                msg_ptr = receive_timed_msg(msg_type);
+                if (msg_ptr || (track ? track->isClosed() : m_rtp_cache.is_closed()))
+                {
+                    m_all_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    co_return std::move(msg_ptr);
+                }
                 auto res = co_await cfgo::select(
                     close_ch,
                     asiochan::ops::read(m_msg_notify, m_closed_notify)
                 );
+                m_all_waiters.fetch_sub(1, std::memory_order_relaxed);
                 if (!res)
                 {
-                    co_return nullptr;
+                    co_return cfgo::Track::TimedMsg {};
                 }
                 else if (res.received_from(m_closed_notify))
                 {
                     chan_must_write(m_closed_notify);
                 }
-
-                msg_ptr = receive_msg(msg_type);
-                if (msg_ptr)
-                {
-                    co_return std::move(msg_ptr);
-                }
-                if (track->isClosed())
-                {
-                    co_return nullptr;
-                }
             } while (true);
         }
 
         cfgo::Track::MsgPtr Track::receive_msg(cfgo::Track::MsgType msg_type) {
+            return std::move(receive_timed_msg(msg_type).msg);
+        }
+
+        cfgo::Track::TimedMsg Track::receive_timed_msg(cfgo::Track::MsgType msg_type) {
             if (!m_inited)
             {
                 throw cpptrace::logic_error("Before call receive_msg, call prepare_track at first.");
             }
 
-            std::lock_guard g(m_lock);
-            cfgo::Track::MsgPtr msg_ptr;
             if (msg_type == cfgo::Track::MsgType::ALL)
             {
-                if (m_rtp_cache.empty() && m_rtcp_cache.empty())
-                {
-                    return cfgo::Track::MsgPtr();
-                }
-                else if (m_rtp_cache.empty())
-                {
-                    m_rtcp_cache.front().second.swap(msg_ptr);
-                    m_rtcp_cache.pop_front();
-                }
-                else if (m_rtcp_cache.empty())
+                return _receive_all();
+            }
+            else if (msg_type == cfgo::Track::MsgType::RTP)
+            {
+                return _receive_one(m_rtp_cache, m_rtp_staged);
+            }
+            else
+            {
+                return _receive_one(m_rtcp_cache, m_rtcp_staged);
+            }
+        }
+
+        cfgo::Track::TimedMsg Track::_receive_one(MsgBuffer & cache, StagedMsg & staged)
+        {
+            // the staged head is older than anything in the cache.
+            if (m_staged_num.load(std::memory_order_acquire) > 0)
+            {
+                std::lock_guard g(m_staged_lock);
+                if (staged)
                 {
-                    m_rtp_cache.front().second.swap(msg_ptr);
-                    m_rtp_cache.pop_front();
+                    auto msg_ptr = std::move(staged->second);
+                    staged.reset();
+                    m_staged_num.fetch_sub(1, std::memory_order_release);
+                    return msg_ptr;
                 }
-                else
+            }
+            if (auto msg = cache.try_read())
+            {
+                return std::move(msg->second);
+            }
+            return cfgo::Track::TimedMsg {};
+        }
+
+        cfgo::Track::TimedMsg Track::_receive_all()
+        {
+            std::lock_guard g(m_staged_lock);
+            if (!m_rtp_staged)
+            {
+                m_rtp_staged = m_rtp_cache.try_read();
+                if (m_rtp_staged)
                 {
-                    auto & rtp = m_rtp_cache.front();
-                    auto & rtcp = m_rtcp_cache.front();
-                    if (rtp.first > rtcp.first)
-                    {
-                        rtcp.second.swap(msg_ptr);
-                        m_rtcp_cache.pop_front();
-                    }
-                    else
-                    {
-                        rtp.second.swap(msg_ptr);
-                        m_rtp_cache.pop_front();
-                    }
+                    m_staged_num.fetch_add(1, std::memory_order_release);
                 }
             }
-            else if (msg_type == cfgo::Track::MsgType::RTP)
+            if (!m_rtcp_staged)
             {
-                if (m_rtp_cache.empty())
+                m_rtcp_staged = m_rtcp_cache.try_read();
+                if (m_rtcp_staged)
                 {
-                    return cfgo::Track::MsgPtr();
+                    m_staged_num.fetch_add(1, std::memory_order_release);
                 }
-                m_rtp_cache.front().second.swap(msg_ptr);
-                m_rtp_cache.pop_front();
+            }
+            StagedMsg * picked = nullptr;
+            if (m_rtp_staged && m_rtcp_staged)
+            {
+                picked = m_rtp_staged->first > m_rtcp_staged->first ? &m_rtcp_staged : &m_rtp_staged;
+            }
+            else if (m_rtp_staged)
+            {
+                picked = &m_rtp_staged;
+            }
+            else if (m_rtcp_staged)
+            {
+                picked = &m_rtcp_staged;
             }
             else
             {
-                if (m_rtcp_cache.empty())
-                {
-                    return cfgo::Track::MsgPtr();
-                }
-                m_rtcp_cache.front().second.swap(msg_ptr);
-                m_rtcp_cache.pop_front();
+                return cfgo::Track::TimedMsg {};
             }
+            auto msg_ptr = std::move((*picked)->second);
+            picked->reset();
+            m_staged_num.fetch_sub(1, std::memory_order_release);
             return msg_ptr;
         }
 
@@ -437,6 +489,20 @@ namespace cfgo
             m_on_stat = nullptr;
         }
 
+        void Track::set_recorder(RtpRecorder recorder)
+        {
+            std::lock_guard g(m_lock);
+            m_recording.store(static_cast<bool>(recorder), std::memory_order_relaxed);
+            m_recorder = std::move(recorder);
+        }
+
+        void Track::unset_recorder() noexcept
+        {
+            std::lock_guard g(m_lock);
+            m_recording.store(false, std::memory_order_relaxed);
+            m_recorder = nullptr;
+        }
+
         std::uint64_t Track::get_rtp_drops_bytes() noexcept
         {
             std::lock_guard g(m_lock);
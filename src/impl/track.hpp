@@ -11,9 +11,12 @@
 #include "cfgo/config/configuration.h"
 #include "cfgo/track.hpp"
 #include "cfgo/async.hpp"
+#include "cfgo/mpmc_chan.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/metrics.hpp"
 #include "impl/client.hpp"
-#include "boost/circular_buffer.hpp"
+#include <atomic>
+#include <optional>
 #ifdef CFGO_SUPPORT_GSTREAMER
 #include "gst/sdp/sdp.h"
 #endif
@@ -30,10 +33,18 @@ namespace cfgo
         struct Track : public std::enable_shared_from_this<Track>
         {
             using Ptr = std::shared_ptr<Track>;
-            using MsgBuffer = boost::circular_buffer<std::pair<std::uint32_t, cfgo::Track::MsgPtr>>;
+            using MsgBuffer = MpmcChan<std::pair<std::uint64_t, cfgo::Track::TimedMsg>>;
+            using StagedMsg = std::optional<MsgBuffer::value_type>;
             using OnDataCb = cfgo::Track::OnDataCb;
             using OnStatCb = cfgo::Track::OnStatCb;
             using Statistics = cfgo::Track::Statistics;
+            struct Metrics
+            {
+                metrics::CounterPtr received_packets;
+                metrics::CounterPtr received_bytes;
+                metrics::CounterPtr dropped_packets;
+                metrics::CounterPtr dropped_bytes;
+            };
             
             std::string type;
             std::string pubId;
@@ -46,14 +57,29 @@ namespace cfgo
 
             bool m_inited;
             Logger m_logger;
+            // guard the statistics and the callbacks, the caches are lock-free.
             mutex m_lock;
             MsgBuffer m_rtp_cache;
             MsgBuffer m_rtcp_cache;
-            uint32_t m_seq;
+            std::uint64_t m_seq;
+            // the heads taken out by the ALL mode to compare their seq.
+            mutex m_staged_lock;
+            StagedMsg m_rtp_staged;
+            StagedMsg m_rtcp_staged;
+            std::atomic_uint32_t m_staged_num {0};
+            std::atomic_uint32_t m_all_waiters {0};
             OnDataCb m_on_data = nullptr;
             Statistics m_statistics;
             OnStatCb m_on_stat = nullptr;
+            RtpRecorder m_recorder {nullptr};
+            // so the packets skip the recorder lookup when nothing is recorded.
+            std::atomic_bool m_recording {false};
             std::shared_ptr<Client> m_client;
+            std::shared_ptr<TrackLatency> m_latency;
+            // created by bind_client, when the client and the subscribation are known.
+            Metrics m_rtp_metrics;
+            Metrics m_rtcp_metrics;
+            // only written when some ALL mode reader is waiting.
             asiochan::channel<void, 1> m_msg_notify;
             asiochan::channel<void, 1> m_open_notify;
             asiochan::channel<void, 1> m_closed_notify;
@@ -64,16 +90,21 @@ namespace cfgo
             Track(const msg_ptr& msg, int cache_capicity);
             ~Track();
 
-            uint32_t makesure_min_seq();
             void prepare_track();
+            void prepare_injected();
             void on_track_msg(rtc::binary data);
             void on_track_open();
             void on_track_closed();
             void on_track_error(std::string error);
             auto await_open_or_closed(close_chan close_ch) -> asio::awaitable<bool>;
             cfgo::Track::MsgPtr receive_msg(cfgo::Track::MsgType msg_type);
+            cfgo::Track::TimedMsg receive_timed_msg(cfgo::Track::MsgType msg_type);
+            cfgo::Track::TimedMsg _receive_one(MsgBuffer & cache, StagedMsg & staged);
+            cfgo::Track::TimedMsg _receive_all();
             auto await_msg(cfgo::Track::MsgType msg_type, close_chan close_ch) -> asio::awaitable<cfgo::Track::MsgPtr>;
-            void bind_client(std::shared_ptr<Client> client);
+            auto await_timed_msg(cfgo::Track::MsgType msg_type, close_chan close_ch) -> asio::awaitable<cfgo::Track::TimedMsg>;
+            void bind_client(std::shared_ptr<Client> client, const std::string & sub_id);
+            void _init_metrics(const std::string & client_id, const std::string & sub_id);
             void * get_gst_caps(int pt) const;
             void set_on_data(const OnDataCb & cb);
             void set_on_data(OnDataCb && cb);
@@ -81,6 +112,8 @@ namespace cfgo
             void set_on_stat(const OnStatCb & cb);
             void set_on_stat(OnStatCb && cb);
             void unset_on_stat() noexcept;
+            void set_recorder(RtpRecorder recorder);
+            void unset_recorder() noexcept;
             std::uint64_t get_rtp_drops_bytes() noexcept;
             std::uint32_t get_rtp_drops_packets() noexcept;
             std::uint64_t get_rtp_receives_bytes() noexcept;
@@ -1,10 +1,12 @@
 #include "cfgo/log.hpp"
+#include "cfgo/async_log.hpp"
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "cpptrace/cpptrace.hpp"
 
 #include <regex>
 #include <unordered_map>
+#include <vector>
 
 namespace cfgo
 {
@@ -21,6 +23,12 @@ namespace cfgo
             return std::make_shared<spdlog::logger>(std::move(name), logger_sink);
         }
 
+        static Logger create_async_logger(const cfgo::AsyncLogBackend & backend, std::string name)
+        {
+            auto logger_sink = backend.wrap(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+            return std::make_shared<spdlog::logger>(std::move(name), std::move(logger_sink));
+        }
+
         class Log
         {
         public:
@@ -57,18 +65,49 @@ namespace cfgo
             std::size_t get_backtrace_size(Category category) const;
             Logger create_logger(Category category, const std::string & name) const;
             Logger default_logger() const;
+            void set_async_backend(cfgo::AsyncLogBackend backend);
         private:
             CategoryMap m_categories;
+            cfgo::AsyncLogBackend m_async_backend {nullptr};
             Logger m_default_logger;
+            // cfgo::Log::should_log may still read a replaced default logger through the raw pointer, so it is never freed.
+            std::vector<Logger> m_retired_loggers;
+
+            LoggerFactory _fallback_factory() const;
+            void _set_default_logger(Logger logger);
         };
 
-        Log::Log(): m_default_logger(create_logger(Category::DEFAULT, "")) {}
+        Log::Log(): m_default_logger(nullptr)
+        {
+            _set_default_logger(create_logger(Category::DEFAULT, ""));
+        }
+
+        void Log::_set_default_logger(Logger logger)
+        {
+            if (m_default_logger)
+            {
+                m_retired_loggers.push_back(m_default_logger);
+            }
+            m_default_logger = std::move(logger);
+            cfgo::Log::s_default_logger.store(m_default_logger.get(), std::memory_order_release);
+        }
+
+        LoggerFactory Log::_fallback_factory() const
+        {
+            if (m_async_backend)
+            {
+                return [backend = m_async_backend](std::string name) {
+                    return create_async_logger(backend, std::move(name));
+                };
+            }
+            return create_default_logger;
+        }
 
         void Log::set_logger_factory(Category category, LoggerFactory factory)
         {
             if (category == Category::DEFAULT)
             {
-                m_default_logger = create_logger(Category::DEFAULT, "");
+                _set_default_logger(create_logger(Category::DEFAULT, ""));
             }
             else
             {
@@ -85,11 +124,11 @@ namespace cfgo
             {
                 return cat_iter->second.factory_set 
                     ? cat_iter->second.factory 
-                    : (category != Category::DEFAULT ? get_logger_factory(Category::DEFAULT) : create_default_logger);
+                    : (category != Category::DEFAULT ? get_logger_factory(Category::DEFAULT) : _fallback_factory());
             }
             else
             {
-                return category != Category::DEFAULT ? get_logger_factory(Category::DEFAULT) : create_default_logger;
+                return category != Category::DEFAULT ? get_logger_factory(Category::DEFAULT) : _fallback_factory();
             }
         }
 
@@ -255,6 +294,12 @@ namespace cfgo
         {
             return m_default_logger;
         }
+
+        void Log::set_async_backend(cfgo::AsyncLogBackend backend)
+        {
+            m_async_backend = std::move(backend);
+            _set_default_logger(create_logger(Category::DEFAULT, ""));
+        }
          
     } // namespace detail
 
@@ -266,6 +311,11 @@ namespace cfgo
         return log;
     }
 
+    bool Log::_should_log_default(LogLevel level) noexcept
+    {
+        return instance().default_logger()->should_log(level);
+    }
+
     const char * Log::get_category_name(Category category) noexcept
     {
         switch (category)
@@ -338,4 +388,9 @@ namespace cfgo
         return impl()->default_logger();
     }
 
+    void Log::set_async_backend(AsyncLogBackend backend) const
+    {
+        impl()->set_async_backend(std::move(backend));
+    }
+
 } // namespace cfgo
@@ -0,0 +1,330 @@
+#include "cfgo/metrics.hpp"
+#include "cfgo/alias.hpp"
+#include "fmt/format.h"
+#include "cpptrace/cpptrace.hpp"
+
+#include <array>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <variant>
+
+namespace cfgo
+{
+    namespace metrics
+    {
+        namespace detail
+        {
+            enum class Type
+            {
+                COUNTER,
+                GAUGE,
+                HISTOGRAM,
+            };
+
+            template<typename T>
+            constexpr Type type_of() noexcept;
+            template<>
+            constexpr Type type_of<Counter>() noexcept { return Type::COUNTER; }
+            template<>
+            constexpr Type type_of<Gauge>() noexcept { return Type::GAUGE; }
+            template<>
+            constexpr Type type_of<Histogram>() noexcept { return Type::HISTOGRAM; }
+
+            static const char * type_name(Type type) noexcept
+            {
+                switch (type)
+                {
+                case Type::COUNTER:
+                    return "counter";
+                case Type::GAUGE:
+                    return "gauge";
+                default:
+                    return "histogram";
+                }
+            }
+
+            static bool is_valid_name(const std::string & name) noexcept
+            {
+                if (name.empty())
+                {
+                    return false;
+                }
+                for (std::size_t i = 0; i < name.size(); ++i)
+                {
+                    auto c = name[i];
+                    bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (i > 0 && c >= '0' && c <= '9');
+                    if (!valid)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            static void append_escaped(std::string & out, const std::string & value, bool quote)
+            {
+                for (auto c : value)
+                {
+                    switch (c)
+                    {
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    case '"':
+                        out += quote ? "\\\"" : "\"";
+                        break;
+                    default:
+                        out += c;
+                    }
+                }
+            }
+
+            // the labels without the braces, the empty ones are skipped. also used as the key of the series.
+            static std::string format_labels(const Labels & labels)
+            {
+                std::string out;
+                auto append = [&out](const char * key, const std::string & value) {
+                    if (value.empty())
+                    {
+                        return;
+                    }
+                    if (!out.empty())
+                    {
+                        out += ',';
+                    }
+                    out += key;
+                    out += "=\"";
+                    append_escaped(out, value, true);
+                    out += '"';
+                };
+                append("client", labels.client);
+                append("sub", labels.sub);
+                append("track", labels.track);
+                append("category", labels.category);
+                return out;
+            }
+
+            // the upper bounds of the histogram buckets in seconds, the last bucket is +Inf.
+            static const std::array<std::string, Histogram::BUCKETS> & bucket_bounds()
+            {
+                static const auto bounds = []() {
+                    std::array<std::string, Histogram::BUCKETS> bounds {};
+                    for (std::size_t i = 0; i + 1 < Histogram::BUCKETS; ++i)
+                    {
+                        bounds[i] = fmt::format("{}", static_cast<double>(std::uint64_t {1} << i) / 1e6);
+                    }
+                    bounds[Histogram::BUCKETS - 1] = "+Inf";
+                    return bounds;
+                }();
+                return bounds;
+            }
+
+            class Registry
+            {
+            public:
+                using Metric = std::variant<std::weak_ptr<const Counter>, std::weak_ptr<const Gauge>, std::weak_ptr<const Histogram>>;
+                struct Family
+                {
+                    Type type;
+                    std::string help;
+                    std::map<std::string, Metric> series;
+                };
+
+                template<typename T>
+                std::shared_ptr<T> get_or_create(const std::string & name, const std::string & help, const Labels & labels)
+                {
+                    auto key = format_labels(labels);
+                    std::lock_guard lock(m_mutex);
+                    auto & slot = _family(name, help, type_of<T>()).series[key];
+                    if (auto weak = std::get_if<std::weak_ptr<const T>>(&slot))
+                    {
+                        if (auto alive = weak->lock())
+                        {
+                            return std::const_pointer_cast<T>(alive);
+                        }
+                    }
+                    auto metric = std::make_shared<T>();
+                    slot = std::weak_ptr<const T>(metric);
+                    return metric;
+                }
+
+                void attach(const std::string & name, const std::string & help, const Labels & labels, const std::shared_ptr<const Histogram> & histogram);
+                void export_text(std::string & out);
+            private:
+                mutex m_mutex;
+                std::map<std::string, Family> m_families;
+
+                Family & _family(const std::string & name, const std::string & help, Type type);
+                static bool _write_series(std::string & out, const std::string & name, const std::string & labels, const Metric & metric);
+            };
+
+            auto Registry::_family(const std::string & name, const std::string & help, Type type) -> Family &
+            {
+                auto iter = m_families.find(name);
+                if (iter == m_families.end())
+                {
+                    if (!is_valid_name(name))
+                    {
+                        throw cpptrace::logic_error(fmt::format("Invalid metric name {}.", name));
+                    }
+                    iter = m_families.emplace(name, Family { .type = type, .help = help }).first;
+                }
+                else if (iter->second.type != type)
+                {
+                    throw cpptrace::logic_error(fmt::format("The metric {} is already registered as a {}.", name, type_name(iter->second.type)));
+                }
+                return iter->second;
+            }
+
+            void Registry::attach(const std::string & name, const std::string & help, const Labels & labels, const std::shared_ptr<const Histogram> & histogram)
+            {
+                if (!histogram)
+                {
+                    throw cpptrace::logic_error("The attached histogram must not be null.");
+                }
+                auto key = format_labels(labels);
+                std::lock_guard lock(m_mutex);
+                _family(name, help, Type::HISTOGRAM).series[key] = std::weak_ptr<const Histogram>(histogram);
+            }
+
+            bool Registry::_write_series(std::string & out, const std::string & name, const std::string & labels, const Metric & metric)
+            {
+                auto it = std::back_inserter(out);
+                auto lb = labels.empty() ? "" : "{";
+                auto rb = labels.empty() ? "" : "}";
+                if (auto weak = std::get_if<std::weak_ptr<const Counter>>(&metric))
+                {
+                    auto counter = weak->lock();
+                    if (!counter)
+                    {
+                        return false;
+                    }
+                    fmt::format_to(it, "{}{}{}{} {}\n", name, lb, labels, rb, counter->value());
+                }
+                else if (auto weak = std::get_if<std::weak_ptr<const Gauge>>(&metric))
+                {
+                    auto gauge = weak->lock();
+                    if (!gauge)
+                    {
+                        return false;
+                    }
+                    fmt::format_to(it, "{}{}{}{} {}\n", name, lb, labels, rb, gauge->value());
+                }
+                else
+                {
+                    auto histogram = std::get<std::weak_ptr<const Histogram>>(metric).lock();
+                    if (!histogram)
+                    {
+                        return false;
+                    }
+                    auto snapshot = histogram->snapshot();
+                    auto & bounds = bucket_bounds();
+                    auto sep = labels.empty() ? "" : ",";
+                    std::uint64_t cumulative = 0;
+                    for (std::size_t i = 0; i < Histogram::BUCKETS; ++i)
+                    {
+                        cumulative += snapshot.buckets[i];
+                        fmt::format_to(it, "{}_bucket{{{}{}le=\"{}\"}} {}\n", name, labels, sep, bounds[i], cumulative);
+                    }
+                    // the buckets and the count are loaded separately, keep them consistent for the scrapers.
+                    fmt::format_to(it, "{}_sum{}{}{} {}\n", name, lb, labels, rb, static_cast<double>(snapshot.sum.count()) / 1e9);
+                    fmt::format_to(it, "{}_count{}{}{} {}\n", name, lb, labels, rb, cumulative);
+                }
+                return true;
+            }
+
+            void Registry::export_text(std::string & out)
+            {
+                std::lock_guard lock(m_mutex);
+                for (auto family_iter = m_families.begin(); family_iter != m_families.end();)
+                {
+                    auto & [name, family] = *family_iter;
+                    bool header = false;
+                    for (auto series_iter = family.series.begin(); series_iter != family.series.end();)
+                    {
+                        auto start = out.size();
+                        if (!header)
+                        {
+                            out += "# HELP ";
+                            out += name;
+                            out += ' ';
+                            append_escaped(out, family.help, false);
+                            out += "\n# TYPE ";
+                            out += name;
+                            out += ' ';
+                            out += type_name(family.type);
+                            out += '\n';
+                        }
+                        if (_write_series(out, name, series_iter->first, series_iter->second))
+                        {
+                            header = true;
+                            ++series_iter;
+                        }
+                        else
+                        {
+                            out.resize(start);
+                            series_iter = family.series.erase(series_iter);
+                        }
+                    }
+                    if (family.series.empty())
+                    {
+                        family_iter = m_families.erase(family_iter);
+                    }
+                    else
+                    {
+                        ++family_iter;
+                    }
+                }
+            }
+        } // namespace detail
+
+        Registry::Registry(): ImplBy() {}
+
+        const Registry & Registry::instance()
+        {
+            static Registry registry {};
+            return registry;
+        }
+
+        CounterPtr Registry::counter(const std::string & name, const std::string & help, const Labels & labels) const
+        {
+            return impl()->get_or_create<Counter>(name, help, labels);
+        }
+
+        GaugePtr Registry::gauge(const std::string & name, const std::string & help, const Labels & labels) const
+        {
+            return impl()->get_or_create<Gauge>(name, help, labels);
+        }
+
+        HistogramPtr Registry::histogram(const std::string & name, const std::string & help, const Labels & labels) const
+        {
+            return impl()->get_or_create<Histogram>(name, help, labels);
+        }
+
+        void Registry::attach(const std::string & name, const std::string & help, const Labels & labels, const std::shared_ptr<const Histogram> & histogram) const
+        {
+            impl()->attach(name, help, labels, histogram);
+        }
+
+        std::string Registry::export_text() const
+        {
+            std::string out;
+            export_text(out);
+            return out;
+        }
+
+        void Registry::export_text(std::string & out) const
+        {
+            impl()->export_text(out);
+        }
+
+        std::string export_text()
+        {
+            return Registry::instance().export_text();
+        }
+    } // namespace metrics
+} // namespace cfgo
@@ -5,13 +5,18 @@
 #include "cfgo/track.hpp"
 #include "cfgo/async.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/metrics.hpp"
 #include "cfgo/spd_helper.hpp"
 #include "cfgo/gst/gstcfgosrc.h"
 #include "cfgo/gst/utils.hpp"
+#include "cfgo/gst/buffer_pool.hpp"
+#include "cfgo/gst/latency_meta.hpp"
 #include "gst/gst.h"
 #include "gst/app/gstappsrc.h"
 #include <vector>
+#include <deque>
 #include <thread>
+#include <atomic>
 
 namespace cfgo
 {
@@ -31,6 +36,8 @@ namespace cfgo
                 gulong m_pad_added_handle = 0L;
                 gulong m_pad_removed_handle = 0L;
                 GstElement * m_processor = nullptr;
+                // the caps of m_pad without the stream specific fields, used as the key of the processor pool.
+                GstCaps * m_processor_key = nullptr;
                 std::vector<GstPad *> m_pads;
 
                 ~Channel();
@@ -40,24 +47,80 @@ namespace cfgo
                 void uninstall_ghost(GstCfgoSrc * owner, GstPad * pad, bool remove = true);
             };
             using ChannelPtr = std::shared_ptr<Channel>;
-            struct Session
+            // a flushed decodebin or parsebin kept in the bin, waiting for a new channel with the same caps.
+            struct PooledProcessor
+            {
+                GstCaps * m_key;
+                GstElement * m_processor;
+            };
+            // the counters are shared with the metrics registry, they are created by init before the appsrc.
+            struct SrcStats
+            {
+                metrics::CounterPtr m_need_data;
+                metrics::CounterPtr m_enough_data;
+                metrics::CounterPtr m_pushed_buffers;
+                metrics::CounterPtr m_pushed_bytes;
+                metrics::GaugePtr m_level_bytes;
+                std::atomic_uint64_t m_max_level_bytes {0};
+
+                void init(const metrics::Labels & labels);
+            };
+            // maps the rtp timestamps of a session to the running time.
+            struct RtpClock
+            {
+                guint8 m_pt = 255;
+                guint32 m_ssrc = 0;
+                guint32 m_clock_rate = 0;
+                guint64 m_ext_ts = (guint64) -1;
+                bool m_has_base = false;
+                guint64 m_base_ext_ts = 0;
+                GstClockTime m_base_time = 0;
+                bool m_has_sr = false;
+                guint64 m_sr_ext_ts = 0;
+                GstClockTime m_sr_ntp = 0;
+                // set once the timestamps follow the sender reports instead of the arrival anchor.
+                bool m_sr_mapped = false;
+                // added to the sender report timestamps so they continue from the arrival anchored ones, slewed to 0 afterwards.
+                gint64 m_pts_offset = 0;
+                guint64 m_slew_ext_ts = 0;
+            };
+            struct Session : public std::enable_shared_from_this<Session>
             {
                 guint m_id;
                 TrackPtr m_track;
                 GstPad * m_rtp_pad = nullptr;
                 GstPad * m_rtcp_pad = nullptr;
+                // each session owns its appsrc pair, so a slow session only throttles itself.
+                GstElement * m_rtp_src = nullptr;
+                GstElement * m_rtcp_src = nullptr;
+                SrcStats m_rtp_stats;
+                SrcStats m_rtcp_stats;
+                RtpClock m_rtp_clock;
+                // checked once when the session is created, emitting a signal without handler is not free.
+                bool m_emit_buffer_allocate = false;
+                BufferPool m_pool {nullptr};
+                guint m_pool_buf_size = 0;
+                // created on the first latency meta, owns one ref.
+                LatencyRef * m_latency_ref = nullptr;
                 asiochan::channel<void, 1> m_rtp_need_data_ch;
                 asiochan::channel<void, 1> m_rtp_enough_data_ch;
                 asiochan::channel<void, 1> m_rtcp_need_data_ch;
                 asiochan::channel<void, 1> m_rtcp_enough_data_ch;
                 std::vector<ChannelPtr> m_channels;
+                // only used in the depay mode, which links the rtp appsrc to a rtpptdemux instead of the rtpbin.
+                GstElement * m_ptdemux = nullptr;
+                std::vector<GstElement *> m_depays;
                 ~Session();
                 ChannelPtr create_channel(CfgoSrc * parent, GstCfgoSrc * owner, guint ssrc, guint pt, GstPad * pad);
-                void destroy_channel(CfgoSrc * parent, GstCfgoSrc * owner, Channel & channel, bool remove = true);
+                void destroy_channel(CfgoSrc * parent, GstCfgoSrc * owner, Channel & channel, bool remove = true, bool recycle = false);
                 ChannelPtr find_channel(GstPad * pad);
                 ChannelPtr find_channel(guint ssrc, guint pt);
                 void release_rtp_pad(GstElement * rtpbin);
                 void release_rtcp_pad(GstElement * rtpbin);
+                void release_srcs(GstCfgoSrc * owner);
+                void release_depays(GstCfgoSrc * owner);
+                void set_queue_limits(guint64 max_bytes, guint64 max_buffers);
+                GstStructure * create_stats() const;
             };
             using SessionPtr = std::shared_ptr<Session>;
             
@@ -90,15 +153,47 @@ namespace cfgo
             gulong m_pad_removed_handler = 0;
             std::vector<SessionPtr> m_sessions;
             GstCaps * m_decode_caps = nullptr;
+            guint64 m_session_max_bytes = 200000;
+            guint64 m_session_max_buffers = 0;
+            guint m_batch_size = 1;
+            // cached when playing, so the pushing path does not query the element for each batch.
+            GstClock * m_clock = nullptr;
+            GstClockTime m_base_time = 0;
+            GstCfgoSrcTimestampMode m_timestamp_mode = GST_CFGO_SRC_TIMESTAMP_MODE_ARRIVAL;
+            bool m_has_ntp_offset = false;
+            gint64 m_ntp_offset = 0;
+            guint m_pool_min_buffers = 0;
+            guint m_pool_max_buffers = 0;
+            guint m_processor_pool_size = 0;
+            guint m_processor_seq = 0;
+            std::deque<PooledProcessor> m_processor_pool;
+            std::atomic_uint64_t m_processor_reuses {0};
+            std::atomic_uint64_t m_processor_misses {0};
+            bool m_latency_meta = false;
 
             void _reset_sub_closer();
             void _reset_read_closer();
             void _create_rtp_bin(GstCfgoSrc * owner);
-            SessionPtr _create_session(GstCfgoSrc * owner, TrackPtr track);
+            SessionPtr _create_session(GstCfgoSrc * owner, const std::string & sub_id, TrackPtr track);
+            GstElement * _create_session_src(GstCfgoSrc * owner, Session & session, const std::string & name, GstPad * sink_pad, GstAppSrcCallbacks & callbacks);
+            void _create_rtp_session(GstCfgoSrc * owner, Session & session);
+            void _create_depay_session(GstCfgoSrc * owner, Session & session);
+            void _install_depay_pad(GstElement * ptdemux, GstPad * pad);
             void _create_processor(GstCfgoSrc * owner, Channel & channel, const std::string & type);
-            void _destroy_processor(GstCfgoSrc * owner, Channel & channel);
+            void _destroy_processor(GstCfgoSrc * owner, Channel & channel, bool recycle = false);
+            void _dispose_processor(GstCfgoSrc * owner, GstElement * processor);
+            GstElement * _take_pooled_processor(const std::string & type, const GstCaps * key);
+            void _trim_processor_pool(GstCfgoSrc * owner, std::size_t size);
             auto _loop() -> asio::awaitable<void>;
             auto _post_buffer(Session & session, Track::MsgType msg_type) -> asio::awaitable<void>;
+            GstBuffer * _create_buffer(GstCfgoSrc * owner, Session & session, Track::MsgPtr && msg);
+            void _push_msgs(GstCfgoSrc * owner, Session & session, Track::MsgType msg_type, std::vector<Track::TimedMsg> & msgs);
+            GstClockTime _get_running_time(GstCfgoSrc * owner);
+            void _on_rtcp_buffer(Session & session, GstBuffer * buffer, GstClockTime running_time);
+            bool _update_rtp_clock(Session & session, GstBuffer * buffer);
+            GstClockTime _rtp_to_running_time(Session & session, bool clock_updated, GstClockTime arrival_time);
+            GstClockTime _rtp_to_sender_time(Session & session, bool clock_updated);
+            void _add_latency_meta(Session & session, GstBuffer * buffer, bool clock_updated, const Track::TimedMsg & msg, GstClockTime push_time, GstClockTime now);
             void _detach();
             void _install_pad(GstPad * pad);
             void _uninstall_pad(GstPad * pad);
@@ -172,14 +267,20 @@ namespace cfgo
             void stop();
             void switch_mode(GstCfgoSrcMode mode);
             void set_decode_caps(const GstCaps * caps);
+            void set_session_queue_limits(guint64 max_bytes, guint64 max_buffers);
+            void set_batch_size(guint batch_size);
+            void set_clock(GstClock * clock, GstClockTime base_time);
+            void set_timestamp_mode(GstCfgoSrcTimestampMode mode);
+            // only affect the sessions created later.
+            void set_pool_limits(guint min_buffers, guint max_buffers);
+            void set_processor_pool_size(guint size);
+            void set_latency_meta(bool enable);
+            GstStructure * create_stats();
 
-            friend void rtpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data);
-            friend void rtpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data);
-            friend void rtcpsrc_need_data(GstAppSrc * appsrc, guint length, gpointer user_data);
-            friend void rtcpsrc_enough_data(GstAppSrc * appsrc, gpointer user_data);
             friend GstCaps * request_pt_map(GstElement *src, guint session_id, guint pt, gpointer user_data);
             friend void pad_added_handler(GstElement *src, GstPad *new_pad, gpointer user_data);
             friend void pad_removed_handler(GstElement * src, GstPad * pad, gpointer user_data);
+            friend void depay_pad_added_handler(GstElement * src, GstPad * new_pad, gpointer user_data);
             // friend GstPadProbeReturn block_buffer_probe(GstPad * pad, GstPadProbeInfo * info, CfgoSrc * input);
         };
     } // namespace gst    
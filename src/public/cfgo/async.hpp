@@ -2,6 +2,7 @@
 #define _CFGO_ASYNC_HPP_
 
 #include <chrono>
+#include <cstdint>
 #include <mutex>
 #include <vector>
 #include <set>
@@ -10,6 +11,7 @@
 #include "cfgo/black_magic.hpp"
 #include "cfgo/utils.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/event_trace.hpp"
 #include "asio/awaitable.hpp"
 #include "asio/steady_timer.hpp"
 #include "asiochan/asiochan.hpp"
@@ -123,6 +125,19 @@ namespace cfgo
         }
     };
 
+    /**
+     * Capture the stack trace of one in every n CancelError created on each thread, even if it is not asked for.
+     * Cancellation is a normal control flow, so the trace is skipped by default: 0 disables the sampling,
+     * which is the default of the release builds, the debug builds default to 1 in 64.
+     * A sampled CancelError prints its trace in what() like a traced one.
+    */
+    void set_cancel_trace_sampling(std::uint32_t n) noexcept;
+    [[nodiscard]] std::uint32_t get_cancel_trace_sampling() noexcept;
+    /**
+     * Count one cancellation on this thread, return true if its trace should be captured according to the sampling.
+    */
+    [[nodiscard]] bool sample_cancel_trace() noexcept;
+
     class CancelError : public cpptrace::exception_with_message
     {
     public:
@@ -800,8 +815,18 @@ namespace cfgo
         }
     }
 
+    namespace detail
+    {
+        // a channel is a handle of its shared state, so the state identifies the channel across the copies.
+        inline const void * chan_identity(auto & ch) noexcept
+        {
+            return &ch.shared_state();
+        }
+    } // namespace detail
+
     template<typename T>
     auto chan_read(asiochan::readable_channel_type<T> auto ch, close_chan close_ch = INVALID_CLOSE_CHAN) -> asio::awaitable<cancelable<T>> {
+        event_trace::Span span(event_trace::Event::CHAN_WAIT, detail::chan_identity(ch));
         if (is_valid_close_chan(close_ch))
         {
             auto && res = co_await select(
@@ -840,6 +865,7 @@ namespace cfgo
 
     template<typename T>
     auto chan_read_or_throw(asiochan::readable_channel_type<T> auto ch, close_chan close_ch = INVALID_CLOSE_CHAN) -> asio::awaitable<T> {
+        event_trace::Span span(event_trace::Event::CHAN_WAIT, detail::chan_identity(ch));
         if (is_valid_close_chan(close_ch))
         {
             auto && res = co_await select_or_throw(
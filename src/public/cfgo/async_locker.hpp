@@ -7,6 +7,8 @@
 #include "cfgo/coroutine_concepts.hpp"
 #include <mutex>
 #include <memory>
+#include <map>
+#include <vector>
 #include <cstdint>
 
 namespace cfgo
@@ -330,20 +332,48 @@ namespace cfgo
     public:
         struct Configure
         {
+            // the max time lock waits for the blockers. zero means no limit.
             duration_t block_timeout;
             int target_batch;
             std::uint32_t min_batch = 1;
+            // flush a partial batch (at least min_batch) once the oldest blocked blocker has waited so long. zero means wait for the full batch.
+            duration_t max_queue_delay {0};
+            // override max_queue_delay of the blockers with the priority.
+            std::map<int, duration_t> priority_queue_delays {};
 
             void validate() const;
         };
+        struct Statistics
+        {
+            // batch_sizes[n] is the number of locks which got n blocked blockers.
+            std::vector<std::uint64_t> batch_sizes {};
+            // the upper bounds of the queue delay buckets. queue_delays has one more bucket for the larger ones.
+            std::vector<duration_t> queue_delay_bounds {};
+            std::vector<std::uint64_t> queue_delays {};
+            std::uint64_t flushed_by_batch = 0;
+            std::uint64_t flushed_by_deadline = 0;
+            std::uint64_t flushed_by_timeout = 0;
+        };
 
         AsyncBlockerManager(const Configure & configure);
         auto lock(const close_chan & closer = nullptr) const -> asio::awaitable<void>;
         void unlock() const;
         void collect_locked_blocker(std::vector<AsyncBlocker> & blockers) const;
+        /**
+         * The priority is strict: the blockers of a higher priority are always selected first, so the lower ones only get into a batch
+         * the higher ones do not fill, and may starve while the higher ones keep up. Within one priority, the least recently served one is selected first.
+        */
         auto add_blocker(int priority, const close_chan & closer = nullptr) const -> asio::awaitable<AsyncBlocker>;
         void remove_blocker(std::uint32_t id) const;
+        /**
+         * Block if requested, until unblocked. Return at once if not requested.
+        */
         auto wait_blocker(std::uint32_t id, const close_chan & closer = nullptr) const -> asio::awaitable<void>;
+        /**
+         * Park until the blocker is requested, then block like wait_blocker. For the blockers which have nothing else to do meanwhile.
+        */
+        auto wait_block_request(std::uint32_t id, const close_chan & closer = nullptr) const -> asio::awaitable<void>;
+        [[nodiscard]] Statistics statistics() const;
     };
     
 } // namespace cfgo
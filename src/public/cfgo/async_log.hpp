@@ -0,0 +1,55 @@
+#ifndef _CFGO_ASYNC_LOG_HPP_
+#define _CFGO_ASYNC_LOG_HPP_
+
+#include "cfgo/utils.hpp"
+#include "spdlog/sinks/sink.h"
+#include <cstdint>
+
+namespace cfgo
+{
+    namespace detail
+    {
+        class AsyncLogBackend;
+    } // namespace detail
+
+    /**
+     * A background thread which writes the log records of many loggers to their real sinks.
+     * The records are copied into a preallocated ring (Vyukov's bounded queue, consumed by the only background thread),
+     * so logging never locks and never allocates unless the message is longer than record_size.
+     * The payload is still formatted by the calling thread, only the sink io is moved out.
+    */
+    class AsyncLogBackend : public ImplBy<detail::AsyncLogBackend>
+    {
+    public:
+        struct Configure
+        {
+            // the number of the preallocated records, rounded up to the power of two.
+            std::size_t capacity = 8192;
+            // the text reserved for each record, the logger name and the payload. the longer ones allocate once and keep it.
+            std::size_t record_size = 256;
+            // wait for a free record instead of dropping the message when the ring is full.
+            bool block_when_full = false;
+
+            void validate() const;
+        };
+
+        AsyncLogBackend(std::nullptr_t);
+        explicit AsyncLogBackend(const Configure & conf);
+        operator bool() const noexcept;
+        /**
+         * Return a sink which writes to the target through the background thread.
+         * The target is called by the background thread only, but its pattern may be set by any thread, so use a _mt sink.
+        */
+        [[nodiscard]] spdlog::sink_ptr wrap(spdlog::sink_ptr target) const;
+        /**
+         * Wait until the records logged before are written to the targets. Flush the wrapped sinks to flush the targets too.
+        */
+        void flush() const;
+        /**
+         * The records dropped because the ring was full, counted by the process wide metric cfgo_log_dropped_records_total.
+        */
+        [[nodiscard]] std::uint64_t dropped() const noexcept;
+    };
+} // namespace cfgo
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _CFGO_ASYNC_TASK_GROUP_HPP_
+#define _CFGO_ASYNC_TASK_GROUP_HPP_
+
+#include "asio/awaitable.hpp"
+#include "asio/any_io_executor.hpp"
+#include "cfgo/utils.hpp"
+#include "cfgo/async.hpp"
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace cfgo
+{
+    namespace detail
+    {
+        class AsyncTaskGroup;
+    } // namespace detail
+
+    /**
+     * A task group which limits the number of tasks in flight.
+     * Unlike AsyncTasksAll, tasks are queued in priority lanes and only started when a slot is free.
+     * Each executor is a worker with its own lanes, an idle worker steals the most urgent task from the others.
+     * All tasks share a child closer of the input closer. The first failed task closes it and its exception is rethrown by await.
+    */
+    class AsyncTaskGroup : public ImplBy<detail::AsyncTaskGroup>
+    {
+    public:
+        using Task = std::function<asio::awaitable<void>(close_chan closer)>;
+        struct Configure
+        {
+            // 0 means no limit.
+            std::uint32_t max_in_flight = 0;
+            // priority in [0, lanes), the larger one run first.
+            std::uint32_t lanes = 1;
+            // the workers. If empty, the executor of the first await caller is used.
+            std::vector<asio::any_io_executor> executors {};
+            // how many run times are kept to calculate the percentiles.
+            std::uint32_t stat_window = 1024;
+
+            void validate() const;
+        };
+        struct Stats
+        {
+            std::uint64_t queued;
+            std::uint64_t running;
+            std::uint64_t completed;
+            std::uint64_t failed;
+            std::uint64_t stolen;
+            duration_t p99_run_time;
+        };
+
+        AsyncTaskGroup(const Configure & configure, const close_chan & closer = INVALID_CLOSE_CHAN);
+        /**
+         * Add a task to the lane of priority. Could be called before or after await.
+        */
+        void add_task(Task task, std::uint32_t priority = 0) const;
+        /**
+         * Start the tasks and wait until all the queued and running tasks done.
+         * Throw CancelError if the closer closed, or rethrow the first exception of the tasks.
+        */
+        auto await() const -> asio::awaitable<void>;
+        [[nodiscard]] Stats stats() const;
+        [[nodiscard]] const close_chan & closer() const noexcept;
+    };
+
+} // namespace cfgo
+
+#endif
@@ -74,6 +74,17 @@ CFGO_API const unsigned char * cfgo_track_receive_msg(int track_handle, cfgoMsgT
 CFGO_API int cfgo_track_ref(int track_handle);
 CFGO_API int cfgo_track_unref(int track_handle);
 
+// like snprintf, write the metrics in the Prometheus text format to buf and return the full length without the null terminator.
+// the output is truncated when the length is not less than size, call it with a null buf to get the length.
+CFGO_API int cfgo_metrics_export_text(char * buf, int size);
+
+// record the coroutine and packet events into the per thread rings, ring_size <= 0 means the default size.
+CFGO_API int cfgo_event_trace_start(int ring_size);
+CFGO_API int cfgo_event_trace_stop();
+// write the recorded events in the Chrome trace json format.
+CFGO_API int cfgo_event_trace_dump(const char * path);
+CFGO_API int cfgo_event_trace_install_crash_handler(const char * path);
+
 
 #ifdef __cplusplus
 }
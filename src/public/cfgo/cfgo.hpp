@@ -3,6 +3,7 @@
 
 #include "cfgo/alias.hpp"
 #include "cfgo/async.hpp"
+#include "cfgo/async_log.hpp"
 #include "cfgo/async_locker.hpp"
 #include "cfgo/capi.h"
 #include "cfgo/cbridge.hpp"
@@ -10,8 +11,11 @@
 #include "cfgo/configuration.hpp"
 #include "cfgo/defer.hpp"
 #include "cfgo/error.hpp"
+#include "cfgo/event_trace.hpp"
 #include "cfgo/exports.h"
+#include "cfgo/metrics.hpp"
 #include "cfgo/pattern.hpp"
+#include "cfgo/rtp_capture.hpp"
 #include "cfgo/spd_helper.hpp"
 #include "cfgo/subscribation.hpp"
 #include "cfgo/track.hpp"
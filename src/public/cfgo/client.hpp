@@ -30,6 +30,8 @@ namespace cfgo {
         std::optional<rtc::Description> peer_remote_desc() const;
         CtxPtr execution_context() const noexcept;
         close_chan get_closer() const noexcept;
+        const Configuration & config() const noexcept;
+        const std::string & id() const noexcept;
         void init() const;
         [[nodiscard]] auto subscribe(const Pattern& pattern, const std::vector<std::string>& req_types, const close_chan & closer = nullptr) const -> asio::awaitable<SubPtr>;
         [[nodiscard]] auto unsubscribe(const std::string& sub_id, const close_chan & closer = nullptr) const -> asio::awaitable<cancelable<void>>;
@@ -0,0 +1,136 @@
+#ifndef _CFGO_EVENT_TRACE_HPP_
+#define _CFGO_EVENT_TRACE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace cfgo
+{
+    namespace event_trace
+    {
+        /**
+         * The events are exported as the async events of the Chrome trace format, the category is the event name
+         * and the id is the object, so the spans of the same object are nested in the same track of Perfetto.
+        */
+        enum class Event : std::uint16_t
+        {
+            // a chan_read suspends on the channel, ends when the channel or the close signal wakes it up.
+            CHAN_WAIT,
+            // AsyncMutex::accquire waits for the holder, only when contended.
+            MUTEX_WAIT,
+            // AsyncBlockerManager::lock, from waiting for the batch to all the selected blockers synced.
+            BLOCKER_LOCK,
+            // Client::subscribe.
+            SUBSCRIBE,
+            // CfgoSrc::_post_buffer waits for the next packet of the track, arg is the msg type.
+            SRC_READ,
+            // CfgoSrc::_post_buffer waits for the need-data of appsrc, arg is the msg type.
+            SRC_NEED_DATA,
+            // a packet received by impl::Track, arg is the size, the highest bit is set for rtcp.
+            PACKET_INGEST,
+            // packets pushed to appsrc by CfgoSrc, arg is the number of packets.
+            PACKET_PUSH,
+            // a close signal is closed, arg is 1 when timeout.
+            CLOSE,
+        };
+        constexpr std::size_t EVENT_COUNT = static_cast<std::size_t>(Event::CLOSE) + 1;
+
+        enum class Phase : std::uint8_t
+        {
+            BEGIN,
+            END,
+            INSTANT,
+        };
+
+        struct Configure
+        {
+            // the number of the records kept per thread, rounded up to the power of two. a record takes 40 bytes.
+            std::size_t ring_size = 16384;
+
+            void validate() const;
+        };
+
+        namespace detail
+        {
+            inline std::atomic_bool s_enabled {false};
+
+            void record(Event event, Phase phase, std::uint64_t object, std::uint64_t arg) noexcept;
+        } // namespace detail
+
+        [[nodiscard]] const char * get_event_name(Event event) noexcept;
+        /**
+         * Start recording. Each thread allocates its ring when it records the first time after started,
+         * the rings of the exited threads are reused by the new ones, and never released.
+         * The ring_size only affects the rings allocated after.
+        */
+        void start(const Configure & conf = {});
+        /**
+         * Stop recording, the recorded events are kept until overwritten.
+        */
+        void stop() noexcept;
+
+        [[nodiscard]] inline bool enabled() noexcept
+        {
+            return detail::s_enabled.load(std::memory_order_relaxed);
+        }
+        /**
+         * Only a relaxed load when stopped. When started, the owner thread writes its ring without any lock or allocation.
+        */
+        inline void record(Event event, Phase phase, const void * object, std::uint64_t arg = 0) noexcept
+        {
+            if (enabled())
+            {
+                detail::record(event, phase, reinterpret_cast<std::uintptr_t>(object), arg);
+            }
+        }
+        /**
+         * Write the events of all the threads in the Chrome trace json format, loadable by chrome://tracing and ui.perfetto.dev.
+         * Safe while the other threads are recording, the records being overwritten meanwhile are skipped.
+        */
+        void dump(std::ostream & os);
+        /**
+         * Return false if failed to open the file.
+        */
+        bool dump(const std::string & path);
+        /**
+         * Dump to the path when the process crashes by SIGSEGV, SIGBUS, SIGFPE, SIGILL or SIGABRT, then chain to the previous handlers.
+         * Only async signal safe functions are used by the crash dump.
+        */
+        void install_crash_handler(const std::string & path);
+
+        /**
+         * Record BEGIN when constructed and END when destroyed. The END is recorded even if the coroutine is destroyed by cancellation.
+        */
+        class Span
+        {
+        public:
+            Span(Event event, const void * object, std::uint64_t arg = 0) noexcept:
+                m_event(event), m_object(object), m_arg(arg), m_begun(enabled())
+            {
+                if (m_begun)
+                {
+                    detail::record(m_event, Phase::BEGIN, reinterpret_cast<std::uintptr_t>(m_object), m_arg);
+                }
+            }
+            Span(const Span &) = delete;
+            Span & operator = (const Span &) = delete;
+            ~Span() noexcept
+            {
+                // always close the begun span, otherwise the viewer leaves it open forever.
+                if (m_begun)
+                {
+                    detail::record(m_event, Phase::END, reinterpret_cast<std::uintptr_t>(m_object), m_arg);
+                }
+            }
+        private:
+            Event m_event;
+            const void * m_object;
+            std::uint64_t m_arg;
+            bool m_begun;
+        };
+    } // namespace event_trace
+} // namespace cfgo
+
+#endif
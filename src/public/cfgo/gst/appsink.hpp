@@ -5,6 +5,7 @@
 #include "cfgo/async.hpp"
 #include "cfgo/utils.hpp"
 #include "cfgo/gst/utils.hpp"
+#include <vector>
 
 namespace cfgo
 {
@@ -13,8 +14,26 @@ namespace cfgo
         namespace detail
         {
             class AppSink;
+            class AppSinkConsumer;
         } // namespace detail
-        
+
+        /**
+         * A cursor on the fan-out ring of AppSink. Every consumer sees all the samples, a slow consumer skips the overwritten ones.
+        */
+        class AppSinkConsumer : public ImplBy<detail::AppSinkConsumer>
+        {
+        public:
+            AppSinkConsumer(impl_ptr<detail::AppSinkConsumer> impl);
+            /**
+             * Wait for at least one sample, then take up to max_n samples without waiting.
+             * throw CancelError when closer is closed. return empty vector when eos and no sample available.
+            */
+            auto pull_samples(std::size_t max_n, close_chan closer = INVALID_CLOSE_CHAN) const -> asio::awaitable<std::vector<GstSampleSPtr>>;
+            /**
+             * The samples overwritten before this consumer read them.
+            */
+            [[nodiscard]] std::uint64_t dropped_samples() const;
+        };
 
         class AppSink : public ImplBy<detail::AppSink>
         {
@@ -63,6 +82,21 @@ namespace cfgo
                 }
             };
 
+            struct AllocationConfigure
+            {
+                // propose a buffer pool to the upstream when the negotiated caps is in system memory.
+                bool propose_pool = true;
+                // the buffers held outside of the cache, such as the last sample of appsink and the ones pulled but not released yet.
+                // the min buffers of the proposed pool is cache_capicity + extra_buffers.
+                guint extra_buffers = 2;
+                // if true, the max buffers of the proposed pool is the same as the min buffers, so the upstream blocks instead of allocating more.
+                bool limit_max_buffers = false;
+                // the alignment mask of the memory, such as 63 for 64 bytes alignment. 0 means the default alignment.
+                gsize align = 0;
+                // proposed to the upstream and used by the proposed pool. a new ref is taken. nullptr means the default allocator.
+                GstAllocator * allocator = nullptr;
+            };
+
             using OnSampleCb = std::function<void(GstSample *)>;
             using OnStatCb = std::function<void(const Statistics &)>;
             AppSink(GstAppSink * sink, int cache_capicity);
@@ -71,12 +105,29 @@ namespace cfgo
              * throw CancelError when closer is closed. return null shared_ptr when eos and no sample available.
             */
             auto pull_sample(close_chan closer = INVALID_CLOSE_CHAN) const -> asio::awaitable<GstSampleSPtr>;
+            /**
+             * Wait for at least one sample, then take up to max_n samples without waiting.
+             * throw CancelError when closer is closed. return empty vector when eos and no sample available.
+             * Multiple pullers share the samples, each sample is delivered to only one of them.
+            */
+            auto pull_samples(std::size_t max_n, close_chan closer = INVALID_CLOSE_CHAN) const -> asio::awaitable<std::vector<GstSampleSPtr>>;
+            /**
+             * Switch to the fan-out mode and create a consumer which starts from the next sample.
+             * The first consumer also gets the samples still queued for pull_sample/pull_samples when switching.
+             * In the fan-out mode, the samples are only delivered to the consumers and pull_sample/pull_samples throw, the pending ones included.
+            */
+            AppSinkConsumer create_consumer() const;
             void set_on_sample(const OnSampleCb & cb) const;
             void set_on_sample(OnSampleCb && cb) const;
             void unset_on_sample() const noexcept;
             void set_on_stat(const OnStatCb & cb) const;
             void set_on_stat(OnStatCb && cb) const;
             void unset_on_stat() const noexcept;
+            /**
+             * Control how the allocation query of the upstream is answered. Take effect on the next allocation query.
+             * The GstVideoMeta is always advertised, so the upstream could use padded or strided video buffers without copying.
+            */
+            void set_allocation_configure(const AllocationConfigure & conf) const;
         };
     } // namespace gst
     
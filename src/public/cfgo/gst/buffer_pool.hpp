@@ -3,6 +3,8 @@
 
 #include "cfgo/utils.hpp"
 #include "gst/gst.h"
+#include <vector>
+#include <cstdint>
 
 namespace cfgo
 {
@@ -12,19 +14,81 @@ namespace cfgo
         {
             class BufferPool;
         } // namespace detail
-        
 
+
+        /**
+         * A set of GstBufferPool, one for each size class. A buffer is acquired from the smallest class which fits the requested size.
+         * When the class is exhausted or no class fits, the buffer is allocated from the same allocator instead and counted as a fallback.
+        */
         class BufferPool : public cfgo::ImplBy<detail::BufferPool>
         {
         public:
+            struct SizeClass
+            {
+                guint buf_size;
+                guint min_buf = 0;
+                // 0 means unlimited.
+                guint max_buf = 0;
+            };
+            struct Configure
+            {
+                std::vector<SizeClass> size_classes {};
+                // the alignment mask of the memory, such as 63 for 64 bytes alignment. 0 means the default alignment.
+                gsize align = 0;
+                // back the memory with transparent huge pages. Only the classes not less than the huge page size benefit from it.
+                bool huge_pages = false;
+                // custom allocator, a new ref is taken. nullptr means the default allocator or the huge page allocator.
+                GstAllocator * allocator = nullptr;
+
+                void validate() const;
+            };
+            struct ClassStatistics
+            {
+                guint buf_size;
+                std::uint64_t hits;
+                std::uint64_t fallbacks;
+                std::uint64_t in_use;
+                std::uint64_t peak_in_use;
+            };
+            struct Statistics
+            {
+                std::vector<ClassStatistics> classes;
+                // the requests larger than any class.
+                std::uint64_t oversizes;
+            };
+
+            /**
+             * Small class for rtcp, mtu class for rtp and large class for video frames.
+            */
+            static Configure make_default_configure(guint mtu, guint frame_size = 0, guint min_buf = 0, guint max_buf = 0);
+
             BufferPool(std::nullptr_t);
             BufferPool(guint buf_size, guint min_buf, guint max_buf);
+            BufferPool(const Configure & conf);
             operator bool() const noexcept;
+            /**
+             * Acquire a buffer from the largest class.
+            */
             GstBuffer * acquire_buffer() const;
+            /**
+             * Acquire a buffer of at least size bytes. The size of the returned buffer is set to size.
+            */
+            GstBuffer * acquire_buffer(gsize size) const;
+            /**
+             * The pool of the smallest class which fits size, nullptr if none. transfer none.
+             * Could be used to answer the allocation query of the upstream.
+            */
+            GstBufferPool * get_pool(gsize size) const;
+            /**
+             * The allocator used by all the classes except the huge page ones. transfer none.
+            */
+            GstAllocator * get_allocator() const;
+            const GstAllocationParams & get_allocation_params() const;
+            [[nodiscard]] Statistics statistics() const;
         };
 
     } // namespace gst
-    
+
 } // namespace cfgo
 
 
@@ -4,8 +4,10 @@
 #include "cfgo/gst/gst.h"
 #include "cfgo/gst/buffer_pool.hpp"
 #include "cfgo/gst/error.hpp"
+#include "cfgo/gst/latency_meta.hpp"
 #include "cfgo/gst/link.hpp"
 #include "cfgo/gst/pipeline.hpp"
+#include "cfgo/gst/tracer.hpp"
 #include "cfgo/gst/utils.hpp"
 
 #endif
\ No newline at end of file
@@ -20,9 +20,15 @@ typedef struct _GstCfgoSrcPrivate GstCfgoSrcPrivate;
 typedef enum {
     GST_CFGO_SRC_MODE_RAW,
     GST_CFGO_SRC_MODE_PARSE,
-    GST_CFGO_SRC_MODE_DECODE
+    GST_CFGO_SRC_MODE_DECODE,
+    GST_CFGO_SRC_MODE_DEPAY
 } GstCfgoSrcMode;
 
+typedef enum {
+    GST_CFGO_SRC_TIMESTAMP_MODE_ARRIVAL,
+    GST_CFGO_SRC_TIMESTAMP_MODE_RTP
+} GstCfgoSrcTimestampMode;
+
 struct _GstCfgoSrc
 {
     GstBin bin;
@@ -42,6 +48,14 @@ struct _GstCfgoSrc
     guint32 read_try_delay_level;
     GstCfgoSrcMode mode;
     GstCaps * decode_caps;
+    guint64 session_max_bytes;
+    guint64 session_max_buffers;
+    guint32 batch_size;
+    GstCfgoSrcTimestampMode timestamp_mode;
+    guint32 pool_min_buffers;
+    guint32 pool_max_buffers;
+    guint32 processor_pool_size;
+    gboolean latency_meta;
 
     /*< private >*/
     GstCfgoSrcPrivate *priv;
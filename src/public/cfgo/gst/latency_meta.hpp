@@ -0,0 +1,81 @@
+#ifndef _CFGO_GST_LATENCY_META_HPP_
+#define _CFGO_GST_LATENCY_META_HPP_
+
+#include "gst/gst.h"
+#include "cfgo/track.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace cfgo
+{
+    namespace gst
+    {
+        /**
+         * An intrusive ref counted holder of the histograms of a track.
+         * cfgosrc creates one per track, the metas only ref it, so nothing is allocated per buffer.
+        */
+        class LatencyRef
+        {
+        public:
+            // the new ref is owned by the caller.
+            explicit LatencyRef(std::shared_ptr<TrackLatency> latency): m_latency(std::move(latency)) {}
+            LatencyRef(const LatencyRef &) = delete;
+            LatencyRef & operator = (const LatencyRef &) = delete;
+
+            LatencyRef * ref() noexcept
+            {
+                m_refs.fetch_add(1, std::memory_order_relaxed);
+                return this;
+            }
+
+            void unref() noexcept
+            {
+                if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete this;
+                }
+            }
+
+            [[nodiscard]] TrackLatency * get() const noexcept
+            {
+                return m_latency.get();
+            }
+        private:
+            std::atomic<std::uint32_t> m_refs {1};
+            std::shared_ptr<TrackLatency> m_latency;
+
+            ~LatencyRef() = default;
+        };
+
+        /**
+         * Attached by cfgosrc to the rtp buffers when its latency-meta property is set.
+         * The meta has no tags, so the depayloaders and decoders copy it to their outputs.
+         * A frame assembled from many packets may carry one meta per packet.
+        */
+        struct LatencyMeta
+        {
+            GstMeta meta;
+            // when the buffer is pushed into the pipeline, in nanoseconds of std::chrono::steady_clock.
+            GstClockTime push_time;
+            // the capture time of the publisher in nanoseconds since the unix epoch, GST_CLOCK_TIME_NONE if no sender report yet.
+            GstClockTime sender_time;
+            // the histograms of the track, reffed by the meta.
+            LatencyRef * latency;
+        };
+
+        GType latency_meta_api_get_type();
+        const GstMetaInfo * latency_meta_get_info();
+        LatencyMeta * buffer_add_latency_meta(GstBuffer * buffer, GstClockTime push_time, GstClockTime sender_time, LatencyRef * latency);
+        /**
+         * Record push_to_sample and sender_to_sample of the tracks whose metas are on the buffer.
+         * When a buffer carries many metas of the same track, the latest push time and the latest sender time are used.
+        */
+        void record_buffer_latency(GstBuffer * buffer);
+
+        [[nodiscard]] GstClockTime steady_clock_ns() noexcept;
+        [[nodiscard]] GstClockTime system_clock_ns() noexcept;
+    } // namespace gst
+} // namespace cfgo
+
+#endif
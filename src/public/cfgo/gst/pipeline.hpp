@@ -6,9 +6,11 @@
 #include "cfgo/utils.hpp"
 #include "cfgo/gst/utils.hpp"
 #include "cfgo/gst/link.hpp"
+#include "cfgo/gst/tracer.hpp"
 #include "gst/gst.h"
 #include "asio/awaitable.hpp"
 #include <set>
+#include <cstdint>
 
 namespace cfgo
 {
@@ -24,11 +26,55 @@ namespace cfgo
         {
         public:
             using CtxPtr = std::shared_ptr<asio::execution_context>;
+            struct MessageStatistics
+            {
+                // the messages accepted by the mask.
+                std::uint64_t received;
+                // the messages dropped at the source because of the mask.
+                std::uint64_t filtered;
+                // the messages dropped because the queue is full. the error and eos messages are never dropped.
+                std::uint64_t overflows;
+                std::uint64_t queued;
+            };
+            static constexpr std::size_t DEFAULT_MESSAGE_CAPACITY = 256;
+            static constexpr GstMessageType DEFAULT_MESSAGE_MASK = static_cast<GstMessageType>(GST_MESSAGE_ERROR | GST_MESSAGE_WARNING | GST_MESSAGE_EOS);
         public:
-            Pipeline(const std::string & name, CtxPtr exec_ctx = nullptr);
+            /**
+             * The bus messages are bridged by a sync handler, so no GMainLoop is needed.
+             * Only the messages in the mask are queued, at most message_capacity of them.
+            */
+            Pipeline(const std::string & name, CtxPtr exec_ctx = nullptr, std::size_t message_capacity = DEFAULT_MESSAGE_CAPACITY);
             void run();
             void stop();
+            /**
+             * Wait until eos. Throw when an error message is received. Return false if closed.
+            */
             [[nodiscard]] auto await(close_chan & close_ch = INVALID_CLOSE_CHAN) -> asio::awaitable<bool>;
+            /**
+             * Wait for the next message of the types. The types are added to the mask.
+             * The queued messages of other types are discarded, so only one coroutine should consume the messages at a time.
+             * The error and eos messages are the exception: they are kept aside until a caller asking for them takes them,
+             * and they are returned before the other queued messages.
+             * Return nullptr if closed.
+            */
+            [[nodiscard]] auto await_message(GstMessageType types, close_chan close_ch = INVALID_CLOSE_CHAN) -> asio::awaitable<GstMessageSPtr>;
+            /**
+             * Replace the mask. The messages not in the mask are dropped in the streaming thread which posts them.
+             * The error and eos messages are always accepted.
+            */
+            void set_message_mask(GstMessageType types) const noexcept;
+            [[nodiscard]] GstMessageType message_mask() const noexcept;
+            [[nodiscard]] MessageStatistics message_statistics() const noexcept;
+            /**
+             * Trace every element of the pipeline with pad probes. Return the existing tracer if already enabled, conf is ignored in that case.
+             * Use ElementTracer::snapshot or ElementTracer::run to read the results.
+            */
+            ElementTracer enable_tracer(const ElementTracer::Configure & conf = {}) const;
+            void disable_tracer() const;
+            /**
+             * nullptr if not enabled.
+            */
+            [[nodiscard]] ElementTracer tracer() const;
             void add_node(const std::string & name, const std::string & type);
             [[nodiscard]] auto await_pad(const std::string & node, const std::string & pad, const std::set<GstPad *> & excludes, close_chan closer = INVALID_CLOSE_CHAN) -> asio::awaitable<GstPadSPtr>;
             bool link(const std::string & src, const std::string & target);
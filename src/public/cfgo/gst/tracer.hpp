@@ -0,0 +1,87 @@
+#ifndef _CFGO_GST_TRACER_HPP_
+#define _CFGO_GST_TRACER_HPP_
+
+#include "cfgo/async.hpp"
+#include "cfgo/histogram.hpp"
+#include "cfgo/utils.hpp"
+#include "gst/gst.h"
+#include "asio/awaitable.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cfgo
+{
+    namespace gst
+    {
+        namespace detail
+        {
+            class ElementTracer;
+        } // namespace detail
+
+        /**
+         * Measure every element of a bin with pad probes, the elements and pads added later are traced too.
+         * The latency of an element is the time between a buffer entering one of its sink pads and the buffer with the same pts
+         * leaving one of its src pads. When no such buffer is found, the last arrival is used instead,
+         * so the latency of the elements which aggregate or split the buffers is approximate.
+        */
+        class ElementTracer : public ImplBy<detail::ElementTracer>
+        {
+        public:
+            struct Configure
+            {
+                // only one of sample_interval buffers is measured for the latency. 1 means all.
+                std::uint32_t sample_interval = 1;
+                // trace the elements inside the child bins, such as the ones of cfgosrc and decodebin.
+                bool recursive = true;
+
+                void validate() const;
+            };
+            struct ElementSnapshot
+            {
+                // the path of the element, such as /pipeline0/cfgosrc0/rtpbin.
+                std::string path;
+                std::string factory;
+                LatencyHistogram::Snapshot latency;
+                std::uint64_t buffers;
+                std::uint64_t bytes;
+                // the rates since the last snapshot.
+                double buffers_per_sec;
+                double bytes_per_sec;
+                // the fill of the queue like elements, -1 if the element has no such property.
+                std::int64_t queue_buffers;
+                std::int64_t queue_bytes;
+            };
+            struct Snapshot
+            {
+                std::chrono::steady_clock::time_point at;
+                duration_t interval;
+                std::vector<ElementSnapshot> elements;
+            };
+            using SnapshotCallback = std::function<void(const Snapshot &)>;
+
+            ElementTracer(std::nullptr_t);
+            /**
+             * Start tracing the bin, a new ref is taken.
+            */
+            ElementTracer(GstBin * bin, const Configure & conf);
+            operator bool() const noexcept;
+            /**
+             * The rates are computed against the previous call of snapshot.
+            */
+            [[nodiscard]] Snapshot snapshot() const;
+            /**
+             * Call the callback with a snapshot every interval until stopped. Throw CancelError when the closer is closed.
+            */
+            [[nodiscard]] auto run(duration_t interval, SnapshotCallback cb, close_chan closer = INVALID_CLOSE_CHAN) const -> asio::awaitable<void>;
+            /**
+             * Remove all the probes. Called automatically when the last ref is gone.
+            */
+            void stop() const;
+        };
+    } // namespace gst
+} // namespace cfgo
+
+#endif
@@ -50,6 +50,9 @@ namespace cfgo
         CFGO_DECLARE_SHARED_PTR(GstBuffer);
         CFGO_DECLARE_MAKE_SHARED(gst_buffer, GstBuffer);
         CFGO_DECLARE_STEAL_SHARED(gst_buffer, GstBuffer);
+        CFGO_DECLARE_SHARED_PTR(GstMessage);
+        CFGO_DECLARE_MAKE_SHARED(gst_message, GstMessage);
+        CFGO_DECLARE_STEAL_SHARED(gst_message, GstMessage);
         CFGO_DECLARE_SHARED_PTR(GError);
         CFGO_DECLARE_STEAL_SHARED(g_error, GError);
 
@@ -0,0 +1,115 @@
+#ifndef _CFGO_HISTOGRAM_HPP_
+#define _CFGO_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace cfgo
+{
+    /**
+     * A lock-free latency histogram with power of two buckets in microseconds.
+     * The bucket 0 holds the values less than 1us, the bucket i holds [2^(i-1), 2^i) us and the last one holds all the larger values.
+     * record only touches relaxed atomics, so it is cheap enough for the streaming threads.
+    */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr std::size_t BUCKETS = 32;
+
+        struct Snapshot
+        {
+            std::uint64_t count = 0;
+            std::chrono::nanoseconds sum {0};
+            std::chrono::nanoseconds max {0};
+            std::array<std::uint64_t, BUCKETS> buckets {};
+
+            [[nodiscard]] std::chrono::nanoseconds mean() const noexcept
+            {
+                return count > 0 ? sum / static_cast<std::int64_t>(count) : std::chrono::nanoseconds {0};
+            }
+
+            /**
+             * The upper bound of the bucket which contains the p quantile, p in [0, 1]. Never greater than max.
+            */
+            [[nodiscard]] std::chrono::nanoseconds percentile(double p) const noexcept
+            {
+                if (count == 0)
+                {
+                    return std::chrono::nanoseconds {0};
+                }
+                auto rank = static_cast<std::uint64_t>(p * (count - 1)) + 1;
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < BUCKETS; ++i)
+                {
+                    seen += buckets[i];
+                    if (seen >= rank)
+                    {
+                        auto upper = std::chrono::nanoseconds {std::chrono::microseconds {std::uint64_t {1} << i}};
+                        return upper < max ? upper : max;
+                    }
+                }
+                return max;
+            }
+
+            Snapshot & operator -= (const Snapshot & other) noexcept
+            {
+                count -= other.count;
+                sum -= other.sum;
+                for (std::size_t i = 0; i < BUCKETS; ++i)
+                {
+                    buckets[i] -= other.buckets[i];
+                }
+                return *this;
+            }
+        };
+
+        LatencyHistogram() = default;
+        LatencyHistogram(const LatencyHistogram &) = delete;
+        LatencyHistogram & operator = (const LatencyHistogram &) = delete;
+
+        template<typename Rep, typename Period>
+        void record(const std::chrono::duration<Rep, Period> & value) noexcept
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+            record_ns(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+        }
+
+        void record_ns(std::uint64_t ns) noexcept
+        {
+            auto us = ns / 1000;
+            std::size_t i = us == 0 ? 0 : static_cast<std::size_t>(std::bit_width(us));
+            m_buckets[i < BUCKETS ? i : BUCKETS - 1].fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(ns, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            auto max = m_max.load(std::memory_order_relaxed);
+            while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+        }
+
+        /**
+         * Not atomic as a whole, the fields may be off by the records in progress.
+        */
+        [[nodiscard]] Snapshot snapshot() const noexcept
+        {
+            Snapshot s {};
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                s.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+            }
+            s.count = m_count.load(std::memory_order_relaxed);
+            s.sum = std::chrono::nanoseconds {m_sum.load(std::memory_order_relaxed)};
+            s.max = std::chrono::nanoseconds {m_max.load(std::memory_order_relaxed)};
+            return s;
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets {};
+        std::atomic<std::uint64_t> m_count {0};
+        std::atomic<std::uint64_t> m_sum {0};
+        std::atomic<std::uint64_t> m_max {0};
+    };
+} // namespace cfgo
+
+#endif
@@ -5,6 +5,20 @@
 #include "cfgo/utils.hpp"
 
 #include "spdlog/spdlog.h"
+#include <atomic>
+
+#define CFGO_LEVEL_TRACE 0
+#define CFGO_LEVEL_DEBUG 1
+#define CFGO_LEVEL_INFO 2
+#define CFGO_LEVEL_WARN 3
+#define CFGO_LEVEL_ERROR 4
+#define CFGO_LEVEL_CRITICAL 5
+#define CFGO_LEVEL_OFF 6
+
+// the log macros below this level are compiled out, arguments included. set by the cmake option LOG_ACTIVE_LEVEL.
+#ifndef CFGO_ACTIVE_LEVEL
+#define CFGO_ACTIVE_LEVEL CFGO_LEVEL_TRACE
+#endif
 
 namespace cfgo
 {
@@ -18,6 +32,8 @@ namespace cfgo
     using LogTimeType = spdlog::pattern_time_type;
     using LoggerFactory = std::function<Logger(std::string)>;
 
+    class AsyncLogBackend;
+
     class Log : public cfgo::ImplBy<detail::Log>
     {
     public:
@@ -43,6 +59,29 @@ namespace cfgo
         bool is_backtrace(Category category) const;
         Logger create_logger(Category category, const std::string & name = "") const;
         Logger default_logger() const;
+        /**
+         * Write the loggers created by the default factory through the backend, nullptr to go back to the synchronous sinks.
+         * Only the loggers created after are affected, the default logger is recreated at once.
+        */
+        void set_async_backend(AsyncLogBackend backend) const;
+        /**
+         * Whether the default logger logs the level, without copying the default logger shared_ptr.
+         * It reads the level of the default logger itself, so a level set on default_logger() directly is seen too.
+         * The loggers of the other categories are checked by the CFGO_LOGGER_* macros on the logger.
+        */
+        static bool should_log(LogLevel level) noexcept
+        {
+            auto logger = s_default_logger.load(std::memory_order_acquire);
+            return logger ? logger->should_log(level) : _should_log_default(level);
+        }
+    private:
+        // the default logger of instance(), set when it is created or replaced. the replaced ones are kept alive by instance().
+        static inline std::atomic<spdlog::logger *> s_default_logger {nullptr};
+
+        // before instance() is created.
+        static bool _should_log_default(LogLevel level) noexcept;
+
+        friend class detail::Log;
     };
 
 } // namespace cfgo
@@ -59,39 +98,92 @@ do { \
 
 #define _CFGO_LOG_DEFAULT_LOG(LVL, MTH, FMT, ...) \
 do { \
-    const auto & logger = cfgo::Log::instance().default_logger(); \
-    if (logger->should_log(cfgo::LogLevel::LVL)) \
+    if (cfgo::Log::should_log(cfgo::LogLevel::LVL)) \
     { \
-        logger->MTH(FMT CFGO_VA_ARGS(__VA_ARGS__)); \
+        const auto & logger = cfgo::Log::instance().default_logger(); \
+        if (logger->should_log(cfgo::LogLevel::LVL)) \
+        { \
+            logger->MTH(FMT CFGO_VA_ARGS(__VA_ARGS__)); \
+        } \
     } \
 } while(false)
 
-#define CFGO_TRACE(FMT, ...) _CFGO_LOG_DEFAULT_LOG(trace, trace, FMT, __VA_ARGS__)
-#define CFGO_DEBUG(FMT, ...) _CFGO_LOG_DEFAULT_LOG(debug, debug, FMT, __VA_ARGS__)
-#define CFGO_INFO(FMT, ...) _CFGO_LOG_DEFAULT_LOG(info, info, FMT, __VA_ARGS__)
-#define CFGO_WARN(FMT, ...) _CFGO_LOG_DEFAULT_LOG(warn, warn, FMT, __VA_ARGS__)
-#define CFGO_ERROR(FMT, ...) _CFGO_LOG_DEFAULT_LOG(err, error, FMT, __VA_ARGS__)
-#define CFGO_CRITICAL(FMT, ...) _CFGO_LOG_DEFAULT_LOG(critical, critical, FMT, __VA_ARGS__)
-
-#define CFGO_THIS_TRACE(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, trace, trace, FMT, __VA_ARGS__)
-#define CFGO_THIS_DEBUG(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, debug, debug, FMT, __VA_ARGS__)
-#define CFGO_THIS_INFO(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, info, info, FMT, __VA_ARGS__)
-#define CFGO_THIS_WARN(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, warn, warn, FMT, __VA_ARGS__)
-#define CFGO_THIS_ERROR(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, err, error, FMT, __VA_ARGS__)
-#define CFGO_THIS_CRITICAL(FMT, ...) _CFGO_LOG_LOGGER_LOG(this->m_logger, critical, critical, FMT, __VA_ARGS__)
-
-#define CFGO_SELF_TRACE(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, trace, trace, FMT, __VA_ARGS__)
-#define CFGO_SELF_DEBUG(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, debug, debug, FMT, __VA_ARGS__)
-#define CFGO_SELF_INFO(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, info, info, FMT, __VA_ARGS__)
-#define CFGO_SELF_WARN(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, warn, warn, FMT, __VA_ARGS__)
-#define CFGO_SELF_ERROR(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, err, error, FMT, __VA_ARGS__)
-#define CFGO_SELF_CRITICAL(FMT, ...) _CFGO_LOG_LOGGER_LOG(self->m_logger, critical, critical, FMT, __VA_ARGS__)
-
-#define CFGO_LOGGER_TRACE(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, trace, trace, FMT, __VA_ARGS__)
-#define CFGO_LOGGER_DEBUG(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, debug, debug, FMT, __VA_ARGS__)
-#define CFGO_LOGGER_INFO(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, info, info, FMT, __VA_ARGS__)
-#define CFGO_LOGGER_WARN(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, warn, warn, FMT, __VA_ARGS__)
-#define CFGO_LOGGER_ERROR(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, err, error, FMT, __VA_ARGS__)
-#define CFGO_LOGGER_CRITICAL(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, critical, critical, FMT, __VA_ARGS__)
+#define _CFGO_LOG_DISABLED(...) do {} while(false)
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_TRACE
+#define _CFGO_LOG_DEFAULT_TRACE(FMT, ...) _CFGO_LOG_DEFAULT_LOG(trace, trace, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_TRACE(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, trace, trace, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_TRACE(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_TRACE(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_DEBUG
+#define _CFGO_LOG_DEFAULT_DEBUG(FMT, ...) _CFGO_LOG_DEFAULT_LOG(debug, debug, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_DEBUG(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, debug, debug, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_DEBUG(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_DEBUG(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_INFO
+#define _CFGO_LOG_DEFAULT_INFO(FMT, ...) _CFGO_LOG_DEFAULT_LOG(info, info, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_INFO(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, info, info, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_INFO(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_INFO(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_WARN
+#define _CFGO_LOG_DEFAULT_WARN(FMT, ...) _CFGO_LOG_DEFAULT_LOG(warn, warn, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_WARN(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, warn, warn, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_WARN(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_WARN(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_ERROR
+#define _CFGO_LOG_DEFAULT_ERROR(FMT, ...) _CFGO_LOG_DEFAULT_LOG(err, error, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_ERROR(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, err, error, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_ERROR(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_ERROR(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_CRITICAL
+#define _CFGO_LOG_DEFAULT_CRITICAL(FMT, ...) _CFGO_LOG_DEFAULT_LOG(critical, critical, FMT, __VA_ARGS__)
+#define _CFGO_LOG_LOGGER_CRITICAL(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_LOG(LOGGER, critical, critical, FMT, __VA_ARGS__)
+#else
+#define _CFGO_LOG_DEFAULT_CRITICAL(FMT, ...) _CFGO_LOG_DISABLED()
+#define _CFGO_LOG_LOGGER_CRITICAL(LOGGER, FMT, ...) _CFGO_LOG_DISABLED()
+#endif
+
+#define CFGO_TRACE(FMT, ...) _CFGO_LOG_DEFAULT_TRACE(FMT, __VA_ARGS__)
+#define CFGO_DEBUG(FMT, ...) _CFGO_LOG_DEFAULT_DEBUG(FMT, __VA_ARGS__)
+#define CFGO_INFO(FMT, ...) _CFGO_LOG_DEFAULT_INFO(FMT, __VA_ARGS__)
+#define CFGO_WARN(FMT, ...) _CFGO_LOG_DEFAULT_WARN(FMT, __VA_ARGS__)
+#define CFGO_ERROR(FMT, ...) _CFGO_LOG_DEFAULT_ERROR(FMT, __VA_ARGS__)
+#define CFGO_CRITICAL(FMT, ...) _CFGO_LOG_DEFAULT_CRITICAL(FMT, __VA_ARGS__)
+
+#define CFGO_THIS_TRACE(FMT, ...) _CFGO_LOG_LOGGER_TRACE(this->m_logger, FMT, __VA_ARGS__)
+#define CFGO_THIS_DEBUG(FMT, ...) _CFGO_LOG_LOGGER_DEBUG(this->m_logger, FMT, __VA_ARGS__)
+#define CFGO_THIS_INFO(FMT, ...) _CFGO_LOG_LOGGER_INFO(this->m_logger, FMT, __VA_ARGS__)
+#define CFGO_THIS_WARN(FMT, ...) _CFGO_LOG_LOGGER_WARN(this->m_logger, FMT, __VA_ARGS__)
+#define CFGO_THIS_ERROR(FMT, ...) _CFGO_LOG_LOGGER_ERROR(this->m_logger, FMT, __VA_ARGS__)
+#define CFGO_THIS_CRITICAL(FMT, ...) _CFGO_LOG_LOGGER_CRITICAL(this->m_logger, FMT, __VA_ARGS__)
+
+#define CFGO_SELF_TRACE(FMT, ...) _CFGO_LOG_LOGGER_TRACE(self->m_logger, FMT, __VA_ARGS__)
+#define CFGO_SELF_DEBUG(FMT, ...) _CFGO_LOG_LOGGER_DEBUG(self->m_logger, FMT, __VA_ARGS__)
+#define CFGO_SELF_INFO(FMT, ...) _CFGO_LOG_LOGGER_INFO(self->m_logger, FMT, __VA_ARGS__)
+#define CFGO_SELF_WARN(FMT, ...) _CFGO_LOG_LOGGER_WARN(self->m_logger, FMT, __VA_ARGS__)
+#define CFGO_SELF_ERROR(FMT, ...) _CFGO_LOG_LOGGER_ERROR(self->m_logger, FMT, __VA_ARGS__)
+#define CFGO_SELF_CRITICAL(FMT, ...) _CFGO_LOG_LOGGER_CRITICAL(self->m_logger, FMT, __VA_ARGS__)
+
+#define CFGO_LOGGER_TRACE(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_TRACE(LOGGER, FMT, __VA_ARGS__)
+#define CFGO_LOGGER_DEBUG(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_DEBUG(LOGGER, FMT, __VA_ARGS__)
+#define CFGO_LOGGER_INFO(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_INFO(LOGGER, FMT, __VA_ARGS__)
+#define CFGO_LOGGER_WARN(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_WARN(LOGGER, FMT, __VA_ARGS__)
+#define CFGO_LOGGER_ERROR(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_ERROR(LOGGER, FMT, __VA_ARGS__)
+#define CFGO_LOGGER_CRITICAL(LOGGER, FMT, ...) _CFGO_LOG_LOGGER_CRITICAL(LOGGER, FMT, __VA_ARGS__)
 
 #endif
\ No newline at end of file
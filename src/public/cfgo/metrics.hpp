@@ -0,0 +1,134 @@
+#ifndef _CFGO_METRICS_HPP_
+#define _CFGO_METRICS_HPP_
+
+#include "cfgo/histogram.hpp"
+#include "cfgo/utils.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cfgo
+{
+    namespace metrics
+    {
+        namespace detail
+        {
+            class Registry;
+        } // namespace detail
+
+        /**
+         * The labels of a series, the empty ones are not exported.
+         * category is the discriminator inside a family, such as rtp or rtcp for the tracks and the element name for the appsinks.
+        */
+        struct Labels
+        {
+            std::string client;
+            std::string sub;
+            std::string track;
+            std::string category;
+        };
+
+        /**
+         * A monotonic counter, inc only touches a relaxed atomic.
+        */
+        class Counter
+        {
+        public:
+            Counter() = default;
+            Counter(const Counter &) = delete;
+            Counter & operator = (const Counter &) = delete;
+
+            void inc(std::uint64_t n = 1) noexcept
+            {
+                m_value.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] std::uint64_t value() const noexcept
+            {
+                return m_value.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> m_value {0};
+        };
+
+        /**
+         * A value which goes up and down, all the operations touch a relaxed atomic only.
+        */
+        class Gauge
+        {
+        public:
+            Gauge() = default;
+            Gauge(const Gauge &) = delete;
+            Gauge & operator = (const Gauge &) = delete;
+
+            void set(std::int64_t v) noexcept
+            {
+                m_value.store(v, std::memory_order_relaxed);
+            }
+
+            void add(std::int64_t n = 1) noexcept
+            {
+                m_value.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            void sub(std::int64_t n = 1) noexcept
+            {
+                m_value.fetch_sub(n, std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] std::int64_t value() const noexcept
+            {
+                return m_value.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::int64_t> m_value {0};
+        };
+
+        /**
+         * Exported in seconds with the power of two microsecond buckets of LatencyHistogram.
+        */
+        using Histogram = LatencyHistogram;
+
+        using CounterPtr = std::shared_ptr<Counter>;
+        using GaugePtr = std::shared_ptr<Gauge>;
+        using HistogramPtr = std::shared_ptr<Histogram>;
+
+        /**
+         * The registry only keeps weak refs of the metrics, a series disappears from the export once its owner releases it.
+         * So the objects own their metrics and the registry is only touched when they are created and when exported.
+         * The name must match [a-zA-Z_:][a-zA-Z0-9_:]*, and the same name must always be used with the same type.
+        */
+        class Registry : public ImplBy<detail::Registry>
+        {
+        public:
+            Registry();
+
+            static const Registry & instance();
+            /**
+             * Return the alive series of the same name and labels if any, otherwise create a new one.
+            */
+            [[nodiscard]] CounterPtr counter(const std::string & name, const std::string & help, const Labels & labels = {}) const;
+            [[nodiscard]] GaugePtr gauge(const std::string & name, const std::string & help, const Labels & labels = {}) const;
+            [[nodiscard]] HistogramPtr histogram(const std::string & name, const std::string & help, const Labels & labels = {}) const;
+            /**
+             * Export a histogram owned by someone else, such as the ones of TrackLatency. It replaces the series of the same labels.
+            */
+            void attach(const std::string & name, const std::string & help, const Labels & labels, const std::shared_ptr<const Histogram> & histogram) const;
+            /**
+             * Format all the alive series with the Prometheus text exposition format 0.0.4, the expired series are pruned meanwhile.
+            */
+            [[nodiscard]] std::string export_text() const;
+            void export_text(std::string & out) const;
+        };
+
+        /**
+         * Shortcut of Registry::instance().export_text().
+        */
+        [[nodiscard]] std::string export_text();
+    } // namespace metrics
+} // namespace cfgo
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef _CFGO_MPMC_CHAN_HPP_
+#define _CFGO_MPMC_CHAN_HPP_
+
+#include "cfgo/async.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <cstdint>
+
+namespace cfgo
+{
+    /**
+     * A bounded multi-producer multi-consumer channel which carries the payload itself.
+     * The data lives in a lock-free ring (Vyukov's bounded queue). The asiochan wakeup channels are only touched
+     * when some reader or writer is really parked, so the fast path of try_read/try_write never locks or allocates.
+     * The capacity is a soft limit, concurrent producers may overshoot it by at most the number of producers - 1.
+    */
+    template<typename T>
+    class MpmcChan
+    {
+    public:
+        using value_type = T;
+
+        explicit MpmcChan(std::size_t capacity):
+            m_capacity(capacity > 0 ? capacity : 1),
+            m_mask(std::bit_ceil(std::max<std::size_t>(m_capacity, 2)) - 1),
+            m_cells(std::make_unique<Cell[]>(m_mask + 1))
+        {
+            for (std::size_t i = 0; i <= m_mask; ++i)
+            {
+                m_cells[i].m_seq.store(i, std::memory_order_relaxed);
+            }
+        }
+        MpmcChan(const MpmcChan &) = delete;
+        MpmcChan & operator = (const MpmcChan &) = delete;
+
+        [[nodiscard]] std::size_t capacity() const noexcept
+        {
+            return m_capacity;
+        }
+
+        [[nodiscard]] std::size_t size_approx() const noexcept
+        {
+            auto tail = m_enqueue_pos.load(std::memory_order_acquire);
+            auto head = m_dequeue_pos.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        [[nodiscard]] bool empty_approx() const noexcept
+        {
+            return size_approx() == 0;
+        }
+
+        [[nodiscard]] bool is_closed() const noexcept
+        {
+            return m_closed.load(std::memory_order_acquire);
+        }
+
+        /**
+         * No more write is accepted. The readers drain the remaining values, then get canceled.
+        */
+        void close() noexcept
+        {
+            m_closed.store(true, std::memory_order_release);
+            chan_maybe_write(m_readable);
+            chan_maybe_write(m_writable);
+        }
+
+        /**
+         * Return false if full or closed, value is untouched in that case.
+        */
+        bool try_write(T && value)
+        {
+            if (is_closed() || !_push(value))
+            {
+                return false;
+            }
+            _notify(m_read_waiters, m_readable);
+            return true;
+        }
+
+        /**
+         * Write the value, drop the oldest one if full. Return the dropped one.
+         * Return the input value itself if closed.
+        */
+        std::optional<T> force_write(T && value)
+        {
+            std::optional<T> dropped = std::nullopt;
+            do
+            {
+                if (try_write(std::move(value)))
+                {
+                    return dropped;
+                }
+                if (is_closed())
+                {
+                    return std::optional<T>(std::move(value));
+                }
+                if (auto oldest = _pop())
+                {
+                    dropped = std::move(oldest);
+                }
+            } while (true);
+        }
+
+        std::optional<T> try_read()
+        {
+            auto value = _pop();
+            if (value)
+            {
+                _notify(m_write_waiters, m_writable);
+                // one wakeup may have been consumed by a reader which has gone, chain it to the next one.
+                if (!empty_approx())
+                {
+                    _notify(m_read_waiters, m_readable);
+                }
+            }
+            return value;
+        }
+
+        /**
+         * Wait until the value is written. Return canceled when the closer or the channel is closed.
+        */
+        auto write(T value, close_chan closer = INVALID_CLOSE_CHAN) -> asio::awaitable<cancelable<void>>
+        {
+            do
+            {
+                if (is_closed())
+                {
+                    co_return make_canceled();
+                }
+                if (try_write(std::move(value)))
+                {
+                    co_return make_resolved();
+                }
+                m_write_waiters.fetch_add(1, std::memory_order_seq_cst);
+                if (is_closed() || _writable())
+                {
+                    m_write_waiters.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+                auto res = co_await chan_read<void>(m_writable, closer);
+                m_write_waiters.fetch_sub(1, std::memory_order_relaxed);
+                if (!res)
+                {
+                    co_return make_canceled();
+                }
+            } while (true);
+        }
+
+        /**
+         * Wait for a value. Return canceled when the closer is closed, or the channel is closed and drained.
+        */
+        auto read(close_chan closer = INVALID_CLOSE_CHAN) -> asio::awaitable<cancelable<T>>
+        {
+            do
+            {
+                if (auto value = try_read())
+                {
+                    co_return make_resolved<T>(std::move(*value));
+                }
+                if (is_closed())
+                {
+                    if (auto value = try_read())
+                    {
+                        co_return make_resolved<T>(std::move(*value));
+                    }
+                    co_return make_canceled<T>();
+                }
+                if (!co_await _wait_readable(closer))
+                {
+                    co_return make_canceled<T>();
+                }
+            } while (true);
+        }
+
+        /**
+         * Wait for at least one value, then take up to n values without waiting.
+         * Return an empty vector when the closer is closed, or the channel is closed and drained.
+        */
+        auto read_n(std::size_t n, close_chan closer = INVALID_CLOSE_CHAN) -> asio::awaitable<std::vector<T>>
+        {
+            std::vector<T> values {};
+            if (n == 0)
+            {
+                co_return values;
+            }
+            auto first = co_await read(closer);
+            if (!first)
+            {
+                co_return values;
+            }
+            values.reserve(std::min(n, m_capacity));
+            values.push_back(std::move(first).value());
+            while (values.size() < n)
+            {
+                auto value = try_read();
+                if (!value)
+                {
+                    break;
+                }
+                values.push_back(std::move(*value));
+            }
+            co_return values;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<std::size_t> m_seq;
+            std::optional<T> m_data;
+        };
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        const std::size_t m_capacity;
+        const std::size_t m_mask;
+        std::unique_ptr<Cell[]> m_cells;
+        alignas(CACHE_LINE) std::atomic<std::size_t> m_enqueue_pos {0};
+        alignas(CACHE_LINE) std::atomic<std::size_t> m_dequeue_pos {0};
+        alignas(CACHE_LINE) std::atomic<std::uint32_t> m_read_waiters {0};
+        std::atomic<std::uint32_t> m_write_waiters {0};
+        std::atomic_bool m_closed {false};
+        unique_void_chan m_readable {};
+        unique_void_chan m_writable {};
+
+        bool _push(T & value)
+        {
+            auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            Cell * cell;
+            do
+            {
+                auto head = m_dequeue_pos.load(std::memory_order_acquire);
+                if (pos >= head && pos - head >= m_capacity)
+                {
+                    return false;
+                }
+                cell = &m_cells[pos & m_mask];
+                auto seq = cell->m_seq.load(std::memory_order_acquire);
+                auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (dif == 0)
+                {
+                    if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            } while (true);
+            cell->m_data.emplace(std::move(value));
+            // seq_cst pairs with _readable, so _notify needs no fence.
+            cell->m_seq.store(pos + 1, std::memory_order_seq_cst);
+            return true;
+        }
+
+        std::optional<T> _pop()
+        {
+            auto pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            Cell * cell;
+            do
+            {
+                cell = &m_cells[pos & m_mask];
+                auto seq = cell->m_seq.load(std::memory_order_acquire);
+                auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                if (dif == 0)
+                {
+                    // seq_cst pairs with the capacity check of _writable. free on x86, where the cas is a locked instruction anyway.
+                    if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    return std::nullopt;
+                }
+                else
+                {
+                    pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                }
+            } while (true);
+            std::optional<T> value(std::move(cell->m_data));
+            cell->m_data.reset();
+            cell->m_seq.store(pos + m_mask + 1, std::memory_order_seq_cst);
+            return value;
+        }
+
+        /**
+         * Called after the state is changed by a seq_cst store or cas, the waiting side registers with a seq_cst rmw, then checks the state
+         * with seq_cst loads. So either the waiter sees the new state or we see the waiter, without a full fence on every packet.
+        */
+        static void _notify(std::atomic<std::uint32_t> & waiters, unique_void_chan & ch)
+        {
+            if (waiters.load(std::memory_order_seq_cst) > 0)
+            {
+                chan_maybe_write(ch);
+            }
+        }
+
+        // the head cell is published. a cell claimed by a writer but not published yet is not readable, the writer notifies after publishing it.
+        bool _readable() const noexcept
+        {
+            auto pos = m_dequeue_pos.load(std::memory_order_seq_cst);
+            do
+            {
+                auto seq = m_cells[pos & m_mask].m_seq.load(std::memory_order_seq_cst);
+                auto dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                if (dif == 0)
+                {
+                    return true;
+                }
+                else if (dif < 0)
+                {
+                    return false;
+                }
+                // released by another reader, so the head has moved.
+                pos = m_dequeue_pos.load(std::memory_order_seq_cst);
+            } while (true);
+        }
+
+        // a write would not fail because of the capacity or a cell still taken by a reader.
+        bool _writable() const noexcept
+        {
+            auto pos = m_enqueue_pos.load(std::memory_order_seq_cst);
+            auto head = m_dequeue_pos.load(std::memory_order_seq_cst);
+            if (pos >= head && pos - head >= m_capacity)
+            {
+                return false;
+            }
+            // a smaller seq means the reader of the previous round has not released the cell, it notifies after releasing it.
+            auto seq = m_cells[pos & m_mask].m_seq.load(std::memory_order_seq_cst);
+            return static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos) >= 0;
+        }
+
+        auto _wait_readable(const close_chan & closer) -> asio::awaitable<bool>
+        {
+            m_read_waiters.fetch_add(1, std::memory_order_seq_cst);
+            if (is_closed() || _readable())
+            {
+                m_read_waiters.fetch_sub(1, std::memory_order_relaxed);
+                co_return true;
+            }
+            auto res = co_await chan_read<void>(m_readable, closer);
+            m_read_waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (is_closed())
+            {
+                // wake up the other readers too.
+                chan_maybe_write(m_readable);
+            }
+            co_return (bool) res;
+        }
+    };
+} // namespace cfgo
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef _CFGO_RTP_CAPTURE_HPP_
+#define _CFGO_RTP_CAPTURE_HPP_
+
+#include "cfgo/async.hpp"
+#include "cfgo/utils.hpp"
+#include "rtc/common.hpp"
+#include "asio/awaitable.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cfgo
+{
+    struct Track;
+
+    namespace detail
+    {
+        class RtpRecorder;
+    } // namespace detail
+
+    /**
+     * Write the rtp and rtcp packets received by the tracks to a rtpdump or pcapng file, with their arrival time.
+     * The receiving thread only copies the packet into a preallocated slot, a background thread writes the slots by batch,
+     * so recording never allocates and never touches the file on the receiving thread.
+     * The packets are dropped when all the slots are in use, and counted by the process wide metric cfgo_rtp_recorder_dropped_packets_total.
+     * Attach it with Track::set_recorder. A recorder may be shared by several tracks, their packets are then interleaved in the same file.
+    */
+    class RtpRecorder : public ImplBy<detail::RtpRecorder>
+    {
+    public:
+        enum Format
+        {
+            // the format of rtptools, the times are in milliseconds.
+            RTPDUMP,
+            // ipv4 udp packets with nanosecond times, readable by wireshark with "decode as rtp".
+            PCAPNG,
+        };
+        struct Configure
+        {
+            std::string path;
+            Format format = PCAPNG;
+            // the number of the preallocated slots.
+            std::size_t capacity = 4096;
+            // the bytes kept of each packet, the longer ones are truncated. both formats keep the original length.
+            std::size_t snaplen = 1500;
+            // the writer wakes up this often to write the queued packets.
+            duration_t flush_interval = std::chrono::milliseconds {10};
+
+            void validate() const;
+        };
+
+        RtpRecorder(std::nullptr_t);
+        /**
+         * Create the file and start the writer. throw cpptrace::runtime_error if the file can not be created.
+        */
+        explicit RtpRecorder(const Configure & conf);
+        operator bool() const noexcept;
+        /**
+         * Called by the tracks, arrival is the steady time when the packet is handed to the track.
+        */
+        void record(const rtc::binary & data, bool is_rtcp, std::chrono::steady_clock::time_point arrival) const noexcept;
+        /**
+         * Wait until the packets recorded before are written and the file is flushed.
+        */
+        void flush() const;
+        [[nodiscard]] std::uint64_t recorded() const noexcept;
+        [[nodiscard]] std::uint64_t dropped() const noexcept;
+    };
+
+    struct CapturedPacket
+    {
+        // the arrival time relative to the first packet of the capture.
+        std::chrono::nanoseconds offset;
+        rtc::binary data;
+    };
+
+    /**
+     * Load the rtp and rtcp packets of a rtpdump or pcapng file, the format is detected by its head.
+     * The pcapng files may be written by RtpRecorder or captured by wireshark, only the udp payloads which look like rtp (version 2) are kept.
+     * throw cpptrace::runtime_error if the file can not be read or is malformed.
+    */
+    std::vector<CapturedPacket> load_rtp_capture(const std::string & path);
+
+    /**
+     * Inject the packets into a track prepared by Track::prepare_injected, the same order and the same spacing as captured,
+     * scaled by 1 / speed. A speed of 0 injects them as fast as possible.
+     * Return the number of injected packets, less than packets.size() when close_ch is closed.
+    */
+    auto replay_rtp_capture(std::vector<CapturedPacket> packets, Track track, double speed = 1.0, close_chan close_ch = INVALID_CLOSE_CHAN) -> asio::awaitable<std::size_t>;
+} // namespace cfgo
+
+#endif
@@ -7,7 +7,10 @@
 #include "cfgo/alias.hpp"
 #include "cfgo/async.hpp"
 #include "cfgo/utils.hpp"
+#include "cfgo/histogram.hpp"
+#include "cfgo/rtp_capture.hpp"
 #include "rtc/track.hpp"
+#include <chrono>
 #include "asio/awaitable.hpp"
 
 namespace rtc
@@ -24,6 +27,22 @@ namespace cfgo
     } // namespace impl
     
     constexpr int DEFAULT_TRACK_CACHE_CAPICITY = 16;
+
+    /**
+     * The latency of the packets and samples of a track, recorded by cfgosrc and AppSink when the latency meta of cfgosrc is enabled.
+     * The sender times are the publisher capture times mapped by the rtcp sender reports, so they are only meaningful when both clocks are synced by ntp.
+    */
+    struct TrackLatency
+    {
+        // from the capture of the publisher to the arrival at the track.
+        LatencyHistogram sender_to_track;
+        // from the arrival at the track to the push into the pipeline.
+        LatencyHistogram track_to_push;
+        // from the push into the pipeline to the sample returned by AppSink.
+        LatencyHistogram push_to_sample;
+        // from the capture of the publisher to the sample returned by AppSink.
+        LatencyHistogram sender_to_sample;
+    };
     
     struct Track : ImplBy<impl::Track>
     {
@@ -140,6 +159,17 @@ namespace cfgo
         using Ptr = std::shared_ptr<Track>;
         using MsgPtr = std::unique_ptr<rtc::binary>;
         using MsgSharedPtr = std::shared_ptr<rtc::binary>;
+        struct TimedMsg
+        {
+            MsgPtr msg;
+            // when the packet is handed to the track by the transport.
+            std::chrono::steady_clock::time_point arrival;
+
+            explicit operator bool() const noexcept
+            {
+                return (bool) msg;
+            }
+        };
         using OnDataCb = std::function<void(const rtc::binary &, bool)>;
         using OnStatCb = std::function<void(const Statistics &)>;
         enum MsgType
@@ -168,6 +198,11 @@ namespace cfgo
         void set_on_stat(const OnStatCb & cb) const;
         void set_on_stat(OnStatCb && cb) const;
         void unset_on_stat() const noexcept;
+        /**
+         * record the received rtp and rtcp packets, see RtpRecorder.
+        */
+        void set_recorder(RtpRecorder recorder) const;
+        void unset_recorder() const noexcept;
         /**
          * wait until track open or closed. return false if close_ch is closed.
         */
@@ -180,6 +215,26 @@ namespace cfgo
          * immediately return a msg or nullptr if no msg available.
         */
         MsgPtr receive_msg(MsgType msg_type) const;
+        /**
+         * same as await_msg, but with the arrival time of the msg.
+        */
+        auto await_timed_msg(MsgType msg_type, const close_chan &  close_ch = INVALID_CLOSE_CHAN) const -> asio::awaitable<TimedMsg>;
+        /**
+         * same as receive_msg, but with the arrival time of the msg.
+        */
+        TimedMsg receive_timed_msg(MsgType msg_type) const;
+        /**
+         * drive the track without a transport, e.g. by a load generator or a replayer.
+         * the track is treated as opened, the packets come from inject_msg and close_injected closes it.
+         * only for the tracks without a rtc::Track.
+        */
+        void prepare_injected() const;
+        /**
+         * hand a rtp or rtcp packet to the track as if it was received from the transport.
+        */
+        void inject_msg(rtc::binary data) const;
+        void close_injected() const;
+        const std::shared_ptr<TrackLatency> & latency() const noexcept;
 
         std::uint64_t get_rtp_drops_bytes() const noexcept;
         std::uint32_t get_rtp_drops_packets() const noexcept;
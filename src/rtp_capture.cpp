@@ -0,0 +1,667 @@
+#include "cfgo/rtp_capture.hpp"
+#include "cfgo/track.hpp"
+#include "cfgo/metrics.hpp"
+#include "cfgo/mpmc_chan.hpp"
+#include "cpptrace/cpptrace.hpp"
+#include "asio/steady_timer.hpp"
+#include "asio/use_awaitable.hpp"
+#include "asio/this_coro.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace cfgo
+{
+    namespace detail
+    {
+        // the ipv4 and udp headers put before the packets in the pcapng files.
+        constexpr std::size_t PCAPNG_IP_UDP_SIZE = 28;
+        constexpr std::uint16_t CAPTURE_RTP_PORT = 5004;
+        constexpr std::uint16_t CAPTURE_RTCP_PORT = 5005;
+        constexpr std::uint32_t CAPTURE_ADDRESS = 0x7F000001;
+
+        static void put_be16(std::byte * p, std::uint16_t v) noexcept
+        {
+            p[0] = static_cast<std::byte>(v >> 8);
+            p[1] = static_cast<std::byte>(v);
+        }
+
+        static void put_be32(std::byte * p, std::uint32_t v) noexcept
+        {
+            put_be16(p, static_cast<std::uint16_t>(v >> 16));
+            put_be16(p + 2, static_cast<std::uint16_t>(v));
+        }
+
+        class RtpRecorder
+        {
+        public:
+            using Configure = cfgo::RtpRecorder::Configure;
+
+            explicit RtpRecorder(const Configure & conf);
+            ~RtpRecorder();
+            RtpRecorder(const RtpRecorder &) = delete;
+            RtpRecorder & operator = (const RtpRecorder &) = delete;
+
+            void record(const rtc::binary & data, bool is_rtcp, std::chrono::steady_clock::time_point arrival) noexcept;
+            void flush();
+            std::uint64_t recorded() const noexcept
+            {
+                return m_recorded.load(std::memory_order_acquire);
+            }
+            std::uint64_t dropped() const noexcept
+            {
+                return m_dropped.load(std::memory_order_relaxed);
+            }
+        private:
+            struct Slot
+            {
+                std::chrono::steady_clock::time_point m_arrival;
+                std::uint32_t m_size = 0;
+                std::uint32_t m_orig_size = 0;
+                bool m_is_rtcp = false;
+                std::byte * m_data = nullptr;
+            };
+
+            const Configure m_conf;
+            std::unique_ptr<Slot[]> m_slots;
+            std::unique_ptr<std::byte[]> m_buffer;
+            MpmcChan<Slot *> m_free;
+            MpmcChan<Slot *> m_filled;
+            metrics::CounterPtr m_dropped_metric;
+            std::atomic_uint64_t m_dropped {0};
+            std::atomic_uint64_t m_recorded {0};
+            // the steady and system times of the same instant, to map the arrivals to the wall clock.
+            std::chrono::steady_clock::time_point m_steady_start;
+            std::chrono::system_clock::time_point m_system_start;
+            std::FILE * m_file = nullptr;
+            std::mutex m_mutex;
+            std::condition_variable m_wake_cv;
+            std::condition_variable m_written_cv;
+            bool m_urgent = false;
+            bool m_stop = false;
+            std::uint64_t m_written = 0;
+            std::thread m_thread;
+
+            void _run();
+            void _write_file_head();
+            void _write_packet(const Slot & slot);
+            void _write(const void * data, std::size_t size) noexcept
+            {
+                std::fwrite(data, 1, size, m_file);
+            }
+            std::int64_t _system_ns(std::chrono::steady_clock::time_point time) const noexcept
+            {
+                auto system_time = m_system_start + std::chrono::duration_cast<std::chrono::system_clock::duration>(time - m_steady_start);
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(system_time.time_since_epoch()).count();
+            }
+        };
+
+        RtpRecorder::RtpRecorder(const Configure & conf):
+            m_conf(conf),
+            m_free(conf.capacity),
+            m_filled(conf.capacity),
+            m_dropped_metric(metrics::Registry::instance().counter("cfgo_rtp_recorder_dropped_packets_total", "The packets not recorded because all the slots of the rtp recorder are in use.")),
+            m_steady_start(std::chrono::steady_clock::now()),
+            m_system_start(std::chrono::system_clock::now())
+        {
+            m_conf.validate();
+            m_slots = std::make_unique<Slot[]>(m_conf.capacity);
+            m_buffer = std::make_unique<std::byte[]>(m_conf.capacity * m_conf.snaplen);
+            for (std::size_t i = 0; i < m_conf.capacity; ++i)
+            {
+                m_slots[i].m_data = m_buffer.get() + i * m_conf.snaplen;
+                m_free.try_write(&m_slots[i]);
+            }
+            m_file = std::fopen(m_conf.path.c_str(), "wb");
+            if (!m_file)
+            {
+                throw cpptrace::runtime_error("Unable to create the capture file " + m_conf.path + ".");
+            }
+            // the writer flushes once per batch, so the buffer bounds the syscalls, not the packets.
+            std::setvbuf(m_file, nullptr, _IOFBF, 256 * 1024);
+            _write_file_head();
+            m_thread = std::thread([this]() {
+                _run();
+            });
+        }
+
+        RtpRecorder::~RtpRecorder()
+        {
+            {
+                std::lock_guard g(m_mutex);
+                m_stop = true;
+            }
+            m_wake_cv.notify_one();
+            if (m_thread.joinable())
+            {
+                m_thread.join();
+            }
+            if (m_file)
+            {
+                std::fclose(m_file);
+            }
+        }
+
+        void RtpRecorder::record(const rtc::binary & data, bool is_rtcp, std::chrono::steady_clock::time_point arrival) noexcept
+        {
+            auto slot = m_free.try_read();
+            if (!slot)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_dropped_metric->inc();
+                return;
+            }
+            auto s = *slot;
+            s->m_arrival = arrival;
+            s->m_is_rtcp = is_rtcp;
+            s->m_orig_size = static_cast<std::uint32_t>(data.size());
+            s->m_size = static_cast<std::uint32_t>(std::min(data.size(), m_conf.snaplen));
+            std::memcpy(s->m_data, data.data(), s->m_size);
+            // never fails, there are only capacity slots.
+            m_filled.try_write(std::move(s));
+            m_recorded.fetch_add(1, std::memory_order_release);
+        }
+
+        void RtpRecorder::flush()
+        {
+            auto target = recorded();
+            std::unique_lock lk(m_mutex);
+            m_urgent = true;
+            m_wake_cv.notify_one();
+            m_written_cv.wait(lk, [this, target]() {
+                return m_written >= target || m_stop;
+            });
+        }
+
+        void RtpRecorder::_run()
+        {
+            bool stopping = false;
+            do
+            {
+                std::uint64_t n = 0;
+                while (auto slot = m_filled.try_read())
+                {
+                    _write_packet(**slot);
+                    m_free.try_write(std::move(*slot));
+                    ++n;
+                }
+                std::fflush(m_file);
+                std::unique_lock lk(m_mutex);
+                m_written += n;
+                m_written_cv.notify_all();
+                if (stopping)
+                {
+                    break;
+                }
+                m_wake_cv.wait_for(lk, m_conf.flush_interval, [this]() {
+                    return m_urgent || m_stop;
+                });
+                m_urgent = false;
+                // one more round to drain the packets recorded before the stop.
+                stopping = m_stop;
+            } while (true);
+        }
+
+        void RtpRecorder::_write_file_head()
+        {
+            if (m_conf.format == cfgo::RtpRecorder::RTPDUMP)
+            {
+                const char line[] = "#!rtpplay1.0 127.0.0.1/5004\n";
+                _write(line, sizeof(line) - 1);
+                auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(m_system_start.time_since_epoch()).count();
+                std::byte head[16] {};
+                put_be32(head, static_cast<std::uint32_t>(since_epoch / 1000000));
+                put_be32(head + 4, static_cast<std::uint32_t>(since_epoch % 1000000));
+                put_be32(head + 8, CAPTURE_ADDRESS);
+                put_be16(head + 12, CAPTURE_RTP_PORT);
+                _write(head, sizeof(head));
+            }
+            else
+            {
+                // the pcapng blocks are in the native byte order, told by the byte order magic.
+                const std::uint32_t shb[7] {0x0A0D0D0A, 28, 0x1A2B3C4D, 0x00000001, 0xFFFFFFFF, 0xFFFFFFFF, 28};
+                _write(shb, sizeof(shb));
+                // linktype ipv4, if_tsresol = 9 (nanoseconds), opt_endofopt.
+                std::uint32_t idb[8] {1, 32, 228, static_cast<std::uint32_t>(m_conf.snaplen + PCAPNG_IP_UDP_SIZE), 0x00010009, 0x00000009, 0, 32};
+                _write(idb, sizeof(idb));
+            }
+        }
+
+        void RtpRecorder::_write_packet(const Slot & slot)
+        {
+            if (m_conf.format == cfgo::RtpRecorder::RTPDUMP)
+            {
+                auto offset = std::chrono::duration_cast<std::chrono::milliseconds>(slot.m_arrival - m_steady_start).count();
+                std::byte head[8];
+                put_be16(head, static_cast<std::uint16_t>(8 + slot.m_size));
+                // rtptools marks the rtcp packets by a zero plen.
+                put_be16(head + 2, slot.m_is_rtcp ? 0 : static_cast<std::uint16_t>(std::min<std::uint32_t>(slot.m_orig_size, 0xFFFF)));
+                put_be32(head + 4, static_cast<std::uint32_t>(std::max<std::int64_t>(offset, 0)));
+                _write(head, sizeof(head));
+                _write(slot.m_data, slot.m_size);
+                return;
+            }
+            auto captured = static_cast<std::uint32_t>(PCAPNG_IP_UDP_SIZE + slot.m_size);
+            auto original = static_cast<std::uint32_t>(PCAPNG_IP_UDP_SIZE + slot.m_orig_size);
+            auto padding = (4 - captured % 4) % 4;
+            auto ts = static_cast<std::uint64_t>(_system_ns(slot.m_arrival));
+            std::uint32_t epb[7] {6, 32 + captured + padding, 0, static_cast<std::uint32_t>(ts >> 32), static_cast<std::uint32_t>(ts), captured, original};
+            _write(epb, sizeof(epb));
+            std::byte ip_udp[PCAPNG_IP_UDP_SIZE] {};
+            auto ip_size = static_cast<std::uint16_t>(std::min<std::uint32_t>(original, 0xFFFF));
+            ip_udp[0] = std::byte {0x45};
+            put_be16(ip_udp + 2, ip_size);
+            put_be16(ip_udp + 6, 0x4000);
+            ip_udp[8] = std::byte {64};
+            ip_udp[9] = std::byte {17};
+            put_be32(ip_udp + 12, CAPTURE_ADDRESS);
+            put_be32(ip_udp + 16, CAPTURE_ADDRESS);
+            std::uint32_t sum = 0;
+            for (std::size_t i = 0; i < 20; i += 2)
+            {
+                sum += (std::to_integer<std::uint32_t>(ip_udp[i]) << 8) | std::to_integer<std::uint32_t>(ip_udp[i + 1]);
+            }
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            sum = (sum & 0xFFFF) + (sum >> 16);
+            put_be16(ip_udp + 10, static_cast<std::uint16_t>(~sum));
+            auto port = slot.m_is_rtcp ? CAPTURE_RTCP_PORT : CAPTURE_RTP_PORT;
+            put_be16(ip_udp + 20, port);
+            put_be16(ip_udp + 22, port);
+            put_be16(ip_udp + 24, static_cast<std::uint16_t>(ip_size - 20));
+            _write(ip_udp, sizeof(ip_udp));
+            _write(slot.m_data, slot.m_size);
+            const std::uint32_t zero = 0;
+            _write(&zero, padding);
+            auto total = epb[1];
+            _write(&total, sizeof(total));
+        }
+
+        /**
+         * A bounds checked reader of the capture files.
+        */
+        class CaptureReader
+        {
+        public:
+            CaptureReader(const std::string & path, const std::vector<std::byte> & data): m_path(path), m_data(data) {}
+
+            std::size_t pos() const noexcept
+            {
+                return m_pos;
+            }
+            bool eof() const noexcept
+            {
+                return m_pos >= m_data.size();
+            }
+            void seek(std::size_t pos)
+            {
+                if (pos > m_data.size())
+                {
+                    _malformed();
+                }
+                m_pos = pos;
+            }
+            const std::byte * take(std::size_t n)
+            {
+                if (n > m_data.size() - m_pos)
+                {
+                    _malformed();
+                }
+                auto p = m_data.data() + m_pos;
+                m_pos += n;
+                return p;
+            }
+            std::uint16_t be16()
+            {
+                auto p = take(2);
+                return static_cast<std::uint16_t>((std::to_integer<std::uint16_t>(p[0]) << 8) | std::to_integer<std::uint16_t>(p[1]));
+            }
+            std::uint32_t be32()
+            {
+                std::uint32_t high = be16();
+                return (high << 16) | be16();
+            }
+            std::uint32_t u32(bool swap)
+            {
+                std::uint32_t v;
+                std::memcpy(&v, take(4), 4);
+                return swap ? _swap32(v) : v;
+            }
+            std::uint16_t u16(bool swap)
+            {
+                std::uint16_t v;
+                std::memcpy(&v, take(2), 2);
+                return swap ? static_cast<std::uint16_t>((v >> 8) | (v << 8)) : v;
+            }
+            [[noreturn]] void _malformed() const
+            {
+                throw cpptrace::runtime_error("The capture file " + m_path + " is malformed.");
+            }
+        private:
+            const std::string & m_path;
+            const std::vector<std::byte> & m_data;
+            std::size_t m_pos = 0;
+
+            static std::uint32_t _swap32(std::uint32_t v) noexcept
+            {
+                return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+            }
+        };
+
+        static void load_rtpdump(CaptureReader & reader, std::vector<CapturedPacket> & packets)
+        {
+            while (!reader.eof() && *reader.take(1) != std::byte {'\n'}) {}
+            reader.take(16);
+            while (!reader.eof())
+            {
+                auto length = reader.be16();
+                reader.be16();
+                auto offset = reader.be32();
+                if (length < 8)
+                {
+                    reader._malformed();
+                }
+                auto data = reader.take(length - 8);
+                packets.push_back(CapturedPacket {
+                    .offset = std::chrono::milliseconds {offset},
+                    .data = rtc::binary(data, data + length - 8),
+                });
+            }
+        }
+
+        // strip the link, ip and udp headers. return nullptr if it is not an udp packet.
+        static const std::byte * udp_payload(std::uint16_t linktype, const std::byte * p, std::size_t size, std::size_t & payload_size)
+        {
+            auto be16 = [p](std::size_t pos) {
+                return (std::to_integer<std::uint16_t>(p[pos]) << 8) | std::to_integer<std::uint16_t>(p[pos + 1]);
+            };
+            std::size_t pos = 0;
+            if (linktype == 1)
+            {
+                // ethernet, maybe with a vlan tag.
+                pos = 14;
+                if (size >= 18 && be16(12) == 0x8100)
+                {
+                    pos = 18;
+                }
+            }
+            else if (linktype == 113)
+            {
+                // linux cooked capture.
+                pos = 16;
+            }
+            else if (linktype != 101 && linktype != 228 && linktype != 229)
+            {
+                return nullptr;
+            }
+            if (size < pos + 1)
+            {
+                return nullptr;
+            }
+            auto version = std::to_integer<std::uint8_t>(p[pos]) >> 4;
+            if (version == 4)
+            {
+                std::size_t ihl = (std::to_integer<std::uint8_t>(p[pos]) & 0x0F) * 4;
+                if (size < pos + ihl + 8 || std::to_integer<std::uint8_t>(p[pos + 9]) != 17)
+                {
+                    return nullptr;
+                }
+                pos += ihl;
+            }
+            else if (version == 6)
+            {
+                if (size < pos + 48 || std::to_integer<std::uint8_t>(p[pos + 6]) != 17)
+                {
+                    return nullptr;
+                }
+                pos += 40;
+            }
+            else
+            {
+                return nullptr;
+            }
+            pos += 8;
+            payload_size = size - pos;
+            return p + pos;
+        }
+
+        static void load_pcapng(CaptureReader & reader, std::vector<CapturedPacket> & packets)
+        {
+            struct Interface
+            {
+                std::uint16_t linktype;
+                // microseconds by default.
+                std::uint64_t ticks_per_second;
+            };
+            std::vector<Interface> interfaces {};
+            bool swap = false;
+            while (!reader.eof())
+            {
+                auto start = reader.pos();
+                auto head = reader.take(8);
+                std::uint32_t type;
+                std::memcpy(&type, head, 4);
+                if (type == 0x0A0D0D0A)
+                {
+                    // a new section, with its own byte order and interfaces.
+                    std::uint32_t magic;
+                    std::memcpy(&magic, reader.take(4), 4);
+                    if (magic != 0x1A2B3C4D && magic != 0x4D3C2B1A)
+                    {
+                        reader._malformed();
+                    }
+                    swap = magic != 0x1A2B3C4D;
+                    interfaces.clear();
+                }
+                else
+                {
+                    type = swap ? ((type >> 24) | ((type >> 8) & 0xFF00) | ((type << 8) & 0xFF0000) | (type << 24)) : type;
+                }
+                reader.seek(start + 4);
+                auto length = reader.u32(swap);
+                if (length < 12 || length % 4 != 0)
+                {
+                    reader._malformed();
+                }
+                if (type == 1)
+                {
+                    Interface iface {reader.u16(swap), 1000000};
+                    reader.u16(swap);
+                    reader.u32(swap);
+                    // the options up to the trailing length.
+                    while (reader.pos() + 4 <= start + length - 4)
+                    {
+                        auto code = reader.u16(swap);
+                        auto size = reader.u16(swap);
+                        auto value = reader.take((size + 3) / 4 * 4);
+                        if (code == 0)
+                        {
+                            break;
+                        }
+                        if (code == 9 && size >= 1)
+                        {
+                            auto resol = std::to_integer<std::uint8_t>(value[0]);
+                            auto exp = resol & 0x7F;
+                            iface.ticks_per_second = 1;
+                            for (int e = 0; e < exp && e < 63; ++e)
+                            {
+                                iface.ticks_per_second *= (resol & 0x80) ? 2 : 10;
+                            }
+                        }
+                    }
+                    interfaces.push_back(iface);
+                }
+                else if (type == 6)
+                {
+                    auto id = reader.u32(swap);
+                    std::uint64_t ts = reader.u32(swap);
+                    ts = (ts << 32) | reader.u32(swap);
+                    auto captured = reader.u32(swap);
+                    reader.u32(swap);
+                    auto data = reader.take(captured);
+                    if (id >= interfaces.size())
+                    {
+                        reader._malformed();
+                    }
+                    std::size_t size = 0;
+                    auto payload = udp_payload(interfaces[id].linktype, data, captured, size);
+                    // only the rtp version 2 packets, the stun and dtls ones of webrtc are skipped.
+                    if (payload && size >= 4 && (std::to_integer<std::uint8_t>(payload[0]) & 0xC0) == 0x80)
+                    {
+                        auto tps = interfaces[id].ticks_per_second;
+                        // split the ticks to keep the nanoseconds of the times since the epoch exact.
+                        auto ns = ts / tps * 1000000000 + static_cast<std::uint64_t>(static_cast<long double>(ts % tps) * 1e9L / tps);
+                        packets.push_back(CapturedPacket {
+                            .offset = std::chrono::nanoseconds {static_cast<std::int64_t>(ns)},
+                            .data = rtc::binary(payload, payload + size),
+                        });
+                    }
+                }
+                reader.seek(start + length);
+            }
+        }
+    } // namespace detail
+
+    void RtpRecorder::Configure::validate() const
+    {
+        if (path.empty())
+        {
+            throw cpptrace::runtime_error("Invalid path. The path must not be empty.");
+        }
+        if (capacity < 1)
+        {
+            throw cpptrace::runtime_error("Invalid capacity. The capacity must be greater or equal than 1.");
+        }
+        // the packet length of rtpdump is 16 bits, including its 8 bytes header.
+        if (snaplen < 12 || snaplen > 0xFFFF - 8 - detail::PCAPNG_IP_UDP_SIZE)
+        {
+            throw cpptrace::runtime_error("Invalid snaplen. The snaplen must be in [12, 65499].");
+        }
+        if (flush_interval <= duration_t::zero())
+        {
+            throw cpptrace::runtime_error("Invalid flush_interval. The flush_interval must be greater than 0.");
+        }
+    }
+
+    RtpRecorder::RtpRecorder(std::nullptr_t): ImplBy(std::shared_ptr<detail::RtpRecorder>()) {}
+
+    RtpRecorder::RtpRecorder(const Configure & conf): ImplBy(conf) {}
+
+    RtpRecorder::operator bool() const noexcept
+    {
+        return (bool) impl();
+    }
+
+    void RtpRecorder::record(const rtc::binary & data, bool is_rtcp, std::chrono::steady_clock::time_point arrival) const noexcept
+    {
+        impl()->record(data, is_rtcp, arrival);
+    }
+
+    void RtpRecorder::flush() const
+    {
+        impl()->flush();
+    }
+
+    std::uint64_t RtpRecorder::recorded() const noexcept
+    {
+        return impl()->recorded();
+    }
+
+    std::uint64_t RtpRecorder::dropped() const noexcept
+    {
+        return impl()->dropped();
+    }
+
+    std::vector<CapturedPacket> load_rtp_capture(const std::string & path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw cpptrace::runtime_error("Unable to open the capture file " + path + ".");
+        }
+        std::vector<char> chars {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        std::vector<std::byte> data(chars.size());
+        std::memcpy(data.data(), chars.data(), chars.size());
+        detail::CaptureReader reader(path, data);
+        std::vector<CapturedPacket> packets {};
+        if (data.size() >= 9 && std::memcmp(data.data(), "#!rtpplay", 9) == 0)
+        {
+            detail::load_rtpdump(reader, packets);
+        }
+        else if (data.size() >= 4 && std::memcmp(data.data(), "\x0A\x0D\x0D\x0A", 4) == 0)
+        {
+            detail::load_pcapng(reader, packets);
+        }
+        else
+        {
+            throw cpptrace::runtime_error("The capture file " + path + " is neither a rtpdump file nor a pcapng file.");
+        }
+        // the wireshark captures are not sorted across the interfaces.
+        std::stable_sort(packets.begin(), packets.end(), [](const CapturedPacket & a, const CapturedPacket & b) {
+            return a.offset < b.offset;
+        });
+        if (!packets.empty())
+        {
+            auto first = packets.front().offset;
+            for (auto & packet : packets)
+            {
+                packet.offset -= first;
+            }
+        }
+        return packets;
+    }
+
+    auto replay_rtp_capture(std::vector<CapturedPacket> packets, Track track, double speed, close_chan close_ch) -> asio::awaitable<std::size_t>
+    {
+        auto executor = co_await asio::this_coro::executor;
+        asio::steady_timer timer {executor};
+        auto start = std::chrono::steady_clock::now();
+        std::size_t injected = 0;
+        for (auto & packet : packets)
+        {
+            if (is_valid_close_chan(close_ch) && close_ch.is_closed())
+            {
+                break;
+            }
+            if (speed > 0)
+            {
+                auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(packet.offset / speed);
+                auto now = std::chrono::steady_clock::now();
+                if (due > now)
+                {
+                    if (is_valid_close_chan(close_ch))
+                    {
+                        bool canceled = false;
+                        try
+                        {
+                            co_await wait_timeout(due - now, close_ch);
+                        }
+                        catch (const CancelError &)
+                        {
+                            canceled = true;
+                        }
+                        if (canceled)
+                        {
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        timer.expires_at(due);
+                        co_await timer.async_wait(asio::use_awaitable);
+                    }
+                }
+            }
+            track.inject_msg(std::move(packet.data));
+            ++injected;
+        }
+        co_return injected;
+    }
+} // namespace cfgo
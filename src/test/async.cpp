@@ -1,13 +1,26 @@
 #include "cfgo/async.hpp"
 #include "cfgo/async_locker.hpp"
+#include "cfgo/async_task_group.hpp"
+#include "cfgo/mpmc_chan.hpp"
+#include "cfgo/metrics.hpp"
+#include "cfgo/async_log.hpp"
+#include "cfgo/event_trace.hpp"
 #include "cfgo/defer.hpp"
 #include "cfgo/log.hpp"
+#include "cfgo/track.hpp"
+#include "cfgo/rtp_capture.hpp"
 #include "asio.hpp"
 #include "gtest/gtest.h"
+#include "sio_message.h"
+#include "spdlog/sinks/ostream_sink.h"
 #include <chrono>
 #include <thread>
 #include <random>
+#include <atomic>
 #include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <future>
 
 void do_async(std::function<asio::awaitable<void>()> func, bool wait = false, std::shared_ptr<asio::thread_pool> tp_ptr = nullptr) {
     auto tp = tp_ptr ? tp_ptr : std::make_shared<asio::thread_pool>();
@@ -590,6 +603,29 @@ TEST(Closer, ParentAndChildrenCloseTogether) {
     std::this_thread::sleep_for(std::chrono::milliseconds {1000});
 }
 
+TEST(CancelError, TraceSampling) {
+    using namespace cfgo;
+    auto sampling = get_cancel_trace_sampling();
+    DEFER({
+        set_cancel_trace_sampling(sampling);
+    });
+    set_cancel_trace_sampling(0);
+    for (size_t i = 0; i < 100; i++)
+    {
+        EXPECT_FALSE(sample_cancel_trace());
+    }
+    EXPECT_STREQ(CancelError("canceled").what(), "canceled");
+    set_cancel_trace_sampling(4);
+    int sampled = 0;
+    for (size_t i = 0; i < 100; i++)
+    {
+        sampled += sample_cancel_trace() ? 1 : 0;
+    }
+    EXPECT_EQ(sampled, 25);
+    set_cancel_trace_sampling(1);
+    EXPECT_STRNE(CancelError("canceled").what(), "canceled");
+}
+
 TEST(AsyncBlocker, CheckDeadLock) {
     using namespace cfgo;
     AsyncBlockerManager::Configure conf {
@@ -686,6 +722,547 @@ TEST(AsyncBlocker, CheckBlockedNum) {
     }), true, m_pool);
 }
 
+TEST(AsyncBlocker, FlushByDeadline) {
+    using namespace cfgo;
+    AsyncBlockerManager::Configure conf {
+        .block_timeout = std::chrono::milliseconds {1000},
+        .target_batch = 8,
+        .min_batch = 1,
+        .max_queue_delay = std::chrono::milliseconds {20},
+    };
+    AsyncBlockerManager manager {conf};
+    close_chan closer {};
+    auto m_pool = std::make_shared<asio::thread_pool>();
+    for (size_t i = 0; i < 8; i++)
+    {
+        // half of the blockers are too slow to fill the batch before the deadline.
+        asio::co_spawn(m_pool->get_executor(), fix_async_lambda([i, manager, closer]() -> asio::awaitable<void> {
+            auto blocker = co_await manager.add_blocker(0, closer);
+            DEFER({
+                manager.remove_blocker(blocker.id());
+            });
+            try
+            {
+                do
+                {
+                    co_await wait_timeout(std::chrono::milliseconds {i % 2 == 0 ? 5 : 300}, closer);
+                    co_await manager.wait_blocker(blocker.id());
+                } while (true);
+            }
+            catch(const CancelError& e) {}
+        }), asio::detached);
+    }
+    do_async(fix_async_lambda([manager, closer]() -> asio::awaitable<void> {
+        std::vector<AsyncBlocker> blockers {};
+        for (size_t i = 0; i < 20; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            co_await manager.lock(closer);
+            DEFER({
+                manager.unlock();
+            });
+            auto cost = std::chrono::steady_clock::now() - start;
+            EXPECT_LT(cost, std::chrono::milliseconds {200});
+            manager.collect_locked_blocker(blockers);
+            EXPECT_LE(blockers.size(), 8);
+        }
+        closer.close();
+    }), true, m_pool);
+    auto stats = manager.statistics();
+    EXPECT_GT(stats.flushed_by_deadline, 0);
+    EXPECT_EQ(stats.flushed_by_timeout, 0);
+    EXPECT_EQ(stats.queue_delays.size(), stats.queue_delay_bounds.size() + 1);
+}
+
+// the blocker parks until requested, then blocks at once.
+static void park_blocker(asio::thread_pool & pool, cfgo::AsyncBlockerManager manager, cfgo::AsyncBlocker blocker, cfgo::close_chan closer)
+{
+    asio::co_spawn(pool.get_executor(), cfgo::fix_async_lambda([manager, blocker, closer]() -> asio::awaitable<void> {
+        try
+        {
+            do
+            {
+                co_await manager.wait_block_request(blocker.id(), closer);
+            } while (true);
+        }
+        catch(const cfgo::CancelError& e) {}
+    }), asio::detached);
+}
+
+TEST(AsyncBlocker, HigherPriorityWinsTheBatch) {
+    using namespace cfgo;
+    AsyncBlockerManager::Configure conf {
+        .block_timeout = std::chrono::milliseconds {1000},
+        .target_batch = 1,
+        .min_batch = 1,
+    };
+    AsyncBlockerManager manager {conf};
+    close_chan closer {};
+    auto m_pool = std::make_shared<asio::thread_pool>(4);
+    do_async(fix_async_lambda([m_pool, manager, closer]() -> asio::awaitable<void> {
+        // a batch of one requests two blockers, both of the higher priority.
+        for (int priority : {0, 5, 0, 5, 0})
+        {
+            auto blocker = co_await manager.add_blocker(priority, closer);
+            blocker.set_user_data((std::int64_t) priority);
+            park_blocker(*m_pool, manager, blocker, closer);
+        }
+        std::vector<AsyncBlocker> blockers {};
+        for (size_t i = 0; i < 20; i++)
+        {
+            co_await manager.lock(closer);
+            DEFER({
+                manager.unlock();
+            });
+            manager.collect_locked_blocker(blockers);
+            EXPECT_EQ(blockers.size(), 1);
+            for (auto && blocker : blockers)
+            {
+                EXPECT_EQ(blocker.get_integer_user_data(), 5);
+            }
+        }
+        closer.close();
+    }), true, m_pool);
+}
+
+TEST(AsyncBlocker, RotateWithinPriority) {
+    using namespace cfgo;
+    AsyncBlockerManager::Configure conf {
+        .block_timeout = std::chrono::milliseconds {1000},
+        .target_batch = 1,
+        .min_batch = 1,
+    };
+    AsyncBlockerManager manager {conf};
+    close_chan closer {};
+    auto m_pool = std::make_shared<asio::thread_pool>(4);
+    do_async(fix_async_lambda([m_pool, manager, closer]() -> asio::awaitable<void> {
+        // least recently served first.
+        std::vector<std::int64_t> order {};
+        for (std::int64_t i = 0; i < 4; i++)
+        {
+            auto blocker = co_await manager.add_blocker(0, closer);
+            blocker.set_user_data(i);
+            park_blocker(*m_pool, manager, blocker, closer);
+            order.push_back(i);
+        }
+        std::vector<AsyncBlocker> blockers {};
+        for (size_t i = 0; i < 40; i++)
+        {
+            co_await manager.lock(closer);
+            DEFER({
+                manager.unlock();
+            });
+            manager.collect_locked_blocker(blockers);
+            EXPECT_EQ(blockers.size(), 1);
+            if (blockers.size() == 1)
+            {
+                // a batch of one only requests the two least recently served blockers.
+                auto served = blockers[0].get_integer_user_data();
+                auto iter = std::find(order.begin(), order.end(), served);
+                EXPECT_LT(iter - order.begin(), 2) << "lock " << i << ", served " << served;
+                order.erase(iter);
+                order.push_back(served);
+            }
+        }
+        closer.close();
+    }), true, m_pool);
+}
+
+TEST(AsyncBlocker, ReleaseSurplusBlockers) {
+    using namespace cfgo;
+    AsyncBlockerManager::Configure conf {
+        .block_timeout = std::chrono::milliseconds {1000},
+        .target_batch = 2,
+        .min_batch = 1,
+    };
+    AsyncBlockerManager manager {conf};
+    close_chan closer {};
+    auto m_pool = std::make_shared<asio::thread_pool>(4);
+    do_async(fix_async_lambda([m_pool, manager, closer]() -> asio::awaitable<void> {
+        for (size_t i = 0; i < 6; i++)
+        {
+            auto blocker = co_await manager.add_blocker(0, closer);
+            park_blocker(*m_pool, manager, blocker, closer);
+        }
+        std::vector<AsyncBlocker> blockers {};
+        for (size_t i = 0; i < 100; i++)
+        {
+            co_await manager.lock(closer);
+            DEFER({
+                manager.unlock();
+            });
+            // four are requested and all of them block at once, the ones beyond the batch must be released before lock returns.
+            manager.collect_locked_blocker(blockers);
+            EXPECT_EQ(blockers.size(), 2) << "lock " << i;
+        }
+        closer.close();
+    }), true, m_pool);
+    auto stats = manager.statistics();
+    EXPECT_EQ(stats.flushed_by_batch, 100);
+    std::uint64_t surplus = 0;
+    for (std::size_t n = 3; n < stats.batch_sizes.size(); n++)
+    {
+        surplus += stats.batch_sizes[n];
+    }
+    // how often the surplus path ran, it depends on the timing.
+    RecordProperty("surplus_flushes", std::to_string(surplus));
+}
+
+TEST(AsyncTaskGroup, LimitInFlight) {
+    using namespace cfgo;
+    auto pool = std::make_shared<asio::thread_pool>(4);
+    AsyncTaskGroup::Configure conf {
+        .max_in_flight = 3,
+        .lanes = 2,
+        .executors = { pool->get_executor(), pool->get_executor() },
+    };
+    AsyncTaskGroup group {conf};
+    auto running = std::make_shared<std::atomic_int>(0);
+    auto max_running = std::make_shared<std::atomic_int>(0);
+    for (size_t i = 0; i < 100; i++)
+    {
+        group.add_task(fix_async_lambda([running, max_running](close_chan closer) -> asio::awaitable<void> {
+            auto n = ++(*running);
+            int m = *max_running;
+            while (n > m && !max_running->compare_exchange_weak(m, n)) {}
+            co_await wait_timeout(std::chrono::milliseconds {5}, closer);
+            --(*running);
+        }), i % 2);
+    }
+    do_async(fix_async_lambda([group]() -> asio::awaitable<void> {
+        co_await group.await();
+    }), true, pool);
+    auto stats = group.stats();
+    EXPECT_LE(max_running->load(), 3);
+    EXPECT_EQ(stats.completed, 100);
+    EXPECT_EQ(stats.queued, 0);
+    EXPECT_EQ(stats.running, 0);
+    EXPECT_GE(stats.p99_run_time, std::chrono::milliseconds {5});
+}
+
+TEST(AsyncTaskGroup, PriorityOrder) {
+    using namespace cfgo;
+    auto pool = std::make_shared<asio::thread_pool>(1);
+    AsyncTaskGroup::Configure conf {
+        .max_in_flight = 1,
+        .lanes = 3,
+    };
+    AsyncTaskGroup group {conf};
+    auto order = std::make_shared<std::vector<int>>();
+    for (int i = 0; i < 9; i++)
+    {
+        // the priorities 0, 1, 2, 0, 1, 2, ...
+        group.add_task(fix_async_lambda([order, i](close_chan closer) -> asio::awaitable<void> {
+            order->push_back(i);
+            co_return;
+        }), i % 3);
+    }
+    do_async(fix_async_lambda([group]() -> asio::awaitable<void> {
+        co_await group.await();
+    }), true, pool);
+    // the most urgent lane first, fifo in the same lane.
+    std::vector<int> expected {2, 5, 8, 1, 4, 7, 0, 3, 6};
+    EXPECT_EQ(*order, expected);
+    EXPECT_EQ(group.stats().stolen, 0U);
+}
+
+TEST(AsyncTaskGroup, StealFromBusyWorker) {
+    using namespace cfgo;
+    auto fast_pool = std::make_shared<asio::thread_pool>(1);
+    auto slow_pool = std::make_shared<asio::thread_pool>(1);
+    auto slow_executor = slow_pool->get_executor();
+    AsyncTaskGroup::Configure conf {
+        .max_in_flight = 2,
+        .executors = { fast_pool->get_executor(), slow_pool->get_executor() },
+    };
+    AsyncTaskGroup group {conf};
+    auto on_fast = std::make_shared<std::atomic_int>(0);
+    close_chan release {};
+    for (size_t i = 0; i < 10; i++)
+    {
+        // half of the tasks are queued to each worker, the one run by the slow worker blocks until the fast worker has run all the others.
+        group.add_task(fix_async_lambda([on_fast, slow_executor, release](close_chan closer) -> asio::awaitable<void> {
+            auto executor = co_await asio::this_coro::executor;
+            if (executor == asio::any_io_executor(slow_executor))
+            {
+                co_await release.await();
+            }
+            else if (++(*on_fast) == 9)
+            {
+                release.close_no_except();
+            }
+        }));
+    }
+    do_async(fix_async_lambda([group]() -> asio::awaitable<void> {
+        co_await group.await();
+    }), true, fast_pool);
+    auto stats = group.stats();
+    EXPECT_EQ(stats.completed, 10);
+    // the fast worker runs its own 5 tasks, then steals the 4 still queued on the slow worker.
+    EXPECT_EQ(on_fast->load(), 9);
+    EXPECT_EQ(stats.stolen, 4U);
+}
+
+TEST(AsyncTaskGroup, ConcurrentAddAndAwait) {
+    using namespace cfgo;
+    auto pool = std::make_shared<asio::thread_pool>(4);
+    for (int round = 0; round < 200; round++)
+    {
+        close_chan closer {};
+        // unlimited, so the adding thread and a completing task can both hold a slot for the same queued task.
+        AsyncTaskGroup::Configure conf {
+            .max_in_flight = 0,
+            .executors = { pool->get_executor(), pool->get_executor() },
+        };
+        AsyncTaskGroup group {conf, closer};
+        auto done = std::make_shared<std::atomic_int>(0);
+        auto task = fix_async_lambda([done](close_chan closer) -> asio::awaitable<void> {
+            ++(*done);
+            co_return;
+        });
+        group.add_task(task);
+        auto first = asio::co_spawn(pool->get_executor(), fix_async_lambda([group]() -> asio::awaitable<void> {
+            co_await group.await();
+        }), asio::use_future);
+        // the adds race with the dispatches of the completing tasks on the pool.
+        for (int i = 0; i < 16; i++)
+        {
+            group.add_task(task);
+        }
+        bool finished = first.wait_for(std::chrono::seconds {5}) == std::future_status::ready;
+        if (finished)
+        {
+            // the first await may return between two adds, the last one covers the rest.
+            auto last = asio::co_spawn(pool->get_executor(), fix_async_lambda([group]() -> asio::awaitable<void> {
+                co_await group.await();
+            }), asio::use_future);
+            finished = last.wait_for(std::chrono::seconds {5}) == std::future_status::ready;
+        }
+        if (!finished)
+        {
+            // unblock the lost waiters before failing.
+            closer.close_no_except();
+        }
+        ASSERT_TRUE(finished) << "round " << round;
+        EXPECT_EQ(done->load(), 17);
+    }
+}
+
+TEST(MpmcChan, ReadWrite) {
+    using namespace cfgo;
+    auto pool = std::make_shared<asio::thread_pool>(4);
+    auto chan = std::make_shared<MpmcChan<int>>(8);
+    auto sum = std::make_shared<std::atomic_int>(0);
+    constexpr int producers = 4;
+    constexpr int n = 1000;
+    for (int p = 0; p < producers; p++)
+    {
+        asio::co_spawn(pool->get_executor(), fix_async_lambda([chan]() -> asio::awaitable<void> {
+            for (int i = 1; i <= n; i++)
+            {
+                auto res = co_await chan->write(std::move(i));
+                EXPECT_TRUE(res);
+            }
+        }), asio::detached);
+    }
+    do_async(fix_async_lambda([chan, sum]() -> asio::awaitable<void> {
+        int received = 0;
+        while (received < producers * n)
+        {
+            auto values = co_await chan->read_n(16);
+            EXPECT_FALSE(values.empty());
+            EXPECT_LE(values.size(), 16);
+            for (auto v : values)
+            {
+                *sum += v;
+            }
+            received += values.size();
+        }
+        chan->close();
+        auto res = co_await chan->read();
+        EXPECT_FALSE(res);
+    }), true, pool);
+    EXPECT_EQ(sum->load(), producers * n * (n + 1) / 2);
+    EXPECT_FALSE(chan->try_write(1));
+    auto dropped = std::make_shared<MpmcChan<int>>(2);
+    EXPECT_FALSE(dropped->force_write(1));
+    EXPECT_FALSE(dropped->force_write(2));
+    EXPECT_EQ(dropped->force_write(3), std::optional<int>(1));
+}
+
+TEST(Metrics, ExportText) {
+    using namespace cfgo;
+    auto & registry = metrics::Registry::instance();
+    metrics::Labels labels { .client = "c1", .track = "t\"1", .category = "rtp" };
+    auto counter = registry.counter("test_metrics_packets_total", "The test packets.", labels);
+    counter->inc(3);
+    EXPECT_EQ(registry.counter("test_metrics_packets_total", "The test packets.", labels), counter);
+    EXPECT_THROW(std::ignore = registry.gauge("test_metrics_packets_total", "The test packets.", labels), cpptrace::logic_error);
+    EXPECT_THROW(std::ignore = registry.gauge("test metrics", "Bad name."), cpptrace::logic_error);
+    auto histogram = registry.histogram("test_metrics_latency_seconds", "The test latency.");
+    histogram->record(std::chrono::microseconds {3});
+    auto text = registry.export_text();
+    EXPECT_NE(text.find("# TYPE test_metrics_packets_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_packets_total{client=\"c1\",track=\"t\\\"1\",category=\"rtp\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_latency_seconds_bucket{le=\"1e-06\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_latency_seconds_bucket{le=\"4e-06\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_latency_seconds_count 1\n"), std::string::npos);
+    counter.reset();
+    text = registry.export_text();
+    EXPECT_EQ(text.find("test_metrics_packets_total"), std::string::npos);
+}
+
+TEST(Log, DefaultLoggerLevel) {
+    using namespace cfgo;
+    auto logger = Log::instance().default_logger();
+    auto old_level = logger->level();
+    logger->set_level(LogLevel::trace);
+    EXPECT_TRUE(Log::should_log(LogLevel::trace));
+    logger->set_level(LogLevel::warn);
+    EXPECT_FALSE(Log::should_log(LogLevel::info));
+    EXPECT_TRUE(Log::should_log(LogLevel::err));
+    logger->set_level(old_level);
+}
+
+TEST(Log, ReplaceDefaultLogger) {
+    using namespace cfgo;
+    const auto & log = Log::instance();
+    std::atomic_bool stop {false};
+    // the replaced default loggers must stay readable by the lock free check.
+    std::thread reader([&stop]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            std::ignore = Log::should_log(LogLevel::critical);
+        }
+    });
+    for (int i = 0; i < 100; ++i)
+    {
+        log.set_async_backend(nullptr);
+    }
+    stop = true;
+    reader.join();
+    EXPECT_TRUE(Log::should_log(LogLevel::critical));
+    EXPECT_EQ(Log::should_log(LogLevel::trace), log.default_logger()->should_log(LogLevel::trace));
+}
+
+// the info logs are compiled out below this level.
+#if CFGO_ACTIVE_LEVEL <= CFGO_LEVEL_INFO
+TEST(Log, AsyncBackend) {
+    using namespace cfgo;
+    std::ostringstream oss;
+    AsyncLogBackend backend(AsyncLogBackend::Configure { .capacity = 16, .record_size = 16, .block_when_full = true });
+    auto logger = std::make_shared<spdlog::logger>("async", backend.wrap(std::make_shared<spdlog::sinks::ostream_sink_mt>(oss)));
+    logger->set_pattern("%n %v");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([logger, t]() {
+            for (int i = 0; i < 1000; ++i)
+            {
+                CFGO_LOGGER_INFO(logger, "thread {} message {} longer than the record", t, i);
+            }
+        });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+    logger->flush();
+    auto text = oss.str();
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 4000);
+    EXPECT_NE(text.find("async thread 3 message 999 longer than the record\n"), std::string::npos);
+}
+#endif
+
+TEST(EventTrace, Dump) {
+    using namespace cfgo;
+    int object = 0;
+    event_trace::start();
+    {
+        event_trace::Span span(event_trace::Event::SUBSCRIBE, &object, 7);
+        event_trace::record(event_trace::Event::PACKET_INGEST, event_trace::Phase::INSTANT, &object, 1200);
+    }
+    event_trace::stop();
+    event_trace::record(event_trace::Event::PACKET_INGEST, event_trace::Phase::INSTANT, &object, 1300);
+    std::ostringstream oss;
+    event_trace::dump(oss);
+    auto text = oss.str();
+    EXPECT_EQ(text.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+    EXPECT_NE(text.find("\"name\":\"subscribe\",\"cat\":\"subscribe\",\"ph\":\"b\""), std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"subscribe\",\"cat\":\"subscribe\",\"ph\":\"e\""), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"arg\":1200}"), std::string::npos);
+    EXPECT_EQ(text.find("\"args\":{\"arg\":1300}"), std::string::npos);
+}
+
+TEST(Track, Inject) {
+    using namespace cfgo;
+    Track track {sio::object_message::create(), 4};
+    track.prepare_injected();
+    rtc::binary packet(1200, std::byte {0});
+    packet[0] = std::byte {0x80};
+    packet[1] = std::byte {96};
+    for (int i = 0; i < 6; ++i)
+    {
+        track.inject_msg(packet);
+    }
+    EXPECT_EQ(track.get_rtp_receives_packets(), 6);
+    EXPECT_EQ(track.get_rtp_drops_packets(), 2);
+    track.close_injected();
+    int received = 0;
+    asio::io_context ctx {};
+    asio::co_spawn(ctx, fix_async_lambda([track, &received]() -> asio::awaitable<void> {
+        while (co_await track.await_msg(Track::MsgType::RTP))
+        {
+            ++received;
+        }
+    }), asio::detached);
+    ctx.run();
+    EXPECT_EQ(received, 4);
+}
+
+TEST(RtpCapture, RecordAndReplay) {
+    using namespace cfgo;
+    for (auto format : {RtpRecorder::RTPDUMP, RtpRecorder::PCAPNG})
+    {
+        auto path = (std::filesystem::temp_directory_path() / (format == RtpRecorder::RTPDUMP ? "cfgo-test.rtpdump" : "cfgo-test.pcapng")).string();
+        DEFER({
+            std::filesystem::remove(path);
+        });
+        Track source {sio::object_message::create(), 64};
+        source.prepare_injected();
+        {
+            RtpRecorder recorder {RtpRecorder::Configure {.path = path, .format = format}};
+            source.set_recorder(recorder);
+            for (int i = 0; i < 10; ++i)
+            {
+                rtc::binary packet(100 + i, std::byte {0});
+                packet[0] = std::byte {0x80};
+                packet[1] = std::byte {96};
+                packet[3] = std::byte (i);
+                source.inject_msg(std::move(packet));
+            }
+            source.unset_recorder();
+            recorder.flush();
+            EXPECT_EQ(recorder.recorded(), 10);
+            EXPECT_EQ(recorder.dropped(), 0);
+        }
+        auto packets = load_rtp_capture(path);
+        ASSERT_EQ(packets.size(), 10);
+        EXPECT_EQ(packets[9].data.size(), 109);
+        EXPECT_EQ(packets[9].data[3], std::byte {9});
+        Track target {sio::object_message::create(), 64};
+        target.prepare_injected();
+        asio::io_context ctx {};
+        auto replayed = asio::co_spawn(ctx, replay_rtp_capture(std::move(packets), target, 0), asio::use_future);
+        ctx.run();
+        EXPECT_EQ(replayed.get(), 10);
+        EXPECT_EQ(target.get_rtp_receives_packets(), 10);
+        auto first = target.receive_msg(Track::MsgType::RTP);
+        ASSERT_TRUE(first);
+        EXPECT_EQ((*first)[3], std::byte {0});
+    }
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     // cfgo::Log::instance().set_level(cfgo::Log::DEFAULT, spdlog::level::trace);
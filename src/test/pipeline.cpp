@@ -0,0 +1,267 @@
+#include "cfgo/async.hpp"
+#include "cfgo/gst/gst.hpp"
+#include "asio.hpp"
+#include "gtest/gtest.h"
+#include "gst/gst.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+#include <string>
+#include <exception>
+
+template<typename T>
+T run_sync(asio::thread_pool & pool, std::function<asio::awaitable<T>()> func)
+{
+    return asio::co_spawn(pool.get_executor(), func, asio::use_future).get();
+}
+
+static void post_application(cfgo::gst::Pipeline & pipeline, const std::string & node, const char * name)
+{
+    auto element = pipeline.require_node(node);
+    gst_element_post_message(element.get(), gst_message_new_application(GST_OBJECT(element.get()), gst_structure_new_empty(name)));
+}
+
+static void post_error(cfgo::gst::Pipeline & pipeline, const std::string & node)
+{
+    auto element = pipeline.require_node(node);
+    GError * err = g_error_new_literal(GST_CORE_ERROR, GST_CORE_ERROR_FAILED, "posted by the test");
+    gst_element_post_message(element.get(), gst_message_new_error(GST_OBJECT(element.get()), err, nullptr));
+    g_error_free(err);
+}
+
+static const char * structure_name(const cfgo::GstMessageSPtr & msg)
+{
+    return gst_structure_get_name(gst_message_get_structure(msg.get()));
+}
+
+TEST(Pipeline, BridgeKeepsOrderOfQueuedMessages) {
+    using namespace cfgo;
+    asio::thread_pool pool(2);
+    gst::Pipeline pipeline("bridge_order");
+    pipeline.add_node("sink", "fakesink");
+    // posted before the bridge exists, kept by the bus.
+    post_application(pipeline, "sink", "first");
+    post_application(pipeline, "sink", "second");
+    auto first = run_sync<GstMessageSPtr>(pool, [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(GST_MESSAGE_APPLICATION, make_timeout(std::chrono::seconds{5}));
+    });
+    // posted after the bridge exists, forwarded by the sync handler.
+    post_application(pipeline, "sink", "third");
+    auto second = run_sync<GstMessageSPtr>(pool, [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(GST_MESSAGE_APPLICATION, make_timeout(std::chrono::seconds{5}));
+    });
+    auto third = run_sync<GstMessageSPtr>(pool, [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(GST_MESSAGE_APPLICATION, make_timeout(std::chrono::seconds{5}));
+    });
+    ASSERT_TRUE(first && second && third);
+    EXPECT_STREQ(structure_name(first), "first");
+    EXPECT_STREQ(structure_name(second), "second");
+    EXPECT_STREQ(structure_name(third), "third");
+    EXPECT_EQ(pipeline.message_statistics().queued, 0U);
+}
+
+TEST(Pipeline, MaskFiltersAtTheSource) {
+    using namespace cfgo;
+    gst::Pipeline pipeline("mask");
+    pipeline.add_node("sink", "fakesink");
+    pipeline.set_message_mask(GST_MESSAGE_WARNING);
+    EXPECT_NE(pipeline.message_mask() & GST_MESSAGE_EOS, 0);
+    EXPECT_NE(pipeline.message_mask() & GST_MESSAGE_ERROR, 0);
+    EXPECT_EQ(pipeline.message_mask() & GST_MESSAGE_APPLICATION, 0);
+    pipeline.run();
+    post_application(pipeline, "sink", "filtered");
+    auto stats = pipeline.message_statistics();
+    EXPECT_GE(stats.filtered, 1U);
+    EXPECT_EQ(stats.queued, 0U);
+}
+
+TEST(Pipeline, EosSurvivesTypedAwait) {
+    using namespace cfgo;
+    asio::thread_pool pool(2);
+    gst::Pipeline pipeline("eos_typed");
+    pipeline.add_node("src", "fakesrc");
+    pipeline.add_node("sink", "fakesink");
+    g_object_set(pipeline.require_node("src").get(), "num-buffers", 1, nullptr);
+    ASSERT_TRUE(pipeline.link("src", "sink"));
+    pipeline.run();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (pipeline.message_statistics().queued == 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_GT(pipeline.message_statistics().queued, 0U);
+    // nothing of this type is posted, the queued eos must not be consumed by it.
+    auto msg = run_sync<GstMessageSPtr>(pool, [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(GST_MESSAGE_APPLICATION, make_timeout(std::chrono::milliseconds{200}));
+    });
+    EXPECT_FALSE(msg);
+    auto eos = run_sync<bool>(pool, [&pipeline]() -> asio::awaitable<bool> {
+        close_chan closer = make_timeout(std::chrono::seconds{5});
+        co_return co_await pipeline.await(closer);
+    });
+    EXPECT_TRUE(eos);
+}
+
+TEST(Pipeline, ErrorSurvivesTypedAwait) {
+    using namespace cfgo;
+    asio::thread_pool pool(2);
+    gst::Pipeline pipeline("error_typed");
+    pipeline.add_node("sink", "fakesink");
+    pipeline.set_message_mask(GST_MESSAGE_APPLICATION);
+    pipeline.run();
+    post_error(pipeline, "sink");
+    post_application(pipeline, "sink", "after_error");
+    auto msg = run_sync<GstMessageSPtr>(pool, [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(GST_MESSAGE_APPLICATION, make_timeout(std::chrono::seconds{5}));
+    });
+    ASSERT_TRUE(msg);
+    EXPECT_STREQ(structure_name(msg), "after_error");
+    EXPECT_THROW(run_sync<bool>(pool, [&pipeline]() -> asio::awaitable<bool> {
+        close_chan closer = make_timeout(std::chrono::seconds{5});
+        co_return co_await pipeline.await(closer);
+    }), std::exception);
+}
+
+TEST(Pipeline, CriticalMessageWakesBlockedReader) {
+    using namespace cfgo;
+    asio::thread_pool pool(2);
+    gst::Pipeline pipeline("critical_wake");
+    pipeline.add_node("src", "fakesrc");
+    pipeline.add_node("sink", "fakesink");
+    g_object_set(pipeline.require_node("src").get(), "num-buffers", 1, nullptr);
+    ASSERT_TRUE(pipeline.link("src", "sink"));
+    // blocked on the queue of the other types when the eos arrives.
+    auto res = asio::co_spawn(pool.get_executor(), [&pipeline]() -> asio::awaitable<GstMessageSPtr> {
+        co_return co_await pipeline.await_message(static_cast<GstMessageType>(GST_MESSAGE_APPLICATION | GST_MESSAGE_EOS), make_timeout(std::chrono::seconds{5}));
+    }, asio::use_future);
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    pipeline.run();
+    ASSERT_EQ(res.wait_for(std::chrono::seconds{5}), std::future_status::ready);
+    auto msg = res.get();
+    ASSERT_TRUE(msg);
+    EXPECT_EQ(GST_MESSAGE_TYPE(msg.get()), GST_MESSAGE_EOS);
+}
+
+TEST(Pipeline, CriticalMessagesAreNeverDropped) {
+    using namespace cfgo;
+    asio::thread_pool pool(2);
+    gst::Pipeline pipeline("overflow", nullptr, 1);
+    pipeline.add_node("sink", "fakesink");
+    pipeline.set_message_mask(GST_MESSAGE_APPLICATION);
+    pipeline.run();
+    post_application(pipeline, "sink", "kept");
+    post_application(pipeline, "sink", "dropped");
+    post_error(pipeline, "sink");
+    auto stats = pipeline.message_statistics();
+    EXPECT_EQ(stats.overflows, 1U);
+    EXPECT_EQ(stats.queued, 2U);
+    EXPECT_THROW(run_sync<bool>(pool, [&pipeline]() -> asio::awaitable<bool> {
+        close_chan closer = make_timeout(std::chrono::seconds{5});
+        co_return co_await pipeline.await(closer);
+    }), std::exception);
+}
+
+static void add_appsink_graph(cfgo::gst::Pipeline & pipeline)
+{
+    // the appsink graph of test-gst on the cpu.
+    pipeline.add_node("src", "videotestsrc");
+    pipeline.add_node("convert", "videoconvert");
+    pipeline.add_node("capsfilter", "capsfilter");
+    auto target_caps = gst_caps_from_string("video/x-raw, format = (string) { RGB }, width = (int) 224, height = (int) 224");
+    g_object_set(pipeline.require_node("capsfilter").get(), "caps", target_caps, nullptr);
+    gst_caps_unref(target_caps);
+    pipeline.add_node("appsink", "appsink");
+    g_object_set(pipeline.require_node("appsink").get(), "max-buffers", 1, "drop", TRUE, "sync", FALSE, nullptr);
+    ASSERT_TRUE(pipeline.link("src", "convert"));
+    ASSERT_TRUE(pipeline.link("convert", "capsfilter"));
+    ASSERT_TRUE(pipeline.link("capsfilter", "appsink"));
+}
+
+// the tracer refs the element while tracing it, the bin and the returned node hold the rest.
+static void expect_untraced(cfgo::gst::Pipeline & pipeline, const std::string & name)
+{
+    auto node = pipeline.require_node(name);
+    EXPECT_EQ(GST_OBJECT_REFCOUNT_VALUE(node.get()), 2) << name;
+}
+
+TEST(Tracer, MeasureAppsinkGraph) {
+    using namespace cfgo;
+    gst::Pipeline pipeline("tracer");
+    add_appsink_graph(pipeline);
+    auto tracer = pipeline.enable_tracer();
+    ASSERT_TRUE(tracer);
+    pipeline.run();
+    gst::ElementTracer::Snapshot snapshot {};
+    auto find = [&snapshot](const std::string & path) -> const gst::ElementTracer::ElementSnapshot * {
+        auto iter = std::find_if(snapshot.elements.begin(), snapshot.elements.end(), [&path](auto && e) {
+            return e.path == path;
+        });
+        return iter != snapshot.elements.end() ? &*iter : nullptr;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        snapshot = tracer.snapshot();
+        auto convert = find("/tracer/convert");
+        if (convert && convert->buffers > 0 && convert->latency.count > 0)
+        {
+            break;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    ASSERT_EQ(snapshot.elements.size(), 4U);
+    for (auto && path : {"/tracer/src", "/tracer/convert", "/tracer/capsfilter"})
+    {
+        auto element = find(path);
+        ASSERT_TRUE(element) << path;
+        EXPECT_GT(element->buffers, 0U) << path;
+        EXPECT_GT(element->bytes, 0U) << path;
+    }
+    EXPECT_GT(find("/tracer/convert")->latency.count, 0U);
+    EXPECT_EQ(find("/tracer/convert")->factory, "videoconvert");
+    EXPECT_EQ(find("/tracer/src")->queue_buffers, -1);
+    pipeline.stop();
+    pipeline.disable_tracer();
+    EXPECT_FALSE(pipeline.tracer());
+    for (auto && name : {"src", "convert", "capsfilter", "appsink"})
+    {
+        expect_untraced(pipeline, name);
+    }
+}
+
+TEST(Tracer, StopWhileElementsAreAdded) {
+    using namespace cfgo;
+    for (int round = 0; round < 20; ++round)
+    {
+        gst::Pipeline pipeline("tracer_stop");
+        std::ignore = pipeline.enable_tracer();
+        std::vector<std::string> names {};
+        for (int i = 0; i < 32; ++i)
+        {
+            names.push_back("queue" + std::to_string(i));
+        }
+        // the tracer is stopped while add_element is installing the probes of the new elements.
+        std::thread adder([&pipeline, &names]() {
+            for (auto && name : names)
+            {
+                pipeline.add_node(name, "queue");
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds{round * 50});
+        pipeline.disable_tracer();
+        adder.join();
+        for (auto && name : names)
+        {
+            expect_untraced(pipeline, name);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    gst_init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
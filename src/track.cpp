@@ -47,6 +47,25 @@ namespace cfgo
     Track::MsgPtr Track::receive_msg(MsgType msg_type) const {
         return impl()->receive_msg(msg_type);
     }
+    auto Track::await_timed_msg(MsgType msg_type, const close_chan &  close_ch) const -> asio::awaitable<TimedMsg>
+    {
+        return impl()->await_timed_msg(msg_type, close_ch);
+    }
+    Track::TimedMsg Track::receive_timed_msg(MsgType msg_type) const {
+        return impl()->receive_timed_msg(msg_type);
+    }
+    void Track::prepare_injected() const {
+        impl()->prepare_injected();
+    }
+    void Track::inject_msg(rtc::binary data) const {
+        impl()->on_track_msg(std::move(data));
+    }
+    void Track::close_injected() const {
+        impl()->on_track_closed();
+    }
+    const std::shared_ptr<TrackLatency> & Track::latency() const noexcept {
+        return impl()->m_latency;
+    }
     void * Track::get_gst_caps(int pt) const
     {
         return impl()->get_gst_caps(pt);
@@ -75,6 +94,14 @@ namespace cfgo
     {
         impl()->unset_on_stat();
     }
+    void Track::set_recorder(RtpRecorder recorder) const
+    {
+        impl()->set_recorder(std::move(recorder));
+    }
+    void Track::unset_recorder() const noexcept
+    {
+        impl()->unset_recorder();
+    }
     std::uint64_t Track::get_rtp_drops_bytes() const noexcept
     {
         return impl()->get_rtp_drops_bytes();